@@ -49,6 +49,9 @@ struct gnutls_privkey_st
 
   unsigned int flags;
   struct pin_info_st pin;
+
+  /* backend structures for the X.509 key, or NULL */
+  void *prepared;
 };
 
 struct gnutls_pubkey_st
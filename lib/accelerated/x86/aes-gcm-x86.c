@@ -73,6 +73,26 @@ aes_gcm_deinit (void *_ctx)
   gnutls_free (_ctx);
 }
 
+static int
+aes_gcm_copy (void **_dst, const void *_src)
+{
+  const struct aes_gcm_ctx *src = _src;
+  struct aes_gcm_ctx *dst;
+
+  dst = gnutls_calloc (1, sizeof (*dst));
+  if (dst == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  /* the expanded key may sit at a different offset in the new
+   * allocation, so copy it between the aligned positions */
+  memcpy (ALIGN16 (&dst->expanded_key), ALIGN16 (&src->expanded_key),
+          sizeof (AES_KEY) - AES_KEY_ALIGN_SIZE * sizeof (uint32_t));
+  memcpy (&dst->gcm, &src->gcm, sizeof (dst->gcm));
+
+  *_dst = dst;
+  return 0;
+}
+
 static int
 aes_gcm_cipher_init (gnutls_cipher_algorithm_t algorithm, void **_ctx, int enc)
 {
@@ -265,6 +285,7 @@ const gnutls_crypto_cipher_st aes_gcm_struct = {
   .encrypt = aes_gcm_encrypt,
   .decrypt = aes_gcm_decrypt,
   .deinit = aes_gcm_deinit,
+  .copy = aes_gcm_copy,
   .tag = aes_gcm_tag,
   .auth = aes_gcm_auth,
 };
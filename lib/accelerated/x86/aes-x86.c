@@ -113,6 +113,27 @@ aes_deinit (void *_ctx)
   gnutls_free (_ctx);
 }
 
+static int
+aes_copy (void **_dst, const void *_src)
+{
+  const struct aes_ctx *src = _src;
+  struct aes_ctx *dst;
+
+  dst = gnutls_calloc (1, sizeof (*dst));
+  if (dst == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  /* the expanded key may sit at a different offset in the new
+   * allocation, so copy it between the aligned positions */
+  memcpy (ALIGN16 (&dst->expanded_key), ALIGN16 (&src->expanded_key),
+          sizeof (AES_KEY) - AES_KEY_ALIGN_SIZE * sizeof (uint32_t));
+  memcpy (dst->iv, src->iv, sizeof (dst->iv));
+  dst->enc = src->enc;
+
+  *_dst = dst;
+  return 0;
+}
+
 static const gnutls_crypto_cipher_st cipher_struct = {
   .init = aes_cipher_init,
   .setkey = aes_cipher_setkey,
@@ -120,6 +141,7 @@ static const gnutls_crypto_cipher_st cipher_struct = {
   .encrypt = aes_encrypt,
   .decrypt = aes_decrypt,
   .deinit = aes_deinit,
+  .copy = aes_copy,
 };
 
 static unsigned
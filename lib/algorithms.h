@@ -58,7 +58,23 @@ const char *_gnutls_x509_digest_to_oid (gnutls_digest_algorithm_t algorithm);
 const char *_gnutls_digest_get_name (gnutls_digest_algorithm_t algorithm);
 int _gnutls_digest_is_secure (gnutls_digest_algorithm_t algorithm);
 
+/* Size of the direct indices of the algorithm tables; algorithm
+ * values beyond it are looked up by scanning the table.
+ */
+#define ALGO_INDEX_SIZE 256
+
+void _gnutls_algorithms_init (void);
+void _gnutls_cipher_index_init (void);
+void _gnutls_hash_index_init (void);
+void _gnutls_kx_index_init (void);
+void _gnutls_sign_index_init (void);
+void _gnutls_pk_map_index_init (void);
+
 /* Functions for cipher suites. */
+void _gnutls_priority_compile_suites (gnutls_priority_t priority);
+int _gnutls_priority_suite_rank (gnutls_session_t session,
+                                 const uint8_t suite[2],
+                                 gnutls_kx_algorithm_t * kx);
 int _gnutls_supported_ciphersuites (gnutls_session_t session,
                                     uint8_t* cipher_suites, 
                                     unsigned int max_cipher_suite_size);
@@ -88,8 +88,40 @@ static const gnutls_cipher_entry algorithms[] = {
         const gnutls_cipher_entry *p; \
                 for(p = algorithms; p->name != NULL; p++) { b ; }
 
+/* The position of each algorithm in the table plus one; see
+ * _gnutls_algorithms_init(). */
+static uint8_t cipher_index[ALGO_INDEX_SIZE];
+static unsigned int cipher_index_ready = 0;
+
+void
+_gnutls_cipher_index_init (void)
+{
+  GNUTLS_CIPHER_LOOP (
+    if ((unsigned) p->id < ALGO_INDEX_SIZE && cipher_index[p->id] == 0)
+      cipher_index[p->id] = p - algorithms + 1;
+  );
+  cipher_index_ready = 1;
+}
+
+static const gnutls_cipher_entry *
+cipher_to_entry (gnutls_cipher_algorithm_t algorithm)
+{
+  if (cipher_index_ready && (unsigned) algorithm < ALGO_INDEX_SIZE)
+    {
+      if (cipher_index[algorithm] == 0)
+        return NULL;
+      return &algorithms[cipher_index[algorithm] - 1];
+    }
+
+  GNUTLS_CIPHER_LOOP (if (p->id == algorithm) return p);
+  return NULL;
+}
+
 #define GNUTLS_ALG_LOOP(a) \
-                        GNUTLS_CIPHER_LOOP( if(p->id == algorithm) { a; break; } )
+        do { \
+          const gnutls_cipher_entry *p = cipher_to_entry (algorithm); \
+          if (p != NULL) { a; } \
+        } while (0)
 
 /* CIPHER functions */
 
@@ -118,9 +150,9 @@ _gnutls_cipher_priority (gnutls_session_t session,
                          gnutls_cipher_algorithm_t algorithm)
 {
   unsigned int i;
-  for (i = 0; i < session->internals.priorities.cipher.algorithms; i++)
+  for (i = 0; i < session->internals.priorities->cipher.algorithms; i++)
     {
-      if (session->internals.priorities.cipher.priority[i] == algorithm)
+      if (session->internals.priorities->cipher.priority[i] == algorithm)
         return i;
     }
   return -1;
@@ -626,8 +626,73 @@ static const gnutls_cipher_suite_entry cs_algorithms[] = {
         const gnutls_cipher_suite_entry *p; \
                 for(p = cs_algorithms; p->name != NULL; p++) { b ; }
 
+/* The position of the suites in the table plus one, for the IDs
+ * {0x00, x} in the first row and {0xC0, x} in the second; the table
+ * has no other IDs. See _gnutls_algorithms_init().
+ */
+static uint8_t cs_index[2][256];
+static unsigned int cs_index_ready = 0;
+
+#define CS_INDEX_ROW(id) ((id)[0] == 0x00 ? 0 : ((id)[0] == 0xC0 ? 1 : -1))
+
+static void
+cipher_suite_index_init (void)
+{
+  int row;
+
+  CIPHER_SUITE_LOOP (
+    row = CS_INDEX_ROW (p->id);
+    if (row < 0 || p - cs_algorithms >= 255)
+      return;                   /* leave the table unindexed */
+    if (cs_index[row][p->id[1]] == 0)
+      cs_index[row][p->id[1]] = p - cs_algorithms + 1;
+  );
+  cs_index_ready = 1;
+}
+
+static const gnutls_cipher_suite_entry *
+cipher_suite_get_by_id (const uint8_t suite[2])
+{
+  int row;
+
+  if (cs_index_ready)
+    {
+      row = CS_INDEX_ROW (suite);
+      if (row < 0 || cs_index[row][suite[1]] == 0)
+        return NULL;
+      return &cs_algorithms[cs_index[row][suite[1]] - 1];
+    }
+
+  CIPHER_SUITE_LOOP (
+    if (p->id[0] == suite[0] && p->id[1] == suite[1])
+      return p;
+  );
+  return NULL;
+}
+
 #define CIPHER_SUITE_ALG_LOOP(a) \
-        CIPHER_SUITE_LOOP( if( (p->id[0] == suite[0]) && (p->id[1] == suite[1])) { a; break; } )
+        do { \
+          const gnutls_cipher_suite_entry *p = cipher_suite_get_by_id (suite); \
+          if (p != NULL) { a; } \
+        } while (0)
+
+/*-
+ * _gnutls_algorithms_init:
+ *
+ * Builds the direct indices of the algorithm and cipher suite tables,
+ * which replace the linear scans of the lookup functions. Called by
+ * gnutls_global_init(); the tables are scanned until then.
+ -*/
+void
+_gnutls_algorithms_init (void)
+{
+  _gnutls_cipher_index_init ();
+  _gnutls_hash_index_init ();
+  _gnutls_kx_index_init ();
+  _gnutls_sign_index_init ();
+  _gnutls_pk_map_index_init ();
+  cipher_suite_index_init ();
+}
 
 
 /* Cipher Suite's functions */
@@ -814,6 +879,103 @@ _gnutls_cipher_suite_is_ok (const uint8_t suite[2])
 
 }
 
+/* The position of a suite in the index of the compiled priorities;
+ * Fibonacci hashing of the 16-bit ID. */
+#define SUITE_INDEX_SLOT(id) \
+        (((((id)[0] << 8 | (id)[1]) * 40503U & 0xffff) * \
+          PRIORITY_SUITE_INDEX_SIZE) >> 16)
+
+/*-
+ * _gnutls_priority_compile_suites:
+ * @priority: the priorities
+ *
+ * Computes the list of the cipher suites enabled by the kx, cipher
+ * and mac priorities, sorted by order of preference, and the index
+ * used by _gnutls_priority_suite_rank(). Must be called whenever one
+ * of these priorities changes.
+ -*/
+void
+_gnutls_priority_compile_suites (gnutls_priority_t priority)
+{
+  unsigned int i, j, z, slot;
+  const gnutls_cipher_suite_entry * ce;
+
+  priority->suites_size = 0;
+  memset (priority->suite_index, 0, sizeof (priority->suite_index));
+
+  for (i = 0; i < priority->kx.algorithms; i++)
+    for (j = 0; j < priority->cipher.algorithms; j++)
+      for (z = 0; z < priority->mac.algorithms; z++)
+        {
+          ce = cipher_suite_get(priority->kx.priority[i],
+                                priority->cipher.priority[j],
+                                priority->mac.priority[z]);
+
+          if (ce == NULL)
+            continue;
+
+          /* the priority lists may contain duplicates */
+          for (slot = SUITE_INDEX_SLOT (ce->id);
+               priority->suite_index[slot] != 0;
+               slot = (slot + 1) % PRIORITY_SUITE_INDEX_SIZE)
+            {
+              if (&cs_algorithms[priority->suites[priority->suite_index[slot]-1]] == ce)
+                break;
+            }
+
+          if (priority->suite_index[slot] != 0 ||
+              priority->suites_size >= MAX_PRIORITY_SUITES)
+            continue;
+
+          priority->suites[priority->suites_size] = ce - cs_algorithms;
+          priority->suite_index[slot] = ++priority->suites_size;
+        }
+}
+
+/*-
+ * _gnutls_priority_suite_rank:
+ * @session: a TLS session
+ * @suite: a cipher suite ID
+ * @kx: where the key exchange algorithm of the suite will be stored
+ *
+ * Looks up a cipher suite in the session's priorities.
+ *
+ * Returns the position of @suite in the order of preference of the
+ * session, or -1 if it is not enabled or cannot be used with the
+ * negotiated protocol version.
+ -*/
+int
+_gnutls_priority_suite_rank (gnutls_session_t session,
+                             const uint8_t suite[2],
+                             gnutls_kx_algorithm_t * kx)
+{
+  const gnutls_priority_t priority = session->internals.priorities;
+  const gnutls_cipher_suite_entry * ce;
+  unsigned int slot, rank;
+  unsigned int version = gnutls_protocol_get_version(session);
+
+  for (slot = SUITE_INDEX_SLOT (suite); priority->suite_index[slot] != 0;
+       slot = (slot + 1) % PRIORITY_SUITE_INDEX_SIZE)
+    {
+      rank = priority->suite_index[slot] - 1;
+      ce = &cs_algorithms[priority->suites[rank]];
+
+      if (ce->id[0] != suite[0] || ce->id[1] != suite[1])
+        continue;
+
+      if (!(version >= ce->min_version && version <= ce->max_version))
+        return -1;
+
+      if (IS_DTLS(session) && ce->dtls==0)
+        return -1;
+
+      *kx = ce->kx_algorithm;
+      return rank;
+    }
+
+  return -1;
+}
+
 /*-
  * _gnutls_supported_ciphersuites: 
  * @session: a TLS session
@@ -831,32 +993,27 @@ _gnutls_supported_ciphersuites (gnutls_session_t session,
                                 uint8_t *cipher_suites, unsigned int max_cipher_suite_size)
 {
 
-  unsigned int i, ret_count, j, z, k=0;
+  unsigned int i, ret_count, k=0;
   const gnutls_cipher_suite_entry * ce;
+  const gnutls_priority_t priority = session->internals.priorities;
   unsigned int version = gnutls_protocol_get_version( session);
 
-  for (i = 0; i < session->internals.priorities.kx.algorithms; i++)
-    for (j = 0; j < session->internals.priorities.cipher.algorithms; j++)
-      for (z = 0; z < session->internals.priorities.mac.algorithms; z++) 
-        {
-          ce = cipher_suite_get(session->internals.priorities.kx.priority[i],
-                                   session->internals.priorities.cipher.priority[j],
-                                   session->internals.priorities.mac.priority[z]);
-
-          if (ce == NULL) continue;
+  for (i = 0; i < priority->suites_size; i++)
+    {
+      ce = &cs_algorithms[priority->suites[i]];
 
-          if (!(version >= ce->min_version && version <= ce->max_version)) 
-            continue;
+      if (!(version >= ce->min_version && version <= ce->max_version)) 
+        continue;
 
-          if (IS_DTLS(session) && ce->dtls==0) 
-            continue;
+      if (IS_DTLS(session) && ce->dtls==0) 
+        continue;
 
-          if (k+2 > max_cipher_suite_size)
-            return gnutls_assert_val(GNUTLS_E_INTERNAL_ERROR);
+      if (k+2 > max_cipher_suite_size)
+        return gnutls_assert_val(GNUTLS_E_INTERNAL_ERROR);
 
-          memcpy (&cipher_suites[k], ce->id, 2);
-          k+=2;
-        }
+      memcpy (&cipher_suites[k], ce->id, 2);
+      k+=2;
+    }
 
   ret_count = k;
 
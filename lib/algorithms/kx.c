@@ -120,8 +120,65 @@ static const gnutls_kx_algo_entry _gnutls_kx_algorithms[] = {
         const gnutls_kx_algo_entry *p; \
                 for(p = _gnutls_kx_algorithms; p->name != NULL; p++) { b ; }
 
+/* The position of each algorithm in the tables plus one; see
+ * _gnutls_algorithms_init(). */
+static uint8_t kx_index[ALGO_INDEX_SIZE];
+static uint8_t cred_map_index[ALGO_INDEX_SIZE];
+static unsigned int kx_index_ready = 0;
+
+void
+_gnutls_kx_index_init (void)
+{
+  {
+    GNUTLS_KX_LOOP (
+      if ((unsigned) p->algorithm < ALGO_INDEX_SIZE &&
+          kx_index[p->algorithm] == 0)
+        kx_index[p->algorithm] = p - _gnutls_kx_algorithms + 1;
+    );
+  }
+  {
+    GNUTLS_KX_MAP_LOOP (
+      if ((unsigned) p->algorithm < ALGO_INDEX_SIZE &&
+          cred_map_index[p->algorithm] == 0)
+        cred_map_index[p->algorithm] = p - cred_mappings + 1;
+    );
+  }
+  kx_index_ready = 1;
+}
+
+static const gnutls_kx_algo_entry *
+kx_to_entry (gnutls_kx_algorithm_t algorithm)
+{
+  if (kx_index_ready && (unsigned) algorithm < ALGO_INDEX_SIZE)
+    {
+      if (kx_index[algorithm] == 0)
+        return NULL;
+      return &_gnutls_kx_algorithms[kx_index[algorithm] - 1];
+    }
+
+  GNUTLS_KX_LOOP (if (p->algorithm == algorithm) return p);
+  return NULL;
+}
+
+static const gnutls_cred_map *
+kx_to_cred_map (gnutls_kx_algorithm_t algorithm)
+{
+  if (kx_index_ready && (unsigned) algorithm < ALGO_INDEX_SIZE)
+    {
+      if (cred_map_index[algorithm] == 0)
+        return NULL;
+      return &cred_mappings[cred_map_index[algorithm] - 1];
+    }
+
+  GNUTLS_KX_MAP_LOOP (if (p->algorithm == algorithm) return p);
+  return NULL;
+}
+
 #define GNUTLS_KX_ALG_LOOP(a) \
-                        GNUTLS_KX_LOOP( if(p->algorithm == algorithm) { a; break; } )
+        do { \
+          const gnutls_kx_algo_entry *p = kx_to_entry (algorithm); \
+          if (p != NULL) { a; } \
+        } while (0)
 
 
 /* Key EXCHANGE functions */
@@ -140,9 +197,9 @@ _gnutls_kx_priority (gnutls_session_t session,
                      gnutls_kx_algorithm_t algorithm)
 {
   unsigned int i;
-  for (i = 0; i < session->internals.priorities.kx.algorithms; i++)
+  for (i = 0; i < session->internals.priorities->kx.algorithms; i++)
     {
-      if (session->internals.priorities.kx.priority[i] == algorithm)
+      if (session->internals.priorities->kx.priority[i] == algorithm)
         return i;
     }
   return -1;
@@ -271,18 +328,14 @@ _gnutls_map_kx_get_kx (gnutls_credentials_type_t type, int server)
 gnutls_credentials_type_t
 _gnutls_map_kx_get_cred (gnutls_kx_algorithm_t algorithm, int server)
 {
-  gnutls_credentials_type_t ret = -1;
+  const gnutls_cred_map *p = kx_to_cred_map (algorithm);
+
+  if (p == NULL)
+    return -1;
+
   if (server)
-    {
-      GNUTLS_KX_MAP_LOOP (if (p->algorithm == algorithm) ret =
-                          p->server_type);
-    }
+    return p->server_type;
   else
-    {
-      GNUTLS_KX_MAP_LOOP (if (p->algorithm == algorithm) ret =
-                          p->client_type);
-    }
-
-  return ret;
+    return p->client_type;
 }
 
@@ -55,17 +55,49 @@ static const gnutls_hash_entry hash_algorithms[] = {
         const gnutls_hash_entry *p; \
                 for(p = hash_algorithms; p->name != NULL; p++) { b ; }
 
+/* The position of each algorithm in the table plus one; see
+ * _gnutls_algorithms_init(). */
+static uint8_t hash_index[ALGO_INDEX_SIZE];
+static unsigned int hash_index_ready = 0;
+
+void
+_gnutls_hash_index_init (void)
+{
+  GNUTLS_HASH_LOOP (
+    if ((unsigned) p->id < ALGO_INDEX_SIZE && hash_index[p->id] == 0)
+      hash_index[p->id] = p - hash_algorithms + 1;
+  );
+  hash_index_ready = 1;
+}
+
+static const gnutls_hash_entry *
+hash_to_entry (gnutls_mac_algorithm_t algorithm)
+{
+  if (hash_index_ready && (unsigned) algorithm < ALGO_INDEX_SIZE)
+    {
+      if (hash_index[algorithm] == 0)
+        return NULL;
+      return &hash_algorithms[hash_index[algorithm] - 1];
+    }
+
+  GNUTLS_HASH_LOOP (if (p->id == algorithm) return p);
+  return NULL;
+}
+
 #define GNUTLS_HASH_ALG_LOOP(a) \
-                        GNUTLS_HASH_LOOP( if(p->id == algorithm) { a; break; } )
+        do { \
+          const gnutls_hash_entry *p = hash_to_entry (algorithm); \
+          if (p != NULL) { a; } \
+        } while (0)
 
 int
 _gnutls_mac_priority (gnutls_session_t session,
                       gnutls_mac_algorithm_t algorithm)
 {                               /* actually returns the priority */
   unsigned int i;
-  for (i = 0; i < session->internals.priorities.mac.algorithms; i++)
+  for (i = 0; i < session->internals.priorities->mac.algorithms; i++)
     {
-      if (session->internals.priorities.mac.priority[i] == algorithm)
+      if (session->internals.priorities->mac.priority[i] == algorithm)
         return i;
     }
   return -1;
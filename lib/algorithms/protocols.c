@@ -61,9 +61,9 @@ _gnutls_version_priority (gnutls_session_t session, gnutls_protocol_t version)
 {
   unsigned int i;
 
-  for (i = 0; i < session->internals.priorities.protocol.algorithms; i++)
+  for (i = 0; i < session->internals.priorities->protocol.algorithms; i++)
     {
-      if (session->internals.priorities.protocol.priority[i] == version)
+      if (session->internals.priorities->protocol.priority[i] == version)
         return i;
     }
   return -1;
@@ -77,9 +77,9 @@ _gnutls_version_lowest (gnutls_session_t session)
   unsigned int i, min = 0xff;
   gnutls_protocol_t cur_prot;
 
-  for (i = 0; i < session->internals.priorities.protocol.algorithms; i++)
+  for (i = 0; i < session->internals.priorities->protocol.algorithms; i++)
     {
-      cur_prot = session->internals.priorities.protocol.priority[i];
+      cur_prot = session->internals.priorities->protocol.priority[i];
 
       if (cur_prot < min && _gnutls_version_is_supported(session, cur_prot))
 	min = cur_prot;
@@ -99,9 +99,9 @@ _gnutls_version_max (gnutls_session_t session)
   unsigned int i, max = 0x00;
   gnutls_protocol_t cur_prot;
 
-  for (i = 0; i < session->internals.priorities.protocol.algorithms; i++)
+  for (i = 0; i < session->internals.priorities->protocol.algorithms; i++)
     {
-      cur_prot = session->internals.priorities.protocol.priority[i];
+      cur_prot = session->internals.priorities->protocol.priority[i];
 
       if (cur_prot > max && _gnutls_version_is_supported(session, cur_prot))
 	max = cur_prot;
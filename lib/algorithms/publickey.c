@@ -61,8 +61,41 @@ static const gnutls_pk_map pk_mappings[] = {
         const gnutls_pk_map *p; \
                 for(p = pk_mappings; p->kx_algorithm != 0; p++) { b }
 
+/* The position of each key exchange algorithm in the table plus one;
+ * see _gnutls_algorithms_init(). */
+static uint8_t pk_map_index[ALGO_INDEX_SIZE];
+static unsigned int pk_map_index_ready = 0;
+
+void
+_gnutls_pk_map_index_init (void)
+{
+  GNUTLS_PK_MAP_LOOP (
+    if ((unsigned) p->kx_algorithm < ALGO_INDEX_SIZE &&
+        pk_map_index[p->kx_algorithm] == 0)
+      pk_map_index[p->kx_algorithm] = p - pk_mappings + 1;
+  );
+  pk_map_index_ready = 1;
+}
+
+static const gnutls_pk_map *
+kx_to_pk_map (gnutls_kx_algorithm_t kx_algorithm)
+{
+  if (pk_map_index_ready && (unsigned) kx_algorithm < ALGO_INDEX_SIZE)
+    {
+      if (pk_map_index[kx_algorithm] == 0)
+        return NULL;
+      return &pk_mappings[pk_map_index[kx_algorithm] - 1];
+    }
+
+  GNUTLS_PK_MAP_LOOP (if (p->kx_algorithm == kx_algorithm) return p;);
+  return NULL;
+}
+
 #define GNUTLS_PK_MAP_ALG_LOOP(a) \
-                        GNUTLS_PK_MAP_LOOP( if(p->kx_algorithm == kx_algorithm) { a; break; })
+        do { \
+          const gnutls_pk_map *p = kx_to_pk_map (kx_algorithm); \
+          if (p != NULL) { a; } \
+        } while (0)
 
 
 /* returns the gnutls_pk_algorithm_t which is compatible with
@@ -73,7 +106,8 @@ _gnutls_map_pk_get_pk (gnutls_kx_algorithm_t kx_algorithm)
 {
   gnutls_pk_algorithm_t ret = -1;
 
-  GNUTLS_PK_MAP_ALG_LOOP (ret = p->pk_algorithm) return ret;
+  GNUTLS_PK_MAP_ALG_LOOP (ret = p->pk_algorithm);
+  return ret;
 }
 
 /* pk algorithms;
@@ -256,7 +290,8 @@ enum encipher_type
 _gnutls_kx_encipher_type (gnutls_kx_algorithm_t kx_algorithm)
 {
   int ret = CIPHER_IGN;
-  GNUTLS_PK_MAP_ALG_LOOP (ret = p->encipher_type) return ret;
+  GNUTLS_PK_MAP_ALG_LOOP (ret = p->encipher_type);
+  return ret;
 
 }
 
@@ -83,8 +83,41 @@ static const gnutls_sign_entry sign_algorithms[] = {
     for(p = sign_algorithms; p->name != NULL; p++) { b ; }	       \
   } while (0)
 
+/* The position of each algorithm in the table plus one; see
+ * _gnutls_algorithms_init(). */
+static uint8_t sign_index[ALGO_INDEX_SIZE];
+static unsigned int sign_index_ready = 0;
+
+void
+_gnutls_sign_index_init (void)
+{
+  GNUTLS_SIGN_LOOP (
+    if (p->id != 0 && (unsigned) p->id < ALGO_INDEX_SIZE &&
+        sign_index[p->id] == 0)
+      sign_index[p->id] = p - sign_algorithms + 1;
+  );
+  sign_index_ready = 1;
+}
+
+static const gnutls_sign_entry *
+sign_to_entry (gnutls_sign_algorithm_t sign)
+{
+  if (sign_index_ready && (unsigned) sign < ALGO_INDEX_SIZE)
+    {
+      if (sign_index[sign] == 0)
+        return NULL;
+      return &sign_algorithms[sign_index[sign] - 1];
+    }
+
+  GNUTLS_SIGN_LOOP (if (p->id && p->id == sign) return p);
+  return NULL;
+}
+
 #define GNUTLS_SIGN_ALG_LOOP(a) \
-  GNUTLS_SIGN_LOOP( if(p->id && p->id == sign) { a; break; } )
+  do {								       \
+    const gnutls_sign_entry *p = sign_to_entry (sign);		       \
+    if (p != NULL) { a; }					       \
+  } while (0)
 
 /**
  * gnutls_sign_get_name:
@@ -43,6 +43,7 @@
 #include <gnutls_x509.h>
 #include <gnutls/abstract.h>
 #include "debug.h"
+#include <gnutls_pcert_cache.h>
 
 #ifdef ENABLE_OPENPGP
 #include "openpgp/gnutls_openpgp.h"
@@ -53,8 +54,6 @@ static gnutls_pcert_st *alloc_and_load_pgp_certs (gnutls_openpgp_crt_t cert);
 
 #endif
 
-static gnutls_pcert_st *alloc_and_load_x509_certs (gnutls_x509_crt_t * certs,
-                                                   unsigned);
 static gnutls_privkey_t alloc_and_load_x509_key (gnutls_x509_privkey_t key,
                                                  int deinit);
 
@@ -69,6 +68,77 @@ typedef enum CertificateSigType
 { RSA_SIGN = 1, DSA_SIGN = 2, ECDSA_SIGN = 64
 } CertificateSigType;
 
+static void
+free_x509_crt_list (gnutls_x509_crt_t * list)
+{
+  unsigned int i;
+
+  for (i = 0; list[i] != NULL; i++)
+    gnutls_x509_crt_deinit (list[i]);
+  gnutls_free (list);
+}
+
+/* Returns the peer's X.509 certificates, parsing the raw ones
+ * only the first time.
+ */
+int
+_gnutls_get_peer_x509_crts (cert_auth_info_t info, gnutls_x509_crt_t ** crts)
+{
+  gnutls_x509_crt_t *list;
+  unsigned int i;
+  int ret;
+
+  if (info->x509_crts != NULL)
+    {
+      *crts = info->x509_crts;
+      return 0;
+    }
+
+  if (info->raw_certificate_list == NULL || info->ncerts == 0)
+    return gnutls_assert_val (GNUTLS_E_NO_CERTIFICATE_FOUND);
+
+  list = gnutls_calloc (info->ncerts + 1, sizeof (gnutls_x509_crt_t));
+  if (list == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  for (i = 0; i < info->ncerts; i++)
+    {
+      ret = gnutls_x509_crt_init (&list[i]);
+      if (ret < 0)
+        {
+          gnutls_assert ();
+          goto fail;
+        }
+
+      ret = gnutls_x509_crt_import (list[i], &info->raw_certificate_list[i],
+                                    GNUTLS_X509_FMT_DER);
+      if (ret < 0)
+        {
+          gnutls_assert ();
+          goto fail;
+        }
+    }
+
+  info->x509_crts = list;
+  *crts = list;
+
+  return 0;
+
+fail:
+  free_x509_crt_list (list);
+  return ret;
+}
+
+void
+_gnutls_free_peer_x509_crts (cert_auth_info_t info)
+{
+  if (info->x509_crts == NULL)
+    return;
+
+  free_x509_crt_list (info->x509_crts);
+  info->x509_crts = NULL;
+}
+
 /* Copies data from a internal certificate struct (gnutls_pcert_st) to 
  * exported certificate struct (cert_auth_info_t)
  */
@@ -81,6 +151,8 @@ _gnutls_copy_certificate_auth_info (cert_auth_info_t info, gnutls_pcert_st * cer
   int ret;
   size_t i, j;
 
+  _gnutls_free_peer_x509_crts (info);
+
   if (info->raw_certificate_list != NULL)
     {
       for (j = 0; j < info->ncerts; j++)
@@ -88,6 +160,11 @@ _gnutls_copy_certificate_auth_info (cert_auth_info_t info, gnutls_pcert_st * cer
       gnutls_free (info->raw_certificate_list);
     }
 
+  /* the result of verifying the previous chain, e.g., before a
+   * rehandshake, does not apply to the new one */
+  memset (&info->verify, 0, sizeof (info->verify));
+  info->chain_digest_set = 0;
+
   if (ncerts == 0)
     {
       info->raw_certificate_list = NULL;
@@ -455,6 +532,12 @@ st_to_st2 (gnutls_retr2_st * st2, gnutls_retr_st * st)
 
 }
 
+static void
+release_pcert_entry (void *entry)
+{
+  _gnutls_pcert_cache_release (entry);
+}
+
 /* Calls the client get callback.
  */
 static int
@@ -472,6 +555,7 @@ call_get_cert_callback (gnutls_session_t session,
   gnutls_retr2_st st2;
   gnutls_pcert_st *pcert = NULL;
   unsigned int pcert_length = 0;
+  pcert_cache_entry_st *cert_entry = NULL;
 
   cred = (gnutls_certificate_credentials_t)
     _gnutls_get_cred (session, GNUTLS_CRD_CERTIFICATE, NULL);
@@ -562,7 +646,15 @@ call_get_cert_callback (gnutls_session_t session,
 
   if (type == GNUTLS_CRT_X509)
     {
-      local_certs = alloc_and_load_x509_certs (st2.cert.x509, st2.ncerts);
+      /* the same certificates are usually returned on every
+       * handshake; reuse their earlier conversion */
+      ret = _gnutls_pcert_cache_get_x509 (st2.cert.x509, st2.ncerts,
+                                          &local_certs, &cert_entry);
+      if (ret < 0)
+        {
+          gnutls_assert ();
+          goto cleanup;
+        }
     }
   else
     {                           /* PGP */
@@ -641,6 +733,7 @@ call_get_cert_callback (gnutls_session_t session,
   _gnutls_selected_certs_set (session, local_certs,
                               (local_certs != NULL) ? st2.ncerts : 0,
                               local_key, 1);
+  _gnutls_selected_certs_set_ref (session, cert_entry, release_pcert_entry);
 
   ret = 0;
 
@@ -671,6 +764,7 @@ cleanup:
     {
       if (local_key != NULL)
         gnutls_privkey_deinit (local_key);
+      _gnutls_pcert_cache_release (cert_entry);
     }
 
   return ret;
@@ -775,6 +869,7 @@ _select_client_cert (gnutls_session_t session,
                                       &cred->certs[indx].cert_list[0],
                                       cred->certs[indx].cert_list_length,
                                       cred->pkey[indx], 0);
+          session->internals.selected_cert_index = indx;
         }
       else
         {
@@ -790,6 +885,76 @@ cleanup:
 
 }
 
+/* Returns the encoded body of the Certificate message for the
+ * selected certificate chain, if it was taken from the credentials
+ * and was encoded when it was added to them. The returned data belong
+ * to the credentials.
+ */
+int
+_gnutls_get_selected_cert_msg (gnutls_session_t session,
+                               gnutls_datum_t * msg)
+{
+  gnutls_certificate_credentials_t cred;
+  int idx = session->internals.selected_cert_index;
+
+  if (session->internals.selected_cert_msg != NULL
+      && session->internals.selected_cert_msg->data != NULL)
+    {
+      msg->data = session->internals.selected_cert_msg->data;
+      msg->size = session->internals.selected_cert_msg->size;
+      return 0;
+    }
+
+  if (idx < 0 || session->internals.selected_cert_list == NULL)
+    return GNUTLS_E_REQUESTED_DATA_NOT_AVAILABLE;
+
+  cred = (gnutls_certificate_credentials_t)
+    _gnutls_get_cred (session, GNUTLS_CRD_CERTIFICATE, NULL);
+  if (cred == NULL || (unsigned) idx >= cred->ncerts
+      || cred->certs[idx].cert_list != session->internals.selected_cert_list
+      || cred->certs[idx].cert_msg.data == NULL)
+    return GNUTLS_E_REQUESTED_DATA_NOT_AVAILABLE;
+
+  msg->data = cred->certs[idx].cert_msg.data;
+  msg->size = cred->certs[idx].cert_msg.size;
+
+  return 0;
+}
+
+/* Encodes the given X.509 certificate list as the body of a Certificate
+ * handshake message.
+ */
+int
+_gnutls_encode_x509_crt_msg (gnutls_pcert_st * certs, unsigned ncerts,
+                             gnutls_datum_t * msg)
+{
+  unsigned i;
+  size_t size = 3;
+  uint8_t *p;
+
+  for (i = 0; i < ncerts; i++)
+    size += certs[i].cert.size + 3;
+
+  msg->data = gnutls_malloc (size);
+  if (msg->data == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+  msg->size = size;
+
+  p = msg->data;
+  _gnutls_write_uint24 (size - 3, p);
+  p += 3;
+
+  for (i = 0; i < ncerts; i++)
+    {
+      _gnutls_write_uint24 (certs[i].cert.size, p);
+      p += 3;
+      memcpy (p, certs[i].cert.data, certs[i].cert.size);
+      p += certs[i].cert.size;
+    }
+
+  return 0;
+}
+
 /* Generate certificate message
  */
 static int
@@ -799,6 +964,7 @@ _gnutls_gen_x509_crt (gnutls_session_t session, gnutls_buffer_st * data)
   gnutls_pcert_st *apr_cert_list;
   gnutls_privkey_t apr_pkey;
   int apr_cert_list_length;
+  gnutls_datum_t msg;
 
   /* find the appropriate certificate 
    */
@@ -810,6 +976,16 @@ _gnutls_gen_x509_crt (gnutls_session_t session, gnutls_buffer_st * data)
       return ret;
     }
 
+  /* the chain from the credentials is already encoded */
+  if (_gnutls_get_selected_cert_msg (session, &msg) == 0)
+    {
+      ret = _gnutls_buffer_append_data (data, msg.data, msg.size);
+      if (ret < 0)
+        return gnutls_assert_val (ret);
+
+      return data->length;
+    }
+
   ret = 3;
   for (i = 0; i < apr_cert_list_length; i++)
     {
@@ -1027,7 +1203,6 @@ _gnutls_gen_cert_server_crt (gnutls_session_t session,
 /* Process server certificate
  */
 
-#define CLEAR_CERTS for(x=0;x<peer_certificate_list_size;x++) gnutls_pcert_deinit(&peer_certificate_list[x])
 static int
 _gnutls_proc_x509_server_crt (gnutls_session_t session,
                                       uint8_t * data, size_t data_size)
@@ -1038,9 +1213,9 @@ _gnutls_proc_x509_server_crt (gnutls_session_t session,
   gnutls_certificate_credentials_t cred;
   ssize_t dsize = data_size;
   int i;
-  gnutls_pcert_st *peer_certificate_list;
+  gnutls_datum_t *raw_certificate_list;
+  gnutls_pcert_st peer_cert;
   size_t peer_certificate_list_size = 0, j, x;
-  gnutls_datum_t tmp;
 
   cred = (gnutls_certificate_credentials_t)
     _gnutls_get_cred (session, GNUTLS_CRD_CERTIFICATE, NULL);
@@ -1104,10 +1279,9 @@ _gnutls_proc_x509_server_crt (gnutls_session_t session,
    * certificate list 
    */
 
-  peer_certificate_list =
-    gnutls_calloc (1,
-                   sizeof (gnutls_pcert_st) * (peer_certificate_list_size));
-  if (peer_certificate_list == NULL)
+  raw_certificate_list =
+    gnutls_calloc (peer_certificate_list_size, sizeof (gnutls_datum_t));
+  if (raw_certificate_list == NULL)
     {
       gnutls_assert ();
       return GNUTLS_E_MEMORY_ERROR;
@@ -1125,46 +1299,46 @@ _gnutls_proc_x509_server_crt (gnutls_session_t session,
       len = _gnutls_read_uint24 (p);
       p += 3;
 
-      tmp.size = len;
-      tmp.data = p;
-
-      ret =
-        gnutls_pcert_import_x509_raw (&peer_certificate_list
-                                      [j], &tmp, GNUTLS_X509_FMT_DER, 0);
+      ret = _gnutls_set_datum (&raw_certificate_list[j], p, len);
       if (ret < 0)
         {
           gnutls_assert ();
-          peer_certificate_list_size = j;
-          goto cleanup;
+          for (x = 0; x < j; x++)
+            _gnutls_free_datum (&raw_certificate_list[x]);
+          gnutls_free (raw_certificate_list);
+          return ret;
         }
 
       p += len;
     }
 
+  /* release the previous certificates, if any */
+  _gnutls_copy_certificate_auth_info (info, NULL, 0, NULL);
 
-  if ((ret =
-       _gnutls_copy_certificate_auth_info (info,
-                                           peer_certificate_list,
-                                           peer_certificate_list_size,
-                                           NULL)) < 0)
+  info->raw_certificate_list = raw_certificate_list;
+  info->ncerts = peer_certificate_list_size;
+  info->cert_type = GNUTLS_CRT_X509;
+
+  /* this parses the certificates, once for the whole session */
+  ret = _gnutls_get_auth_info_pcert (&peer_cert, GNUTLS_CRT_X509, info);
+  if (ret < 0)
     {
       gnutls_assert ();
       goto cleanup;
     }
 
-  if ((ret =
-       _gnutls_check_key_usage (&peer_certificate_list[0],
-                                gnutls_kx_get (session))) < 0)
+  ret = _gnutls_check_key_usage (&peer_cert, gnutls_kx_get (session));
+  gnutls_pcert_deinit (&peer_cert);
+  if (ret < 0)
     {
       gnutls_assert ();
       goto cleanup;
     }
 
-  ret = 0;
+  return 0;
 
 cleanup:
-  CLEAR_CERTS;
-  gnutls_free (peer_certificate_list);
+  _gnutls_copy_certificate_auth_info (info, NULL, 0, NULL);
   return ret;
 
 }
@@ -1802,47 +1976,6 @@ _gnutls_get_selected_cert (gnutls_session_t session,
   return 0;
 }
 
-/* converts the given x509 certificate list to gnutls_pcert_st* and allocates
- * space for them.
- */
-static gnutls_pcert_st *
-alloc_and_load_x509_certs (gnutls_x509_crt_t * certs, unsigned ncerts)
-{
-  gnutls_pcert_st *local_certs;
-  int ret = 0;
-  unsigned i, j;
-
-  if (certs == NULL)
-    return NULL;
-
-  local_certs = gnutls_malloc (sizeof (gnutls_pcert_st) * ncerts);
-  if (local_certs == NULL)
-    {
-      gnutls_assert ();
-      return NULL;
-    }
-
-  for (i = 0; i < ncerts; i++)
-    {
-      ret = gnutls_pcert_import_x509 (&local_certs[i], certs[i], 0);
-      if (ret < 0)
-        break;
-    }
-
-  if (ret < 0)
-    {
-      gnutls_assert ();
-      for (j = 0; j < i; j++)
-        {
-          gnutls_pcert_deinit (&local_certs[j]);
-        }
-      gnutls_free (local_certs);
-      return NULL;
-    }
-
-  return local_certs;
-}
-
 /* converts the given x509 key to gnutls_privkey* and allocates
  * space for it.
  */
@@ -1992,21 +2125,48 @@ _gnutls_selected_certs_deinit (gnutls_session_t session)
     {
       int i;
 
-      for (i = 0; i < session->internals.selected_cert_list_length; i++)
+      /* a shared list is released below */
+      if (session->internals.selected_ref == NULL)
         {
-          gnutls_pcert_deinit (&session->internals.selected_cert_list[i]);
+          for (i = 0; i < session->internals.selected_cert_list_length; i++)
+            {
+              gnutls_pcert_deinit (&session->internals.selected_cert_list[i]);
+            }
+          gnutls_free (session->internals.selected_cert_list);
         }
-      gnutls_free (session->internals.selected_cert_list);
-      session->internals.selected_cert_list = NULL;
-      session->internals.selected_cert_list_length = 0;
 
       gnutls_privkey_deinit(session->internals.selected_key);
-      session->internals.selected_key = NULL;
     }
+  else if (session->internals.selected_ref == NULL)
+    return;
+
+  if (session->internals.selected_ref != NULL)
+    {
+      session->internals.selected_ref_release (session->internals.selected_ref);
+      session->internals.selected_ref = NULL;
+      session->internals.selected_ref_release = NULL;
+      session->internals.selected_cert_msg = NULL;
+    }
+
+  session->internals.selected_cert_list = NULL;
+  session->internals.selected_cert_list_length = 0;
+  session->internals.selected_key = NULL;
 
   return;
 }
 
+/* Makes the session hold a reference on the selected certificates
+ * (and key, if it is not freed with the session) which is released
+ * when they are no longer used.
+ */
+void
+_gnutls_selected_certs_set_ref (gnutls_session_t session, void *ref,
+                                void (*release) (void *))
+{
+  session->internals.selected_ref = ref;
+  session->internals.selected_ref_release = release;
+}
+
 void
 _gnutls_selected_certs_set (gnutls_session_t session,
                             gnutls_pcert_st * certs, int ncerts,
@@ -2018,6 +2178,10 @@ _gnutls_selected_certs_set (gnutls_session_t session,
   session->internals.selected_cert_list_length = ncerts;
   session->internals.selected_key = key;
   session->internals.selected_need_free = need_free;
+  session->internals.selected_cert_index = -1;
+  session->internals.selected_ref = NULL;
+  session->internals.selected_ref_release = NULL;
+  session->internals.selected_cert_msg = NULL;
 
 }
 
@@ -2051,6 +2215,37 @@ unsigned int type;
  * selected certificate will be in session->internals.selected_*.
  *
  */
+/* Returns the index of the first certificate that has the given name
+ * and is compatible with the requested algorithms, or -1. This is the
+ * scan used when the names of the credentials could not be indexed.
+ */
+static int
+find_cert_by_name (gnutls_session_t session,
+                   gnutls_certificate_credentials_t cred, const char *name,
+                   gnutls_pk_algorithm_t * pk_algos, size_t pk_algos_size)
+{
+  unsigned i, j;
+  gnutls_pk_algorithm pk;
+
+  for (i = 0; i < cred->ncerts; i++)
+    {
+      if (_gnutls_sni_names_match (cred->certs[i].names, name) == 0
+          || session->security_parameters.cert_type !=
+          cred->certs[i].cert_list[0].type)
+        continue;
+
+      /* if requested algorithms are also compatible select it */
+      pk = gnutls_pubkey_get_pk_algorithm (cred->certs[i].cert_list[0].pubkey,
+                                           NULL);
+
+      for (j = 0; j < pk_algos_size; j++)
+        if (pk_algos[j] == pk)
+          return i;
+    }
+
+  return -1;
+}
+
 int
 _gnutls_server_select_cert (gnutls_session_t session,
                             gnutls_pk_algorithm_t * pk_algos,
@@ -2060,6 +2255,7 @@ _gnutls_server_select_cert (gnutls_session_t session,
   int idx, ret;
   gnutls_certificate_credentials_t cred;
   char server_name[MAX_CN];
+  char wildcard[MAX_CN + 2];
 
   cred = (gnutls_certificate_credentials_t)
     _gnutls_get_cred (session, GNUTLS_CRD_CERTIFICATE, NULL);
@@ -2087,35 +2283,60 @@ _gnutls_server_select_cert (gnutls_session_t session,
 
   idx = -1;                     /* default is use no certificate */
 
-  /* find certificates that match the requested server_name
+  if (_gnutls_sni_index_usable (cred->sni_index))
+    {
+      if (server_name[0] != 0)
+        {
+          _gnutls_handshake_log ("HSK[%p]: Requested server name: '%s', ctype: %s (%d)\n",
+                                 session, server_name,
+                                 gnutls_certificate_type_get_name (session->security_parameters.cert_type),
+                                 session->security_parameters.cert_type);
+
+          idx = _gnutls_sni_index_find_name (cred->sni_index, server_name,
+                                             session->security_parameters.cert_type,
+                                             pk_algos, pk_algos_size);
+
+          if (idx < 0 && cred->lazy_certs != NULL
+              && _gnutls_lazy_certs_select (session, cred->lazy_certs,
+                                            &cred->pin, server_name,
+                                            pk_algos, pk_algos_size) == 0)
+            return 0;
+        }
+
+      if (idx < 0)
+        idx = _gnutls_sni_index_find_any (cred->sni_index,
+                                          session->security_parameters.cert_type,
+                                          pk_algos, pk_algos_size);
+      goto finished;
+    }
+
+  /* find certificates that match the requested server_name,
+   * with the same rules as the index
    */
   
   if (server_name[0] != 0)
     {
-      for (i = 0; i < cred->ncerts; i++)
-        {
-          if (cred->certs[i].names != NULL && _gnutls_str_array_match(cred->certs[i].names, server_name) != 0)
-            {
-              /* if requested algorithms are also compatible select it */
-              gnutls_pk_algorithm pk =
-                gnutls_pubkey_get_pk_algorithm (cred->certs[i].cert_list[0].pubkey,
-                                            NULL);
+      _gnutls_handshake_log("HSK[%p]: Requested server name: '%s', ctype: %s (%d)\n", session, server_name,
+            gnutls_certificate_type_get_name (session->security_parameters.cert_type), 
+            session->security_parameters.cert_type);
 
-              _gnutls_handshake_log("HSK[%p]: Requested server name: '%s', ctype: %s (%d)", session, server_name,
-                    gnutls_certificate_type_get_name (session->security_parameters.cert_type), 
-                    session->security_parameters.cert_type);
+      idx = find_cert_by_name (session, cred, server_name,
+                               pk_algos, pk_algos_size);
 
-              if (session->security_parameters.cert_type == cred->certs[i].cert_list[0].type)
-                {
-                  for (j = 0; j < pk_algos_size; j++)
-                  if (pk_algos[j] == pk)
-                    {
-		      idx = i;
-	              goto finished;
-	            }
-                }
-            }
-        }
+      if (idx < 0
+          && _gnutls_sni_wildcard (server_name, wildcard,
+                                   sizeof (wildcard)) >= 0)
+        idx = find_cert_by_name (session, cred, wildcard,
+                                 pk_algos, pk_algos_size);
+
+      if (idx >= 0)
+        goto finished;
+
+      if (cred->lazy_certs != NULL
+          && _gnutls_lazy_certs_select (session, cred->lazy_certs,
+                                        &cred->pin, server_name,
+                                        pk_algos, pk_algos_size) == 0)
+        return 0;
     }
 
   for (j = 0; j < pk_algos_size; j++)
@@ -2165,6 +2386,7 @@ finished:
                                   &cred->certs[idx].cert_list[0],
                                   cred->certs[idx].cert_list_length,
                                   cred->pkey[idx], 0);
+      session->internals.selected_cert_index = idx;
     }
   else
     {
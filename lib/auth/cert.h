@@ -29,11 +29,18 @@
 #include <gnutls/abstract.h>
 #include <gnutls/compat.h>
 #include <gnutls_str_array.h>
+#include <gnutls_chain_cache.h>
+#include <gnutls_sni_index.h>
+#include <gnutls_cert_lazy.h>
 
 typedef struct {
   gnutls_pcert_st * cert_list; /* a certificate chain */
   unsigned int cert_list_length; /* its length */
   gnutls_str_array_t names; /* the names in the first certificate */
+
+  /* the body of the Certificate handshake message carrying this
+   * chain; only for X.509 chains. */
+  gnutls_datum_t cert_msg;
 } certs_st;
 
 /* This structure may be complex, but it's the only way to
@@ -51,6 +58,13 @@ typedef struct gnutls_certificate_credentials_st
   certs_st *certs;
   unsigned ncerts; /* the number of certs */
 
+  /* the names of the certs above, for the server to select
+   * one for the requested name */
+  sni_index_st *sni_index;
+
+  /* the certificates registered by name, loaded when requested */
+  lazy_certs_st *lazy_certs;
+
   gnutls_privkey_t *pkey;
   /* private keys. It contains ncerts private
    * keys. pkey[i] corresponds to certificate in
@@ -64,6 +78,7 @@ typedef struct gnutls_certificate_credentials_st
 
   /* X509 specific stuff */
   gnutls_x509_trust_list_t tlist;
+  unsigned int shared_tlist;    /* set with gnutls_certificate_set_trust_list() */
   unsigned int verify_flags;    /* flags to be used at 
                                  * certificate verification.
                                  */
@@ -92,6 +107,9 @@ typedef struct gnutls_certificate_credentials_st
   gnutls_status_request_ocsp_func ocsp_func;
   void *ocsp_func_ptr;
   char *ocsp_response_file;
+
+  /* peer chains referenced by digest from resumption data */
+  chain_cache_st *chain_cache;
 } certificate_credentials_st;
 
 typedef struct rsa_info_st
@@ -100,6 +118,29 @@ typedef struct rsa_info_st
   gnutls_datum_t exponent;
 } rsa_info_st;
 
+/* The result of an X.509 chain verification, kept with the session
+ * so that a resumed session need not verify the chain again. It
+ * holds for the chain with the given digest, while the trust list and
+ * the verification flags are the same and the current time is within
+ * [not_before, not_after]. The length
+ * of the chain and its key sizes are kept to apply the current limits
+ * of the credentials.
+ */
+typedef struct peer_verify_st
+{
+  unsigned int done;            /* the fields below are set */
+  unsigned int status;          /* without the hostname check */
+  unsigned int flags;           /* the verification flags used */
+  unsigned int ocsp_checked;
+  uint64_t tlist_generation;
+  time_t not_before;
+  time_t not_after;
+  unsigned int ncerts;
+  unsigned int max_bits;        /* of the largest key in the chain */
+  unsigned int weak;            /* a key in the chain is insecure */
+  uint8_t chain[CHAIN_DIGEST_SIZE];     /* the verified chain */
+} peer_verify_st;
+
 /* This is the information we keep for the peer
  * certificate.
  */
@@ -116,6 +157,22 @@ typedef struct cert_auth_info_st
                                          */
   unsigned int ncerts;          /* holds the size of the list above */
 
+  /* the X.509 certificates above, parsed on first use; a NULL
+   * terminated list shared by the key exchange, the verification
+   * and the hostname check. Not part of the packed session data.
+   */
+  gnutls_x509_crt_t *x509_crts;
+
+  /* when the chain was stored in the credentials' chain cache
+   * on resumption, this is its digest and raw_certificate_list
+   * is filled on demand.
+   */
+  uint8_t chain_digest[CHAIN_DIGEST_SIZE];
+  unsigned int chain_digest_set;
+
+  /* the result of the last verification of the chain */
+  peer_verify_st verify;
+
   gnutls_certificate_type_t cert_type;
 #ifdef ENABLE_OPENPGP
   uint8_t subkey_id[GNUTLS_OPENPGP_KEYID_SIZE];
@@ -125,6 +182,13 @@ typedef struct cert_auth_info_st
 typedef struct cert_auth_info_st cert_auth_info_st;
 
 void _gnutls_free_rsa_info (rsa_info_st * rsa);
+int _gnutls_get_peer_x509_crts (cert_auth_info_t info,
+                                gnutls_x509_crt_t ** crts);
+void _gnutls_free_peer_x509_crts (cert_auth_info_t info);
+int _gnutls_peer_chain_restore (gnutls_session_t session,
+                                cert_auth_info_t info);
+int _gnutls_peer_chain_digest (cert_auth_info_t info,
+                               uint8_t digest[CHAIN_DIGEST_SIZE]);
 
 /* AUTH X509 functions */
 int _gnutls_gen_cert_server_crt (gnutls_session_t, gnutls_buffer_st *);
@@ -139,12 +203,19 @@ int _gnutls_get_selected_cert (gnutls_session_t session,
                                int *apr_cert_list_length,
                                gnutls_privkey_t * apr_pkey);
 
+int _gnutls_get_selected_cert_msg (gnutls_session_t session,
+                                   gnutls_datum_t * msg);
+int _gnutls_encode_x509_crt_msg (gnutls_pcert_st * certs, unsigned ncerts,
+                                 gnutls_datum_t * msg);
+
 int _gnutls_server_select_cert (struct gnutls_session_int *,
                                 gnutls_pk_algorithm_t*, size_t);
 void _gnutls_selected_certs_deinit (gnutls_session_t session);
 void _gnutls_selected_certs_set (gnutls_session_t session,
                                  gnutls_pcert_st * certs, int ncerts,
                                  gnutls_privkey_t key, int need_free);
+void _gnutls_selected_certs_set_ref (gnutls_session_t session, void *ref,
+                                     void (*release) (void *));
 
 gnutls_rsa_params_t _gnutls_certificate_get_rsa_params (gnutls_rsa_params_t
                                                         rsa_params,
@@ -161,6 +232,7 @@ int certificate_credential_append_crt_list (gnutls_certificate_credentials_t
                                             gnutls_pcert_st* crt, int nr);
 int certificate_credentials_append_pkey (gnutls_certificate_credentials_t res,
                                          gnutls_privkey_t pkey);
+void certificate_credentials_index_last (gnutls_certificate_credentials_t res);
 
 int _gnutls_selected_cert_supported_kx (struct gnutls_session_int *session,
                                         gnutls_kx_algorithm_t * alg,
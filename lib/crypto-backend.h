@@ -41,6 +41,9 @@
     int (*auth) (void *ctx, const void *data, size_t datasize);
     void (*tag) (void *ctx, void *tag, size_t tagsize);
     void (*deinit) (void *ctx);
+    /* Optional; duplicates a keyed context into a newly
+     * allocated one. */
+    int (*copy) (void **dst_ctx, const void *src_ctx);
     
     /* Not needed for registered on run-time. Only included
      * should define it. */
@@ -56,6 +59,9 @@
     int (*output) (void *src_ctx, void *digest, size_t digestsize);
     void (*deinit) (void *ctx);
     int (*fast)(gnutls_mac_algorithm_t, const void *key, size_t keysize, const void *text, size_t textsize, void *digest);
+    /* Optional; duplicates a keyed context into a newly
+     * allocated one. */
+    int (*copy) (void **dst_ctx, const void *src_ctx);
 
     /* Not needed for registered on run-time. Only included
      * should define it. */
@@ -333,6 +339,18 @@
                    const gnutls_pk_params_st * priv,
                    const gnutls_pk_params_st * pub);
 
+    /* optional; converts the parameters of a long-lived private
+     * key to backend structures once, so that signing and decryption
+     * do not repeat the setup. The prepared key must hold its own
+     * copy of the parameters, and must be usable by several threads
+     * at once. */
+    int (*prepare) (gnutls_pk_algorithm_t, const gnutls_pk_params_st * priv,
+                    void **prepared);
+    void (*prepared_deinit) (void *prepared);
+    int (*prepared_sign) (void *prepared, gnutls_datum_t * signature,
+                          const gnutls_datum_t * data);
+    int (*prepared_decrypt) (void *prepared, gnutls_datum_t * plaintext,
+                             const gnutls_datum_t * ciphertext);
 
   } gnutls_crypto_pk_st;
 
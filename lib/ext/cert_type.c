@@ -168,13 +168,13 @@ _gnutls_cert_type_send_params (gnutls_session_t session, gnutls_buffer_st* extda
   if (session->security_parameters.entity == GNUTLS_CLIENT)
     {
 
-      if (session->internals.priorities.cert_type.algorithms > 0)
+      if (session->internals.priorities->cert_type.algorithms > 0)
         {
 
-          len = session->internals.priorities.cert_type.algorithms;
+          len = session->internals.priorities->cert_type.algorithms;
 
           if (len == 1 &&
-              session->internals.priorities.cert_type.priority[0] ==
+              session->internals.priorities->cert_type.priority[0] ==
               GNUTLS_CRT_X509)
             {
               /* We don't use this extension if X.509 certificates
@@ -193,7 +193,7 @@ _gnutls_cert_type_send_params (gnutls_session_t session, gnutls_buffer_st* extda
           for (i = 0; i < len; i++)
             {
               p =
-                _gnutls_cert_type2num (session->internals.priorities.
+                _gnutls_cert_type2num (session->internals.priorities->
                                        cert_type.priority[i]);
               ret = _gnutls_buffer_append_data(extdata, &p, 1);
               if (ret < 0)
@@ -160,10 +160,10 @@ _gnutls_supported_ecc_send_params (gnutls_session_t session, gnutls_buffer_st* e
   if (session->security_parameters.entity == GNUTLS_CLIENT)
     {
 
-      if (session->internals.priorities.supported_ecc.algorithms > 0)
+      if (session->internals.priorities->supported_ecc.algorithms > 0)
         {
 
-          len = session->internals.priorities.supported_ecc.algorithms;
+          len = session->internals.priorities->supported_ecc.algorithms;
 
           /* this is a vector!
            */
@@ -174,7 +174,7 @@ _gnutls_supported_ecc_send_params (gnutls_session_t session, gnutls_buffer_st* e
           for (i = 0; i < len; i++)
             {
               p =
-                _gnutls_ecc_curve_get_tls_id (session->internals.priorities.
+                _gnutls_ecc_curve_get_tls_id (session->internals.priorities->
                                        supported_ecc.priority[i]);
               ret = _gnutls_buffer_append_prefix(extdata, 16, p);
               if (ret < 0)
@@ -241,7 +241,7 @@ _gnutls_supported_ecc_pf_send_params (gnutls_session_t session, gnutls_buffer_st
   if (session->security_parameters.entity == GNUTLS_SERVER && !_gnutls_session_is_ecc(session))
     return 0;
   
-  if (session->internals.priorities.supported_ecc.algorithms > 0)
+  if (session->internals.priorities->supported_ecc.algorithms > 0)
     {
       _gnutls_buffer_append_data(extdata, p, 2);
       return 2;
@@ -258,11 +258,11 @@ _gnutls_session_supports_ecc_curve (gnutls_session_t session, unsigned int ecc_t
 {
   unsigned i;
   
-  if (session->internals.priorities.supported_ecc.algorithms > 0)
+  if (session->internals.priorities->supported_ecc.algorithms > 0)
     {
-      for (i = 0; i < session->internals.priorities.supported_ecc.algorithms; i++)
+      for (i = 0; i < session->internals.priorities->supported_ecc.algorithms; i++)
         {
-          if (session->internals.priorities.supported_ecc.priority[i] == ecc_type)
+          if (session->internals.priorities->supported_ecc.priority[i] == ecc_type)
             return 0;
         }
     }
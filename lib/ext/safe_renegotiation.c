@@ -50,7 +50,7 @@ _gnutls_ext_sr_finished (gnutls_session_t session, void *vdata,
   sr_ext_st *priv;
   extension_priv_data_t epriv;
 
-  if (session->internals.priorities.sr == SR_DISABLED)
+  if (session->internals.priorities->sr == SR_DISABLED)
     {
       return 0;
     }
@@ -95,7 +95,7 @@ _gnutls_ext_sr_verify (gnutls_session_t session)
   sr_ext_st *priv = NULL;
   extension_priv_data_t epriv;
 
-  if (session->internals.priorities.sr == SR_DISABLED)
+  if (session->internals.priorities->sr == SR_DISABLED)
     {
       gnutls_assert ();
       return 0;
@@ -163,7 +163,7 @@ _gnutls_ext_sr_verify (gnutls_session_t session)
       /* Clients can't tell if it's an initial negotiation */
       if (session->internals.initial_negotiation_completed)
         {
-          if (session->internals.priorities.sr < SR_PARTIAL)
+          if (session->internals.priorities->sr < SR_PARTIAL)
             {
               _gnutls_handshake_log
                 ("HSK[%p]: Allowing unsafe (re)negotiation\n", session);
@@ -178,7 +178,7 @@ _gnutls_ext_sr_verify (gnutls_session_t session)
         }
       else
         {
-          if (session->internals.priorities.sr < SR_SAFE)
+          if (session->internals.priorities->sr < SR_SAFE)
             {
               _gnutls_handshake_log
                 ("HSK[%p]: Allowing unsafe initial negotiation\n", session);
@@ -291,7 +291,7 @@ _gnutls_sr_recv_params (gnutls_session_t session,
 
   DECR_LEN (data_size, len + 1 /* count the first byte and payload */ );
 
-  if (session->internals.priorities.sr == SR_DISABLED)
+  if (session->internals.priorities->sr == SR_DISABLED)
     {
       gnutls_assert ();
       return 0;
@@ -369,7 +369,7 @@ _gnutls_sr_send_params (gnutls_session_t session, gnutls_buffer_st* extdata)
   extension_priv_data_t epriv;
   size_t init_length = extdata->length;
 
-  if (session->internals.priorities.sr == SR_DISABLED)
+  if (session->internals.priorities->sr == SR_DISABLED)
     {
       gnutls_assert ();
       return 0;
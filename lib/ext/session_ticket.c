@@ -33,6 +33,9 @@
 #include <gnutls_mbuffers.h>
 #include <gnutls_extensions.h>
 #include <gnutls_constate.h>
+#include <gnutls_cipher_int.h>
+#include <gnutls_hash_int.h>
+#include <locks.h>
 
 #define KEY_NAME_SIZE SESSION_TICKET_KEY_NAME_SIZE
 #define KEY_SIZE SESSION_TICKET_KEY_SIZE
@@ -41,6 +44,23 @@
 
 #define MAC_SIZE 32
 
+/* The ticket format is:
+ *      16 bytes the key name
+ *      1 byte the format version (TICKET_VERSION)
+ *      12 bytes the AES-GCM nonce
+ *      x bytes the encrypted session, in the compact packing
+ *      16 bytes the AES-GCM tag
+ *
+ * The key name and the version are authenticated as additional
+ * data. Tickets in the older format (AES-CBC with HMAC-SHA256,
+ * see struct ticket) are accepted but no longer issued.
+ */
+#define TICKET_VERSION 1
+#define AEAD_NONCE_SIZE 12
+#define AEAD_TAG_SIZE 16
+#define AEAD_HEADER_SIZE (KEY_NAME_SIZE+1+AEAD_NONCE_SIZE)
+#define AEAD_KEY_LABEL "gnutls session ticket aead key"
+
 static int session_ticket_recv_params (gnutls_session_t session,
                                        const uint8_t * data, size_t data_size);
 static int session_ticket_send_params (gnutls_session_t session,
@@ -72,14 +92,45 @@ typedef struct
 {
   int session_ticket_enable;
   int session_ticket_renew;
-  uint8_t session_ticket_IV[SESSION_TICKET_IV_SIZE];
 
   uint8_t *session_ticket;
   int session_ticket_len;
 
   uint8_t key[SESSION_KEY_SIZE];
+
+  /* if set, the key above is unused */
+  gnutls_session_ticket_keys_t keys;
 } session_ticket_ext_st;
 
+/* A ticket key with its AES key schedules and HMAC state computed
+ * once. The handles are cloned for every ticket.
+ */
+typedef struct
+{
+  uint8_t key[SESSION_KEY_SIZE];
+  cipher_hd_st aead;
+  /* for tickets in the older format */
+  cipher_hd_st dec;
+  digest_hd_st mac;
+} ticket_key_st;
+
+struct gnutls_session_ticket_keys_int
+{
+  /* keys[0] is the active key; the rest are only used to
+   * decrypt tickets issued before the last rotations. */
+  ticket_key_st **keys;
+  unsigned int nkeys;
+  unsigned int max_keys;
+
+  void *mutex;
+};
+
+#define KEYS_LOCK(k) if (gnutls_mutex_lock(&(k)->mutex)!=0) abort()
+#define KEYS_UNLOCK(k) if (gnutls_mutex_unlock(&(k)->mutex)!=0) abort()
+
+#define DEFAULT_MAX_TICKET_KEYS 3
+
+/* the older ticket format */
 struct ticket
 {
   uint8_t key_name[KEY_NAME_SIZE];
@@ -89,174 +140,406 @@ struct ticket
   uint8_t mac[MAC_SIZE];
 };
 
+/* Initializes the handles needed for a ticket from a raw key. If @aead
+ * is non-zero @cipher is set to AES-128-GCM under a key derived from
+ * the MAC secret, otherwise @cipher is set to AES-128-CBC decryption
+ * and @mac to HMAC-SHA256, as used by the older format.
+ */
 static int
-digest_ticket (const gnutls_datum_t * key, struct ticket *ticket,
-               uint8_t * digest)
+ticket_handles_init (const uint8_t * raw_key, int aead, cipher_hd_st * cipher,
+                     digest_hd_st * mac)
 {
-  digest_hd_st digest_hd;
-  uint16_t length16;
+  gnutls_datum_t key;
+  uint8_t aead_key[MAC_SIZE];
+  int ret;
+
+  if (aead)
+    {
+      ret = _gnutls_hmac_fast (GNUTLS_MAC_SHA256, &raw_key[MAC_SECRET_POS],
+                               MAC_SECRET_SIZE, AEAD_KEY_LABEL,
+                               sizeof (AEAD_KEY_LABEL) - 1, aead_key);
+      if (ret < 0)
+        return gnutls_assert_val (ret);
+
+      key.data = aead_key;
+      key.size = KEY_SIZE;
+      ret = _gnutls_cipher_init (cipher, GNUTLS_CIPHER_AES_128_GCM, &key,
+                                 NULL, 1);
+      memset (aead_key, 0, sizeof (aead_key));
+      if (ret < 0)
+        return gnutls_assert_val (ret);
+
+      return 0;
+    }
+
+  key.data = (void *) &raw_key[KEY_POS];
+  key.size = KEY_SIZE;
+  ret =
+    _gnutls_cipher_init (cipher, GNUTLS_CIPHER_AES_128_CBC, &key, NULL, 0);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  ret = _gnutls_hmac_init (mac, GNUTLS_MAC_SHA256, &raw_key[MAC_SECRET_POS],
+                           MAC_SECRET_SIZE);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      _gnutls_cipher_deinit (cipher);
+      return ret;
+    }
+
+  return 0;
+}
+
+/* Sets up the handles needed to process a single ticket. If
+ * @key_name is NULL the active key is used and its name is
+ * copied to @name_out, otherwise the key with that name is used.
+ * @mac is only set for the older format.
+ */
+static int
+ticket_handles_get (session_ticket_ext_st * priv, const uint8_t * key_name,
+                    int aead, cipher_hd_st * cipher, digest_hd_st * mac,
+                    uint8_t * name_out)
+{
+  gnutls_session_ticket_keys_t keys = priv->keys;
+  ticket_key_st *k = NULL;
+  uint8_t raw_key[SESSION_KEY_SIZE];
+  unsigned int i;
+  int ret;
+
+  if (keys == NULL)
+    {
+      if (key_name != NULL
+          && memcmp (key_name, &priv->key[NAME_POS], KEY_NAME_SIZE) != 0)
+        return GNUTLS_E_DECRYPTION_FAILED;
+
+      if (name_out)
+        memcpy (name_out, &priv->key[NAME_POS], KEY_NAME_SIZE);
+
+      return ticket_handles_init (priv->key, aead, cipher, mac);
+    }
+
+  KEYS_LOCK (keys);
+  if (key_name == NULL)
+    {
+      if (keys->nkeys > 0)
+        k = keys->keys[0];
+    }
+  else
+    {
+      for (i = 0; i < keys->nkeys; i++)
+        {
+          if (memcmp (key_name, &keys->keys[i]->key[NAME_POS],
+                      KEY_NAME_SIZE) == 0)
+            {
+              k = keys->keys[i];
+              break;
+            }
+        }
+    }
+
+  if (k == NULL)
+    {
+      KEYS_UNLOCK (keys);
+      return GNUTLS_E_DECRYPTION_FAILED;
+    }
+
+  if (name_out)
+    memcpy (name_out, &k->key[NAME_POS], KEY_NAME_SIZE);
+
+  if (aead)
+    ret = _gnutls_cipher_copy (cipher, &k->aead);
+  else
+    {
+      ret = _gnutls_cipher_copy (cipher, &k->dec);
+      if (ret >= 0)
+        {
+          ret = _gnutls_hmac_copy (mac, &k->mac);
+          if (ret < 0)
+            _gnutls_cipher_deinit (cipher);
+        }
+    }
+
+  if (ret == GNUTLS_E_UNIMPLEMENTED_FEATURE)
+    memcpy (raw_key, k->key, SESSION_KEY_SIZE);
+  KEYS_UNLOCK (keys);
+
+  /* the backend cannot clone contexts; set them up from the key */
+  if (ret == GNUTLS_E_UNIMPLEMENTED_FEATURE)
+    {
+      ret = ticket_handles_init (raw_key, aead, cipher, mac);
+      memset (raw_key, 0, sizeof (raw_key));
+    }
+
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  return 0;
+}
+
+/* Restores the session from the decrypted ticket contents. */
+static int
+ticket_restore_session (gnutls_session_t session,
+                        const gnutls_datum_t * state, unsigned compact)
+{
+  time_t timestamp = gnutls_time (0);
   int ret;
 
-  ret = _gnutls_hmac_init (&digest_hd, GNUTLS_MAC_SHA256, key->data,
-                           key->size);
+  if (compact)
+    ret = _gnutls_session_unpack_compact (session, state);
+  else
+    ret = _gnutls_session_unpack (session, state);
   if (ret < 0)
     {
       gnutls_assert ();
       return ret;
     }
-  _gnutls_hmac (&digest_hd, ticket->key_name, KEY_NAME_SIZE);
-  _gnutls_hmac (&digest_hd, ticket->IV, IV_SIZE);
+
+  if (timestamp - session->internals.resumed_security_parameters.timestamp >
+      session->internals.expire_time
+      || session->internals.resumed_security_parameters.timestamp > timestamp)
+    {
+      gnutls_assert ();
+      return GNUTLS_E_EXPIRED;
+    }
+
+  session->internals.resumed = RESUME_TRUE;
+
+  return 0;
+}
+
+static void
+digest_ticket (digest_hd_st * digest_hd, struct ticket *ticket,
+               uint8_t * digest)
+{
+  uint16_t length16;
+
+  _gnutls_hmac (digest_hd, ticket->key_name, KEY_NAME_SIZE);
+  _gnutls_hmac (digest_hd, ticket->IV, IV_SIZE);
   length16 = _gnutls_conv_uint16 (ticket->encrypted_state_len);
-  _gnutls_hmac (&digest_hd, &length16, 2);
-  _gnutls_hmac (&digest_hd, ticket->encrypted_state,
+  _gnutls_hmac (digest_hd, &length16, 2);
+  _gnutls_hmac (digest_hd, ticket->encrypted_state,
                 ticket->encrypted_state_len);
-  _gnutls_hmac_deinit (&digest_hd, digest);
+  _gnutls_hmac_deinit (digest_hd, digest);
+}
 
-  return 0;
+/* Returns non-zero if the data following the key name have the
+ * layout of a ticket in the older format. */
+static int
+is_legacy_ticket (const uint8_t * data, size_t data_size)
+{
+  if (data_size < IV_SIZE + 2 + MAC_SIZE)
+    return 0;
+
+  return data_size ==
+    IV_SIZE + 2 + (size_t) _gnutls_read_uint16 (&data[IV_SIZE]) + MAC_SIZE;
 }
 
 static int
-decrypt_ticket (gnutls_session_t session, session_ticket_ext_st * priv,
-                struct ticket *ticket)
+decrypt_legacy_ticket (gnutls_session_t session,
+                       session_ticket_ext_st * priv, const uint8_t * key_name,
+                       const uint8_t * data)
 {
   cipher_hd_st cipher_hd;
-  gnutls_datum_t key, IV, mac_secret, state;
+  digest_hd_st digest_hd;
+  struct ticket ticket;
+  gnutls_datum_t state;
   uint8_t final[MAC_SECRET_SIZE];
-  time_t timestamp = gnutls_time (0);
   int ret;
 
-  /* Check the integrity of ticket using HMAC-SHA-256. */
-  mac_secret.data = (void *) &priv->key[MAC_SECRET_POS];
-  mac_secret.size = MAC_SECRET_SIZE;
-  ret = digest_ticket (&mac_secret, ticket, final);
+  memcpy (ticket.key_name, key_name, KEY_NAME_SIZE);
+  memcpy (ticket.IV, data, IV_SIZE);
+  data += IV_SIZE;
+  ticket.encrypted_state_len = _gnutls_read_uint16 (data);
+  data += 2;
+  memcpy (ticket.mac, data + ticket.encrypted_state_len, MAC_SIZE);
+
+  ticket.encrypted_state = gnutls_malloc (ticket.encrypted_state_len);
+  if (!ticket.encrypted_state)
+    {
+      gnutls_assert ();
+      return GNUTLS_E_MEMORY_ERROR;
+    }
+  memcpy (ticket.encrypted_state, data, ticket.encrypted_state_len);
+
+  ret = ticket_handles_get (priv, key_name, 0, &cipher_hd, &digest_hd, NULL);
   if (ret < 0)
     {
       gnutls_assert ();
-      return ret;
+      goto cleanup;
     }
 
-  if (memcmp (ticket->mac, final, MAC_SIZE))
+  /* Check the integrity of ticket using HMAC-SHA-256. */
+  digest_ticket (&digest_hd, &ticket, final);
+
+  if (memcmp (ticket.mac, final, MAC_SIZE))
     {
       gnutls_assert ();
-      return GNUTLS_E_DECRYPTION_FAILED;
+      _gnutls_cipher_deinit (&cipher_hd);
+      ret = GNUTLS_E_DECRYPTION_FAILED;
+      goto cleanup;
     }
 
   /* Decrypt encrypted_state using 128-bit AES in CBC mode. */
-  key.data = (void *) &priv->key[KEY_POS];
-  key.size = KEY_SIZE;
-  IV.data = ticket->IV;
-  IV.size = IV_SIZE;
-  ret =
-    _gnutls_cipher_init (&cipher_hd, GNUTLS_CIPHER_AES_128_CBC, &key, &IV, 0);
+  _gnutls_cipher_setiv (&cipher_hd, ticket.IV, IV_SIZE);
+  ret = _gnutls_cipher_decrypt (&cipher_hd, ticket.encrypted_state,
+                                ticket.encrypted_state_len);
+  _gnutls_cipher_deinit (&cipher_hd);
   if (ret < 0)
     {
       gnutls_assert ();
-      return ret;
+      goto cleanup;
     }
-  ret = _gnutls_cipher_decrypt (&cipher_hd, ticket->encrypted_state,
-                                ticket->encrypted_state_len);
-  _gnutls_cipher_deinit (&cipher_hd);
+
+  state.data = ticket.encrypted_state;
+  state.size = ticket.encrypted_state_len;
+  ret = ticket_restore_session (session, &state, 0);
+
+cleanup:
+  gnutls_free (ticket.encrypted_state);
+  return ret;
+}
+
+/* @data points to the version byte, after the key name. */
+static int
+decrypt_ticket (gnutls_session_t session, session_ticket_ext_st * priv,
+                const uint8_t * key_name, const uint8_t * data,
+                size_t data_size)
+{
+  cipher_hd_st cipher_hd;
+  uint8_t aad[KEY_NAME_SIZE + 1];
+  uint8_t tag[AEAD_TAG_SIZE];
+  gnutls_datum_t state;
+  int ret;
+
+  if (data_size < 1 + AEAD_NONCE_SIZE + AEAD_TAG_SIZE
+      || data[0] != TICKET_VERSION)
+    return GNUTLS_E_DECRYPTION_FAILED;
+
+  state.size = data_size - (1 + AEAD_NONCE_SIZE + AEAD_TAG_SIZE);
+  if (state.size == 0)
+    return GNUTLS_E_DECRYPTION_FAILED;
+
+  state.data = gnutls_malloc (state.size);
+  if (state.data == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  ret = ticket_handles_get (priv, key_name, 1, &cipher_hd, NULL, NULL);
   if (ret < 0)
     {
       gnutls_assert ();
-      return ret;
+      goto cleanup;
     }
 
-  /* Unpack security parameters. */
-  state.data = ticket->encrypted_state;
-  state.size = ticket->encrypted_state_len;
-  ret = _gnutls_session_unpack (session, &state);
+  memcpy (aad, key_name, KEY_NAME_SIZE);
+  aad[KEY_NAME_SIZE] = data[0];
+
+  _gnutls_cipher_setiv (&cipher_hd, &data[1], AEAD_NONCE_SIZE);
+  ret = _gnutls_cipher_auth (&cipher_hd, aad, sizeof (aad));
+  if (ret >= 0)
+    ret = _gnutls_cipher_decrypt2 (&cipher_hd, &data[1 + AEAD_NONCE_SIZE],
+                                   state.size, state.data, state.size);
+  if (ret >= 0)
+    _gnutls_cipher_tag (&cipher_hd, tag, AEAD_TAG_SIZE);
+  _gnutls_cipher_deinit (&cipher_hd);
   if (ret < 0)
     {
       gnutls_assert ();
-      return ret;
+      goto cleanup;
     }
 
-  if (timestamp - session->internals.resumed_security_parameters.timestamp >
-      session->internals.expire_time
-      || session->internals.resumed_security_parameters.timestamp > timestamp)
+  if (memcmp (tag, &data[data_size - AEAD_TAG_SIZE], AEAD_TAG_SIZE) != 0)
     {
       gnutls_assert ();
-      return GNUTLS_E_EXPIRED;
+      ret = GNUTLS_E_DECRYPTION_FAILED;
+      goto cleanup;
     }
 
-  session->internals.resumed = RESUME_TRUE;
+  ret = ticket_restore_session (session, &state, 1);
 
-  return 0;
+cleanup:
+  gnutls_free (state.data);
+  return ret;
 }
 
+/* Encrypts the current session into a ticket, ready to be sent. */
 static int
 encrypt_ticket (gnutls_session_t session, session_ticket_ext_st * priv,
-                struct ticket *ticket)
+                gnutls_datum_t * ticket)
 {
   cipher_hd_st cipher_hd;
-  gnutls_datum_t key, IV, mac_secret, state, encrypted_state;
-  int blocksize;
+  gnutls_datum_t state;
+  uint8_t *p;
   int ret;
 
   /* Pack security parameters. */
-  ret = _gnutls_session_pack (session, &state);
+  ret = _gnutls_session_pack_compact (session, &state);
   if (ret < 0)
     {
       gnutls_assert ();
       return ret;
     }
-  blocksize = gnutls_cipher_get_block_size (GNUTLS_CIPHER_AES_128_CBC);
 
-  encrypted_state.size =
-    ((state.size + blocksize - 1) / blocksize) * blocksize;
-  encrypted_state.data = gnutls_malloc (encrypted_state.size);
-  if (!encrypted_state.data)
+  ticket->size = AEAD_HEADER_SIZE + state.size + AEAD_TAG_SIZE;
+  if (ticket->size > 0xffff)
     {
       gnutls_assert ();
-      _gnutls_free_datum (&state);
-      return GNUTLS_E_MEMORY_ERROR;
+      ret = GNUTLS_E_INTERNAL_ERROR;
+      goto cleanup;
     }
-  memset (encrypted_state.data, 0, encrypted_state.size);
-  memcpy (encrypted_state.data, state.data, state.size);
-  _gnutls_free_datum (&state);
 
-  /* Encrypt state using 128-bit AES in CBC mode. */
-  key.data = (void *) &priv->key[KEY_POS];
-  key.size = KEY_SIZE;
-  IV.data = priv->session_ticket_IV;
-  IV.size = IV_SIZE;
-  ret =
-    _gnutls_cipher_init (&cipher_hd, GNUTLS_CIPHER_AES_128_CBC, &key, &IV, 1);
+  ticket->data = gnutls_malloc (ticket->size);
+  if (ticket->data == NULL)
+    {
+      gnutls_assert ();
+      ret = GNUTLS_E_MEMORY_ERROR;
+      goto cleanup;
+    }
+  p = ticket->data;
+
+  ret = ticket_handles_get (priv, NULL, 1, &cipher_hd, NULL, p);
   if (ret < 0)
     {
       gnutls_assert ();
-      _gnutls_free_datum (&encrypted_state);
-      return ret;
+      goto fail;
     }
+  p += KEY_NAME_SIZE;
 
-  ret = _gnutls_cipher_encrypt (&cipher_hd, encrypted_state.data,
-                                encrypted_state.size);
-  _gnutls_cipher_deinit (&cipher_hd);
+  *p++ = TICKET_VERSION;
+
+  ret = _gnutls_rnd (GNUTLS_RND_NONCE, p, AEAD_NONCE_SIZE);
   if (ret < 0)
     {
       gnutls_assert ();
-      _gnutls_free_datum (&encrypted_state);
-      return ret;
+      _gnutls_cipher_deinit (&cipher_hd);
+      goto fail;
     }
 
-  /* Fill the ticket structure to compute MAC. */
-  memcpy (ticket->key_name, &priv->key[NAME_POS], KEY_NAME_SIZE);
-  memcpy (ticket->IV, IV.data, IV.size);
-  ticket->encrypted_state_len = encrypted_state.size;
-  ticket->encrypted_state = encrypted_state.data;
+  /* Encrypt state using 128-bit AES in GCM mode. */
+  _gnutls_cipher_setiv (&cipher_hd, p, AEAD_NONCE_SIZE);
+  p += AEAD_NONCE_SIZE;
 
-  mac_secret.data = &priv->key[MAC_SECRET_POS];
-  mac_secret.size = MAC_SECRET_SIZE;
-  ret = digest_ticket (&mac_secret, ticket, ticket->mac);
+  ret = _gnutls_cipher_auth (&cipher_hd, ticket->data, KEY_NAME_SIZE + 1);
+  if (ret >= 0)
+    ret = _gnutls_cipher_encrypt2 (&cipher_hd, state.data, state.size,
+                                   p, state.size);
+  if (ret >= 0)
+    _gnutls_cipher_tag (&cipher_hd, p + state.size, AEAD_TAG_SIZE);
+  _gnutls_cipher_deinit (&cipher_hd);
   if (ret < 0)
     {
       gnutls_assert ();
-      _gnutls_free_datum (&encrypted_state);
-      return ret;
+      goto fail;
     }
 
-  return 0;
+  ret = 0;
+  goto cleanup;
+
+fail:
+  _gnutls_free_datum (ticket);
+cleanup:
+  _gnutls_free_datum (&state);
+  return ret;
 }
 
 static int
@@ -282,8 +565,7 @@ session_ticket_recv_params (gnutls_session_t session,
 
   if (session->security_parameters.entity == GNUTLS_SERVER)
     {
-      struct ticket ticket;
-      const uint8_t *encrypted_state;
+      const uint8_t *key_name;
       int ret;
 
       /* The client requested a new session ticket. */
@@ -294,44 +576,14 @@ session_ticket_recv_params (gnutls_session_t session,
         }
 
       DECR_LEN (data_size, KEY_NAME_SIZE);
-      memcpy (ticket.key_name, data, KEY_NAME_SIZE);
+      key_name = data;
       data += KEY_NAME_SIZE;
 
-      /* If the key name of the ticket does not match the one that we
-         hold, issue a new ticket. */
-      if (memcmp (ticket.key_name, &priv->key[NAME_POS], KEY_NAME_SIZE))
-        {
-          priv->session_ticket_renew = 1;
-          return 0;
-        }
-
-      DECR_LEN (data_size, IV_SIZE);
-      memcpy (ticket.IV, data, IV_SIZE);
-      data += IV_SIZE;
-
-      DECR_LEN (data_size, 2);
-      ticket.encrypted_state_len = _gnutls_read_uint16 (data);
-      data += 2;
-
-      encrypted_state = data;
-
-      DECR_LEN (data_size, ticket.encrypted_state_len);
-      data += ticket.encrypted_state_len;
-
-      DECR_LEN (data_size, MAC_SIZE);
-      memcpy (ticket.mac, data, MAC_SIZE);
-
-      ticket.encrypted_state = gnutls_malloc (ticket.encrypted_state_len);
-      if (!ticket.encrypted_state)
-        {
-          gnutls_assert ();
-          return GNUTLS_E_MEMORY_ERROR;
-        }
-      memcpy (ticket.encrypted_state, encrypted_state,
-              ticket.encrypted_state_len);
-
-      ret = decrypt_ticket (session, priv, &ticket);
-      gnutls_free (ticket.encrypted_state);
+      /* If the key name of the ticket does not match any key that we
+         hold, the decryption fails and a new ticket is issued. */
+      ret = decrypt_ticket (session, priv, key_name, data, data_size);
+      if (ret < 0 && is_legacy_ticket (data, data_size))
+        ret = decrypt_legacy_ticket (session, priv, key_name, data);
       if (ret < 0)
         {
           priv->session_ticket_renew = 1;
@@ -407,6 +659,33 @@ session_ticket_send_params (gnutls_session_t session,
 }
 
 
+/* Points @ticket to the ticket the client holds for the session.
+ * Returns GNUTLS_E_INVALID_REQUEST if it holds none.
+ */
+int
+_gnutls_session_ticket_get (gnutls_session_t session,
+                            gnutls_datum_t * ticket)
+{
+  session_ticket_ext_st *priv;
+  extension_priv_data_t epriv;
+  int ret;
+
+  ret =
+    _gnutls_ext_get_session_data (session, GNUTLS_EXTENSION_SESSION_TICKET,
+                                  &epriv);
+  if (ret < 0)
+    return GNUTLS_E_INVALID_REQUEST;
+  priv = epriv.ptr;
+
+  if (priv->session_ticket_len <= 0)
+    return GNUTLS_E_INVALID_REQUEST;
+
+  ticket->data = priv->session_ticket;
+  ticket->size = priv->session_ticket_len;
+
+  return 0;
+}
+
 static void
 session_ticket_deinit_data (extension_priv_data_t epriv)
 {
@@ -536,7 +815,6 @@ int
 gnutls_session_ticket_enable_server (gnutls_session_t session,
                                      const gnutls_datum_t * key)
 {
-  int ret;
   session_ticket_ext_st *priv = NULL;
   extension_priv_data_t epriv;
 
@@ -555,14 +833,209 @@ gnutls_session_ticket_enable_server (gnutls_session_t session,
     }
   epriv.ptr = priv;
 
-  ret = _gnutls_rnd (GNUTLS_RND_NONCE, priv->session_ticket_IV, IV_SIZE);
+  memcpy (&priv->key, key->data, key->size);
+  priv->session_ticket_enable = 1;
+
+  _gnutls_ext_set_session_data (session,
+                                GNUTLS_EXTENSION_SESSION_TICKET, epriv);
+
+  return 0;
+}
+
+static void
+ticket_key_deinit (ticket_key_st * k)
+{
+  _gnutls_cipher_deinit (&k->aead);
+  _gnutls_cipher_deinit (&k->dec);
+  _gnutls_hmac_deinit (&k->mac, NULL);
+  memset (k->key, 0, sizeof (k->key));
+  gnutls_free (k);
+}
+
+/**
+ * gnutls_session_ticket_keys_init:
+ * @keys: is a pointer to a #gnutls_session_ticket_keys_t structure.
+ * @max_keys: the number of keys to keep, or zero for the default (3)
+ *
+ * This function initializes a set of session ticket keys that can
+ * be shared by all the server sessions with
+ * gnutls_session_ticket_enable_server_keys(). The set holds one
+ * active key, used to issue new tickets, and up to @max_keys - 1
+ * older keys that are only used to decrypt tickets issued before
+ * a rotation. The AES key schedules and the HMAC state of every key
+ * are computed once, when the key is added.
+ *
+ * Returns: On success, %GNUTLS_E_SUCCESS (0) is returned, or an
+ * error code.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_session_ticket_keys_init (gnutls_session_ticket_keys_t * keys,
+                                 unsigned int max_keys)
+{
+  gnutls_session_ticket_keys_t k;
+  int ret;
+
+  if (max_keys == 0)
+    max_keys = DEFAULT_MAX_TICKET_KEYS;
+
+  k = gnutls_calloc (1, sizeof (*k));
+  if (k == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  k->keys = gnutls_calloc (max_keys, sizeof (k->keys[0]));
+  if (k->keys == NULL)
+    {
+      gnutls_free (k);
+      return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+    }
+  k->max_keys = max_keys;
+
+  ret = gnutls_mutex_init (&k->mutex);
   if (ret < 0)
     {
       gnutls_assert ();
+      gnutls_free (k->keys);
+      gnutls_free (k);
       return ret;
     }
 
-  memcpy (&priv->key, key->data, key->size);
+  *keys = k;
+  return 0;
+}
+
+/**
+ * gnutls_session_ticket_keys_deinit:
+ * @keys: is a #gnutls_session_ticket_keys_t structure.
+ *
+ * This function deinitializes the given set of session ticket keys.
+ * It must not be called while sessions that use it exist.
+ *
+ * Since: 3.1.6
+ **/
+void
+gnutls_session_ticket_keys_deinit (gnutls_session_ticket_keys_t keys)
+{
+  unsigned int i;
+
+  if (keys == NULL)
+    return;
+
+  for (i = 0; i < keys->nkeys; i++)
+    ticket_key_deinit (keys->keys[i]);
+
+  gnutls_mutex_deinit (&keys->mutex);
+  gnutls_free (keys->keys);
+  gnutls_free (keys);
+}
+
+/**
+ * gnutls_session_ticket_keys_add:
+ * @keys: is a #gnutls_session_ticket_keys_t structure.
+ * @key: a key generated with gnutls_session_ticket_key_generate()
+ *
+ * This function adds @key to the given set and makes it the active
+ * key, i.e., the key used to encrypt new tickets. The previously
+ * active keys are kept for decryption only, and the oldest one is
+ * discarded once the set holds the maximum number of keys. Tickets
+ * issued under a discarded key are no longer accepted, and a full
+ * handshake is performed instead.
+ *
+ * This function may be called while the set is in use by sessions.
+ *
+ * Returns: On success, %GNUTLS_E_SUCCESS (0) is returned, or an
+ * error code.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_session_ticket_keys_add (gnutls_session_ticket_keys_t keys,
+                                const gnutls_datum_t * key)
+{
+  ticket_key_st *k, *old = NULL;
+  int ret;
+
+  if (keys == NULL || key == NULL || key->size != SESSION_KEY_SIZE)
+    return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST);
+
+  k = gnutls_calloc (1, sizeof (*k));
+  if (k == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  memcpy (k->key, key->data, SESSION_KEY_SIZE);
+
+  ret = ticket_handles_init (k->key, 1, &k->aead, NULL);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      gnutls_free (k);
+      return ret;
+    }
+
+  ret = ticket_handles_init (k->key, 0, &k->dec, &k->mac);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      _gnutls_cipher_deinit (&k->aead);
+      gnutls_free (k);
+      return ret;
+    }
+
+  KEYS_LOCK (keys);
+  if (keys->nkeys == keys->max_keys)
+    old = keys->keys[--keys->nkeys];
+
+  memmove (&keys->keys[1], &keys->keys[0],
+           keys->nkeys * sizeof (keys->keys[0]));
+  keys->keys[0] = k;
+  keys->nkeys++;
+  KEYS_UNLOCK (keys);
+
+  if (old != NULL)
+    ticket_key_deinit (old);
+
+  return 0;
+}
+
+/**
+ * gnutls_session_ticket_enable_server_keys:
+ * @session: is a #gnutls_session_t structure.
+ * @keys: is a #gnutls_session_ticket_keys_t structure.
+ *
+ * Request that the server should attempt session resumption using
+ * SessionTicket, with the keys in @keys. New tickets are encrypted
+ * with the active key, and tickets encrypted with any key in the set
+ * are accepted. @keys must contain at least one key and must remain
+ * valid for the lifetime of the session.
+ *
+ * Returns: On success, %GNUTLS_E_SUCCESS (0) is returned, or an
+ * error code.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_session_ticket_enable_server_keys (gnutls_session_t session,
+                                          gnutls_session_ticket_keys_t keys)
+{
+  session_ticket_ext_st *priv = NULL;
+  extension_priv_data_t epriv;
+
+  if (!session || !keys || keys->nkeys == 0)
+    {
+      gnutls_assert ();
+      return GNUTLS_E_INVALID_REQUEST;
+    }
+
+  priv = gnutls_calloc (1, sizeof (*priv));
+  if (priv == NULL)
+    {
+      gnutls_assert ();
+      return GNUTLS_E_MEMORY_ERROR;
+    }
+  epriv.ptr = priv;
+
+  priv->keys = keys;
   priv->session_ticket_enable = 1;
 
   _gnutls_ext_set_session_data (session,
@@ -578,8 +1051,7 @@ _gnutls_send_new_session_ticket (gnutls_session_t session, int again)
   uint8_t *data = NULL, *p;
   int data_size = 0;
   int ret;
-  struct ticket ticket;
-  uint16_t ticket_len;
+  gnutls_datum_t ticket;
   session_ticket_ext_st *priv = NULL;
   extension_priv_data_t epriv;
   uint16_t epoch_saved = session->security_parameters.epoch_write;
@@ -621,14 +1093,12 @@ _gnutls_send_new_session_ticket (gnutls_session_t session, int again)
           return ret;
         }
 
-      ticket_len = KEY_NAME_SIZE + IV_SIZE + 2 + ticket.encrypted_state_len
-        + MAC_SIZE;
-
-      bufel = _gnutls_handshake_alloc (session, 4 + 2 + ticket_len, 4+2+ticket_len);
+      bufel = _gnutls_handshake_alloc (session, 4 + 2 + ticket.size,
+                                       4 + 2 + ticket.size);
       if (!bufel)
         {
           gnutls_assert ();
-          gnutls_free (ticket.encrypted_state);
+          _gnutls_free_datum (&ticket);
           return GNUTLS_E_MEMORY_ERROR;
         }
 
@@ -638,24 +1108,12 @@ _gnutls_send_new_session_ticket (gnutls_session_t session, int again)
       _gnutls_write_uint32 (session->internals.expire_time, p);
       p += 4;
 
-      _gnutls_write_uint16 (ticket_len, p);
+      _gnutls_write_uint16 (ticket.size, p);
       p += 2;
 
-      memcpy (p, ticket.key_name, KEY_NAME_SIZE);
-      p += KEY_NAME_SIZE;
-
-      memcpy (p, ticket.IV, IV_SIZE);
-      p += IV_SIZE;
-
-      _gnutls_write_uint16 (ticket.encrypted_state_len, p);
-      p += 2;
-
-      memcpy (p, ticket.encrypted_state, ticket.encrypted_state_len);
-      gnutls_free (ticket.encrypted_state);
-      p += ticket.encrypted_state_len;
-
-      memcpy (p, ticket.mac, MAC_SIZE);
-      p += MAC_SIZE;
+      memcpy (p, ticket.data, ticket.size);
+      p += ticket.size;
+      _gnutls_free_datum (&ticket);
 
       data_size = p - data;
       
@@ -75,7 +75,7 @@ _gnutls_sign_algorithm_write_params (gnutls_session_t session, uint8_t * data,
   unsigned int len, i, j;
   const sign_algorithm_st *aid;
 
-  if (max_data_size < (session->internals.priorities.sign_algo.algorithms*2) + 2)
+  if (max_data_size < (session->internals.priorities->sign_algo.algorithms*2) + 2)
     {
       gnutls_assert ();
       return GNUTLS_E_SHORT_MEMORY_BUFFER;
@@ -86,17 +86,17 @@ _gnutls_sign_algorithm_write_params (gnutls_session_t session, uint8_t * data,
 
   p += 2;
 
-  for (i = j = 0; j < session->internals.priorities.sign_algo.algorithms; i += 2, j++)
+  for (i = j = 0; j < session->internals.priorities->sign_algo.algorithms; i += 2, j++)
     {
       aid =
-        _gnutls_sign_to_tls_aid (session->internals.priorities.
+        _gnutls_sign_to_tls_aid (session->internals.priorities->
                                  sign_algo.priority[j]);
 
       if (aid == NULL)
         continue;
         
        _gnutls_handshake_log ("EXT[%p]: sent signature algo (%d.%d) %s\n", session, aid->hash_algorithm, 
-         aid->sign_algorithm, gnutls_sign_get_name(session->internals.priorities.sign_algo.priority[j]));
+         aid->sign_algorithm, gnutls_sign_get_name(session->internals.priorities->sign_algo.priority[j]));
       *p = aid->hash_algorithm;
       p++;
       *p = aid->sign_algorithm;
@@ -219,7 +219,7 @@ _gnutls_signature_algorithm_send_params (gnutls_session_t session,
   if (session->security_parameters.entity == GNUTLS_CLIENT
       && _gnutls_version_has_selectable_sighash (ver))
     {
-      if (session->internals.priorities.sign_algo.algorithms > 0)
+      if (session->internals.priorities->sign_algo.algorithms > 0)
         {
           uint8_t p[MAX_SIGN_ALGO_SIZE];
 
@@ -317,9 +317,9 @@ _gnutls_session_sign_algo_enabled (gnutls_session_t session,
       return 0;
     }
 
-  for (i = 0; i < session->internals.priorities.sign_algo.algorithms; i++)
+  for (i = 0; i < session->internals.priorities->sign_algo.algorithms; i++)
     {
-      if (session->internals.priorities.sign_algo.priority[i] == sig)
+      if (session->internals.priorities->sign_algo.priority[i] == sig)
         {
           return 0;             /* ok */
         }
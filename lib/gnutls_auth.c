@@ -340,6 +340,7 @@ _gnutls_free_auth_info (gnutls_session_t session)
 
         dh_info = &info->dh;
         rsa_info = &info->rsa_export;
+        _gnutls_free_peer_x509_crts (info);
         for (i = 0; i < info->ncerts; i++)
           {
             _gnutls_free_datum (&info->raw_certificate_list[i]);
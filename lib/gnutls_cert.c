@@ -38,6 +38,7 @@
 #include <gnutls_x509.h>
 #include <gnutls_str_array.h>
 #include "x509/x509_int.h"
+#include "x509/verify-high.h"
 #ifdef ENABLE_OPENPGP
 #include "openpgp/gnutls_openpgp.h"
 #endif
@@ -66,6 +67,7 @@ gnutls_certificate_free_keys (gnutls_certificate_credentials_t sc)
         }
       gnutls_free (sc->certs[i].cert_list);
       _gnutls_str_array_clear (&sc->certs[i].names);
+      _gnutls_free_datum (&sc->certs[i].cert_msg);
     }
 
   gnutls_free (sc->certs);
@@ -80,6 +82,11 @@ gnutls_certificate_free_keys (gnutls_certificate_credentials_t sc)
   sc->pkey = NULL;
 
   sc->ncerts = 0;
+
+  _gnutls_sni_index_clear (sc->sni_index);
+
+  _gnutls_lazy_certs_deinit (sc->lazy_certs);
+  sc->lazy_certs = NULL;
 }
 
 /**
@@ -192,10 +199,12 @@ _gnutls_certificate_get_rsa_params (gnutls_rsa_params_t rsa_params,
 void
 gnutls_certificate_free_credentials (gnutls_certificate_credentials_t sc)
 {
-  gnutls_x509_trust_list_deinit(sc->tlist, 1);
+  _gnutls_trustlist_unref(sc->tlist);
   gnutls_certificate_free_keys (sc);
   gnutls_certificate_free_ca_names (sc);
   gnutls_free(sc->ocsp_response_file);
+  _gnutls_chain_cache_deinit (sc->chain_cache);
+  _gnutls_sni_index_deinit (sc->sni_index);
 
 #ifdef ENABLE_OPENPGP
   gnutls_openpgp_keyring_deinit (sc->keyring);
@@ -232,6 +241,16 @@ int ret;
       gnutls_free(*res);
       return GNUTLS_E_MEMORY_ERROR;
     }
+
+  ret = _gnutls_sni_index_init (&(*res)->sni_index);
+  if (ret < 0)
+    {
+      gnutls_assert();
+      gnutls_x509_trust_list_deinit((*res)->tlist, 1);
+      gnutls_free(*res);
+      return ret;
+    }
+
   (*res)->verify_bits = DEFAULT_MAX_VERIFY_BITS;
   (*res)->verify_depth = DEFAULT_MAX_VERIFY_DEPTH;
 
@@ -504,74 +523,6 @@ void
   cred->verify_callback = func;
 }
 
-/*-
- * _gnutls_x509_extract_certificate_activation_time - return the peer's certificate activation time
- * @cert: should contain an X.509 DER encoded certificate
- *
- * This function will return the certificate's activation time in UNIX time
- * (ie seconds since 00:00:00 UTC January 1, 1970).
- *
- * Returns a (time_t) -1 in case of an error.
- *
- -*/
-static time_t
-_gnutls_x509_get_raw_crt_activation_time (const gnutls_datum_t * cert)
-{
-  gnutls_x509_crt_t xcert;
-  time_t result;
-
-  result = gnutls_x509_crt_init (&xcert);
-  if (result < 0)
-    return (time_t) - 1;
-
-  result = gnutls_x509_crt_import (xcert, cert, GNUTLS_X509_FMT_DER);
-  if (result < 0)
-    {
-      gnutls_x509_crt_deinit (xcert);
-      return (time_t) - 1;
-    }
-
-  result = gnutls_x509_crt_get_activation_time (xcert);
-
-  gnutls_x509_crt_deinit (xcert);
-
-  return result;
-}
-
-/*-
- * gnutls_x509_extract_certificate_expiration_time:
- * @cert: should contain an X.509 DER encoded certificate
- *
- * This function will return the certificate's expiration time in UNIX
- * time (ie seconds since 00:00:00 UTC January 1, 1970).  Returns a
- *
- * (time_t) -1 in case of an error.
- *
- -*/
-static time_t
-_gnutls_x509_get_raw_crt_expiration_time (const gnutls_datum_t * cert)
-{
-  gnutls_x509_crt_t xcert;
-  time_t result;
-
-  result = gnutls_x509_crt_init (&xcert);
-  if (result < 0)
-    return (time_t) - 1;
-
-  result = gnutls_x509_crt_import (xcert, cert, GNUTLS_X509_FMT_DER);
-  if (result < 0)
-    {
-      gnutls_x509_crt_deinit (xcert);
-      return (time_t) - 1;
-    }
-
-  result = gnutls_x509_crt_get_expiration_time (xcert);
-
-  gnutls_x509_crt_deinit (xcert);
-
-  return result;
-}
-
 #ifdef ENABLE_OPENPGP
 /*-
  * _gnutls_openpgp_crt_verify_peers - return the peer's certificate status
@@ -664,30 +615,7 @@ int
 gnutls_certificate_verify_peers2 (gnutls_session_t session,
                                   unsigned int *status)
 {
-  cert_auth_info_t info;
-
-  CHECK_AUTH (GNUTLS_CRD_CERTIFICATE, GNUTLS_E_INVALID_REQUEST);
-
-  info = _gnutls_get_auth_info (session);
-  if (info == NULL)
-    {
-      return GNUTLS_E_NO_CERTIFICATE_FOUND;
-    }
-
-  if (info->raw_certificate_list == NULL || info->ncerts == 0)
-    return GNUTLS_E_NO_CERTIFICATE_FOUND;
-
-  switch (gnutls_certificate_type_get (session))
-    {
-    case GNUTLS_CRT_X509:
-      return _gnutls_x509_cert_verify_peers (session, NULL, status);
-#ifdef ENABLE_OPENPGP
-    case GNUTLS_CRT_OPENPGP:
-      return _gnutls_openpgp_crt_verify_peers (session, NULL, status);
-#endif
-    default:
-      return GNUTLS_E_INVALID_REQUEST;
-    }
+  return gnutls_certificate_verify_peers3 (session, NULL, status);
 }
 
 /**
@@ -709,6 +637,12 @@ gnutls_certificate_verify_peers2 (gnutls_session_t session,
  * If available the OCSP Certificate Status extension will be
  * utilized by this function.
  * 
+ * The result of the verification of an X.509 chain is kept in the
+ * session data, and it is reported without verifying the chain again
+ * on a resumed session, as long as the trust list and the
+ * verification flags are unchanged and the certificates are within
+ * their validity period.
+ *
  * To avoid denial of service attacks some
  * default upper limits regarding the certificate key size and chain
  * size are set. To override them use gnutls_certificate_set_verify_limits().
@@ -723,6 +657,7 @@ gnutls_certificate_verify_peers3 (gnutls_session_t session,
                                   unsigned int *status)
 {
   cert_auth_info_t info;
+  int ret;
 
   CHECK_AUTH (GNUTLS_CRD_CERTIFICATE, GNUTLS_E_INVALID_REQUEST);
 
@@ -732,8 +667,14 @@ gnutls_certificate_verify_peers3 (gnutls_session_t session,
       return GNUTLS_E_NO_CERTIFICATE_FOUND;
     }
 
-  if (info->raw_certificate_list == NULL || info->ncerts == 0)
-    return GNUTLS_E_NO_CERTIFICATE_FOUND;
+  /* an X.509 chain that is no longer in the chain cache may
+   * still have a valid verification result, if it was stored for
+   * that chain. */
+  ret = _gnutls_peer_chain_restore (session, info);
+  if (ret < 0 && (info->verify.done == 0 ||
+                  memcmp (info->verify.chain, info->chain_digest,
+                          CHAIN_DIGEST_SIZE) != 0))
+    return ret;
 
   switch (gnutls_certificate_type_get (session))
     {
@@ -741,6 +682,8 @@ gnutls_certificate_verify_peers3 (gnutls_session_t session,
       return _gnutls_x509_cert_verify_peers (session, hostname, status);
 #ifdef ENABLE_OPENPGP
     case GNUTLS_CRT_OPENPGP:
+      if (info->raw_certificate_list == NULL || info->ncerts == 0)
+        return GNUTLS_E_NO_CERTIFICATE_FOUND;
       return _gnutls_openpgp_crt_verify_peers (session, hostname, status);
 #endif
     default:
@@ -762,6 +705,7 @@ time_t
 gnutls_certificate_expiration_time_peers (gnutls_session_t session)
 {
   cert_auth_info_t info;
+  gnutls_x509_crt_t *crts;
 
   CHECK_AUTH (GNUTLS_CRD_CERTIFICATE, GNUTLS_E_INVALID_REQUEST);
 
@@ -771,7 +715,8 @@ gnutls_certificate_expiration_time_peers (gnutls_session_t session)
       return (time_t) - 1;
     }
 
-  if (info->raw_certificate_list == NULL || info->ncerts == 0)
+  if (_gnutls_peer_chain_restore (session, info) < 0 ||
+      info->raw_certificate_list == NULL || info->ncerts == 0)
     {
       gnutls_assert ();
       return (time_t) - 1;
@@ -780,9 +725,9 @@ gnutls_certificate_expiration_time_peers (gnutls_session_t session)
   switch (gnutls_certificate_type_get (session))
     {
     case GNUTLS_CRT_X509:
-      return
-        _gnutls_x509_get_raw_crt_expiration_time (&info->raw_certificate_list
-                                                  [0]);
+      if (_gnutls_get_peer_x509_crts (info, &crts) < 0)
+        return (time_t) - 1;
+      return gnutls_x509_crt_get_expiration_time (crts[0]);
 #ifdef ENABLE_OPENPGP
     case GNUTLS_CRT_OPENPGP:
       return
@@ -809,6 +754,7 @@ time_t
 gnutls_certificate_activation_time_peers (gnutls_session_t session)
 {
   cert_auth_info_t info;
+  gnutls_x509_crt_t *crts;
 
   CHECK_AUTH (GNUTLS_CRD_CERTIFICATE, GNUTLS_E_INVALID_REQUEST);
 
@@ -818,7 +764,8 @@ gnutls_certificate_activation_time_peers (gnutls_session_t session)
       return (time_t) - 1;
     }
 
-  if (info->raw_certificate_list == NULL || info->ncerts == 0)
+  if (_gnutls_peer_chain_restore (session, info) < 0 ||
+      info->raw_certificate_list == NULL || info->ncerts == 0)
     {
       gnutls_assert ();
       return (time_t) - 1;
@@ -827,9 +774,9 @@ gnutls_certificate_activation_time_peers (gnutls_session_t session)
   switch (gnutls_certificate_type_get (session))
     {
     case GNUTLS_CRT_X509:
-      return
-        _gnutls_x509_get_raw_crt_activation_time (&info->raw_certificate_list
-                                                  [0]);
+      if (_gnutls_get_peer_x509_crts (info, &crts) < 0)
+        return (time_t) - 1;
+      return gnutls_x509_crt_get_activation_time (crts[0]);
 #ifdef ENABLE_OPENPGP
     case GNUTLS_CRT_OPENPGP:
       return
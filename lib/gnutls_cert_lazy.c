@@ -0,0 +1,707 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * The GnuTLS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+
+/* This file contains the certificates of a server's credentials that
+ * are registered by name, and only loaded the first time a client asks
+ * for that name. The loaded chains are kept in a bounded LRU list, and
+ * are reference counted so that the sessions which use a chain keep it
+ * alive after it is evicted.
+ */
+
+#include <gnutls_int.h>
+#include <gnutls_errors.h>
+#include <gnutls_datum.h>
+#include <gnutls_str.h>
+#include <gnutls/abstract.h>
+#include <auth/cert.h>
+#include <gnutls_cert_lazy.h>
+#include <c-strcase.h>
+#include <locks.h>
+
+#define LAZY_INITIAL_BUCKETS 16
+#define LAZY_DEFAULT_MAX_LOADED 256
+
+typedef struct lazy_chain_st
+{
+  void *mutex;
+  unsigned int refcount;
+
+  gnutls_pcert_st *cert_list;
+  unsigned int cert_list_length;
+  gnutls_datum_t cert_msg;
+  gnutls_privkey_t pkey;
+  gnutls_pk_algorithm_t pk;
+} lazy_chain_st;
+
+typedef struct lazy_entry_st
+{
+  struct lazy_entry_st *next;   /* in the hash bucket */
+  struct lazy_entry_st *lru_prev;       /* towards the most recent */
+  struct lazy_entry_st *lru_next;       /* towards the least recent */
+  unsigned int hash;
+  char *name;
+
+  /* where the chain and key are loaded from; either files or a copy
+   * of the data */
+  char *certfile;
+  char *keyfile;
+  gnutls_datum_t cert;
+  gnutls_datum_t key;
+  gnutls_x509_crt_fmt_t type;
+
+  lazy_chain_st *chain;         /* when loaded */
+  unsigned int failed:1;        /* set when loading failed */
+} lazy_entry_st;
+
+struct lazy_certs_st
+{
+  void *mutex;
+
+  lazy_entry_st **buckets;
+  unsigned int nbuckets;
+  unsigned int nentries;
+
+  /* the entries whose chain is loaded */
+  lazy_entry_st *lru_head;
+  lazy_entry_st *lru_tail;
+  unsigned int nloaded;
+  unsigned int max_loaded;
+};
+
+#define STORE_LOCK(s) if (gnutls_mutex_lock(&(s)->mutex)!=0) abort()
+#define STORE_UNLOCK(s) if (gnutls_mutex_unlock(&(s)->mutex)!=0) abort()
+#define CHAIN_LOCK(c) if (gnutls_mutex_lock(&(c)->mutex)!=0) abort()
+#define CHAIN_UNLOCK(c) if (gnutls_mutex_unlock(&(c)->mutex)!=0) abort()
+
+static void
+chain_free (lazy_chain_st * c)
+{
+  unsigned int i;
+
+  for (i = 0; i < c->cert_list_length; i++)
+    gnutls_pcert_deinit (&c->cert_list[i]);
+  gnutls_free (c->cert_list);
+  _gnutls_free_datum (&c->cert_msg);
+  gnutls_privkey_deinit (c->pkey);
+  gnutls_mutex_deinit (&c->mutex);
+  gnutls_free (c);
+}
+
+static void
+chain_ref (lazy_chain_st * c)
+{
+  CHAIN_LOCK (c);
+  c->refcount++;
+  CHAIN_UNLOCK (c);
+}
+
+static void
+chain_release (void *ptr)
+{
+  lazy_chain_st *c = ptr;
+  unsigned int refcount;
+
+  CHAIN_LOCK (c);
+  refcount = --c->refcount;
+  CHAIN_UNLOCK (c);
+
+  if (refcount == 0)
+    chain_free (c);
+}
+
+/* Loads the chain and key of the entry, using temporary credentials
+ * to parse them. Does not access the store, and may run concurrently.
+ */
+static int
+chain_load (const lazy_entry_st * e, const struct pin_info_st *pin,
+            lazy_chain_st ** chain)
+{
+  gnutls_certificate_credentials_t tmp;
+  lazy_chain_st *c;
+  int ret;
+
+  ret = gnutls_certificate_allocate_credentials (&tmp);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  tmp->pin = *pin;
+
+  if (e->certfile != NULL)
+    ret = gnutls_certificate_set_x509_key_file (tmp, e->certfile,
+                                                e->keyfile, e->type);
+  else
+    ret = gnutls_certificate_set_x509_key_mem (tmp, &e->cert, &e->key,
+                                               e->type);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      goto cleanup;
+    }
+
+  if (tmp->ncerts != 1 || tmp->certs[0].cert_list_length == 0)
+    {
+      gnutls_assert ();
+      ret = GNUTLS_E_INTERNAL_ERROR;
+      goto cleanup;
+    }
+
+  c = gnutls_calloc (1, sizeof (*c));
+  if (c == NULL)
+    {
+      gnutls_assert ();
+      ret = GNUTLS_E_MEMORY_ERROR;
+      goto cleanup;
+    }
+
+  ret = gnutls_mutex_init (&c->mutex);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      gnutls_free (c);
+      goto cleanup;
+    }
+
+  /* take the chain and key over from the credentials */
+  c->cert_list = tmp->certs[0].cert_list;
+  c->cert_list_length = tmp->certs[0].cert_list_length;
+  c->cert_msg = tmp->certs[0].cert_msg;
+  c->pkey = tmp->pkey[0];
+  c->pk = gnutls_pubkey_get_pk_algorithm (c->cert_list[0].pubkey, NULL);
+  c->refcount = 1;
+
+  tmp->certs[0].cert_list = NULL;
+  tmp->certs[0].cert_list_length = 0;
+  tmp->certs[0].cert_msg.data = NULL;
+  tmp->certs[0].cert_msg.size = 0;
+  tmp->pkey[0] = NULL;
+
+  *chain = c;
+  ret = 0;
+
+cleanup:
+  gnutls_certificate_free_credentials (tmp);
+  return ret;
+}
+
+static void
+lru_unlink (lazy_certs_st * s, lazy_entry_st * e)
+{
+  if (e->lru_prev)
+    e->lru_prev->lru_next = e->lru_next;
+  else
+    s->lru_head = e->lru_next;
+
+  if (e->lru_next)
+    e->lru_next->lru_prev = e->lru_prev;
+  else
+    s->lru_tail = e->lru_prev;
+
+  e->lru_prev = e->lru_next = NULL;
+}
+
+static void
+lru_push_front (lazy_certs_st * s, lazy_entry_st * e)
+{
+  e->lru_prev = NULL;
+  e->lru_next = s->lru_head;
+  if (s->lru_head)
+    s->lru_head->lru_prev = e;
+  s->lru_head = e;
+  if (s->lru_tail == NULL)
+    s->lru_tail = e;
+}
+
+/* Drops the store's reference to the chain of a loaded entry. Must be
+ * called with the store lock held.
+ */
+static void
+entry_unload (lazy_certs_st * s, lazy_entry_st * e)
+{
+  if (e->chain == NULL)
+    return;
+
+  lru_unlink (s, e);
+  s->nloaded--;
+
+  chain_release (e->chain);
+  e->chain = NULL;
+}
+
+static void
+entry_free (lazy_entry_st * e)
+{
+  gnutls_free (e->certfile);
+  gnutls_free (e->keyfile);
+  _gnutls_free_datum (&e->cert);
+  _gnutls_free_datum (&e->key);
+  gnutls_free (e);
+}
+
+static lazy_entry_st *
+entry_find (const lazy_certs_st * s, const char *name, unsigned int hash)
+{
+  lazy_entry_st *e;
+
+  for (e = s->buckets[hash % s->nbuckets]; e != NULL; e = e->next)
+    {
+      if (e->hash == hash && c_strcasecmp (e->name, name) == 0)
+        return e;
+    }
+
+  return NULL;
+}
+
+static int
+store_grow (lazy_certs_st * s)
+{
+  lazy_entry_st **buckets, *e, *next;
+  unsigned int nbuckets = s->nbuckets * 2, i;
+
+  buckets = gnutls_calloc (nbuckets, sizeof (lazy_entry_st *));
+  if (buckets == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  for (i = 0; i < s->nbuckets; i++)
+    {
+      for (e = s->buckets[i]; e != NULL; e = next)
+        {
+          next = e->next;
+          e->next = buckets[e->hash % nbuckets];
+          buckets[e->hash % nbuckets] = e;
+        }
+    }
+
+  gnutls_free (s->buckets);
+  s->buckets = buckets;
+  s->nbuckets = nbuckets;
+
+  return 0;
+}
+
+int
+_gnutls_lazy_certs_init (lazy_certs_st ** store)
+{
+  lazy_certs_st *s;
+  int ret;
+
+  s = gnutls_calloc (1, sizeof (*s));
+  if (s == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  s->buckets = gnutls_calloc (LAZY_INITIAL_BUCKETS, sizeof (lazy_entry_st *));
+  if (s->buckets == NULL)
+    {
+      gnutls_free (s);
+      return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+    }
+  s->nbuckets = LAZY_INITIAL_BUCKETS;
+  s->max_loaded = LAZY_DEFAULT_MAX_LOADED;
+
+  ret = gnutls_mutex_init (&s->mutex);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      gnutls_free (s->buckets);
+      gnutls_free (s);
+      return ret;
+    }
+
+  *store = s;
+
+  return 0;
+}
+
+/* Frees the store. Chains still used by sessions are freed when the
+ * last of them releases it.
+ */
+void
+_gnutls_lazy_certs_deinit (lazy_certs_st * store)
+{
+  lazy_entry_st *e, *next;
+  unsigned int i;
+
+  if (store == NULL)
+    return;
+
+  for (i = 0; i < store->nbuckets; i++)
+    {
+      for (e = store->buckets[i]; e != NULL; e = next)
+        {
+          next = e->next;
+          entry_unload (store, e);
+          entry_free (e);
+        }
+    }
+
+  gnutls_free (store->buckets);
+  gnutls_mutex_deinit (&store->mutex);
+  gnutls_free (store);
+}
+
+/* Registers the chain and key to be loaded for @name, from the given
+ * files or else a copy of the given data. A name registered earlier is
+ * replaced.
+ */
+int
+_gnutls_lazy_certs_register (lazy_certs_st * store, const char *name,
+                             const char *certfile, const char *keyfile,
+                             const gnutls_datum_t * cert,
+                             const gnutls_datum_t * key,
+                             gnutls_x509_crt_fmt_t type)
+{
+  lazy_entry_st *e, **p;
+  size_t len = strlen (name);
+  unsigned int hash = _gnutls_sni_name_hash (name, len);
+  int ret;
+
+  e = gnutls_calloc (1, sizeof (*e) + len + 1);
+  if (e == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  e->hash = hash;
+  e->name = (char *) (e + 1);
+  memcpy (e->name, name, len + 1);
+  e->type = type;
+
+  if (certfile != NULL)
+    {
+      e->certfile = gnutls_strdup (certfile);
+      e->keyfile = gnutls_strdup (keyfile);
+      if (e->certfile == NULL || e->keyfile == NULL)
+        {
+          gnutls_assert ();
+          ret = GNUTLS_E_MEMORY_ERROR;
+          goto fail;
+        }
+    }
+  else
+    {
+      ret = _gnutls_set_datum (&e->cert, cert->data, cert->size);
+      if (ret < 0)
+        {
+          gnutls_assert ();
+          goto fail;
+        }
+
+      ret = _gnutls_set_datum (&e->key, key->data, key->size);
+      if (ret < 0)
+        {
+          gnutls_assert ();
+          goto fail;
+        }
+    }
+
+  STORE_LOCK (store);
+  for (p = &store->buckets[hash % store->nbuckets]; *p != NULL;
+       p = &(*p)->next)
+    {
+      if ((*p)->hash == hash && c_strcasecmp ((*p)->name, name) == 0)
+        {
+          lazy_entry_st *old = *p;
+
+          e->next = old->next;
+          *p = e;
+          entry_unload (store, old);
+          entry_free (old);
+          STORE_UNLOCK (store);
+          return 0;
+        }
+    }
+
+  if (store->nentries >= store->nbuckets && store_grow (store) < 0)
+    {
+      STORE_UNLOCK (store);
+      gnutls_assert ();
+      ret = GNUTLS_E_MEMORY_ERROR;
+      goto fail;
+    }
+
+  e->next = store->buckets[hash % store->nbuckets];
+  store->buckets[hash % store->nbuckets] = e;
+  store->nentries++;
+  STORE_UNLOCK (store);
+
+  return 0;
+
+fail:
+  entry_free (e);
+  return ret;
+}
+
+void
+_gnutls_lazy_certs_set_max (lazy_certs_st * store, unsigned int max_loaded)
+{
+  STORE_LOCK (store);
+  store->max_loaded = max_loaded;
+  while (store->nloaded > store->max_loaded)
+    entry_unload (store, store->lru_tail);
+  STORE_UNLOCK (store);
+}
+
+/* Returns a reference to the chain registered for @name, or else for a
+ * wildcard name that matches it, loading it if needed.
+ */
+static int
+lazy_certs_get (lazy_certs_st * store, const struct pin_info_st *pin,
+                const char *name, lazy_chain_st ** chain)
+{
+  lazy_entry_st *e;
+  lazy_chain_st *c;
+  char wildcard[MAX_CN + 2];
+  int ret;
+
+  STORE_LOCK (store);
+  e = entry_find (store, name, _gnutls_sni_name_hash (name, strlen (name)));
+  if (e == NULL)
+    {
+      ret = _gnutls_sni_wildcard (name, wildcard, sizeof (wildcard));
+      if (ret >= 0)
+        e = entry_find (store, wildcard,
+                        _gnutls_sni_name_hash (wildcard, ret));
+    }
+
+  if (e == NULL || e->failed)
+    {
+      STORE_UNLOCK (store);
+      return GNUTLS_E_NO_CERTIFICATE_FOUND;
+    }
+
+  if (e->chain != NULL)
+    {
+      lru_unlink (store, e);
+      lru_push_front (store, e);
+      chain_ref (e->chain);
+      *chain = e->chain;
+      STORE_UNLOCK (store);
+      return 0;
+    }
+  STORE_UNLOCK (store);
+
+  /* The registered entries are not modified while the credentials are
+   * in use, so this can be done without the lock.
+   */
+  ret = chain_load (e, pin, &c);
+
+  STORE_LOCK (store);
+  if (ret < 0)
+    {
+      _gnutls_debug_log ("Could not load the certificate of '%s': %s\n",
+                         e->name, gnutls_strerror (ret));
+      e->failed = 1;
+      STORE_UNLOCK (store);
+      return gnutls_assert_val (GNUTLS_E_NO_CERTIFICATE_FOUND);
+    }
+
+  /* another thread may have loaded it meanwhile */
+  if (e->chain != NULL)
+    {
+      chain_release (c);
+      lru_unlink (store, e);
+    }
+  else
+    {
+      e->chain = c;
+      store->nloaded++;
+    }
+  lru_push_front (store, e);
+
+  while (store->nloaded > store->max_loaded && store->lru_tail != e)
+    entry_unload (store, store->lru_tail);
+
+  chain_ref (e->chain);
+  *chain = e->chain;
+  STORE_UNLOCK (store);
+
+  return 0;
+}
+
+/* Selects the chain registered for the requested server name, if its
+ * algorithm is one of @pk_algos. Returns zero if one was selected.
+ */
+int
+_gnutls_lazy_certs_select (gnutls_session_t session, lazy_certs_st * store,
+                           const struct pin_info_st *pin,
+                           const char *server_name,
+                           const gnutls_pk_algorithm_t * pk_algos,
+                           size_t pk_algos_size)
+{
+  lazy_chain_st *c;
+  size_t j;
+  int ret;
+
+  if (session->security_parameters.cert_type != GNUTLS_CRT_X509)
+    return GNUTLS_E_NO_CERTIFICATE_FOUND;
+
+  ret = lazy_certs_get (store, pin, server_name, &c);
+  if (ret < 0)
+    return ret;
+
+  for (j = 0; j < pk_algos_size; j++)
+    {
+      if (pk_algos[j] == c->pk)
+        {
+          _gnutls_selected_certs_set (session, c->cert_list,
+                                      c->cert_list_length, c->pkey, 0);
+          _gnutls_selected_certs_set_ref (session, c, chain_release);
+          session->internals.selected_cert_msg = &c->cert_msg;
+          return 0;
+        }
+    }
+
+  chain_release (c);
+
+  return GNUTLS_E_NO_CERTIFICATE_FOUND;
+}
+
+static int
+lazy_certs_register (gnutls_certificate_credentials_t res, const char *name,
+                     const char *certfile, const char *keyfile,
+                     const gnutls_datum_t * cert, const gnutls_datum_t * key,
+                     gnutls_x509_crt_fmt_t type)
+{
+  int ret;
+
+  if (name == NULL || name[0] == 0)
+    return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST);
+
+  if (res->lazy_certs == NULL)
+    {
+      ret = _gnutls_lazy_certs_init (&res->lazy_certs);
+      if (ret < 0)
+        return gnutls_assert_val (ret);
+    }
+
+  ret = _gnutls_lazy_certs_register (res->lazy_certs, name, certfile,
+                                     keyfile, cert, key, type);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  return 0;
+}
+
+/**
+ * gnutls_certificate_register_x509_key_file:
+ * @res: is a #gnutls_certificate_credentials_t structure.
+ * @name: the server name the certificate is used for
+ * @certfile: is a file that containing the certificate list (path) for
+ *   the specified private key, in PKCS7 format, or a list of certificates
+ * @keyfile: is a file that contains the private key
+ * @type: is PEM or DER
+ *
+ * This function registers a certificate chain and private key for the
+ * given server name, without reading them. They are loaded as with
+ * gnutls_certificate_set_x509_key_file() the first time a client asks
+ * for @name using the server name indication extension, and are
+ * kept in memory while they are used. The least recently used ones
+ * are unloaded when more than the number set with
+ * gnutls_certificate_set_registered_cache_size() are loaded.
+ *
+ * The @name may be a wildcard such as "*.example.com", which is
+ * used for the names that are not registered themselves. Registering
+ * a name again replaces the earlier registration. A chain that cannot
+ * be loaded is not retried.
+ *
+ * The certificates set with gnutls_certificate_set_x509_key_file() and
+ * similar functions have precedence for the names they contain, and
+ * are used for clients that send no name or an unregistered one.
+ *
+ * This function must not be called while the credentials are used in
+ * a session.
+ *
+ * Returns: %GNUTLS_E_SUCCESS (0) on success, or a negative error code.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_certificate_register_x509_key_file (gnutls_certificate_credentials_t
+                                           res, const char *name,
+                                           const char *certfile,
+                                           const char *keyfile,
+                                           gnutls_x509_crt_fmt_t type)
+{
+  if (certfile == NULL || keyfile == NULL)
+    return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST);
+
+  return lazy_certs_register (res, name, certfile, keyfile, NULL, NULL,
+                              type);
+}
+
+/**
+ * gnutls_certificate_register_x509_key_mem:
+ * @res: is a #gnutls_certificate_credentials_t structure.
+ * @name: the server name the certificate is used for
+ * @cert: contains a certificate list (path) for the specified private key
+ * @key: is the private key
+ * @type: is PEM or DER
+ *
+ * This function is like gnutls_certificate_register_x509_key_file()
+ * but registers a copy of the given data, which is only parsed the
+ * first time a client asks for @name.
+ *
+ * Returns: %GNUTLS_E_SUCCESS (0) on success, or a negative error code.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_certificate_register_x509_key_mem (gnutls_certificate_credentials_t
+                                          res, const char *name,
+                                          const gnutls_datum_t * cert,
+                                          const gnutls_datum_t * key,
+                                          gnutls_x509_crt_fmt_t type)
+{
+  if (cert == NULL || key == NULL)
+    return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST);
+
+  return lazy_certs_register (res, name, NULL, NULL, cert, key, type);
+}
+
+/**
+ * gnutls_certificate_set_registered_cache_size:
+ * @res: is a #gnutls_certificate_credentials_t structure.
+ * @max_loaded: the maximum number of registered certificates to keep loaded
+ *
+ * This function sets the number of the certificates registered with
+ * gnutls_certificate_register_x509_key_file() or
+ * gnutls_certificate_register_x509_key_mem() that are kept in memory
+ * once loaded. The default is 256. Certificates used by sessions
+ * are freed when these no longer use them.
+ *
+ * Returns: %GNUTLS_E_SUCCESS (0) on success, or a negative error code.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_certificate_set_registered_cache_size (gnutls_certificate_credentials_t
+                                              res, unsigned int max_loaded)
+{
+  int ret;
+
+  if (res->lazy_certs == NULL)
+    {
+      ret = _gnutls_lazy_certs_init (&res->lazy_certs);
+      if (ret < 0)
+        return gnutls_assert_val (ret);
+    }
+
+  _gnutls_lazy_certs_set_max (res->lazy_certs, max_loaded);
+
+  return 0;
+}
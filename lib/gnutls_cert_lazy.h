@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * The GnuTLS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+
+#ifndef GNUTLS_CERT_LAZY_H
+#define GNUTLS_CERT_LAZY_H
+
+typedef struct lazy_certs_st lazy_certs_st;
+
+int _gnutls_lazy_certs_init (lazy_certs_st ** store);
+void _gnutls_lazy_certs_deinit (lazy_certs_st * store);
+
+int _gnutls_lazy_certs_register (lazy_certs_st * store, const char *name,
+                                 const char *certfile, const char *keyfile,
+                                 const gnutls_datum_t * cert,
+                                 const gnutls_datum_t * key,
+                                 gnutls_x509_crt_fmt_t type);
+void _gnutls_lazy_certs_set_max (lazy_certs_st * store,
+                                 unsigned int max_loaded);
+
+int _gnutls_lazy_certs_select (gnutls_session_t session,
+                               lazy_certs_st * store,
+                               const struct pin_info_st *pin,
+                               const char *server_name,
+                               const gnutls_pk_algorithm_t * pk_algos,
+                               size_t pk_algos_size);
+
+#endif
@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * The GnuTLS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+
+/* This file contains the certificate credential slots, which hold the
+ * current certificate credentials of a server and allow replacing them
+ * while sessions use them. Every set of credentials placed in a slot is
+ * a snapshot, which sessions reference from the time they are given the
+ * slot until they are deinitialized. The credentials of a snapshot are
+ * freed when it is no longer current and no session references it.
+ *
+ * Sessions take a reference without a lock, when the compiler provides
+ * atomic operations. The header of a snapshot is only freed with the
+ * slot, so a session that reads a snapshot pointer which is replaced
+ * meanwhile can still inspect its reference count; a snapshot whose
+ * count dropped to zero is never referenced again.
+ */
+
+#include <gnutls_int.h>
+#include <gnutls_errors.h>
+#include <gnutls_auth.h>
+#include <auth/cert.h>
+#include <gnutls_cert_slot.h>
+#include <locks.h>
+
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4)
+# define HAVE_ATOMIC_REFCOUNT
+#endif
+
+struct cert_snapshot_st
+{
+  struct cert_snapshot_st *next;        /* all the snapshots of the slot */
+  struct gnutls_certificate_slot_st *slot;
+  unsigned int refcount;        /* includes the slot's, while current */
+  gnutls_certificate_credentials_t cred;
+};
+
+struct gnutls_certificate_slot_st
+{
+  cert_snapshot_st *volatile current;
+  cert_snapshot_st *snapshots;
+
+  /* serializes the updates of the slot, and the reference counts
+   * when there are no atomic operations */
+  void *mutex;
+};
+
+#define SLOT_LOCK(s) if (gnutls_mutex_lock(&(s)->mutex)!=0) abort()
+#define SLOT_UNLOCK(s) if (gnutls_mutex_unlock(&(s)->mutex)!=0) abort()
+
+/* Returns a reference to the current snapshot of the slot.
+ */
+static cert_snapshot_st *
+snapshot_acquire (gnutls_certificate_slot_t slot)
+{
+  cert_snapshot_st *s;
+#ifdef HAVE_ATOMIC_REFCOUNT
+  unsigned int n, m;
+
+  for (;;)
+    {
+      s = slot->current;
+      __sync_synchronize ();
+
+      /* the count of a replaced snapshot that reached zero stays
+       * zero; read the slot again */
+      for (n = s->refcount; n != 0; n = m)
+        {
+          m = __sync_val_compare_and_swap (&s->refcount, n, n + 1);
+          if (m == n)
+            return s;
+        }
+    }
+#else
+  SLOT_LOCK (slot);
+  s = slot->current;
+  s->refcount++;
+  SLOT_UNLOCK (slot);
+
+  return s;
+#endif
+}
+
+void
+_gnutls_cert_snapshot_release (cert_snapshot_st * s)
+{
+  unsigned int refcount;
+
+  if (s == NULL)
+    return;
+
+#ifdef HAVE_ATOMIC_REFCOUNT
+  refcount = __sync_sub_and_fetch (&s->refcount, 1);
+#else
+  SLOT_LOCK (s->slot);
+  refcount = --s->refcount;
+  SLOT_UNLOCK (s->slot);
+#endif
+
+  if (refcount == 0)
+    {
+      gnutls_certificate_free_credentials (s->cred);
+      s->cred = NULL;
+    }
+}
+
+/* Makes @cred the current snapshot of the slot. Must be called with the
+ * slot lock held.
+ */
+static int
+slot_publish (gnutls_certificate_slot_t slot,
+              gnutls_certificate_credentials_t cred)
+{
+  cert_snapshot_st *s;
+
+  s = gnutls_calloc (1, sizeof (*s));
+  if (s == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  s->slot = slot;
+  s->cred = cred;
+  s->refcount = 1;
+  s->next = slot->snapshots;
+  slot->snapshots = s;
+
+#ifdef HAVE_ATOMIC_REFCOUNT
+  __sync_synchronize ();
+#endif
+  slot->current = s;
+#ifdef HAVE_ATOMIC_REFCOUNT
+  __sync_synchronize ();
+#endif
+
+  return 0;
+}
+
+/**
+ * gnutls_certificate_slot_init:
+ * @slot: is a pointer to a #gnutls_certificate_slot_t structure.
+ * @cred: the initial certificate credentials
+ *
+ * This function initializes a certificate credentials slot, which
+ * holds the current certificate credentials of a server and allows
+ * replacing them with gnutls_certificate_slot_swap() while sessions
+ * are using them. Sessions are given the slot with
+ * gnutls_credentials_set_slot().
+ *
+ * The slot takes over @cred, which is freed when it is replaced and
+ * no longer used by a session, or when the slot is deinitialized.
+ *
+ * Returns: %GNUTLS_E_SUCCESS (0) on success, or a negative error code.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_certificate_slot_init (gnutls_certificate_slot_t * slot,
+                              gnutls_certificate_credentials_t cred)
+{
+  gnutls_certificate_slot_t s;
+  int ret;
+
+  if (cred == NULL)
+    return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST);
+
+  s = gnutls_calloc (1, sizeof (*s));
+  if (s == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  ret = gnutls_mutex_init (&s->mutex);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      gnutls_free (s);
+      return ret;
+    }
+
+  ret = slot_publish (s, cred);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      gnutls_mutex_deinit (&s->mutex);
+      gnutls_free (s);
+      return ret;
+    }
+
+  *slot = s;
+
+  return 0;
+}
+
+/**
+ * gnutls_certificate_slot_deinit:
+ * @slot: is a #gnutls_certificate_slot_t structure.
+ *
+ * This function deinitializes the slot, and frees the credentials it
+ * holds. It must be called after all the sessions given the slot are
+ * deinitialized.
+ *
+ * Since: 3.1.6
+ **/
+void
+gnutls_certificate_slot_deinit (gnutls_certificate_slot_t slot)
+{
+  cert_snapshot_st *s, *next;
+
+  if (slot == NULL)
+    return;
+
+  for (s = slot->snapshots; s != NULL; s = next)
+    {
+      next = s->next;
+      if (s->cred != NULL)
+        gnutls_certificate_free_credentials (s->cred);
+      gnutls_free (s);
+    }
+
+  gnutls_mutex_deinit (&slot->mutex);
+  gnutls_free (slot);
+}
+
+/**
+ * gnutls_certificate_slot_swap:
+ * @slot: is a #gnutls_certificate_slot_t structure.
+ * @cred: the new certificate credentials
+ *
+ * This function makes @cred the current credentials of the slot. The
+ * sessions given the slot afterwards use @cred, and the sessions that
+ * were given it earlier keep using the previous credentials, which
+ * are freed when the last of them is deinitialized. This function may
+ * be called while other threads use the slot.
+ *
+ * The slot takes over @cred. A small amount of memory is kept for
+ * every replaced set of credentials until the slot is deinitialized.
+ *
+ * Returns: %GNUTLS_E_SUCCESS (0) on success, or a negative error code.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_certificate_slot_swap (gnutls_certificate_slot_t slot,
+                              gnutls_certificate_credentials_t cred)
+{
+  cert_snapshot_st *old;
+  int ret;
+
+  if (cred == NULL)
+    return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST);
+
+  SLOT_LOCK (slot);
+  old = slot->current;
+  ret = slot_publish (slot, cred);
+  SLOT_UNLOCK (slot);
+
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  /* drop the reference of the slot */
+  _gnutls_cert_snapshot_release (old);
+
+  return 0;
+}
+
+/**
+ * gnutls_credentials_set_slot:
+ * @session: is a #gnutls_session_t structure.
+ * @slot: is a #gnutls_certificate_slot_t structure.
+ *
+ * This function sets the current credentials of the slot as the
+ * certificate credentials of the session, as with
+ * gnutls_credentials_set(). The session keeps using these credentials,
+ * even if they are replaced in the slot, until it is deinitialized or
+ * given the slot again.
+ *
+ * Returns: %GNUTLS_E_SUCCESS (0) on success, or a negative error code.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_credentials_set_slot (gnutls_session_t session,
+                             gnutls_certificate_slot_t slot)
+{
+  cert_snapshot_st *s;
+  int ret;
+
+  s = snapshot_acquire (slot);
+
+  ret = gnutls_credentials_set (session, GNUTLS_CRD_CERTIFICATE, s->cred);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      _gnutls_cert_snapshot_release (s);
+      return ret;
+    }
+
+  _gnutls_cert_snapshot_release (session->internals.cert_snapshot);
+  session->internals.cert_snapshot = s;
+
+  return 0;
+}
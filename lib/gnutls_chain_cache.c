@@ -0,0 +1,418 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * The GnuTLS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/* This file contains a cache of peer certificate chains kept in
+ * the certificate credentials. When it is enabled the packed session
+ * data (session cache entries and tickets) contain only a digest of
+ * the peer's chain, and the chain is looked up in this cache when the
+ * application asks for it on a resumed session.
+ */
+
+#include <gnutls_int.h>
+#include <gnutls_errors.h>
+#include <gnutls_num.h>
+#include <gnutls_hash_int.h>
+#include <gnutls_auth.h>
+#include <auth/cert.h>
+#include <gnutls_chain_cache.h>
+#include <locks.h>
+
+#define CHAIN_CACHE_BUCKETS 256
+
+typedef struct chain_cache_entry_st
+{
+  struct chain_cache_entry_st *next;    /* in the hash bucket */
+  struct chain_cache_entry_st *lru_prev;        /* towards the most recent */
+  struct chain_cache_entry_st *lru_next;        /* towards the least recent */
+
+  uint8_t digest[CHAIN_DIGEST_SIZE];
+
+  unsigned int ncerts;
+  gnutls_datum_t *certs;        /* points after the structure */
+} chain_cache_entry_st;
+
+struct chain_cache_st
+{
+  void *mutex;
+
+  chain_cache_entry_st *buckets[CHAIN_CACHE_BUCKETS];
+  chain_cache_entry_st *lru_head;
+  chain_cache_entry_st *lru_tail;
+
+  unsigned int nentries;
+  unsigned int max_entries;
+};
+
+#define CACHE_LOCK(c) if (gnutls_mutex_lock(&(c)->mutex)!=0) abort()
+#define CACHE_UNLOCK(c) if (gnutls_mutex_unlock(&(c)->mutex)!=0) abort()
+
+/* the digest is uniformly distributed */
+#define DIGEST_TO_BUCKET(d) ((d)[0] % CHAIN_CACHE_BUCKETS)
+
+static void
+lru_unlink (chain_cache_st * c, chain_cache_entry_st * e)
+{
+  if (e->lru_prev)
+    e->lru_prev->lru_next = e->lru_next;
+  else
+    c->lru_head = e->lru_next;
+
+  if (e->lru_next)
+    e->lru_next->lru_prev = e->lru_prev;
+  else
+    c->lru_tail = e->lru_prev;
+
+  e->lru_prev = e->lru_next = NULL;
+}
+
+static void
+lru_push_front (chain_cache_st * c, chain_cache_entry_st * e)
+{
+  e->lru_prev = NULL;
+  e->lru_next = c->lru_head;
+  if (c->lru_head)
+    c->lru_head->lru_prev = e;
+  c->lru_head = e;
+  if (c->lru_tail == NULL)
+    c->lru_tail = e;
+}
+
+/* Must be called with the cache lock held.
+ */
+static chain_cache_entry_st *
+cache_find (chain_cache_st * c, const uint8_t * digest)
+{
+  chain_cache_entry_st *e;
+
+  for (e = c->buckets[DIGEST_TO_BUCKET (digest)]; e != NULL; e = e->next)
+    {
+      if (memcmp (e->digest, digest, CHAIN_DIGEST_SIZE) == 0)
+        return e;
+    }
+
+  return NULL;
+}
+
+/* Unlinks and frees the entry. Must be called with the cache lock held.
+ */
+static void
+cache_remove_entry (chain_cache_st * c, chain_cache_entry_st * e)
+{
+  chain_cache_entry_st **p;
+
+  for (p = &c->buckets[DIGEST_TO_BUCKET (e->digest)]; *p != NULL;
+       p = &(*p)->next)
+    {
+      if (*p == e)
+        {
+          *p = e->next;
+          break;
+        }
+    }
+
+  lru_unlink (c, e);
+  c->nentries--;
+  gnutls_free (e);
+}
+
+static int
+chain_cache_init (chain_cache_st ** cache, unsigned int max_entries)
+{
+  chain_cache_st *c;
+  int ret;
+
+  c = gnutls_calloc (1, sizeof (*c));
+  if (c == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  ret = gnutls_mutex_init (&c->mutex);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      gnutls_free (c);
+      return ret;
+    }
+
+  c->max_entries = max_entries;
+  *cache = c;
+
+  return 0;
+}
+
+void
+_gnutls_chain_cache_deinit (chain_cache_st * cache)
+{
+  if (cache == NULL)
+    return;
+
+  while (cache->lru_head != NULL)
+    cache_remove_entry (cache, cache->lru_head);
+
+  gnutls_mutex_deinit (&cache->mutex);
+  gnutls_free (cache);
+}
+
+/* Computes the digest identifying a certificate chain; SHA-256 over
+ * the length-prefixed certificates.
+ */
+int
+_gnutls_chain_digest (const gnutls_datum_t * certs, unsigned int ncerts,
+                      uint8_t digest[CHAIN_DIGEST_SIZE])
+{
+  digest_hd_st hd;
+  uint8_t len[4];
+  unsigned int i;
+  int ret;
+
+  ret = _gnutls_hash_init (&hd, GNUTLS_DIG_SHA256);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  for (i = 0; i < ncerts; i++)
+    {
+      _gnutls_write_uint32 (certs[i].size, len);
+      _gnutls_hash (&hd, len, sizeof (len));
+      _gnutls_hash (&hd, certs[i].data, certs[i].size);
+    }
+
+  _gnutls_hash_deinit (&hd, digest);
+
+  return 0;
+}
+
+/* Stores a copy of the given chain, and returns its digest.
+ */
+int
+_gnutls_chain_cache_store (chain_cache_st * cache,
+                           const gnutls_datum_t * certs, unsigned int ncerts,
+                           uint8_t digest[CHAIN_DIGEST_SIZE])
+{
+  chain_cache_entry_st *e;
+  size_t size;
+  uint8_t *p;
+  unsigned int i;
+  int ret;
+
+  if (ncerts == 0)
+    return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST);
+
+  ret = _gnutls_chain_digest (certs, ncerts, digest);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  CACHE_LOCK (cache);
+  e = cache_find (cache, digest);
+  if (e != NULL)
+    {
+      lru_unlink (cache, e);
+      lru_push_front (cache, e);
+      CACHE_UNLOCK (cache);
+      return 0;
+    }
+  CACHE_UNLOCK (cache);
+
+  size = sizeof (*e) + ncerts * sizeof (gnutls_datum_t);
+  for (i = 0; i < ncerts; i++)
+    size += certs[i].size;
+
+  e = gnutls_malloc (size);
+  if (e == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  memset (e, 0, sizeof (*e));
+  memcpy (e->digest, digest, CHAIN_DIGEST_SIZE);
+  e->ncerts = ncerts;
+  e->certs = (gnutls_datum_t *) (e + 1);
+
+  p = (uint8_t *) & e->certs[ncerts];
+  for (i = 0; i < ncerts; i++)
+    {
+      e->certs[i].data = p;
+      e->certs[i].size = certs[i].size;
+      memcpy (p, certs[i].data, certs[i].size);
+      p += certs[i].size;
+    }
+
+  CACHE_LOCK (cache);
+  /* another thread may have stored the same chain meanwhile */
+  if (cache_find (cache, digest) != NULL)
+    {
+      CACHE_UNLOCK (cache);
+      gnutls_free (e);
+      return 0;
+    }
+
+  e->next = cache->buckets[DIGEST_TO_BUCKET (digest)];
+  cache->buckets[DIGEST_TO_BUCKET (digest)] = e;
+  lru_push_front (cache, e);
+  cache->nentries++;
+
+  while (cache->nentries > cache->max_entries && cache->lru_tail != e)
+    cache_remove_entry (cache, cache->lru_tail);
+  CACHE_UNLOCK (cache);
+
+  return 0;
+}
+
+/* Returns a copy of the chain with the given digest, which must be
+ * freed by the caller, or GNUTLS_E_NO_CERTIFICATE_FOUND.
+ */
+int
+_gnutls_chain_cache_get (chain_cache_st * cache,
+                         const uint8_t digest[CHAIN_DIGEST_SIZE],
+                         gnutls_datum_t ** certs, unsigned int *ncerts)
+{
+  chain_cache_entry_st *e;
+  gnutls_datum_t *list = NULL;
+  unsigned int i, n = 0;
+  int ret;
+
+  CACHE_LOCK (cache);
+  e = cache_find (cache, digest);
+  if (e == NULL)
+    {
+      CACHE_UNLOCK (cache);
+      return GNUTLS_E_NO_CERTIFICATE_FOUND;
+    }
+
+  lru_unlink (cache, e);
+  lru_push_front (cache, e);
+
+  list = gnutls_calloc (e->ncerts, sizeof (gnutls_datum_t));
+  if (list == NULL)
+    {
+      gnutls_assert ();
+      ret = GNUTLS_E_MEMORY_ERROR;
+      goto fail;
+    }
+
+  for (n = 0; n < e->ncerts; n++)
+    {
+      ret = _gnutls_set_datum (&list[n], e->certs[n].data, e->certs[n].size);
+      if (ret < 0)
+        {
+          gnutls_assert ();
+          goto fail;
+        }
+    }
+  CACHE_UNLOCK (cache);
+
+  *certs = list;
+  *ncerts = n;
+
+  return 0;
+
+fail:
+  CACHE_UNLOCK (cache);
+  if (list != NULL)
+    {
+      for (i = 0; i < n; i++)
+        _gnutls_free_datum (&list[i]);
+      gnutls_free (list);
+    }
+  return ret;
+}
+
+/* Fills in the peer's certificate list of a session resumed from
+ * data that contain only a reference to the chain. Returns
+ * GNUTLS_E_NO_CERTIFICATE_FOUND if the chain is no longer available.
+ */
+int
+_gnutls_peer_chain_restore (gnutls_session_t session, cert_auth_info_t info)
+{
+  gnutls_certificate_credentials_t cred;
+  int ret;
+
+  if (info->chain_digest_set == 0 || info->ncerts > 0)
+    return 0;
+
+  cred = (gnutls_certificate_credentials_t)
+    _gnutls_get_cred (session, GNUTLS_CRD_CERTIFICATE, NULL);
+  if (cred == NULL || cred->chain_cache == NULL)
+    return GNUTLS_E_NO_CERTIFICATE_FOUND;
+
+  ret = _gnutls_chain_cache_get (cred->chain_cache, info->chain_digest,
+                                 &info->raw_certificate_list, &info->ncerts);
+  if (ret < 0)
+    return ret;
+
+  return 0;
+}
+
+/* Returns the digest of the peer's certificate chain, whether the
+ * chain is held by the session or only referred to.
+ */
+int
+_gnutls_peer_chain_digest (cert_auth_info_t info,
+                           uint8_t digest[CHAIN_DIGEST_SIZE])
+{
+  if (info->ncerts > 0)
+    return _gnutls_chain_digest (info->raw_certificate_list, info->ncerts,
+                                 digest);
+
+  if (info->chain_digest_set == 0)
+    return gnutls_assert_val (GNUTLS_E_NO_CERTIFICATE_FOUND);
+
+  memcpy (digest, info->chain_digest, CHAIN_DIGEST_SIZE);
+  return 0;
+}
+
+/**
+ * gnutls_certificate_set_peer_chain_cache:
+ * @res: is a gnutls_certificate_credentials_t structure
+ * @max_chains: the maximum number of chains to keep, or zero to disable
+ *
+ * This function enables a cache of peer certificate chains in the
+ * given credentials. When enabled, the session data stored for
+ * resumption, in a session cache or a session ticket, contain only a
+ * SHA-256 digest of the peer's certificate chain instead of the
+ * chain itself. On a resumed session the chain is restored from this
+ * cache when the application asks for it, e.g., with
+ * gnutls_certificate_get_peers() or gnutls_certificate_verify_peers2().
+ *
+ * If the chain is no longer in the cache, gnutls_certificate_get_peers()
+ * returns no certificates, and gnutls_certificate_verify_peers2() reports
+ * the verification result of the original handshake if it still holds.
+ *
+ * This function must be called before the credentials are used in a
+ * session.
+ *
+ * Returns: %GNUTLS_E_SUCCESS (0) on success, or a negative error code.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_certificate_set_peer_chain_cache (gnutls_certificate_credentials_t res,
+                                         unsigned int max_chains)
+{
+  int ret;
+
+  _gnutls_chain_cache_deinit (res->chain_cache);
+  res->chain_cache = NULL;
+
+  if (max_chains == 0)
+    return 0;
+
+  ret = chain_cache_init (&res->chain_cache, max_chains);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  return 0;
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * The GnuTLS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+#ifndef GNUTLS_CHAIN_CACHE_H
+#define GNUTLS_CHAIN_CACHE_H
+
+#define CHAIN_DIGEST_SIZE 32
+
+typedef struct chain_cache_st chain_cache_st;
+
+void _gnutls_chain_cache_deinit (chain_cache_st * cache);
+
+int _gnutls_chain_digest (const gnutls_datum_t * certs, unsigned int ncerts,
+                          uint8_t digest[CHAIN_DIGEST_SIZE]);
+
+int _gnutls_chain_cache_store (chain_cache_st * cache,
+                               const gnutls_datum_t * certs,
+                               unsigned int ncerts,
+                               uint8_t digest[CHAIN_DIGEST_SIZE]);
+int _gnutls_chain_cache_get (chain_cache_st * cache,
+                             const uint8_t digest[CHAIN_DIGEST_SIZE],
+                             gnutls_datum_t ** certs, unsigned int *ncerts);
+
+#endif
@@ -105,7 +105,7 @@ _gnutls_encrypt (gnutls_session_t session, const uint8_t * headers,
         return gnutls_assert_val(GNUTLS_E_MEMORY_ERROR);
       
       ret = _gnutls_compress(&params->write.compression_state, data, data_size, 
-                             comp.data, comp.size, session->internals.priorities.stateless_compression);
+                             comp.data, comp.size, session->internals.priorities->stateless_compression);
       if (ret < 0)
         {
           gnutls_free(comp.data);
@@ -327,7 +327,7 @@ compressed_to_ciphertext (gnutls_session_t session,
 
       /* We don't use long padding if requested or if we are in DTLS.
        */
-      if (session->internals.priorities.no_padding == 0 && !IS_DTLS(session))
+      if (session->internals.priorities->no_padding == 0 && !IS_DTLS(session))
         pad = nonce[blocksize];
 
       length_to_encrypt = length =
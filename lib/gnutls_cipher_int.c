@@ -74,6 +74,7 @@ _gnutls_cipher_init (cipher_hd_st * handle, gnutls_cipher_algorithm_t cipher,
       handle->auth = cc->auth;
       handle->tag = cc->tag;
       handle->setiv = cc->setiv;
+      handle->copy = cc->copy;
 
       SR (cc->init (cipher, &handle->handle, enc), cc_cleanup);
       SR (cc->setkey( handle->handle, key->data, key->size), cc_cleanup);
@@ -91,6 +92,7 @@ _gnutls_cipher_init (cipher_hd_st * handle, gnutls_cipher_algorithm_t cipher,
   handle->auth = _gnutls_cipher_ops.auth;
   handle->tag = _gnutls_cipher_ops.tag;
   handle->setiv = _gnutls_cipher_ops.setiv;
+  handle->copy = _gnutls_cipher_ops.copy;
 
   /* otherwise use generic cipher interface
    */
@@ -128,6 +130,36 @@ cc_cleanup:
   return ret;
 }
 
+/* Duplicates an initialized (keyed) cipher handle. This avoids
+ * the key schedule when the same key is used for many short
+ * operations. Returns GNUTLS_E_UNIMPLEMENTED_FEATURE if the
+ * backend cannot copy contexts; the caller should then use
+ * _gnutls_cipher_init().
+ */
+int
+_gnutls_cipher_copy (cipher_hd_st * dst, const cipher_hd_st * src)
+{
+  int ret;
+
+  if (src->handle == NULL)
+    return gnutls_assert_val(GNUTLS_E_INVALID_REQUEST);
+
+  if (src->copy == NULL)
+    return GNUTLS_E_UNIMPLEMENTED_FEATURE;
+
+  memcpy (dst, src, sizeof (*dst));
+  dst->handle = NULL;
+
+  ret = src->copy (&dst->handle, src->handle);
+  if (ret < 0)
+    {
+      dst->handle = NULL;
+      return gnutls_assert_val(ret);
+    }
+
+  return 0;
+}
+
 /* Auth_cipher API 
  */
 int _gnutls_auth_cipher_init (auth_cipher_hd_st * handle, 
@@ -39,6 +39,7 @@ typedef int (*cipher_auth_func) (void *hd, const void *data, size_t);
 typedef int (*cipher_setiv_func) (void *hd, const void *iv, size_t);
 
 typedef void (*cipher_tag_func) (void *hd, void *tag, size_t);
+typedef int (*cipher_copy_func) (void **dst, const void *src);
 
 typedef struct
 {
@@ -49,6 +50,7 @@ typedef struct
   cipher_tag_func tag;
   cipher_setiv_func setiv;
   cipher_deinit_func deinit;
+  cipher_copy_func copy;
   
   size_t tag_size;
   unsigned int is_aead:1;
@@ -57,6 +59,7 @@ typedef struct
 int _gnutls_cipher_init (cipher_hd_st *, gnutls_cipher_algorithm_t cipher,
                          const gnutls_datum_t * key,
                          const gnutls_datum_t * iv, int enc);
+int _gnutls_cipher_copy (cipher_hd_st * dst, const cipher_hd_st * src);
 
 inline static void _gnutls_cipher_setiv (const cipher_hd_st * handle, 
     const void *iv, size_t ivlen)
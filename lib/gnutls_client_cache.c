@@ -0,0 +1,521 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * The GnuTLS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/* This file contains a cache of session data for clients. A
+ * session attached to the cache looks up the data of an earlier
+ * session with the same server before its handshake, and stores its
+ * own data once the handshake completes. The data are keyed by the
+ * server's name and port, the session's priorities and its
+ * credentials, so that a session is only resumed under the settings
+ * it was established with.
+ */
+
+#include <gnutls_int.h>
+#include <gnutls_errors.h>
+#include <gnutls_num.h>
+#include <gnutls_hash_int.h>
+#include <gnutls_client_cache.h>
+#include <ext/session_ticket.h>
+#include <locks.h>
+
+#define CLIENT_CACHE_BUCKETS 256
+#define CLIENT_CACHE_KEY_SIZE 32
+
+/* used when zero is given to gnutls_client_cache_init() */
+#define CLIENT_CACHE_DEFAULT_ENTRIES 1024
+
+typedef struct client_cache_entry_st
+{
+  struct client_cache_entry_st *next;   /* in the hash bucket */
+  struct client_cache_entry_st *lru_prev;       /* towards the most recent */
+  struct client_cache_entry_st *lru_next;       /* towards the least recent */
+
+  uint8_t key[CLIENT_CACHE_KEY_SIZE];
+  time_t expires;
+
+  /* of the session ID and ticket; a resumed session that got no new
+   * ones keeps the expiration of the stored session */
+  uint8_t resume_digest[CLIENT_CACHE_KEY_SIZE];
+
+  gnutls_datum_t data;
+} client_cache_entry_st;
+
+struct gnutls_client_cache_int
+{
+  void *mutex;
+
+  client_cache_entry_st *buckets[CLIENT_CACHE_BUCKETS];
+  client_cache_entry_st *lru_head;
+  client_cache_entry_st *lru_tail;
+
+  unsigned int nentries;
+  unsigned int max_entries;
+
+  unsigned int hits;
+  unsigned int misses;
+  unsigned int evictions;
+};
+
+#define CACHE_LOCK(c) if (gnutls_mutex_lock(&(c)->mutex)!=0) abort()
+#define CACHE_UNLOCK(c) if (gnutls_mutex_unlock(&(c)->mutex)!=0) abort()
+
+/* the key is a digest */
+#define KEY_TO_BUCKET(k) ((k)[0] % CLIENT_CACHE_BUCKETS)
+
+static void
+lru_unlink (gnutls_client_cache_t c, client_cache_entry_st * e)
+{
+  if (e->lru_prev)
+    e->lru_prev->lru_next = e->lru_next;
+  else
+    c->lru_head = e->lru_next;
+
+  if (e->lru_next)
+    e->lru_next->lru_prev = e->lru_prev;
+  else
+    c->lru_tail = e->lru_prev;
+
+  e->lru_prev = e->lru_next = NULL;
+}
+
+static void
+lru_push_front (gnutls_client_cache_t c, client_cache_entry_st * e)
+{
+  e->lru_prev = NULL;
+  e->lru_next = c->lru_head;
+  if (c->lru_head)
+    c->lru_head->lru_prev = e;
+  c->lru_head = e;
+  if (c->lru_tail == NULL)
+    c->lru_tail = e;
+}
+
+/* Unlinks and frees the entry. Must be called with the cache lock held.
+ */
+static void
+cache_remove_entry (gnutls_client_cache_t c, client_cache_entry_st * e)
+{
+  client_cache_entry_st **p;
+
+  for (p = &c->buckets[KEY_TO_BUCKET (e->key)]; *p != NULL; p = &(*p)->next)
+    {
+      if (*p == e)
+        {
+          *p = e->next;
+          break;
+        }
+    }
+
+  lru_unlink (c, e);
+  c->nentries--;
+  _gnutls_free_datum (&e->data);
+  gnutls_free (e);
+}
+
+/* Must be called with the cache lock held.
+ */
+static client_cache_entry_st *
+cache_find (gnutls_client_cache_t c, const uint8_t * key)
+{
+  client_cache_entry_st *e;
+
+  for (e = c->buckets[KEY_TO_BUCKET (key)]; e != NULL; e = e->next)
+    {
+      if (memcmp (e->key, key, CLIENT_CACHE_KEY_SIZE) == 0)
+        return e;
+    }
+
+  return NULL;
+}
+
+static void
+hash_num (digest_hd_st * hd, uint32_t num)
+{
+  uint8_t buf[4];
+
+  _gnutls_write_uint32 (num, buf);
+  _gnutls_hash (hd, buf, sizeof (buf));
+}
+
+static void
+hash_priority (digest_hd_st * hd, const priority_st * p)
+{
+  unsigned int i;
+
+  hash_num (hd, p->algorithms);
+  for (i = 0; i < p->algorithms; i++)
+    hash_num (hd, p->priority[i]);
+}
+
+/* Computes the key of the session's entry; a digest of the
+ * server's identity, the priorities and the credentials in use.
+ */
+static int
+session_cache_key (gnutls_session_t session, uint8_t key[CLIENT_CACHE_KEY_SIZE])
+{
+  const struct gnutls_priority_st *prio = session->internals.priorities;
+  const char *server = session->internals.client_cache_server;
+  digest_hd_st hd;
+  auth_cred_st *ccred;
+  int ret;
+
+  ret = _gnutls_hash_init (&hd, GNUTLS_DIG_SHA256);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  hash_num (&hd, strlen (server));
+  _gnutls_hash (&hd, server, strlen (server));
+  hash_num (&hd, session->internals.client_cache_port);
+
+  hash_priority (&hd, &prio->cipher);
+  hash_priority (&hd, &prio->mac);
+  hash_priority (&hd, &prio->kx);
+  hash_priority (&hd, &prio->compression);
+  hash_priority (&hd, &prio->protocol);
+  hash_priority (&hd, &prio->cert_type);
+  hash_priority (&hd, &prio->sign_algo);
+  hash_priority (&hd, &prio->supported_ecc);
+  hash_num (&hd, prio->no_extensions | (prio->no_padding << 1) |
+            (prio->allow_large_records << 2) |
+            (prio->ssl3_record_version << 3) |
+            (prio->server_precedence << 4) |
+            (prio->allow_weak_keys << 5) |
+            (prio->stateless_compression << 6));
+  hash_num (&hd, prio->sr);
+  hash_num (&hd, prio->additional_verify_flags);
+
+  /* the credentials are identified by their address, as the
+   * cache is local to the process */
+  for (ccred = session->key.cred; ccred != NULL; ccred = ccred->next)
+    {
+      hash_num (&hd, ccred->algorithm);
+      _gnutls_hash (&hd, &ccred->credentials, sizeof (ccred->credentials));
+    }
+
+  _gnutls_hash_deinit (&hd, key);
+
+  return 0;
+}
+
+/* Computes a digest of what the session is resumed with; its ID
+ * and its session ticket, if any.
+ */
+static int
+session_resume_digest (gnutls_session_t session,
+                       uint8_t digest[CLIENT_CACHE_KEY_SIZE])
+{
+  const security_parameters_st *params = &session->security_parameters;
+  gnutls_datum_t ticket;
+  digest_hd_st hd;
+  int ret;
+
+  ret = _gnutls_hash_init (&hd, GNUTLS_DIG_SHA256);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  hash_num (&hd, params->session_id_size);
+  _gnutls_hash (&hd, params->session_id, params->session_id_size);
+
+  if (_gnutls_session_ticket_get (session, &ticket) < 0)
+    ticket.size = 0;
+
+  hash_num (&hd, ticket.size);
+  if (ticket.size > 0)
+    _gnutls_hash (&hd, ticket.data, ticket.size);
+
+  _gnutls_hash_deinit (&hd, digest);
+
+  return 0;
+}
+
+/**
+ * gnutls_client_cache_init:
+ * @cache: The structure to be initialized
+ * @max_entries: the maximum number of sessions to keep, or zero
+ *
+ * This function will initialize a cache of session data for
+ * clients. It is attached to client sessions with
+ * gnutls_session_set_client_cache(), and may be shared by any
+ * number of sessions and threads, e.g., by several connection pools.
+ * It must outlive the sessions using it.
+ *
+ * When the cache is full the least recently used sessions are
+ * removed. If @max_entries is zero a default of 1024 is used.
+ *
+ * Returns: On success, %GNUTLS_E_SUCCESS (0) is returned, otherwise a
+ *   negative error value.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_client_cache_init (gnutls_client_cache_t * cache,
+                          unsigned int max_entries)
+{
+  gnutls_client_cache_t c;
+  int ret;
+
+  if (max_entries == 0)
+    max_entries = CLIENT_CACHE_DEFAULT_ENTRIES;
+
+  c = gnutls_calloc (1, sizeof (*c));
+  if (c == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  ret = gnutls_mutex_init (&c->mutex);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      gnutls_free (c);
+      return ret;
+    }
+
+  c->max_entries = max_entries;
+  *cache = c;
+
+  return 0;
+}
+
+/**
+ * gnutls_client_cache_deinit:
+ * @cache: The cache to be deinitialized
+ *
+ * This function will deinitialize the client session cache and
+ * release all the stored sessions. No session may be using the cache
+ * when this function is called.
+ *
+ * Since: 3.1.6
+ **/
+void
+gnutls_client_cache_deinit (gnutls_client_cache_t cache)
+{
+  if (cache == NULL)
+    return;
+
+  while (cache->lru_head != NULL)
+    cache_remove_entry (cache, cache->lru_head);
+
+  gnutls_mutex_deinit (&cache->mutex);
+  gnutls_free (cache);
+}
+
+/**
+ * gnutls_session_set_client_cache:
+ * @session: is a #gnutls_session_t structure.
+ * @cache: is an initialized client session cache, or %NULL
+ * @server: the name of the server the session connects to
+ * @port: the port the session connects to
+ *
+ * This function will make the client session resume, if possible,
+ * a session previously established with the same server, port,
+ * priorities and credentials that was stored in @cache. Once the
+ * handshake completes the session's data are stored in @cache for
+ * later sessions. Stored sessions expire after the time set with
+ * gnutls_db_set_cache_expiration().
+ *
+ * The function must be called before gnutls_handshake(), after the
+ * priorities and credentials of the session are set, and the
+ * session must not be given data with gnutls_session_set_data().
+ *
+ * Returns: On success, %GNUTLS_E_SUCCESS (0) is returned, otherwise a
+ *   negative error value.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_session_set_client_cache (gnutls_session_t session,
+                                 gnutls_client_cache_t cache,
+                                 const char *server, unsigned int port)
+{
+  char *name = NULL;
+
+  if (session->security_parameters.entity != GNUTLS_CLIENT)
+    return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST);
+
+  if (cache != NULL)
+    {
+      if (server == NULL)
+        return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST);
+
+      name = gnutls_strdup (server);
+      if (name == NULL)
+        return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+    }
+
+  gnutls_free (session->internals.client_cache_server);
+  session->internals.client_cache_server = name;
+  session->internals.client_cache_port = port;
+  session->internals.client_cache = cache;
+
+  return 0;
+}
+
+/**
+ * gnutls_client_cache_get_stats:
+ * @cache: is an initialized client session cache
+ * @hits: will hold the number of sessions found in the cache
+ * @misses: will hold the number of sessions not found
+ * @evictions: will hold the number of sessions removed to make room
+ *
+ * This function reports the statistics of the client session
+ * cache. Any of the output arguments may be %NULL. Lookups of expired
+ * sessions are counted as misses.
+ *
+ * Since: 3.1.6
+ **/
+void
+gnutls_client_cache_get_stats (gnutls_client_cache_t cache,
+                               unsigned int *hits, unsigned int *misses,
+                               unsigned int *evictions)
+{
+  unsigned int h, m, e;
+
+  CACHE_LOCK (cache);
+  h = cache->hits;
+  m = cache->misses;
+  e = cache->evictions;
+  CACHE_UNLOCK (cache);
+
+  if (hits)
+    *hits = h;
+  if (misses)
+    *misses = m;
+  if (evictions)
+    *evictions = e;
+}
+
+/* Sets the data of a stored session with the same server and
+ * settings to the session, if there is one. Called before the
+ * client hello is sent; failing to find a session is not an error.
+ */
+int
+_gnutls_client_cache_lookup (gnutls_session_t session)
+{
+  gnutls_client_cache_t cache = session->internals.client_cache;
+  client_cache_entry_st *e;
+  uint8_t key[CLIENT_CACHE_KEY_SIZE];
+  gnutls_datum_t data = { NULL, 0 };
+  int ret;
+
+  ret = session_cache_key (session, key);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  CACHE_LOCK (cache);
+  e = cache_find (cache, key);
+  if (e != NULL && e->expires < gnutls_time (0))
+    {
+      cache_remove_entry (cache, e);
+      e = NULL;
+    }
+
+  if (e == NULL)
+    {
+      cache->misses++;
+      CACHE_UNLOCK (cache);
+      return 0;
+    }
+
+  ret = _gnutls_set_datum (&data, e->data.data, e->data.size);
+  if (ret < 0)
+    {
+      CACHE_UNLOCK (cache);
+      return gnutls_assert_val (ret);
+    }
+
+  lru_unlink (cache, e);
+  lru_push_front (cache, e);
+  cache->hits++;
+  CACHE_UNLOCK (cache);
+
+  ret = gnutls_session_set_data (session, data.data, data.size);
+  _gnutls_free_datum (&data);
+  if (ret < 0)
+    {
+      /* not fatal; a full handshake will take place */
+      gnutls_assert ();
+      _gnutls_handshake_log ("HSK[%p]: cached session could not be used\n",
+                             session);
+    }
+
+  return 0;
+}
+
+/* Stores the data of the session, once its handshake is complete,
+ * replacing any earlier session with the same server and settings.
+ * A session resumed with the same ID and ticket as the stored one
+ * keeps its expiration, so that resuming does not extend it.
+ */
+int
+_gnutls_client_cache_store (gnutls_session_t session)
+{
+  gnutls_client_cache_t cache = session->internals.client_cache;
+  client_cache_entry_st *e, *old;
+  int ret;
+
+  e = gnutls_calloc (1, sizeof (*e));
+  if (e == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  ret = gnutls_session_get_data2 (session, &e->data);
+  if (ret < 0)
+    {
+      /* not resumable */
+      gnutls_free (e);
+      return 0;
+    }
+
+  ret = session_cache_key (session, e->key);
+  if (ret >= 0)
+    ret = session_resume_digest (session, e->resume_digest);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      _gnutls_free_datum (&e->data);
+      gnutls_free (e);
+      return ret;
+    }
+
+  e->expires = gnutls_time (0) + session->internals.expire_time;
+
+  CACHE_LOCK (cache);
+  old = cache_find (cache, e->key);
+  if (old != NULL)
+    {
+      if (gnutls_session_is_resumed (session)
+          && memcmp (old->resume_digest, e->resume_digest,
+                     CLIENT_CACHE_KEY_SIZE) == 0)
+        e->expires = old->expires;
+      cache_remove_entry (cache, old);
+    }
+
+  e->next = cache->buckets[KEY_TO_BUCKET (e->key)];
+  cache->buckets[KEY_TO_BUCKET (e->key)] = e;
+  lru_push_front (cache, e);
+  cache->nentries++;
+
+  while (cache->nentries > cache->max_entries)
+    {
+      cache->evictions++;
+      cache_remove_entry (cache, cache->lru_tail);
+    }
+  CACHE_UNLOCK (cache);
+
+  return 0;
+}
@@ -199,7 +199,7 @@ _gnutls_compression_is_ok (gnutls_compression_method_t algorithm)
 
 /* returns the TLS numbers of the compression methods we support
  */
-#define SUPPORTED_COMPRESSION_METHODS session->internals.priorities.compression.algorithms
+#define SUPPORTED_COMPRESSION_METHODS session->internals.priorities->compression.algorithms
 int
 _gnutls_supported_compression_methods (gnutls_session_t session,
                                        uint8_t * comp, size_t comp_size)
@@ -213,7 +213,7 @@ _gnutls_supported_compression_methods (gnutls_session_t session,
     {
       int tmp =
         _gnutls_compression_get_num (session->internals.
-                                     priorities.compression.priority[i]);
+                                     priorities->compression.priority[i]);
 
       /* remove private compression algorithms, if requested.
        */
@@ -169,6 +169,9 @@ gnutls_db_check_entry (gnutls_session_t session, gnutls_datum_t session_entry)
 static int
 db_func_is_ok (gnutls_session_t session)
 {
+  if (session->internals.db_cache != NULL)
+    return 0;
+
   if (session->internals.db_store_func != NULL &&
       session->internals.db_retrieve_func != NULL &&
       session->internals.db_remove_func != NULL)
@@ -209,6 +212,12 @@ store_session (gnutls_session_t session,
       return GNUTLS_E_INVALID_SESSION;
     }
 
+  if (session->internals.db_cache != NULL)
+    return _gnutls_db_cache_store (session->internals.db_cache, &session_id,
+                                   &session_data,
+                                   gnutls_time (0) +
+                                   session->internals.expire_time);
+
   /* if we can't read why bother writing? */
   if (session->internals.db_store_func != NULL)
     ret = session->internals.db_store_func (session->internals.db_ptr,
@@ -266,7 +275,13 @@ retrieve_session (gnutls_session_t session, gnutls_datum_t session_id)
       return ret;
     }
 
-  if (session->internals.db_retrieve_func != NULL)
+  if (session->internals.db_cache != NULL)
+    {
+      if (_gnutls_db_cache_retrieve (session->internals.db_cache,
+                                     &session_id, &ret) < 0)
+        ret.data = NULL;
+    }
+  else if (session->internals.db_retrieve_func != NULL)
     ret = session->internals.db_retrieve_func (session->internals.db_ptr,
 					       session_id);
 
@@ -344,6 +359,12 @@ gnutls_db_remove_session (gnutls_session_t session)
       return /* GNUTLS_E_INVALID_SESSION */;
     }
 
+  if (session->internals.db_cache != NULL)
+    {
+      _gnutls_db_cache_remove (session->internals.db_cache, &session_id);
+      return;
+    }
+
   /* if we can't read why bother writing? */
   if (session->internals.db_remove_func != NULL)
     {
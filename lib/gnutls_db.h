@@ -24,3 +24,11 @@ int _gnutls_server_register_current_session (gnutls_session_t session);
 int _gnutls_server_restore_session (gnutls_session_t session,
                                     uint8_t * session_id,
                                     int session_id_size);
+
+int _gnutls_db_cache_store (gnutls_db_cache_t cache, const gnutls_datum_t * key,
+                            const gnutls_datum_t * data, time_t expires);
+int _gnutls_db_cache_retrieve (gnutls_db_cache_t cache,
+                               const gnutls_datum_t * key,
+                               gnutls_datum_t * data);
+int _gnutls_db_cache_remove (gnutls_db_cache_t cache,
+                             const gnutls_datum_t * key);
@@ -0,0 +1,457 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * The GnuTLS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/* This file contains a built-in in-memory cache of resumable
+ * sessions, that can be used by servers instead of the
+ * gnutls_db_set_*_function() callbacks.
+ *
+ * The cache is split into shards, each protected by its own lock,
+ * so that threads resuming different sessions rarely contend. Each
+ * shard holds a hash table of entries and an LRU list; entries are
+ * evicted, least recently used first, when the shard exceeds its
+ * share of the configured size in bytes.
+ */
+
+#include <gnutls_int.h>
+#include <gnutls_errors.h>
+#include <gnutls_db.h>
+#include <gnutls_num.h>
+#include <locks.h>
+
+#define DB_CACHE_SHARDS 16
+#define DB_CACHE_BUCKETS 256
+
+/* used when zero is given to gnutls_db_cache_init() */
+#define DB_CACHE_DEFAULT_SIZE (4*1024*1024)
+
+typedef struct db_cache_entry_st
+{
+  struct db_cache_entry_st *next;       /* in the hash bucket */
+  struct db_cache_entry_st *lru_prev;   /* towards the most recent */
+  struct db_cache_entry_st *lru_next;   /* towards the least recent */
+
+  uint32_t hash;
+  time_t expires;
+  size_t size;                  /* accounted size of the entry */
+
+  uint8_t key[TLS_MAX_SESSION_ID_SIZE];
+  unsigned int key_size;
+
+  gnutls_datum_t data;
+} db_cache_entry_st;
+
+typedef struct
+{
+  void *mutex;
+
+  db_cache_entry_st *buckets[DB_CACHE_BUCKETS];
+  db_cache_entry_st *lru_head;
+  db_cache_entry_st *lru_tail;
+
+  size_t size;
+  size_t max_size;
+
+  unsigned int hits;
+  unsigned int misses;
+  unsigned int evictions;
+} db_cache_shard_st;
+
+struct gnutls_db_cache_int
+{
+  db_cache_shard_st shards[DB_CACHE_SHARDS];
+};
+
+#define SHARD_LOCK(s) if (gnutls_mutex_lock(&(s)->mutex)!=0) abort()
+#define SHARD_UNLOCK(s) if (gnutls_mutex_unlock(&(s)->mutex)!=0) abort()
+
+/* FNV-1a; session IDs are random, so this only needs to
+ * spread the bits of the whole ID. */
+static uint32_t
+db_cache_hash (const uint8_t * key, unsigned int key_size)
+{
+  uint32_t h = 2166136261U;
+  unsigned int i;
+
+  for (i = 0; i < key_size; i++)
+    {
+      h ^= key[i];
+      h *= 16777619U;
+    }
+
+  return h;
+}
+
+#define HASH_TO_SHARD(h) ((h) % DB_CACHE_SHARDS)
+#define HASH_TO_BUCKET(h) (((h) / DB_CACHE_SHARDS) % DB_CACHE_BUCKETS)
+
+static void
+lru_unlink (db_cache_shard_st * s, db_cache_entry_st * e)
+{
+  if (e->lru_prev)
+    e->lru_prev->lru_next = e->lru_next;
+  else
+    s->lru_head = e->lru_next;
+
+  if (e->lru_next)
+    e->lru_next->lru_prev = e->lru_prev;
+  else
+    s->lru_tail = e->lru_prev;
+
+  e->lru_prev = e->lru_next = NULL;
+}
+
+static void
+lru_push_front (db_cache_shard_st * s, db_cache_entry_st * e)
+{
+  e->lru_prev = NULL;
+  e->lru_next = s->lru_head;
+  if (s->lru_head)
+    s->lru_head->lru_prev = e;
+  s->lru_head = e;
+  if (s->lru_tail == NULL)
+    s->lru_tail = e;
+}
+
+/* Unlinks and frees the entry. Must be called with the shard lock held.
+ */
+static void
+shard_remove_entry (db_cache_shard_st * s, db_cache_entry_st * e)
+{
+  db_cache_entry_st **p;
+
+  for (p = &s->buckets[HASH_TO_BUCKET (e->hash)]; *p != NULL;
+       p = &(*p)->next)
+    {
+      if (*p == e)
+        {
+          *p = e->next;
+          break;
+        }
+    }
+
+  lru_unlink (s, e);
+  s->size -= e->size;
+
+  gnutls_free (e->data.data);
+  gnutls_free (e);
+}
+
+static db_cache_entry_st *
+shard_find (db_cache_shard_st * s, uint32_t hash,
+            const gnutls_datum_t * key)
+{
+  db_cache_entry_st *e;
+
+  for (e = s->buckets[HASH_TO_BUCKET (hash)]; e != NULL; e = e->next)
+    {
+      if (e->hash == hash && e->key_size == key->size &&
+          memcmp (e->key, key->data, key->size) == 0)
+        return e;
+    }
+
+  return NULL;
+}
+
+/**
+ * gnutls_db_cache_init:
+ * @cache: The structure to be initialized
+ * @max_size: the maximum memory in bytes the cache may use, or zero
+ *
+ * This function will initialize an in-memory cache of resumable
+ * sessions, to be attached to server sessions with
+ * gnutls_db_set_cache(). The cache can be shared by any number of
+ * sessions and threads, and must outlive them.
+ *
+ * When the cache is full the least recently used sessions are
+ * removed. If @max_size is zero a default of 4 megabytes is used.
+ *
+ * Returns: On success, %GNUTLS_E_SUCCESS (0) is returned, otherwise a
+ *   negative error value.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_db_cache_init (gnutls_db_cache_t * cache, size_t max_size)
+{
+  gnutls_db_cache_t c;
+  int i, ret;
+
+  if (max_size == 0)
+    max_size = DB_CACHE_DEFAULT_SIZE;
+
+  c = gnutls_calloc (1, sizeof (*c));
+  if (c == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  for (i = 0; i < DB_CACHE_SHARDS; i++)
+    {
+      ret = gnutls_mutex_init (&c->shards[i].mutex);
+      if (ret < 0)
+        {
+          gnutls_assert ();
+          while (--i >= 0)
+            gnutls_mutex_deinit (&c->shards[i].mutex);
+          gnutls_free (c);
+          return ret;
+        }
+
+      c->shards[i].max_size = max_size / DB_CACHE_SHARDS;
+    }
+
+  *cache = c;
+
+  return 0;
+}
+
+/**
+ * gnutls_db_cache_deinit:
+ * @cache: The cache to be deinitialized
+ *
+ * This function will deinitialize the session cache and release
+ * all the stored sessions. No session may be using the cache when
+ * this function is called.
+ *
+ * Since: 3.1.6
+ **/
+void
+gnutls_db_cache_deinit (gnutls_db_cache_t cache)
+{
+  int i;
+
+  if (cache == NULL)
+    return;
+
+  for (i = 0; i < DB_CACHE_SHARDS; i++)
+    {
+      db_cache_shard_st *s = &cache->shards[i];
+
+      while (s->lru_head != NULL)
+        shard_remove_entry (s, s->lru_head);
+
+      gnutls_mutex_deinit (&s->mutex);
+    }
+
+  gnutls_free (cache);
+}
+
+/**
+ * gnutls_db_set_cache:
+ * @session: is a #gnutls_session_t structure.
+ * @cache: is an initialized session cache, or %NULL
+ *
+ * This function will make the server session store and look up
+ * resumable sessions in the given built-in cache. When a cache is
+ * set, the functions given with gnutls_db_set_store_function(),
+ * gnutls_db_set_retrieve_function() and gnutls_db_set_remove_function()
+ * are not used. Stored sessions expire after the time set with
+ * gnutls_db_set_cache_expiration().
+ *
+ * Since: 3.1.6
+ **/
+void
+gnutls_db_set_cache (gnutls_session_t session, gnutls_db_cache_t cache)
+{
+  session->internals.db_cache = cache;
+}
+
+/**
+ * gnutls_db_cache_get_stats:
+ * @cache: is an initialized session cache
+ * @hits: will hold the number of successful lookups
+ * @misses: will hold the number of failed lookups
+ * @evictions: will hold the number of sessions removed to make room
+ *
+ * This function reports the statistics of the session cache. Any
+ * of the output arguments may be %NULL. Lookups of expired sessions
+ * are counted as misses.
+ *
+ * Since: 3.1.6
+ **/
+void
+gnutls_db_cache_get_stats (gnutls_db_cache_t cache, unsigned int *hits,
+                           unsigned int *misses, unsigned int *evictions)
+{
+  unsigned int h = 0, m = 0, e = 0;
+  int i;
+
+  for (i = 0; i < DB_CACHE_SHARDS; i++)
+    {
+      db_cache_shard_st *s = &cache->shards[i];
+
+      SHARD_LOCK (s);
+      h += s->hits;
+      m += s->misses;
+      e += s->evictions;
+      SHARD_UNLOCK (s);
+    }
+
+  if (hits)
+    *hits = h;
+  if (misses)
+    *misses = m;
+  if (evictions)
+    *evictions = e;
+}
+
+/* Stores a copy of the data under the given key, replacing any
+ * previous entry.
+ */
+int
+_gnutls_db_cache_store (gnutls_db_cache_t cache, const gnutls_datum_t * key,
+                        const gnutls_datum_t * data, time_t expires)
+{
+  db_cache_shard_st *s;
+  db_cache_entry_st *e, *old;
+  uint32_t hash;
+  time_t now;
+
+  if (key->size == 0 || key->size > TLS_MAX_SESSION_ID_SIZE)
+    return gnutls_assert_val (GNUTLS_E_INVALID_SESSION);
+
+  hash = db_cache_hash (key->data, key->size);
+  s = &cache->shards[HASH_TO_SHARD (hash)];
+
+  /* prepare the entry outside the lock */
+  e = gnutls_calloc (1, sizeof (*e));
+  if (e == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  e->data.data = gnutls_malloc (data->size);
+  if (e->data.data == NULL)
+    {
+      gnutls_free (e);
+      return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+    }
+  memcpy (e->data.data, data->data, data->size);
+  e->data.size = data->size;
+
+  memcpy (e->key, key->data, key->size);
+  e->key_size = key->size;
+  e->hash = hash;
+  e->expires = expires;
+  e->size = sizeof (*e) + data->size;
+
+  if (e->size > s->max_size)
+    {
+      gnutls_free (e->data.data);
+      gnutls_free (e);
+      return gnutls_assert_val (GNUTLS_E_DB_ERROR);
+    }
+
+  now = gnutls_time (0);
+
+  SHARD_LOCK (s);
+
+  old = shard_find (s, hash, key);
+  if (old != NULL)
+    shard_remove_entry (s, old);
+
+  /* expired entries are dropped without counting as evictions */
+  while (s->lru_tail != NULL && s->size + e->size > s->max_size)
+    {
+      if (s->lru_tail->expires >= now)
+        s->evictions++;
+      shard_remove_entry (s, s->lru_tail);
+    }
+
+  e->next = s->buckets[HASH_TO_BUCKET (hash)];
+  s->buckets[HASH_TO_BUCKET (hash)] = e;
+  lru_push_front (s, e);
+  s->size += e->size;
+
+  SHARD_UNLOCK (s);
+
+  return 0;
+}
+
+/* Returns a copy of the data stored under the given key. The
+ * data must be released with gnutls_free().
+ */
+int
+_gnutls_db_cache_retrieve (gnutls_db_cache_t cache,
+                           const gnutls_datum_t * key, gnutls_datum_t * data)
+{
+  db_cache_shard_st *s;
+  db_cache_entry_st *e;
+  uint32_t hash;
+  int ret;
+
+  hash = db_cache_hash (key->data, key->size);
+  s = &cache->shards[HASH_TO_SHARD (hash)];
+
+  SHARD_LOCK (s);
+
+  e = shard_find (s, hash, key);
+  if (e != NULL && e->expires < gnutls_time (0))
+    {
+      shard_remove_entry (s, e);
+      e = NULL;
+    }
+
+  if (e == NULL)
+    {
+      s->misses++;
+      ret = GNUTLS_E_INVALID_SESSION;
+      goto finish;
+    }
+
+  data->data = gnutls_malloc (e->data.size);
+  if (data->data == NULL)
+    {
+      ret = GNUTLS_E_MEMORY_ERROR;
+      goto finish;
+    }
+  memcpy (data->data, e->data.data, e->data.size);
+  data->size = e->data.size;
+
+  lru_unlink (s, e);
+  lru_push_front (s, e);
+  s->hits++;
+  ret = 0;
+
+finish:
+  SHARD_UNLOCK (s);
+
+  if (ret < 0)
+    gnutls_assert ();
+  return ret;
+}
+
+int
+_gnutls_db_cache_remove (gnutls_db_cache_t cache, const gnutls_datum_t * key)
+{
+  db_cache_shard_st *s;
+  db_cache_entry_st *e;
+  uint32_t hash;
+
+  hash = db_cache_hash (key->data, key->size);
+  s = &cache->shards[HASH_TO_SHARD (hash)];
+
+  SHARD_LOCK (s);
+  e = shard_find (s, hash, key);
+  if (e != NULL)
+    shard_remove_entry (s, e);
+  SHARD_UNLOCK (s);
+
+  if (e == NULL)
+    return gnutls_assert_val (GNUTLS_E_INVALID_SESSION);
+
+  return 0;
+}
@@ -0,0 +1,666 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * The GnuTLS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/* This file contains a session cache kept in shared memory, for
+ * servers that handle connections in several processes. It is
+ * used through the gnutls_db_set_*_function() callbacks.
+ *
+ * The memory consists of a header followed by fixed-size slots.
+ * The slots are grouped in buckets of DB_SHM_BUCKET_SLOTS; a session
+ * ID hashes to a single bucket, whose slots are searched linearly.
+ * The buckets are protected by a fixed number of process-shared,
+ * robust mutexes, so that a worker dying while holding one does not
+ * block the others.
+ */
+
+#include <gnutls_int.h>
+#include <gnutls_errors.h>
+#include <gnutls_num.h>
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP) && \
+    defined(HAVE_LIBPTHREAD) && defined(HAVE_PTHREAD_MUTEXATTR_SETPSHARED) && \
+    defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4)
+/* the barriers order the header initialization with its magic */
+# define DB_SHM_SUPPORTED
+#endif
+
+#ifdef DB_SHM_SUPPORTED
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <errno.h>
+# include <pthread.h>
+# ifdef HAVE_FLOCK
+#  include <sys/file.h>
+# endif
+#endif
+
+#define DB_SHM_MAGIC 0x47544c53 /* "GTLS" */
+#define DB_SHM_VERSION 1
+
+#define DB_SHM_BUCKET_SLOTS 8
+#define DB_SHM_LOCKS 64
+
+#define DB_SHM_DEFAULT_SLOTS 1024
+#define DB_SHM_DEFAULT_SLOT_SIZE 4096
+#define DB_SHM_DEFAULT_EXPIRATION 3600
+
+#ifdef DB_SHM_SUPPORTED
+
+/* The record stored in each slot. key_size is zero for free slots.
+ */
+typedef struct
+{
+  uint32_t hash;
+  uint16_t key_size;
+  uint16_t reserved;
+  uint32_t data_size;
+  uint32_t reserved2;
+  int64_t expires;
+  uint64_t stamp;               /* for LRU replacement within a bucket */
+  uint8_t key[TLS_MAX_SESSION_ID_SIZE];
+  /* followed by slot_size bytes of data */
+} db_shm_slot_st;
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t nslots;
+  uint32_t slot_size;
+  uint32_t expiration;
+  uint32_t reserved;
+  uint64_t clock[DB_SHM_LOCKS]; /* per lock, to avoid a shared counter */
+  pthread_mutex_t locks[DB_SHM_LOCKS];
+} db_shm_header_st;
+
+struct gnutls_db_shm_cache_int
+{
+  void *mem;
+  size_t mem_size;
+  db_shm_header_st *header;
+  uint8_t *slots;
+  size_t slot_stride;
+  unsigned int nbuckets;
+};
+
+#define SLOT_STRIDE(slot_size) \
+  ((sizeof (db_shm_slot_st) + (slot_size) + 7) & ~((size_t) 7))
+#define HEADER_SIZE ((sizeof (db_shm_header_st) + 63) & ~((size_t) 63))
+
+static inline db_shm_slot_st *
+get_slot (gnutls_db_shm_cache_t cache, unsigned int i)
+{
+  return (db_shm_slot_st *) (cache->slots + i * cache->slot_stride);
+}
+
+static inline uint8_t *
+slot_data (db_shm_slot_st * slot)
+{
+  return ((uint8_t *) slot) + sizeof (db_shm_slot_st);
+}
+
+static uint32_t
+db_shm_hash (const uint8_t * key, unsigned int key_size)
+{
+  uint32_t h = 2166136261U;
+  unsigned int i;
+
+  for (i = 0; i < key_size; i++)
+    {
+      h ^= key[i];
+      h *= 16777619U;
+    }
+
+  /* the low bits select the bucket; fold the high ones in */
+  return h ^ (h >> 16);
+}
+
+/* Locks the mutex protecting the bucket. If the previous owner died
+ * while holding it, the bucket's slots may be half written, so they
+ * are discarded before the mutex is marked consistent.
+ */
+static int
+bucket_lock (gnutls_db_shm_cache_t cache, unsigned int bucket)
+{
+  pthread_mutex_t *m = &cache->header->locks[bucket % DB_SHM_LOCKS];
+  unsigned int i, b;
+  int ret;
+
+  ret = pthread_mutex_lock (m);
+#ifdef HAVE_PTHREAD_MUTEXATTR_SETROBUST
+  if (ret == EOWNERDEAD)
+    {
+      _gnutls_debug_log ("db-shm: recovering lock %u\n",
+                         bucket % DB_SHM_LOCKS);
+
+      for (b = bucket % DB_SHM_LOCKS; b < cache->nbuckets; b += DB_SHM_LOCKS)
+        for (i = 0; i < DB_SHM_BUCKET_SLOTS; i++)
+          get_slot (cache, b * DB_SHM_BUCKET_SLOTS + i)->key_size = 0;
+
+      pthread_mutex_consistent (m);
+      ret = 0;
+    }
+#endif
+  if (ret != 0)
+    return gnutls_assert_val (GNUTLS_E_LOCKING_ERROR);
+
+  return 0;
+}
+
+static void
+bucket_unlock (gnutls_db_shm_cache_t cache, unsigned int bucket)
+{
+  pthread_mutex_unlock (&cache->header->locks[bucket % DB_SHM_LOCKS]);
+}
+
+/* Returns non-zero if the header was initialized by another process
+ * with the given parameters. The barrier pairs with the one in
+ * db_shm_header_init() so that the other fields are read after it.
+ */
+static int
+db_shm_header_check (db_shm_header_st * header, unsigned int nslots,
+                     unsigned int slot_size)
+{
+  if (*(volatile uint32_t *) &header->magic != DB_SHM_MAGIC)
+    return 0;
+  __sync_synchronize ();
+
+  return header->version == DB_SHM_VERSION
+    && header->nslots == nslots && header->slot_size == slot_size;
+}
+
+static int
+db_shm_header_init (db_shm_header_st * header, unsigned int nslots,
+                    unsigned int slot_size, unsigned int expiration)
+{
+  pthread_mutexattr_t attr;
+  int i, ret = 0;
+
+  if (pthread_mutexattr_init (&attr) != 0)
+    return gnutls_assert_val (GNUTLS_E_LOCKING_ERROR);
+
+  if (pthread_mutexattr_setpshared (&attr, PTHREAD_PROCESS_SHARED) != 0)
+    {
+      ret = gnutls_assert_val (GNUTLS_E_LOCKING_ERROR);
+      goto cleanup;
+    }
+#ifdef HAVE_PTHREAD_MUTEXATTR_SETROBUST
+  if (pthread_mutexattr_setrobust (&attr, PTHREAD_MUTEX_ROBUST) != 0)
+    {
+      ret = gnutls_assert_val (GNUTLS_E_LOCKING_ERROR);
+      goto cleanup;
+    }
+#endif
+
+  for (i = 0; i < DB_SHM_LOCKS; i++)
+    {
+      if (pthread_mutex_init (&header->locks[i], &attr) != 0)
+        {
+          ret = gnutls_assert_val (GNUTLS_E_LOCKING_ERROR);
+          goto cleanup;
+        }
+    }
+
+  header->version = DB_SHM_VERSION;
+  header->nslots = nslots;
+  header->slot_size = slot_size;
+  header->expiration = expiration;
+  /* set last, after a barrier that makes the fields above visible
+   * to the processes that attach to the file and check it */
+  __sync_synchronize ();
+  *(volatile uint32_t *) &header->magic = DB_SHM_MAGIC;
+
+cleanup:
+  pthread_mutexattr_destroy (&attr);
+  return ret;
+}
+
+#ifdef HAVE_FLOCK
+/* Maps the named file of a cache, and initializes it unless another
+ * process has. The file is checked and initialized under an
+ * exclusive lock on it, so a process never attaches to a file that
+ * is still being created. A file left without its magic by a process
+ * that died during the initialization is initialized again.
+ */
+static int
+db_shm_file_map (gnutls_db_shm_cache_t c, const char *file,
+                 unsigned int nslots, unsigned int slot_size,
+                 unsigned int expiration)
+{
+  struct stat st;
+  uint32_t magic = 0;
+  int fd, ret;
+
+  fd = open (file, O_RDWR | O_CREAT, 0600);
+  if (fd < 0)
+    return gnutls_assert_val (GNUTLS_E_FILE_ERROR);
+
+  while ((ret = flock (fd, LOCK_EX)) != 0 && errno == EINTR);
+  if (ret != 0)
+    {
+      ret = gnutls_assert_val (GNUTLS_E_LOCKING_ERROR);
+      goto cleanup;
+    }
+
+  if (fstat (fd, &st) != 0)
+    {
+      ret = gnutls_assert_val (GNUTLS_E_FILE_ERROR);
+      goto cleanup;
+    }
+
+  if ((size_t) st.st_size >= HEADER_SIZE
+      && pread (fd, &magic, sizeof (magic),
+                offsetof (db_shm_header_st, magic)) != sizeof (magic))
+    {
+      ret = gnutls_assert_val (GNUTLS_E_FILE_ERROR);
+      goto cleanup;
+    }
+
+  if (magic == DB_SHM_MAGIC)
+    {
+      if ((size_t) st.st_size != c->mem_size)
+        {
+          _gnutls_debug_log ("db-shm: %s is not a compatible cache\n", file);
+          ret = gnutls_assert_val (GNUTLS_E_FILE_ERROR);
+          goto cleanup;
+        }
+    }
+  else
+    {
+      /* new or incomplete; no process is attached to it, so it can
+       * be zero filled again */
+      if (ftruncate (fd, 0) != 0 || ftruncate (fd, c->mem_size) != 0)
+        {
+          ret = gnutls_assert_val (GNUTLS_E_FILE_ERROR);
+          goto cleanup;
+        }
+    }
+
+  c->mem = mmap (NULL, c->mem_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                 fd, 0);
+  if (c->mem == MAP_FAILED)
+    {
+      c->mem = NULL;
+      ret = gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+      goto cleanup;
+    }
+
+  if (magic == DB_SHM_MAGIC)
+    {
+      if (!db_shm_header_check (c->mem, nslots, slot_size))
+        {
+          _gnutls_debug_log ("db-shm: %s is not a compatible cache\n", file);
+          ret = gnutls_assert_val (GNUTLS_E_FILE_ERROR);
+          goto cleanup;
+        }
+    }
+  else
+    {
+      ret = db_shm_header_init (c->mem, nslots, slot_size, expiration);
+      if (ret < 0)
+        goto cleanup;
+    }
+
+  ret = 0;
+
+cleanup:
+  if (ret < 0 && c->mem != NULL)
+    {
+      munmap (c->mem, c->mem_size);
+      c->mem = NULL;
+    }
+  close (fd);                   /* releases the lock */
+  return ret;
+}
+#endif
+
+#endif /* DB_SHM_SUPPORTED */
+
+/**
+ * gnutls_db_shm_cache_init:
+ * @cache: The structure to be initialized
+ * @file: a file to map, or %NULL
+ * @slots: the number of sessions to hold, or zero
+ * @slot_size: the maximum size of a stored session, or zero
+ * @expiration: the lifetime of stored sessions in seconds, or zero
+ *
+ * This function will initialize a session cache in shared memory,
+ * to be used by server processes through gnutls_db_set_ptr() and
+ * the gnutls_db_shm_cache_store(), gnutls_db_shm_cache_retrieve()
+ * and gnutls_db_shm_cache_remove() callbacks.
+ *
+ * If @file is %NULL the cache is anonymous and is shared with the
+ * child processes forked after this call. Otherwise the given file is
+ * created, or attached to if it has been created by another process
+ * with the same parameters. The processes serialize the creation with
+ * flock(); a file left incomplete by a process that died while
+ * creating it is initialized again.
+ *
+ * The defaults for zero values are 1024 slots of 4096 bytes, and
+ * an expiration of one hour. Sessions larger than @slot_size are
+ * not cached.
+ *
+ * Returns: On success, %GNUTLS_E_SUCCESS (0) is returned, otherwise a
+ *   negative error value. %GNUTLS_E_UNIMPLEMENTED_FEATURE is returned
+ *   if the system lacks process-shared mutexes, mmap() or memory
+ *   barriers, or flock() for a named @file.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_db_shm_cache_init (gnutls_db_shm_cache_t * cache, const char *file,
+                          unsigned int slots, unsigned int slot_size,
+                          unsigned int expiration)
+{
+#ifdef DB_SHM_SUPPORTED
+  gnutls_db_shm_cache_t c;
+  unsigned int nbuckets;
+  int ret;
+
+  if (slots == 0)
+    slots = DB_SHM_DEFAULT_SLOTS;
+  if (slot_size == 0)
+    slot_size = DB_SHM_DEFAULT_SLOT_SIZE;
+  if (expiration == 0)
+    expiration = DB_SHM_DEFAULT_EXPIRATION;
+
+  nbuckets = (slots + DB_SHM_BUCKET_SLOTS - 1) / DB_SHM_BUCKET_SLOTS;
+  slots = nbuckets * DB_SHM_BUCKET_SLOTS;
+
+  c = gnutls_calloc (1, sizeof (*c));
+  if (c == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  c->nbuckets = nbuckets;
+  c->slot_stride = SLOT_STRIDE (slot_size);
+  c->mem_size = HEADER_SIZE + (size_t) slots *c->slot_stride;
+
+  if (file == NULL)
+    {
+      c->mem = mmap (NULL, c->mem_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+      if (c->mem == MAP_FAILED)
+        {
+          c->mem = NULL;
+          ret = gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+          goto fail;
+        }
+
+      /* new mappings are zero filled */
+      ret = db_shm_header_init (c->mem, slots, slot_size, expiration);
+      if (ret < 0)
+        goto fail;
+    }
+  else
+    {
+#ifdef HAVE_FLOCK
+      ret = db_shm_file_map (c, file, slots, slot_size, expiration);
+      if (ret < 0)
+        goto fail;
+#else
+      ret = gnutls_assert_val (GNUTLS_E_UNIMPLEMENTED_FEATURE);
+      goto fail;
+#endif
+    }
+
+  c->header = c->mem;
+  c->slots = ((uint8_t *) c->mem) + HEADER_SIZE;
+
+  *cache = c;
+  return 0;
+
+fail:
+  if (c->mem != NULL)
+    munmap (c->mem, c->mem_size);
+  gnutls_free (c);
+  return ret;
+#else
+  return gnutls_assert_val (GNUTLS_E_UNIMPLEMENTED_FEATURE);
+#endif
+}
+
+/**
+ * gnutls_db_shm_cache_deinit:
+ * @cache: The cache to be deinitialized
+ *
+ * This function will unmap the shared session cache from the calling
+ * process. The stored sessions remain available to the other
+ * processes using it; a backing file is not removed.
+ *
+ * Since: 3.1.6
+ **/
+void
+gnutls_db_shm_cache_deinit (gnutls_db_shm_cache_t cache)
+{
+#ifdef DB_SHM_SUPPORTED
+  if (cache == NULL)
+    return;
+
+  munmap (cache->mem, cache->mem_size);
+  gnutls_free (cache);
+#endif
+}
+
+/**
+ * gnutls_db_shm_cache_store:
+ * @cache: a #gnutls_db_shm_cache_t, as given to gnutls_db_set_ptr()
+ * @key: the session ID
+ * @data: the session data
+ *
+ * A store function for gnutls_db_set_store_function() that uses
+ * the shared memory cache. When the session's bucket is full the
+ * least recently used entry is replaced.
+ *
+ * Returns: zero on success, or a negative error value.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_db_shm_cache_store (void *cache, gnutls_datum_t key,
+                           gnutls_datum_t data)
+{
+#ifdef DB_SHM_SUPPORTED
+  gnutls_db_shm_cache_t c = cache;
+  db_shm_slot_st *slot, *victim = NULL, *free_slot = NULL, *lru_slot = NULL;
+  unsigned int bucket, i;
+  uint32_t hash;
+  time_t now;
+  int ret;
+
+  if (c == NULL || key.size == 0 || key.size > TLS_MAX_SESSION_ID_SIZE)
+    return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST);
+
+  if (data.size > c->header->slot_size)
+    return gnutls_assert_val (GNUTLS_E_SHORT_MEMORY_BUFFER);
+
+  hash = db_shm_hash (key.data, key.size);
+  bucket = hash % c->nbuckets;
+  now = gnutls_time (0);
+
+  ret = bucket_lock (c, bucket);
+  if (ret < 0)
+    return ret;
+
+  /* prefer the same key, then a free or expired slot, then the LRU */
+  for (i = 0; i < DB_SHM_BUCKET_SLOTS; i++)
+    {
+      slot = get_slot (c, bucket * DB_SHM_BUCKET_SLOTS + i);
+
+      if (slot->key_size == key.size && slot->hash == hash &&
+          memcmp (slot->key, key.data, key.size) == 0)
+        {
+          victim = slot;
+          break;
+        }
+
+      if (slot->key_size == 0 || slot->expires < now)
+        {
+          if (free_slot == NULL)
+            free_slot = slot;
+        }
+      else if (lru_slot == NULL || slot->stamp < lru_slot->stamp)
+        lru_slot = slot;
+    }
+
+  if (victim == NULL)
+    victim = (free_slot != NULL) ? free_slot : lru_slot;
+
+  victim->hash = hash;
+  victim->key_size = key.size;
+  victim->data_size = data.size;
+  victim->expires = now + c->header->expiration;
+  victim->stamp = ++c->header->clock[bucket % DB_SHM_LOCKS];
+  memcpy (victim->key, key.data, key.size);
+  memcpy (slot_data (victim), data.data, data.size);
+
+  bucket_unlock (c, bucket);
+
+  return 0;
+#else
+  return gnutls_assert_val (GNUTLS_E_UNIMPLEMENTED_FEATURE);
+#endif
+}
+
+/**
+ * gnutls_db_shm_cache_retrieve:
+ * @cache: a #gnutls_db_shm_cache_t, as given to gnutls_db_set_ptr()
+ * @key: the session ID
+ *
+ * A retrieve function for gnutls_db_set_retrieve_function() that
+ * uses the shared memory cache.
+ *
+ * Returns: the session data allocated with gnutls_malloc(), or
+ *   a datum containing %NULL and 0 if not found.
+ *
+ * Since: 3.1.6
+ **/
+gnutls_datum_t
+gnutls_db_shm_cache_retrieve (void *cache, gnutls_datum_t key)
+{
+  gnutls_datum_t res = { NULL, 0 };
+#ifdef DB_SHM_SUPPORTED
+  gnutls_db_shm_cache_t c = cache;
+  db_shm_slot_st *slot;
+  unsigned int bucket, i;
+  uint32_t hash, size;
+
+  if (c == NULL || key.size == 0 || key.size > TLS_MAX_SESSION_ID_SIZE)
+    return res;
+
+  hash = db_shm_hash (key.data, key.size);
+  bucket = hash % c->nbuckets;
+
+  if (bucket_lock (c, bucket) < 0)
+    return res;
+
+  for (i = 0; i < DB_SHM_BUCKET_SLOTS; i++)
+    {
+      slot = get_slot (c, bucket * DB_SHM_BUCKET_SLOTS + i);
+
+      if (slot->key_size != key.size || slot->hash != hash ||
+          memcmp (slot->key, key.data, key.size) != 0)
+        continue;
+
+      if (slot->expires < gnutls_time (0))
+        {
+          slot->key_size = 0;
+          break;
+        }
+
+      /* the slot is writable by every process sharing the cache;
+       * never copy beyond the data area of the local layout */
+      size = slot->data_size;
+      if (size > c->slot_stride - sizeof (db_shm_slot_st))
+        {
+          gnutls_assert ();
+          slot->key_size = 0;
+          break;
+        }
+
+      res.data = gnutls_malloc (size);
+      if (res.data != NULL)
+        {
+          memcpy (res.data, slot_data (slot), size);
+          res.size = size;
+          slot->stamp = ++c->header->clock[bucket % DB_SHM_LOCKS];
+        }
+      break;
+    }
+
+  bucket_unlock (c, bucket);
+#endif
+  return res;
+}
+
+/**
+ * gnutls_db_shm_cache_remove:
+ * @cache: a #gnutls_db_shm_cache_t, as given to gnutls_db_set_ptr()
+ * @key: the session ID
+ *
+ * A remove function for gnutls_db_set_remove_function() that
+ * uses the shared memory cache.
+ *
+ * Returns: zero on success, or a negative error value if the
+ *   session was not found.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_db_shm_cache_remove (void *cache, gnutls_datum_t key)
+{
+#ifdef DB_SHM_SUPPORTED
+  gnutls_db_shm_cache_t c = cache;
+  db_shm_slot_st *slot;
+  unsigned int bucket, i;
+  uint32_t hash;
+  int ret = GNUTLS_E_INVALID_SESSION;
+
+  if (c == NULL || key.size == 0 || key.size > TLS_MAX_SESSION_ID_SIZE)
+    return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST);
+
+  hash = db_shm_hash (key.data, key.size);
+  bucket = hash % c->nbuckets;
+
+  if (bucket_lock (c, bucket) < 0)
+    return gnutls_assert_val (GNUTLS_E_LOCKING_ERROR);
+
+  for (i = 0; i < DB_SHM_BUCKET_SLOTS; i++)
+    {
+      slot = get_slot (c, bucket * DB_SHM_BUCKET_SLOTS + i);
+
+      if (slot->key_size == key.size && slot->hash == hash &&
+          memcmp (slot->key, key.data, key.size) == 0)
+        {
+          slot->key_size = 0;
+          ret = 0;
+          break;
+        }
+    }
+
+  bucket_unlock (c, bucket);
+
+  return ret;
+#else
+  return gnutls_assert_val (GNUTLS_E_UNIMPLEMENTED_FEATURE);
+#endif
+}
@@ -394,7 +394,8 @@ _gnutls_ext_register (extension_entry_st * mod)
 }
 
 int
-_gnutls_ext_pack (gnutls_session_t session, gnutls_buffer_st * packed)
+_gnutls_ext_pack (gnutls_session_t session, gnutls_buffer_st * packed,
+                  unsigned compact)
 {
   unsigned int i;
   int ret;
@@ -405,17 +406,32 @@ _gnutls_ext_pack (gnutls_session_t session, gnutls_buffer_st * packed)
   int exts = 0;
 
   total_exts_pos = packed->length;
-  BUFFER_APPEND_NUM (packed, 0);
+  if (compact)
+    {
+      BUFFER_APPEND_NUM8 (packed, 0);
+    }
+  else
+    {
+      BUFFER_APPEND_NUM (packed, 0);
+    }
 
   for (i = 0; i < extfunc_size; i++)
     {
       ret = _gnutls_ext_get_session_data (session, extfunc[i].type, &data);
       if (ret >= 0 && extfunc[i].pack_func != NULL)
         {
-          BUFFER_APPEND_NUM (packed, extfunc[i].type);
-
-          size_offset = packed->length;
-          BUFFER_APPEND_NUM (packed, 0);
+          if (compact)
+            {
+              BUFFER_APPEND_NUM16 (packed, extfunc[i].type);
+              size_offset = packed->length;
+              BUFFER_APPEND_NUM16 (packed, 0);
+            }
+          else
+            {
+              BUFFER_APPEND_NUM (packed, extfunc[i].type);
+              size_offset = packed->length;
+              BUFFER_APPEND_NUM (packed, 0);
+            }
 
           cur_size = packed->length;
 
@@ -428,12 +444,23 @@ _gnutls_ext_pack (gnutls_session_t session, gnutls_buffer_st * packed)
 
           exts++;
           /* write the actual size */
-          _gnutls_write_uint32 (packed->length - cur_size,
-                                packed->data + size_offset);
+          if (compact)
+            {
+              if (packed->length - cur_size > 0xffff)
+                return gnutls_assert_val (GNUTLS_E_INTERNAL_ERROR);
+              _gnutls_write_uint16 (packed->length - cur_size,
+                                    packed->data + size_offset);
+            }
+          else
+            _gnutls_write_uint32 (packed->length - cur_size,
+                                  packed->data + size_offset);
         }
     }
 
-  _gnutls_write_uint32 (exts, packed->data + total_exts_pos);
+  if (compact)
+    packed->data[total_exts_pos] = exts;
+  else
+    _gnutls_write_uint32 (exts, packed->data + total_exts_pos);
 
   return 0;
 
@@ -506,7 +533,8 @@ _gnutls_ext_set_resumed_session_data (gnutls_session_t session, uint16_t type,
 }
 
 int
-_gnutls_ext_unpack (gnutls_session_t session, gnutls_buffer_st * packed)
+_gnutls_ext_unpack (gnutls_session_t session, gnutls_buffer_st * packed,
+                    unsigned compact)
 {
   int i, ret;
   extension_priv_data_t data;
@@ -516,11 +544,26 @@ _gnutls_ext_unpack (gnutls_session_t session, gnutls_buffer_st * packed)
   int size_for_type, cur_pos;
 
 
-  BUFFER_POP_NUM (packed, max_exts);
+  if (compact)
+    {
+      BUFFER_POP_NUM8 (packed, max_exts);
+    }
+  else
+    {
+      BUFFER_POP_NUM (packed, max_exts);
+    }
   for (i = 0; i < max_exts; i++)
     {
-      BUFFER_POP_NUM (packed, type);
-      BUFFER_POP_NUM (packed, size_for_type);
+      if (compact)
+        {
+          BUFFER_POP_NUM16 (packed, type);
+          BUFFER_POP_NUM16 (packed, size_for_type);
+        }
+      else
+        {
+          BUFFER_POP_NUM (packed, type);
+          BUFFER_POP_NUM (packed, size_for_type);
+        }
 
       cur_pos = packed->length;
 
@@ -26,15 +26,20 @@
 #include <gnutls_dh.h>
 #include <random.h>
 #include <gnutls/pkcs11.h>
+#include <pkcs11_int.h>
 
 #include <gnutls_extensions.h>  /* for _gnutls_ext_init */
 #include <locks.h>
 #include <system.h>
+#include <gnutls_priority.h>
+#include <gnutls_pcert_cache.h>
+#include <algorithms.h>
 #include <accelerated/cryptodev.h>
 #include <accelerated/accelerated.h>
 
 #include "sockets.h"
 #include "gettext.h"
+#include <timespec.h>
 
 /* Minimum library versions we accept. */
 #define GNUTLS_MIN_LIBTASN1_VERSION "0.3.4"
@@ -47,6 +52,14 @@ extern void *_gnutls_file_mutex;
 ASN1_TYPE _gnutls_pkix1_asn;
 ASN1_TYPE _gnutls_gnutls_asn;
 
+/* The ASN.1 definition trees are only needed once a structure
+ * is decoded or encoded, so they are built on first use rather
+ * than in gnutls_global_init(). */
+static void *_gnutls_asn_mutex = NULL;
+
+#define ASN_LOCK if (gnutls_mutex_lock(&_gnutls_asn_mutex)!=0) abort()
+#define ASN_UNLOCK if (gnutls_mutex_unlock(&_gnutls_asn_mutex)!=0) abort()
+
 gnutls_log_func _gnutls_log_func;
 gnutls_audit_log_func _gnutls_audit_log_func;
 int _gnutls_log_level = 0;      /* default log level */
@@ -168,6 +181,77 @@ gnutls_global_set_mem_functions (gnutls_alloc_function alloc_func,
 
 static int _gnutls_init = 0;
 
+static ASN1_TYPE
+_gnutls_asn_tree (ASN1_TYPE * tree, const ASN1_ARRAY_TYPE * tab,
+                  const char *name)
+{
+  ASN1_TYPE t;
+  int res;
+
+#ifdef HAVE_MEMORY_BARRIER
+  /* once set, the tree is not modified until gnutls_global_deinit();
+   * the barrier pairs with the one before it is published */
+  t = *(ASN1_TYPE volatile *) tree;
+  if (t != ASN1_TYPE_EMPTY)
+    {
+      gnutls_memory_barrier ();
+      return t;
+    }
+#endif
+
+  ASN_LOCK;
+  t = *tree;
+  if (t == ASN1_TYPE_EMPTY)
+    {
+      res = asn1_array2tree (tab, &t, NULL);
+      if (res != ASN1_SUCCESS)
+        {
+          gnutls_assert ();
+          _gnutls_debug_log ("Cannot parse the %s ASN.1 definitions: %s\n",
+                             name, asn1_strerror (res));
+          t = ASN1_TYPE_EMPTY;
+        }
+      else
+        {
+#ifdef HAVE_MEMORY_BARRIER
+          gnutls_memory_barrier ();
+#endif
+          *(ASN1_TYPE volatile *) tree = t;
+        }
+    }
+  ASN_UNLOCK;
+
+  return t;
+}
+
+ASN1_TYPE
+_gnutls_get_pkix_asn (void)
+{
+  return _gnutls_asn_tree (&_gnutls_pkix1_asn, pkix_asn1_tab, "PKIX");
+}
+
+ASN1_TYPE
+_gnutls_get_gnutls_asn_tree (void)
+{
+  return _gnutls_asn_tree (&_gnutls_gnutls_asn, gnutls_asn1_tab, "GnuTLS");
+}
+
+/* logs the time spent in an initialization step */
+static void
+_gnutls_init_time_log (const char *step, struct timespec *start)
+{
+  struct timespec now;
+
+  if (_gnutls_log_level < 2)
+    return;
+
+  gettime (&now);
+  _gnutls_debug_log ("global init: %s took %ld us\n", step,
+                     (long) ((now.tv_sec - start->tv_sec) * 1000000 +
+                             (now.tv_nsec - start->tv_nsec) / 1000));
+  *start = now;
+}
+
 /**
  * gnutls_global_init:
  *
@@ -201,10 +285,14 @@ gnutls_global_init (void)
 {
   int result = 0;
   int res;
+  struct timespec start, total;
 
   if (_gnutls_init++)
     goto out;
 
+  gettime (&start);
+  total = start;
+
   if (gl_sockets_startup (SOCKETS_1_1))
     return gnutls_assert_val(GNUTLS_E_FILE_ERROR);
 
@@ -216,12 +304,16 @@ gnutls_global_init (void)
       gnutls_assert ();
       return GNUTLS_E_CRYPTO_INIT_FAILED;
     }
+  _gnutls_init_time_log ("crypto backend", &start);
 
   _gnutls_register_accel_crypto();
+  _gnutls_init_time_log ("CPU acceleration", &start);
 
-  /* initialize ASN.1 parser
-   * This should not deal with files in the final
-   * version.
+  _gnutls_algorithms_init ();
+
+  /* initialize ASN.1 parser. The definition trees are
+   * parsed on first use by _gnutls_get_pkix() and
+   * _gnutls_get_gnutls_asn().
    */
   if (asn1_check_version (GNUTLS_MIN_LIBTASN1_VERSION) == NULL)
     {
@@ -232,17 +324,10 @@ gnutls_global_init (void)
       return GNUTLS_E_INCOMPATIBLE_LIBTASN1_LIBRARY;
     }
 
-  res = asn1_array2tree (pkix_asn1_tab, &_gnutls_pkix1_asn, NULL);
-  if (res != ASN1_SUCCESS)
-    {
-      result = _gnutls_asn2err (res);
-      goto out;
-    }
-
-  res = asn1_array2tree (gnutls_asn1_tab, &_gnutls_gnutls_asn, NULL);
-  if (res != ASN1_SUCCESS)
+  result = gnutls_mutex_init (&_gnutls_asn_mutex);
+  if (result < 0)
     {
-      result = _gnutls_asn2err (res);
+      gnutls_assert ();
       goto out;
     }
 
@@ -253,6 +338,7 @@ gnutls_global_init (void)
       gnutls_assert ();
       goto out;
     }
+  _gnutls_init_time_log ("random generator", &start);
 
   /* Initialize the default TLS extensions */
   result = _gnutls_ext_init ();
@@ -269,18 +355,37 @@ gnutls_global_init (void)
       goto out;
     }
 
+  result = _gnutls_priority_cache_init ();
+  if (result < 0)
+    {
+      gnutls_assert ();
+      goto out;
+    }
+
+  result = _gnutls_pcert_cache_init ();
+  if (result < 0)
+    {
+      gnutls_assert ();
+      goto out;
+    }
+
   result = gnutls_system_global_init ();
   if (result < 0)
     {
       gnutls_assert ();
       goto out;
     }
+  _gnutls_init_time_log ("extensions and system", &start);
 
 #ifdef ENABLE_PKCS11
-  gnutls_pkcs11_init (GNUTLS_PKCS11_FLAG_AUTO, NULL);
+  /* the modules are loaded on the first PKCS #11 operation */
+  _gnutls_pkcs11_auto_init_schedule ();
 #endif
 
   _gnutls_cryptodev_init ();
+  _gnutls_init_time_log ("cryptodev", &start);
+
+  _gnutls_init_time_log ("total", &total);
 
 out:
   return result;
@@ -304,15 +409,20 @@ gnutls_global_deinit (void)
       gnutls_crypto_deinit();
       _gnutls_rnd_deinit ();
       _gnutls_ext_deinit ();
-      asn1_delete_structure (&_gnutls_gnutls_asn);
-      asn1_delete_structure (&_gnutls_pkix1_asn);
+      if (_gnutls_gnutls_asn != ASN1_TYPE_EMPTY)
+        asn1_delete_structure (&_gnutls_gnutls_asn);
+      if (_gnutls_pkix1_asn != ASN1_TYPE_EMPTY)
+        asn1_delete_structure (&_gnutls_pkix1_asn);
+      gnutls_mutex_deinit (&_gnutls_asn_mutex);
       _gnutls_crypto_deregister ();
       _gnutls_cryptodev_deinit ();
       gnutls_system_global_deinit ();
 #ifdef ENABLE_PKCS11
-      gnutls_pkcs11_deinit ();
+      _gnutls_pkcs11_auto_deinit ();
 #endif
       gnutls_mutex_deinit(&_gnutls_file_mutex);
+      _gnutls_priority_cache_deinit ();
+      _gnutls_pcert_cache_deinit ();
     }
   _gnutls_init--;
 }
@@ -31,12 +31,14 @@ int gnutls_is_secure_memory (const void *mem);
 extern ASN1_TYPE _gnutls_pkix1_asn;
 extern ASN1_TYPE _gnutls_gnutls_asn;
 
-/* removed const from node_asn* to
- * prevent warnings, since libtasn1 doesn't
- * use the const keywork in its functions.
+/* The trees are parsed on first use; these return
+ * ASN1_TYPE_EMPTY if the definitions could not be parsed.
  */
-#define _gnutls_get_gnutls_asn() ((ASN1_TYPE) _gnutls_gnutls_asn)
-#define _gnutls_get_pkix() ((ASN1_TYPE) _gnutls_pkix1_asn)
+ASN1_TYPE _gnutls_get_pkix_asn (void);
+ASN1_TYPE _gnutls_get_gnutls_asn_tree (void);
+
+#define _gnutls_get_gnutls_asn() _gnutls_get_gnutls_asn_tree()
+#define _gnutls_get_pkix() _gnutls_get_pkix_asn()
 
 extern gnutls_log_func _gnutls_log_func;
 extern gnutls_audit_log_func _gnutls_audit_log_func;
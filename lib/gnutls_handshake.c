@@ -54,6 +54,7 @@
 #include <auth/psk.h>           /* for gnutls_psk_server_credentials_t */
 #include <random.h>
 #include <gnutls_dtls.h>
+#include <gnutls_client_cache.h>
 
 #ifdef HANDSHAKE_DEBUG
 #define ERR(x, y) _gnutls_handshake_log("HSK[%p]: %s (%d)\n", session, x,y)
@@ -72,6 +73,12 @@ _gnutls_remove_unwanted_ciphersuites (gnutls_session_t session,
                                       int cipher_suites_size,
                                       gnutls_pk_algorithm_t *pk_algos,
                                       size_t pk_algos_size);
+static int select_cert_kx (gnutls_session_t session,
+                           gnutls_pk_algorithm_t *pk_algos,
+                           size_t pk_algos_size,
+                           gnutls_kx_algorithm_t * alg, int *alg_size);
+static int kx_is_unwanted (gnutls_session_t session, gnutls_kx_algorithm_t kx,
+                           gnutls_kx_algorithm_t * alg, int alg_size);
 static int _gnutls_handshake_client (gnutls_session_t session);
 static int _gnutls_handshake_server (gnutls_session_t session);
 
@@ -804,25 +811,38 @@ server_find_pk_algos_in_ciphersuites (const uint8_t *
   return 0;
 }
 
+/* The states of the key exchange algorithms in _gnutls_server_select_suite() */
+#define KX_UNCHECKED 0
+#define KX_USABLE 1
+#define KX_UNWANTED 2
+
 /* This selects the best supported ciphersuite from the given ones. Then
  * it adds the suite to the session and performs some checks.
+ *
+ * The client's suites are looked up in the index of the priorities,
+ * and the credentials are checked once for each key exchange method
+ * of the suites that are enabled.
  */
 int
 _gnutls_server_select_suite (gnutls_session_t session, uint8_t * data,
                              unsigned int datalen)
 {
   int ret;
-  unsigned int i, j, cipher_suites_size;
+  unsigned int j;
   size_t pk_algos_size;
-  uint8_t cipher_suites[MAX_CIPHERSUITE_SIZE];
-  int retval, err;
+  int retval, err, rank, selected_rank = -1;
+  unsigned int selected = 0;
+  gnutls_kx_algorithm_t kx, selected_kx = 0;
+  gnutls_kx_algorithm_t alg[MAX_ALGOS];
+  int alg_size = MAX_ALGOS;
+  uint8_t kx_state[MAX_ALGOS];
   gnutls_pk_algorithm_t pk_algos[MAX_ALGOS];        /* will hold the pk algorithms
                                          * supported by the peer.
                                          */
 
   /* First, check for safe renegotiation SCSV.
    */
-  if (session->internals.priorities.sr != SR_DISABLED)
+  if (session->internals.priorities->sr != SR_DISABLED)
     {
       unsigned int offset;
 
@@ -845,33 +865,6 @@ _gnutls_server_select_suite (gnutls_session_t session, uint8_t * data,
         }
     }
 
-  pk_algos_size = MAX_ALGOS;
-  ret = server_find_pk_algos_in_ciphersuites (data, datalen, pk_algos, &pk_algos_size);
-  if (ret < 0)
-    return gnutls_assert_val(ret);
-
-  ret = _gnutls_supported_ciphersuites (session, cipher_suites, sizeof(cipher_suites));
-  if (ret < 0)
-    return gnutls_assert_val(ret);
-    
-  cipher_suites_size = ret;
-
-  /* Here we remove any ciphersuite that does not conform
-   * the certificate requested, or to the
-   * authentication requested (e.g. SRP).
-   */
-  ret = _gnutls_remove_unwanted_ciphersuites (session, cipher_suites, cipher_suites_size, pk_algos, pk_algos_size);
-  if (ret <= 0)
-    {
-      gnutls_assert ();
-      if (ret < 0)
-        return ret;
-      else
-        return GNUTLS_E_UNKNOWN_CIPHER_SUITE;
-    }
-    
-  cipher_suites_size = ret;
-
   /* Data length should be zero mod 2 since
    * every ciphersuite is 2 bytes. (this check is needed
    * see below).
@@ -882,76 +875,78 @@ _gnutls_server_select_suite (gnutls_session_t session, uint8_t * data,
       return GNUTLS_E_UNEXPECTED_PACKET_LENGTH;
     }
 
+  pk_algos_size = MAX_ALGOS;
+  ret = server_find_pk_algos_in_ciphersuites (data, datalen, pk_algos, &pk_algos_size);
+  if (ret < 0)
+    return gnutls_assert_val(ret);
+
+  /* Here we select the certificate requested; the ciphersuites
+   * that do not conform to it, or to the authentication
+   * requested (e.g. SRP), are skipped below.
+   */
+  ret = select_cert_kx (session, pk_algos, pk_algos_size, alg, &alg_size);
+  if (ret < 0)
+    return gnutls_assert_val(ret);
+
+  memset (kx_state, KX_UNCHECKED, sizeof (kx_state));
   memset (session->security_parameters.cipher_suite, 0, 2);
 
   retval = GNUTLS_E_UNKNOWN_CIPHER_SUITE;
 
   _gnutls_handshake_log ("HSK[%p]: Requested cipher suites[size: %d]: \n", session, (int)datalen);
 
-  if (session->internals.priorities.server_precedence == 0)
+  for (j = 0; j < datalen; j += 2)
     {
-      for (j = 0; j < datalen; j += 2)
-        {
-          _gnutls_handshake_log ("\t0x%.2x, 0x%.2x %s\n", data[j], data[j+1], _gnutls_cipher_suite_get_name (&data[j]));
-          for (i = 0; i < cipher_suites_size; i+=2)
-            {
-              if (memcmp (&cipher_suites[i], &data[j], 2) == 0)
-                {
-                  _gnutls_handshake_log
-                    ("HSK[%p]: Selected cipher suite: %s\n", session,
-                    _gnutls_cipher_suite_get_name (&data[j]));
-                  memcpy (session->security_parameters.cipher_suite,
-                      &cipher_suites[i], 2);
-                  _gnutls_epoch_set_cipher_suite (session, EPOCH_NEXT,
-                                                  session->
-                                                  security_parameters.cipher_suite);
+      _gnutls_handshake_log ("\t0x%.2x, 0x%.2x %s\n", data[j], data[j+1], _gnutls_cipher_suite_get_name (&data[j]));
 
+      rank = _gnutls_priority_suite_rank (session, &data[j], &kx);
+      if (rank < 0)
+        continue;
 
-                  retval = 0;
-                  goto finish;
-                }
-            }
+      /* when the server selects, the suite that comes first in
+       * the priorities wins */
+      if (selected_rank >= 0 && rank >= selected_rank)
+        continue;
+
+      if ((unsigned)kx >= sizeof (kx_state))
+        {
+          if (kx_is_unwanted (session, kx, alg, alg_size))
+            continue;
         }
-    }
-  else /* server selects */
-    {
-      for (i = 0; i < cipher_suites_size; i+=2)
+      else
         {
-          for (j = 0; j < datalen; j += 2)
-            {
-              if (memcmp (&cipher_suites[i], &data[j], 2) == 0)
-                {
-                  _gnutls_handshake_log
-                    ("HSK[%p]: Selected cipher suite: %s\n", session,
-                    _gnutls_cipher_suite_get_name (&data[j]));
-                  memcpy (session->security_parameters.cipher_suite,
-                      &cipher_suites[i], 2);
-                  _gnutls_epoch_set_cipher_suite (session, EPOCH_NEXT,
-                                                  session->
-                                                  security_parameters.cipher_suite);
+          if (kx_state[kx] == KX_UNCHECKED)
+            kx_state[kx] = kx_is_unwanted (session, kx, alg, alg_size) ?
+              KX_UNWANTED : KX_USABLE;
 
-
-                  retval = 0;
-                  goto finish;
-                }
-            }
+          if (kx_state[kx] == KX_UNWANTED)
+            continue;
         }
+
+      selected = j;
+      selected_rank = rank;
+      selected_kx = kx;
+
+      if (session->internals.priorities->server_precedence == 0)
+        break;
     }
-finish:
 
-  if (retval != 0)
+  if (selected_rank < 0)
     {
       gnutls_assert ();
       return retval;
     }
 
+  _gnutls_handshake_log
+    ("HSK[%p]: Selected cipher suite: %s\n", session,
+     _gnutls_cipher_suite_get_name (&data[selected]));
+  memcpy (session->security_parameters.cipher_suite, &data[selected], 2);
+  _gnutls_epoch_set_cipher_suite (session, EPOCH_NEXT,
+                                  session->security_parameters.cipher_suite);
+
   /* check if the credentials (username, public key etc.) are ok
    */
-  if (_gnutls_get_kx_cred
-      (session,
-       _gnutls_cipher_suite_get_kx_algo (session->
-                                         security_parameters.cipher_suite),
-       &err) == NULL && err != 0)
+  if (_gnutls_get_kx_cred (session, selected_kx, &err) == NULL && err != 0)
     {
       gnutls_assert ();
       return GNUTLS_E_INSUFFICIENT_CREDENTIALS;
@@ -962,10 +957,7 @@ finish:
    * according to the KX algorithm. This is needed since all the
    * handshake functions are read from there;
    */
-  session->internals.auth_struct =
-    _gnutls_kx_auth_struct (_gnutls_cipher_suite_get_kx_algo
-                            (session->
-                             security_parameters.cipher_suite));
+  session->internals.auth_struct = _gnutls_kx_auth_struct (selected_kx);
   if (session->internals.auth_struct == NULL)
     {
 
@@ -997,7 +989,7 @@ _gnutls_server_select_comp_method (gnutls_session_t session,
       return x;
     }
 
-  if (session->internals.priorities.server_precedence == 0)
+  if (session->internals.priorities->server_precedence == 0)
     {
       for (j = 0; j < datalen; j++)
         {
@@ -1839,7 +1831,7 @@ _gnutls_send_client_hello (gnutls_session_t session, int again)
       _gnutls_set_adv_version (session, hver);
       _gnutls_set_current_version (session, hver);
 
-      if (session->internals.priorities.ssl3_record_version != 0)
+      if (session->internals.priorities->ssl3_record_version != 0)
         {
           /* Advertize the SSL 3.0 record packet version in
            * record packets during the handshake.
@@ -1904,7 +1896,7 @@ _gnutls_send_client_hello (gnutls_session_t session, int again)
       if (!session->internals.initial_negotiation_completed &&
           session->security_parameters.entity == GNUTLS_CLIENT &&
           (gnutls_protocol_get_version (session) == GNUTLS_SSL3 || 
-          session->internals.priorities.no_extensions != 0))
+          session->internals.priorities->no_extensions != 0))
         {
           ret =
             _gnutls_copy_ciphersuites (session, &extdata, TRUE);
@@ -1931,7 +1923,7 @@ _gnutls_send_client_hello (gnutls_session_t session, int again)
 
       /* Generate and copy TLS extensions.
        */
-      if (session->internals.priorities.no_extensions == 0)
+      if (session->internals.priorities->no_extensions == 0)
         {
           if (_gnutls_version_has_extensions (hver))
             type = GNUTLS_EXT_ANY;
@@ -2371,7 +2363,7 @@ gnutls_handshake (gnutls_session_t session)
   
   /* sanity check. Verify that there are priorities setup.
    */
-  if (session->internals.priorities.protocol.algorithms == 0)
+  if (session->internals.priorities->protocol.algorithms == 0)
     return gnutls_assert_val(GNUTLS_E_NO_PRIORITIES_WERE_SET);
 
   if (session->internals.handshake_timeout_ms && 
@@ -2393,6 +2385,14 @@ gnutls_handshake (gnutls_session_t session)
 
   if (session->security_parameters.entity == GNUTLS_CLIENT)
     {
+      if (STATE == STATE0 && session->internals.client_cache != NULL &&
+          session->internals.initial_negotiation_completed == 0)
+        {
+          ret = _gnutls_client_cache_lookup (session);
+          if (ret < 0)
+            return gnutls_assert_val(ret);
+        }
+
       do
 	{
 	  ret = _gnutls_handshake_client (session);
@@ -2429,6 +2429,14 @@ gnutls_handshake (gnutls_session_t session)
 
   session->security_parameters.epoch_next++;
 
+  if (session->security_parameters.entity == GNUTLS_CLIENT &&
+      session->internals.client_cache != NULL)
+    {
+      ret = _gnutls_client_cache_store (session);
+      if (ret < 0)
+        gnutls_assert ();       /* the handshake succeeded regardless */
+    }
+
   return 0;
 }
 
@@ -3199,28 +3207,17 @@ check_server_params (gnutls_session_t session,
   return 0;
 }
 
-/* This function will remove algorithms that are not supported by
- * the requested authentication method. We remove an algorithm if
- * we have a certificate with keyUsage bits set.
- *
- * This does a more high level check than  gnutls_supported_ciphersuites(),
- * by checking certificates etc.
+/* Selects the certificate to use, if there are certificate
+ * credentials, and gets all the key exchange algorithms that are
+ * supported by its parameters.
  */
 static int
-_gnutls_remove_unwanted_ciphersuites (gnutls_session_t session,
-                                      uint8_t * cipher_suites,
-                                      int cipher_suites_size,
-                                      gnutls_pk_algorithm_t *pk_algos,
-                                      size_t pk_algos_size)
+select_cert_kx (gnutls_session_t session,
+                gnutls_pk_algorithm_t *pk_algos, size_t pk_algos_size,
+                gnutls_kx_algorithm_t * alg, int *alg_size)
 {
-
-  int ret = 0;
-  int i, new_suites_size;
+  int ret;
   gnutls_certificate_credentials_t cert_cred;
-  gnutls_kx_algorithm_t kx;
-  int server = session->security_parameters.entity == GNUTLS_SERVER ? 1 : 0;
-  gnutls_kx_algorithm_t alg[MAX_ALGOS];
-  int alg_size = MAX_ALGOS;
 
   /* if we should use a specific certificate, 
    * we should remove all algorithms that are not supported
@@ -3252,64 +3249,93 @@ _gnutls_remove_unwanted_ciphersuites (gnutls_session_t session,
    * supported by the X509 certificate parameters.
    */
   if ((ret =
-       _gnutls_selected_cert_supported_kx (session, alg, &alg_size)) < 0)
+       _gnutls_selected_cert_supported_kx (session, alg, alg_size)) < 0)
     {
       gnutls_assert ();
       return ret;
     }
 
+  return 0;
+}
+
+/* Returns 1 if the given key exchange algorithm cannot be used with
+ * the session's credentials, or the certificate selected by
+ * select_cert_kx(), which supports the algorithms in @alg.
+ */
+static int
+kx_is_unwanted (gnutls_session_t session, gnutls_kx_algorithm_t kx,
+                gnutls_kx_algorithm_t * alg, int alg_size)
+{
+  int server = session->security_parameters.entity == GNUTLS_SERVER ? 1 : 0;
+
+  /* if it is defined but had no credentials 
+   */
+  if (!session->internals.premaster_set &&
+      _gnutls_get_kx_cred (session, kx, NULL) == NULL)
+    return 1;
+
+  if (server && check_server_params (session, kx, alg, alg_size) != 0)
+    return 1;
+
+  /* If we have not agreed to a common curve with the peer don't bother
+   * negotiating ECDH.
+   */
+  if (server != 0 && _gnutls_kx_is_ecc(kx))
+    {
+      if (_gnutls_session_ecc_curve_get(session) == GNUTLS_ECC_CURVE_INVALID)
+        return 1;
+    }
+
+  /* These two SRP kx's are marked to require a CRD_CERTIFICATE,
+     (see cred_mappings in gnutls_algorithms.c), but it also
+     requires a SRP credential.  Don't use SRP kx unless we have a
+     SRP credential too.  */
+  if (kx == GNUTLS_KX_SRP_RSA || kx == GNUTLS_KX_SRP_DSS)
+    {
+      if (!_gnutls_get_cred (session, GNUTLS_CRD_SRP, NULL))
+        return 1;
+    }
+
+  return 0;
+}
+
+/* This function will remove algorithms that are not supported by
+ * the requested authentication method. We remove an algorithm if
+ * we have a certificate with keyUsage bits set.
+ *
+ * This does a more high level check than  gnutls_supported_ciphersuites(),
+ * by checking certificates etc.
+ */
+static int
+_gnutls_remove_unwanted_ciphersuites (gnutls_session_t session,
+                                      uint8_t * cipher_suites,
+                                      int cipher_suites_size,
+                                      gnutls_pk_algorithm_t *pk_algos,
+                                      size_t pk_algos_size)
+{
+
+  int ret = 0;
+  int i, new_suites_size;
+  gnutls_kx_algorithm_t kx;
+  gnutls_kx_algorithm_t alg[MAX_ALGOS];
+  int alg_size = MAX_ALGOS;
+
+  ret = select_cert_kx (session, pk_algos, pk_algos_size, alg, &alg_size);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
   new_suites_size = 0;
 
   /* now removes ciphersuites based on the KX algorithm
    */
   for (i = 0; i < cipher_suites_size; i+=2)
     {
-      int delete = 0;
-
       /* finds the key exchange algorithm in
        * the ciphersuite
        */
       kx = _gnutls_cipher_suite_get_kx_algo (&cipher_suites[i]);
 
-      /* if it is defined but had no credentials 
-       */
-      if (!session->internals.premaster_set &&
-          _gnutls_get_kx_cred (session, kx, NULL) == NULL)
-        {
-          delete = 1;
-        }
-      else
-        {
-          delete = 0;
-
-          if (server)
-            delete = check_server_params (session, kx, alg, alg_size);
-        }
-       
-      /* If we have not agreed to a common curve with the peer don't bother
-       * negotiating ECDH.
-       */
-      if (server != 0 && _gnutls_kx_is_ecc(kx))
-        {
-          if (_gnutls_session_ecc_curve_get(session) == GNUTLS_ECC_CURVE_INVALID)
-            {
-              delete = 1;
-            }
-        }
-
-      /* These two SRP kx's are marked to require a CRD_CERTIFICATE,
-         (see cred_mappings in gnutls_algorithms.c), but it also
-         requires a SRP credential.  Don't use SRP kx unless we have a
-         SRP credential too.  */
-      if (kx == GNUTLS_KX_SRP_RSA || kx == GNUTLS_KX_SRP_DSS)
-        {
-          if (!_gnutls_get_cred (session, GNUTLS_CRD_SRP, NULL))
-            {
-              delete = 1;
-            }
-        }
-
-      if (delete == 0)
+      if (kx_is_unwanted (session, kx, alg, alg_size) == 0)
         {
 
           _gnutls_handshake_log ("HSK[%p]: Keeping ciphersuite: %s (%.2X.%.2X)\n",
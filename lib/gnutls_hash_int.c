@@ -64,6 +64,7 @@ _gnutls_hash_init (digest_hd_st * dig, gnutls_digest_algorithm_t algorithm)
   const gnutls_crypto_digest_st *cc = NULL;
 
   dig->algorithm = algorithm;
+  dig->copy = NULL;
 
   /* check if a digest has been registered 
    */
@@ -234,6 +235,7 @@ _gnutls_hmac_init (digest_hd_st * dig, gnutls_mac_algorithm_t algorithm,
       dig->output = cc->output;
       dig->deinit = cc->deinit;
       dig->reset = cc->reset;
+      dig->copy = cc->copy;
 
       return 0;
     }
@@ -249,6 +251,7 @@ _gnutls_hmac_init (digest_hd_st * dig, gnutls_mac_algorithm_t algorithm,
   dig->output = _gnutls_mac_ops.output;
   dig->deinit = _gnutls_mac_ops.deinit;
   dig->reset = _gnutls_mac_ops.reset;
+  dig->copy = _gnutls_mac_ops.copy;
 
   if (_gnutls_mac_ops.setkey (dig->handle, key, keylen) < 0)
     {
@@ -260,6 +263,34 @@ _gnutls_hmac_init (digest_hd_st * dig, gnutls_mac_algorithm_t algorithm,
   return 0;
 }
 
+/* Duplicates a keyed HMAC handle, including any data already
+ * hashed. Returns GNUTLS_E_UNIMPLEMENTED_FEATURE if the backend
+ * cannot copy contexts; the caller should then use _gnutls_hmac_init().
+ */
+int
+_gnutls_hmac_copy (digest_hd_st * dst, const digest_hd_st * src)
+{
+  int ret;
+
+  if (src->handle == NULL)
+    return gnutls_assert_val(GNUTLS_E_INVALID_REQUEST);
+
+  if (src->copy == NULL)
+    return GNUTLS_E_UNIMPLEMENTED_FEATURE;
+
+  memcpy (dst, src, sizeof (*dst));
+  dst->handle = NULL;
+
+  ret = src->copy (&dst->handle, src->handle);
+  if (ret < 0)
+    {
+      dst->handle = NULL;
+      return gnutls_assert_val(ret);
+    }
+
+  return 0;
+}
+
 void
 _gnutls_hmac_deinit (digest_hd_st * handle, void *digest)
 {
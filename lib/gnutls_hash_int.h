@@ -40,6 +40,7 @@ typedef int (*hash_func) (void *handle, const void *text, size_t size);
 typedef void (*reset_func) (void *ctx);
 typedef int (*output_func) (void *src_ctx, void *digest, size_t digestsize);
 typedef void (*deinit_func) (void *handle);
+typedef int (*copy_func) (void **dst, const void *src);
 
 typedef struct
 {
@@ -51,6 +52,7 @@ typedef struct
   reset_func reset;
   output_func output;
   deinit_func deinit;
+  copy_func copy;
 
   void *handle;
 } digest_hd_st;
@@ -59,6 +61,7 @@ typedef struct
 int _gnutls_hmac_exists(gnutls_mac_algorithm_t algorithm);
 int _gnutls_hmac_init (digest_hd_st *, gnutls_mac_algorithm_t algorithm,
                        const void *key, int keylen);
+int _gnutls_hmac_copy (digest_hd_st * dst, const digest_hd_st * src);
 size_t _gnutls_hash_get_algo_len (gnutls_digest_algorithm_t algorithm);
 #define _gnutls_hmac_get_algo_len(x) _gnutls_hash_get_algo_len((gnutls_digest_algorithm_t)x)
 int _gnutls_hmac_fast (gnutls_mac_algorithm_t algorithm, const void *key,
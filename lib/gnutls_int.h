@@ -586,6 +586,11 @@ typedef enum
   SR_SAFE
 } safe_renegotiation_t;
 
+/* at most one entry per cipher suite; the index is kept at most
+ * half full */
+#define MAX_PRIORITY_SUITES 256
+#define PRIORITY_SUITE_INDEX_SIZE (2*MAX_PRIORITY_SUITES)
+
 /* For the external api */
 struct gnutls_priority_st
 {
@@ -609,6 +614,20 @@ struct gnutls_priority_st
   /* Whether stateless compression will be used */
   unsigned int stateless_compression:1;
   unsigned int additional_verify_flags;
+
+  /* The cipher suites enabled by the kx, cipher and mac priorities
+   * in the order of preference, as indices in the cipher suite table,
+   * and a hash index from the suite IDs to their position (plus one)
+   * in that list. See _gnutls_priority_compile_suites().
+   */
+  uint16_t suites[MAX_PRIORITY_SUITES];
+  unsigned int suites_size;
+  uint16_t suite_index[PRIORITY_SUITE_INDEX_SIZE];
+
+  /* sessions hold a reference to the structure instead of a copy */
+  void *mutex;
+  unsigned int refcount;
+  unsigned int is_static:1;
 };
 
 #define ENABLE_COMPAT(x) \
@@ -721,7 +740,7 @@ typedef struct
   int last_handshake_out;
 
   /* priorities */
-  struct gnutls_priority_st priorities;
+  struct gnutls_priority_st *priorities;     /* never NULL */
 
   /* resumed session */
   unsigned int resumed:1;  /* RESUME_TRUE or FALSE - if we are resuming a session */
@@ -795,6 +814,17 @@ typedef struct
   gnutls_db_remove_func db_remove_func;
   void *db_ptr;
 
+  /* built-in cache; if set the functions above are not used */
+  gnutls_db_cache_t db_cache;
+
+  /* client side session cache, and the server it is keyed by */
+  gnutls_client_cache_t client_cache;
+  /* the credentials snapshot of the slot given with
+   * gnutls_credentials_set_slot() */
+  struct cert_snapshot_st *cert_snapshot;
+  char *client_cache_server;
+  unsigned int client_cache_port;
+
   /* post client hello callback (server side only)
    */
   gnutls_handshake_post_client_hello_func user_hello_func;
@@ -807,6 +837,17 @@ typedef struct
   int selected_cert_list_length;
   struct gnutls_privkey_st *selected_key;
   int selected_need_free:1;
+  /* the index of the selected chain in the certificate credentials,
+   * or -1 if it was not taken from them.
+   */
+  int selected_cert_index;
+  /* when the selected list is shared, the reference the session
+   * holds on it and the function that releases it.
+   */
+  void *selected_ref;
+  void (*selected_ref_release) (void *);
+  /* the encoded Certificate message of a shared list, if any */
+  const gnutls_datum_t *selected_cert_msg;
 
   /* holds the extensions we sent to the peer
    * (in case of a client)
@@ -36,6 +36,7 @@
 #include <gnutls_datum.h>
 #include <gnutls_rsa_export.h>
 #include <gnutls_mbuffers.h>
+#include <auth/cert.h>
 
 /* This is a temporary function to be used before the generate_*
    internal API is changed to use mbuffers. For now we don't avoid the
@@ -416,6 +417,7 @@ int
 _gnutls_send_server_certificate (gnutls_session_t session, int again)
 {
   gnutls_buffer_st data;
+  gnutls_datum_t msg;
   int ret = 0;
 
 
@@ -427,6 +429,17 @@ _gnutls_send_server_certificate (gnutls_session_t session, int again)
 
   if (again == 0)
     {
+      /* a chain from the credentials is sent from its encoding
+       * kept there, instead of being serialized again */
+      if (_gnutls_get_selected_cert_msg (session, &msg) == 0)
+        {
+          ret = send_handshake (session, msg.data, msg.size,
+                                GNUTLS_HANDSHAKE_CERTIFICATE_PKT);
+          if (ret < 0)
+            gnutls_assert ();
+          return ret;
+        }
+
       ret =
         session->internals.
         auth_struct->gnutls_generate_server_certificate (session, &data);
@@ -33,7 +33,7 @@
  * gnutls_pcert_import_x509:
  * @pcert: The pcert structure
  * @crt: The raw certificate to be imported
- * @flags: zero for now
+ * @flags: zero or %GNUTLS_PCERT_NO_CERT
  *
  * This convenience function will import the given certificate to a
  * #gnutls_pcert_st structure. The structure must be deinitialized
@@ -55,6 +55,9 @@ size_t sz;
   pcert->type = GNUTLS_CRT_X509;
   pcert->cert.data = NULL;
 
+  if (flags & GNUTLS_PCERT_NO_CERT)
+    goto import_pubkey;
+
   sz = 0;
   ret = gnutls_x509_crt_export(crt, GNUTLS_X509_FMT_DER, NULL, &sz);
   if (ret < 0 && ret != GNUTLS_E_SHORT_MEMORY_BUFFER)
@@ -78,6 +81,7 @@ size_t sz;
     }
   pcert->cert.size = sz;
 
+import_pubkey:
   ret = gnutls_pubkey_init(&pcert->pubkey);
   if (ret < 0)
     {
@@ -383,11 +387,17 @@ _gnutls_get_auth_info_pcert (gnutls_pcert_st* pcert,
                              gnutls_certificate_type_t type,
                              cert_auth_info_t info)
 {
+  gnutls_x509_crt_t *crts;
+  int ret;
+
   switch (type)
     {
     case GNUTLS_CRT_X509:
-      return gnutls_pcert_import_x509_raw(pcert, &info->raw_certificate_list[0], 
-        GNUTLS_X509_FMT_DER, GNUTLS_PCERT_NO_CERT);
+      ret = _gnutls_get_peer_x509_crts (info, &crts);
+      if (ret < 0)
+        return gnutls_assert_val(ret);
+
+      return gnutls_pcert_import_x509(pcert, crts[0], GNUTLS_PCERT_NO_CERT);
 #ifdef ENABLE_OPENPGP
     case GNUTLS_CRT_OPENPGP:
       return gnutls_pcert_import_openpgp_raw(pcert,
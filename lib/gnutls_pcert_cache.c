@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * The GnuTLS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/* This file contains a cache of the gnutls_pcert_st lists converted
+ * from the X.509 certificates returned by the certificate retrieval
+ * callbacks that use gnutls_retr2_st. The lists are keyed by a digest
+ * of the certificates, and shared by the sessions that selected them.
+ */
+
+#include <gnutls_int.h>
+#include <gnutls_errors.h>
+#include <gnutls_datum.h>
+#include <gnutls/abstract.h>
+#include <gnutls_chain_cache.h>
+#include <gnutls_pcert_cache.h>
+#include <x509/x509_int.h>
+#include <x509/common.h>
+#include <locks.h>
+
+#define PCERT_CACHE_BUCKETS 64
+#define PCERT_CACHE_MAX_ENTRIES 128
+
+struct pcert_cache_entry_st
+{
+  struct pcert_cache_entry_st *next;    /* in the hash bucket */
+  struct pcert_cache_entry_st *lru_prev;        /* towards the most recent */
+  struct pcert_cache_entry_st *lru_next;        /* towards the least recent */
+
+  uint8_t digest[CHAIN_DIGEST_SIZE];
+
+  /* one reference is held by the cache while the entry is in it,
+   * and one by each session that uses the list */
+  unsigned int refcount;
+
+  unsigned int ncerts;
+  gnutls_pcert_st *pcerts;      /* points after the structure */
+};
+
+static pcert_cache_entry_st *pcert_cache[PCERT_CACHE_BUCKETS];
+static pcert_cache_entry_st *lru_head, *lru_tail;
+static unsigned int pcert_cache_entries;
+static void *pcert_cache_mutex;
+
+#define PCERT_CACHE_LOCK if (gnutls_mutex_lock(&pcert_cache_mutex)!=0) abort()
+#define PCERT_CACHE_UNLOCK if (gnutls_mutex_unlock(&pcert_cache_mutex)!=0) abort()
+
+/* the digest is uniformly distributed */
+#define DIGEST_TO_BUCKET(d) ((d)[0] % PCERT_CACHE_BUCKETS)
+
+static void
+lru_unlink (pcert_cache_entry_st * e)
+{
+  if (e->lru_prev)
+    e->lru_prev->lru_next = e->lru_next;
+  else
+    lru_head = e->lru_next;
+
+  if (e->lru_next)
+    e->lru_next->lru_prev = e->lru_prev;
+  else
+    lru_tail = e->lru_prev;
+
+  e->lru_prev = e->lru_next = NULL;
+}
+
+static void
+lru_push_front (pcert_cache_entry_st * e)
+{
+  e->lru_prev = NULL;
+  e->lru_next = lru_head;
+  if (lru_head)
+    lru_head->lru_prev = e;
+  lru_head = e;
+  if (lru_tail == NULL)
+    lru_tail = e;
+}
+
+static void
+entry_free (pcert_cache_entry_st * e)
+{
+  unsigned int i;
+
+  for (i = 0; i < e->ncerts; i++)
+    gnutls_pcert_deinit (&e->pcerts[i]);
+  gnutls_free (e);
+}
+
+/* Must be called with the cache lock held.
+ */
+static pcert_cache_entry_st *
+cache_find (const uint8_t * digest)
+{
+  pcert_cache_entry_st *e;
+
+  for (e = pcert_cache[DIGEST_TO_BUCKET (digest)]; e != NULL; e = e->next)
+    {
+      if (memcmp (e->digest, digest, CHAIN_DIGEST_SIZE) == 0)
+        return e;
+    }
+
+  return NULL;
+}
+
+/* Unlinks the entry and drops the reference of the cache. Must be
+ * called with the cache lock held.
+ */
+static void
+cache_remove_entry (pcert_cache_entry_st * e)
+{
+  pcert_cache_entry_st **p;
+
+  for (p = &pcert_cache[DIGEST_TO_BUCKET (e->digest)]; *p != NULL;
+       p = &(*p)->next)
+    {
+      if (*p == e)
+        {
+          *p = e->next;
+          break;
+        }
+    }
+
+  lru_unlink (e);
+  pcert_cache_entries--;
+
+  if (--e->refcount == 0)
+    entry_free (e);
+}
+
+int
+_gnutls_pcert_cache_init (void)
+{
+  return gnutls_mutex_init (&pcert_cache_mutex);
+}
+
+void
+_gnutls_pcert_cache_deinit (void)
+{
+  while (lru_head != NULL)
+    cache_remove_entry (lru_head);
+
+  gnutls_mutex_deinit (&pcert_cache_mutex);
+}
+
+/* Creates an entry from the given certificates, taking over their
+ * DER encodings in @der.
+ */
+static int
+entry_new (gnutls_x509_crt_t * certs, gnutls_datum_t * der, unsigned ncerts,
+           const uint8_t * digest, pcert_cache_entry_st ** entry)
+{
+  pcert_cache_entry_st *e;
+  unsigned int i;
+  int ret;
+
+  e = gnutls_calloc (1, sizeof (*e) + ncerts * sizeof (gnutls_pcert_st));
+  if (e == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  memcpy (e->digest, digest, CHAIN_DIGEST_SIZE);
+  e->pcerts = (gnutls_pcert_st *) (e + 1);
+
+  for (i = 0; i < ncerts; i++)
+    {
+      e->pcerts[i].type = GNUTLS_CRT_X509;
+      e->pcerts[i].cert = der[i];
+      der[i].data = NULL;
+      der[i].size = 0;
+      e->ncerts++;
+
+      ret = gnutls_pubkey_init (&e->pcerts[i].pubkey);
+      if (ret < 0)
+        {
+          gnutls_assert ();
+          goto fail;
+        }
+
+      ret = gnutls_pubkey_import_x509 (e->pcerts[i].pubkey, certs[i], 0);
+      if (ret < 0)
+        {
+          gnutls_assert ();
+          goto fail;
+        }
+    }
+
+  *entry = e;
+
+  return 0;
+
+fail:
+  entry_free (e);
+  return ret;
+}
+
+/* Returns the gnutls_pcert_st list corresponding to the given
+ * certificates, converting them only if they are not in the cache.
+ * The list remains valid until the returned entry is released with
+ * _gnutls_pcert_cache_release().
+ */
+int
+_gnutls_pcert_cache_get_x509 (gnutls_x509_crt_t * certs, unsigned ncerts,
+                              gnutls_pcert_st ** pcerts,
+                              pcert_cache_entry_st ** entry)
+{
+  pcert_cache_entry_st *e, *new_e = NULL;
+  gnutls_datum_t *der;
+  uint8_t digest[CHAIN_DIGEST_SIZE];
+  unsigned int i;
+  int ret;
+
+  if (certs == NULL || ncerts == 0)
+    return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST);
+
+  der = gnutls_calloc (ncerts, sizeof (gnutls_datum_t));
+  if (der == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  for (i = 0; i < ncerts; i++)
+    {
+      ret = _gnutls_x509_der_encode (certs[i]->cert, "", &der[i], 0);
+      if (ret < 0)
+        {
+          gnutls_assert ();
+          goto cleanup;
+        }
+    }
+
+  ret = _gnutls_chain_digest (der, ncerts, digest);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      goto cleanup;
+    }
+
+  PCERT_CACHE_LOCK;
+  e = cache_find (digest);
+  if (e != NULL)
+    {
+      e->refcount++;
+      lru_unlink (e);
+      lru_push_front (e);
+      PCERT_CACHE_UNLOCK;
+      goto found;
+    }
+  PCERT_CACHE_UNLOCK;
+
+  ret = entry_new (certs, der, ncerts, digest, &new_e);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      goto cleanup;
+    }
+
+  PCERT_CACHE_LOCK;
+  /* another thread may have converted the same list meanwhile */
+  e = cache_find (digest);
+  if (e != NULL)
+    {
+      e->refcount++;
+      lru_unlink (e);
+      lru_push_front (e);
+      PCERT_CACHE_UNLOCK;
+      entry_free (new_e);
+      goto found;
+    }
+
+  e = new_e;
+  e->refcount = 2;
+  e->next = pcert_cache[DIGEST_TO_BUCKET (digest)];
+  pcert_cache[DIGEST_TO_BUCKET (digest)] = e;
+  lru_push_front (e);
+  pcert_cache_entries++;
+
+  while (pcert_cache_entries > PCERT_CACHE_MAX_ENTRIES && lru_tail != e)
+    cache_remove_entry (lru_tail);
+  PCERT_CACHE_UNLOCK;
+
+found:
+  *pcerts = e->pcerts;
+  *entry = e;
+  ret = 0;
+
+cleanup:
+  for (i = 0; i < ncerts; i++)
+    _gnutls_free_datum (&der[i]);
+  gnutls_free (der);
+
+  return ret;
+}
+
+void
+_gnutls_pcert_cache_release (pcert_cache_entry_st * entry)
+{
+  unsigned int refcount;
+
+  if (entry == NULL)
+    return;
+
+  PCERT_CACHE_LOCK;
+  refcount = --entry->refcount;
+  PCERT_CACHE_UNLOCK;
+
+  if (refcount == 0)
+    entry_free (entry);
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * The GnuTLS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+#ifndef GNUTLS_PCERT_CACHE_H
+#define GNUTLS_PCERT_CACHE_H
+
+typedef struct pcert_cache_entry_st pcert_cache_entry_st;
+
+int _gnutls_pcert_cache_init (void);
+void _gnutls_pcert_cache_deinit (void);
+
+int _gnutls_pcert_cache_get_x509 (gnutls_x509_crt_t * certs, unsigned ncerts,
+                                  gnutls_pcert_st ** pcerts,
+                                  pcert_cache_entry_st ** entry);
+void _gnutls_pcert_cache_release (pcert_cache_entry_st * entry);
+
+#endif
@@ -44,6 +44,19 @@ _gnutls_pk_fixup (gnutls_pk_algorithm_t algo, gnutls_direction_t direction,
   return 0;
 }
 
+inline static int
+_gnutls_pk_prepare (gnutls_pk_algorithm_t algo,
+                    const gnutls_pk_params_st * params, void **prepared)
+{
+  if (_gnutls_pk_ops.prepare)
+    return _gnutls_pk_ops.prepare (algo, params, prepared);
+  return GNUTLS_E_UNIMPLEMENTED_FEATURE;
+}
+
+#define _gnutls_pk_prepared_deinit( prepared) _gnutls_pk_ops.prepared_deinit( prepared)
+#define _gnutls_pk_prepared_sign( prepared, sig, data) _gnutls_pk_ops.prepared_sign( prepared, sig, data)
+#define _gnutls_pk_prepared_decrypt( prepared, plaintext, ciphertext) _gnutls_pk_ops.prepared_decrypt( prepared, plaintext, ciphertext)
+
 int _gnutls_pk_params_copy (gnutls_pk_params_st * dst, const gnutls_pk_params_st * src);
 
 /* The internal PK interface */
@@ -27,6 +27,9 @@
 #include "algorithms.h"
 #include "gnutls_errors.h"
 #include <gnutls_num.h>
+#include <gnutls_priority.h>
+#include <locks.h>
+#include <hash-pjw-bare.h>
 
 static void
 break_comma_list (char *etag,
@@ -49,19 +52,25 @@ break_comma_list (char *etag,
 int
 gnutls_cipher_set_priority (gnutls_session_t session, const int *list)
 {
-  int num = 0, i;
+  int num = 0, i, ret;
+
+  ret = _gnutls_priority_unshare (session);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
 
   while (list[num] != 0)
     num++;
   if (num > MAX_ALGOS)
     num = MAX_ALGOS;
-  session->internals.priorities.cipher.algorithms = num;
+  session->internals.priorities->cipher.algorithms = num;
 
   for (i = 0; i < num; i++)
     {
-      session->internals.priorities.cipher.priority[i] = list[i];
+      session->internals.priorities->cipher.priority[i] = list[i];
     }
 
+  _gnutls_priority_compile_suites (session->internals.priorities);
+
   return 0;
 }
 
@@ -141,7 +150,14 @@ _clear_priorities (priority_st * st, const int *list)
 int
 gnutls_kx_set_priority (gnutls_session_t session, const int *list)
 {
-  _set_priority (&session->internals.priorities.kx, list);
+  int ret;
+
+  ret = _gnutls_priority_unshare (session);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  _set_priority (&session->internals.priorities->kx, list);
+  _gnutls_priority_compile_suites (session->internals.priorities);
   return 0;
 }
 
@@ -162,7 +178,14 @@ gnutls_kx_set_priority (gnutls_session_t session, const int *list)
 int
 gnutls_mac_set_priority (gnutls_session_t session, const int *list)
 {
-  _set_priority (&session->internals.priorities.mac, list);
+  int ret;
+
+  ret = _gnutls_priority_unshare (session);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  _set_priority (&session->internals.priorities->mac, list);
+  _gnutls_priority_compile_suites (session->internals.priorities);
   return 0;
 }
 
@@ -187,7 +210,13 @@ gnutls_mac_set_priority (gnutls_session_t session, const int *list)
 int
 gnutls_compression_set_priority (gnutls_session_t session, const int *list)
 {
-  _set_priority (&session->internals.priorities.compression, list);
+  int ret;
+
+  ret = _gnutls_priority_unshare (session);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  _set_priority (&session->internals.priorities->compression, list);
   return 0;
 }
 
@@ -205,7 +234,13 @@ gnutls_compression_set_priority (gnutls_session_t session, const int *list)
 int
 gnutls_protocol_set_priority (gnutls_session_t session, const int *list)
 {
-  _set_priority (&session->internals.priorities.protocol, list);
+  int ret;
+
+  ret = _gnutls_priority_unshare (session);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  _set_priority (&session->internals.priorities->protocol, list);
 
   /* set the current version to the first in the chain.
    * This will be overridden later.
@@ -235,7 +270,13 @@ gnutls_certificate_type_set_priority (gnutls_session_t session,
                                       const int *list)
 {
 #ifdef ENABLE_OPENPGP
-  _set_priority (&session->internals.priorities.cert_type, list);
+  int ret;
+
+  ret = _gnutls_priority_unshare (session);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  _set_priority (&session->internals.priorities->cert_type, list);
   return 0;
 #else
 
@@ -576,6 +617,92 @@ prio_add (priority_st * priority_list, unsigned int algo)
 }
 
 
+/* Sessions start with these priorities, which enable nothing.
+ * Emulates the behavior of old gnutls for applications that do not
+ * use the priority functions.
+ */
+struct gnutls_priority_st _gnutls_default_priority = {
+  .sr = SR_PARTIAL,
+  .is_static = 1
+};
+
+#define PRIORITY_LOCK(p) if (gnutls_mutex_lock(&(p)->mutex)!=0) abort()
+#define PRIORITY_UNLOCK(p) if (gnutls_mutex_unlock(&(p)->mutex)!=0) abort()
+
+void
+_gnutls_priority_ref (gnutls_priority_t priority)
+{
+  if (priority->is_static)
+    return;
+
+  PRIORITY_LOCK (priority);
+  priority->refcount++;
+  PRIORITY_UNLOCK (priority);
+}
+
+void
+_gnutls_priority_unref (gnutls_priority_t priority)
+{
+  unsigned int refcount;
+
+  if (priority == NULL || priority->is_static)
+    return;
+
+  PRIORITY_LOCK (priority);
+  refcount = --priority->refcount;
+  PRIORITY_UNLOCK (priority);
+
+  if (refcount == 0)
+    {
+      gnutls_mutex_deinit (&priority->mutex);
+      gnutls_free (priority);
+    }
+}
+
+/* Makes the session's priorities private to it, so that they can be
+ * modified by the gnutls_*_set_priority() functions.
+ */
+int
+_gnutls_priority_unshare (gnutls_session_t session)
+{
+  gnutls_priority_t old = session->internals.priorities;
+  gnutls_priority_t copy;
+  int shared, ret;
+
+  if (old->is_static)
+    shared = 1;
+  else
+    {
+      PRIORITY_LOCK (old);
+      shared = (old->refcount > 1);
+      PRIORITY_UNLOCK (old);
+    }
+
+  if (shared == 0)
+    return 0;
+
+  copy = gnutls_malloc (sizeof (*copy));
+  if (copy == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  memcpy (copy, old, sizeof (*copy));
+  copy->is_static = 0;
+  copy->refcount = 1;
+
+  ret = gnutls_mutex_init (&copy->mutex);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      gnutls_free (copy);
+      return ret;
+    }
+
+  session->internals.priorities = copy;
+  _gnutls_priority_unref (old);
+
+  return 0;
+}
+
 /**
  * gnutls_priority_set:
  * @session: is a #gnutls_session_t structure.
@@ -595,22 +722,26 @@ gnutls_priority_set (gnutls_session_t session, gnutls_priority_t priority)
       return GNUTLS_E_NO_CIPHER_SUITES;
     }
 
-  memcpy (&session->internals.priorities, priority,
-          sizeof (struct gnutls_priority_st));
+  /* the session keeps a reference to the structure; it is only
+   * copied if modified afterwards with the gnutls_*_set_priority()
+   * functions. */
+  _gnutls_priority_ref (priority);
+  _gnutls_priority_unref (session->internals.priorities);
+  session->internals.priorities = priority;
 
   /* set the current version to the first in the chain.
    * This will be overridden later.
    */
-  if (session->internals.priorities.protocol.algorithms > 0)
+  if (session->internals.priorities->protocol.algorithms > 0)
     _gnutls_set_current_version (session,
-                                 session->internals.priorities.protocol.
+                                 session->internals.priorities->protocol.
                                  priority[0]);
 
-  if (session->internals.priorities.protocol.algorithms == 0 ||
-      session->internals.priorities.cipher.algorithms == 0 ||
-      session->internals.priorities.mac.algorithms == 0 ||
-      session->internals.priorities.kx.algorithms == 0 ||
-      session->internals.priorities.compression.algorithms == 0)
+  if (session->internals.priorities->protocol.algorithms == 0 ||
+      session->internals.priorities->cipher.algorithms == 0 ||
+      session->internals.priorities->mac.algorithms == 0 ||
+      session->internals.priorities->kx.algorithms == 0 ||
+      session->internals.priorities->compression.algorithms == 0)
     return gnutls_assert_val(GNUTLS_E_NO_PRIORITIES_WERE_SET);
 
   return 0;
@@ -719,76 +850,11 @@ bulk_rmadd_func *func;
   return 0;
 }
 
-/**
- * gnutls_priority_init:
- * @priority_cache: is a #gnutls_prioritity_t structure.
- * @priorities: is a string describing priorities
- * @err_pos: In case of an error this will have the position in the string the error occured
- *
- * Sets priorities for the ciphers, key exchange methods, macs and
- * compression methods.
- *
- * The #priorities option allows you to specify a colon
- * separated list of the cipher priorities to enable.
- * Some keywords are defined to provide quick access
- * to common preferences.
- *
- * "PERFORMANCE" means all the "secure" ciphersuites are enabled,
- * limited to 128 bit ciphers and sorted by terms of speed
- * performance.
- *
- * "NORMAL" means all "secure" ciphersuites. The 256-bit ciphers are
- * included as a fallback only.  The ciphers are sorted by security
- * margin.
- *
- * "SECURE128" means all "secure" ciphersuites of security level 128-bit
- * or more.
- *
- * "SECURE192" means all "secure" ciphersuites of security level 192-bit
- * or more.
- *
- * "SUITEB128" means all the NSA SuiteB ciphersuites with security level
- * of 128.
- *
- * "SUITEB192" means all the NSA SuiteB ciphersuites with security level
- * of 192.
- *
- * "EXPORT" means all ciphersuites are enabled, including the
- * low-security 40 bit ciphers.
- *
- * "NONE" means nothing is enabled.  This disables even protocols and
- * compression methods.
- *
- * Special keywords are "!", "-" and "+".
- * "!" or "-" appended with an algorithm will remove this algorithm.
- * "+" appended with an algorithm will add this algorithm.
- *
- * Check the GnuTLS manual section "Priority strings" for detailed
- * information.
- *
- * Examples:
- *
- * "NONE:+VERS-TLS-ALL:+MAC-ALL:+RSA:+AES-128-CBC:+SIGN-ALL:+COMP-NULL"
- *
- * "NORMAL:-ARCFOUR-128" means normal ciphers except for ARCFOUR-128.
- *
- * "SECURE:-VERS-SSL3.0:+COMP-DEFLATE" means that only secure ciphers are
- * enabled, SSL3.0 is disabled, and libz compression enabled.
- *
- * "NONE:+VERS-TLS-ALL:+AES-128-CBC:+RSA:+SHA1:+COMP-NULL:+SIGN-RSA-SHA1", 
- *
- * "NONE:+VERS-TLS-ALL:+AES-128-CBC:+ECDHE-RSA:+SHA1:+COMP-NULL:+SIGN-RSA-SHA1:+CURVE-SECP256R1", 
- *
- * "SECURE256:+SECURE128",
- *
- * Note that "NORMAL:%COMPAT" is the most compatible mode.
- *
- * Returns: On syntax error %GNUTLS_E_INVALID_REQUEST is returned,
- * %GNUTLS_E_SUCCESS on success, or an error code.
- **/
-int
-gnutls_priority_init (gnutls_priority_t * priority_cache,
-                      const char *priorities, const char **err_pos)
+/* Parses the priority string into a new structure.
+ */
+static int
+priority_parse (gnutls_priority_t * priority_cache,
+                const char *priorities, const char **err_pos)
 {
   char *broken_list[MAX_ELEMENTS];
   int broken_list_size = 0, i = 0, j;
@@ -1044,6 +1110,17 @@ gnutls_priority_init (gnutls_priority_t * priority_cache,
     }
 
   gnutls_free (darg);
+
+  if (gnutls_mutex_init (&(*priority_cache)->mutex) < 0)
+    {
+      gnutls_assert ();
+      gnutls_free (*priority_cache);
+      return GNUTLS_E_MEMORY_ERROR;
+    }
+  (*priority_cache)->refcount = 1;
+
+  _gnutls_priority_compile_suites (*priority_cache);
+
   return 0;
 
 error:
@@ -1066,14 +1143,297 @@ error:
  * gnutls_priority_deinit:
  * @priority_cache: is a #gnutls_prioritity_t structure.
  *
- * Deinitializes the priority cache.
+ * Deinitializes the priority cache. Sessions that use it keep it
+ * until they are deinitialized.
  **/
 void
 gnutls_priority_deinit (gnutls_priority_t priority_cache)
 {
-  gnutls_free (priority_cache);
+  _gnutls_priority_unref (priority_cache);
+}
+
+
+/* The priorities parsed by gnutls_priority_init(), keyed by their
+ * string. The cache holds a reference to each structure; these
+ * are never modified, as sessions copy them before any change. Once
+ * full, the least recently used string is evicted. The cache exists
+ * only between gnutls_global_init() and gnutls_global_deinit();
+ * outside of that (priority_cache_mutex is NULL) it is bypassed.
+ */
+#define PRIORITY_CACHE_BUCKETS 64
+#define PRIORITY_CACHE_MAX_ENTRIES 256
+
+typedef struct priority_cache_entry_st
+{
+  struct priority_cache_entry_st *next; /* in the hash bucket */
+  struct priority_cache_entry_st *lru_prev;     /* towards the most recent */
+  struct priority_cache_entry_st *lru_next;     /* towards the least recent */
+  gnutls_priority_t priority;
+  size_t hash;
+  char *str;                    /* points after the structure */
+} priority_cache_entry_st;
+
+static priority_cache_entry_st *priority_cache[PRIORITY_CACHE_BUCKETS];
+static priority_cache_entry_st *lru_head, *lru_tail;
+static unsigned int priority_cache_entries;
+static void *priority_cache_mutex;
+
+#define PRIORITY_CACHE_LOCK if (gnutls_mutex_lock(&priority_cache_mutex)!=0) abort()
+#define PRIORITY_CACHE_UNLOCK if (gnutls_mutex_unlock(&priority_cache_mutex)!=0) abort()
+
+static void
+lru_unlink (priority_cache_entry_st * e)
+{
+  if (e->lru_prev)
+    e->lru_prev->lru_next = e->lru_next;
+  else
+    lru_head = e->lru_next;
+
+  if (e->lru_next)
+    e->lru_next->lru_prev = e->lru_prev;
+  else
+    lru_tail = e->lru_prev;
+
+  e->lru_prev = e->lru_next = NULL;
+}
+
+static void
+lru_push_front (priority_cache_entry_st * e)
+{
+  e->lru_prev = NULL;
+  e->lru_next = lru_head;
+  if (lru_head)
+    lru_head->lru_prev = e;
+  lru_head = e;
+  if (lru_tail == NULL)
+    lru_tail = e;
+}
+
+/* Must be called with the cache lock held.
+ */
+static priority_cache_entry_st *
+cache_find (const char *str, size_t hash)
+{
+  priority_cache_entry_st *e;
+
+  for (e = priority_cache[hash % PRIORITY_CACHE_BUCKETS]; e != NULL;
+       e = e->next)
+    {
+      if (e->hash == hash && strcmp (e->str, str) == 0)
+        return e;
+    }
+
+  return NULL;
 }
 
+/* Unlinks the entry and drops the reference of the cache. Sessions
+ * using the priorities keep their own references. Must be called
+ * with the cache lock held.
+ */
+static void
+cache_remove_entry (priority_cache_entry_st * e)
+{
+  priority_cache_entry_st **p;
+
+  for (p = &priority_cache[e->hash % PRIORITY_CACHE_BUCKETS]; *p != NULL;
+       p = &(*p)->next)
+    {
+      if (*p == e)
+        {
+          *p = e->next;
+          break;
+        }
+    }
+
+  lru_unlink (e);
+  priority_cache_entries--;
+
+  _gnutls_priority_unref (e->priority);
+  gnutls_free (e);
+}
+
+int
+_gnutls_priority_cache_init (void)
+{
+  return gnutls_mutex_init (&priority_cache_mutex);
+}
+
+void
+_gnutls_priority_cache_deinit (void)
+{
+  while (lru_head != NULL)
+    cache_remove_entry (lru_head);
+
+  gnutls_mutex_deinit (&priority_cache_mutex);
+  priority_cache_mutex = NULL;
+}
+
+/* Returns a reference to the cached priorities for the given
+ * string, or NULL.
+ */
+static gnutls_priority_t
+priority_cache_get (const char *str, size_t hash)
+{
+  priority_cache_entry_st *e;
+  gnutls_priority_t priority = NULL;
+
+  if (priority_cache_mutex == NULL)
+    return NULL;
+
+  PRIORITY_CACHE_LOCK;
+  e = cache_find (str, hash);
+  if (e != NULL)
+    {
+      priority = e->priority;
+      _gnutls_priority_ref (priority);
+      lru_unlink (e);
+      lru_push_front (e);
+    }
+  PRIORITY_CACHE_UNLOCK;
+
+  return priority;
+}
+
+static void
+priority_cache_put (const char *str, size_t hash, gnutls_priority_t priority)
+{
+  priority_cache_entry_st *e;
+  size_t len = strlen (str);
+
+  if (priority_cache_mutex == NULL)
+    return;
+
+  e = gnutls_calloc (1, sizeof (*e) + len + 1);
+  if (e == NULL)
+    {
+      gnutls_assert ();
+      return;
+    }
+
+  e->hash = hash;
+  e->str = (char *) (e + 1);
+  memcpy (e->str, str, len + 1);
+  e->priority = priority;
+
+  PRIORITY_CACHE_LOCK;
+  /* another thread may have added the same string meanwhile */
+  if (cache_find (str, hash) != NULL)
+    {
+      PRIORITY_CACHE_UNLOCK;
+      gnutls_free (e);
+      return;
+    }
+
+  _gnutls_priority_ref (priority);
+  e->next = priority_cache[hash % PRIORITY_CACHE_BUCKETS];
+  priority_cache[hash % PRIORITY_CACHE_BUCKETS] = e;
+  lru_push_front (e);
+  priority_cache_entries++;
+
+  while (priority_cache_entries > PRIORITY_CACHE_MAX_ENTRIES)
+    cache_remove_entry (lru_tail);
+  PRIORITY_CACHE_UNLOCK;
+}
+
+/**
+ * gnutls_priority_init:
+ * @priority_cache: is a #gnutls_prioritity_t structure.
+ * @priorities: is a string describing priorities
+ * @err_pos: In case of an error this will have the position in the string the error occured
+ *
+ * Sets priorities for the ciphers, key exchange methods, macs and
+ * compression methods.
+ *
+ * The #priorities option allows you to specify a colon
+ * separated list of the cipher priorities to enable.
+ * Some keywords are defined to provide quick access
+ * to common preferences.
+ *
+ * "PERFORMANCE" means all the "secure" ciphersuites are enabled,
+ * limited to 128 bit ciphers and sorted by terms of speed
+ * performance.
+ *
+ * "NORMAL" means all "secure" ciphersuites. The 256-bit ciphers are
+ * included as a fallback only.  The ciphers are sorted by security
+ * margin.
+ *
+ * "SECURE128" means all "secure" ciphersuites of security level 128-bit
+ * or more.
+ *
+ * "SECURE192" means all "secure" ciphersuites of security level 192-bit
+ * or more.
+ *
+ * "SUITEB128" means all the NSA SuiteB ciphersuites with security level
+ * of 128.
+ *
+ * "SUITEB192" means all the NSA SuiteB ciphersuites with security level
+ * of 192.
+ *
+ * "EXPORT" means all ciphersuites are enabled, including the
+ * low-security 40 bit ciphers.
+ *
+ * "NONE" means nothing is enabled.  This disables even protocols and
+ * compression methods.
+ *
+ * Special keywords are "!", "-" and "+".
+ * "!" or "-" appended with an algorithm will remove this algorithm.
+ * "+" appended with an algorithm will add this algorithm.
+ *
+ * Check the GnuTLS manual section "Priority strings" for detailed
+ * information.
+ *
+ * Examples:
+ *
+ * "NONE:+VERS-TLS-ALL:+MAC-ALL:+RSA:+AES-128-CBC:+SIGN-ALL:+COMP-NULL"
+ *
+ * "NORMAL:-ARCFOUR-128" means normal ciphers except for ARCFOUR-128.
+ *
+ * "SECURE:-VERS-SSL3.0:+COMP-DEFLATE" means that only secure ciphers are
+ * enabled, SSL3.0 is disabled, and libz compression enabled.
+ *
+ * "NONE:+VERS-TLS-ALL:+AES-128-CBC:+RSA:+SHA1:+COMP-NULL:+SIGN-RSA-SHA1", 
+ *
+ * "NONE:+VERS-TLS-ALL:+AES-128-CBC:+ECDHE-RSA:+SHA1:+COMP-NULL:+SIGN-RSA-SHA1:+CURVE-SECP256R1", 
+ *
+ * "SECURE256:+SECURE128",
+ *
+ * Note that "NORMAL:%COMPAT" is the most compatible mode.
+ *
+ * The parsed priorities are kept in a global cache keyed by the
+ * string, and are shared by the calls with the same string. The
+ * returned structure must not be modified other than through a
+ * session using it.
+ *
+ * Returns: On syntax error %GNUTLS_E_INVALID_REQUEST is returned,
+ * %GNUTLS_E_SUCCESS on success, or an error code.
+ **/
+int
+gnutls_priority_init (gnutls_priority_t * priority_cache,
+                      const char *priorities, const char **err_pos)
+{
+  size_t hash;
+  int ret;
+
+  if (priorities == NULL)
+    priorities = LEVEL_NORMAL;
+
+  hash = hash_pjw_bare (priorities, strlen (priorities));
+
+  *priority_cache = priority_cache_get (priorities, hash);
+  if (*priority_cache != NULL)
+    return 0;
+
+  ret = priority_parse (priority_cache, priorities, err_pos);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      return ret;
+    }
+
+  priority_cache_put (priorities, hash, *priority_cache);
+
+  return 0;
+}
 
 /**
  * gnutls_priority_set_direct:
@@ -1086,6 +1446,10 @@ gnutls_priority_deinit (gnutls_priority_t priority_cache)
  * priority cache and is used to directly set string priorities to a
  * TLS session.  For documentation check the gnutls_priority_init().
  *
+ * The parsed priorities are kept in the global cache of
+ * gnutls_priority_init(), so that subsequent calls with the same
+ * string do not parse it again.
+ *
  * Returns: On syntax error %GNUTLS_E_INVALID_REQUEST is returned,
  * %GNUTLS_E_SUCCESS on success, or an error code.
  **/
@@ -1104,14 +1468,14 @@ gnutls_priority_set_direct (gnutls_session_t session,
     }
 
   ret = gnutls_priority_set (session, prio);
+  gnutls_priority_deinit (prio);
+
   if (ret < 0)
     {
       gnutls_assert ();
       return ret;
     }
 
-  gnutls_priority_deinit (prio);
-
   return 0;
 }
 
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * The GnuTLS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+#ifndef GNUTLS_PRIORITY_H
+#define GNUTLS_PRIORITY_H
+
+/* The priorities of sessions that did not set any */
+extern struct gnutls_priority_st _gnutls_default_priority;
+
+void _gnutls_priority_ref (gnutls_priority_t priority);
+void _gnutls_priority_unref (gnutls_priority_t priority);
+int _gnutls_priority_unshare (gnutls_session_t session);
+
+int _gnutls_priority_cache_init (void);
+void _gnutls_priority_cache_deinit (void);
+
+#endif
@@ -265,6 +265,9 @@ gnutls_privkey_deinit (gnutls_privkey_t key)
 {
   if (key == NULL) return;
 
+  if (key->prepared)
+    _gnutls_pk_prepared_deinit (key->prepared);
+
   if (key->flags & GNUTLS_PRIVKEY_IMPORT_AUTO_RELEASE || key->flags & GNUTLS_PRIVKEY_IMPORT_COPY)
     switch (key->type)
       {
@@ -542,6 +545,18 @@ int ret;
   pkey->pk_algorithm = gnutls_x509_privkey_get_pk_algorithm (key);
   pkey->flags = flags;
 
+  /* A key that remains owned by the caller may be changed after
+   * the import; it is only prepared when we own it. Not fatal; the
+   * operations fall back to the key parameters. */
+  pkey->prepared = NULL;
+  if (flags & (GNUTLS_PRIVKEY_IMPORT_COPY|GNUTLS_PRIVKEY_IMPORT_AUTO_RELEASE))
+    {
+      ret = _gnutls_pk_prepare (pkey->pk_algorithm, &pkey->key.x509->params,
+                                &pkey->prepared);
+      if (ret < 0)
+        pkey->prepared = NULL;
+    }
+
   return 0;
 }
 
@@ -834,6 +849,8 @@ _gnutls_privkey_sign_hash (gnutls_privkey_t key,
                                                hash, signature);
 #endif
     case GNUTLS_PRIVKEY_X509:
+      if (key->prepared)
+        return _gnutls_pk_prepared_sign (key->prepared, signature, hash);
       return _gnutls_pk_sign (key->key.x509->pk_algorithm,
                               signature, hash, &key->key.x509->params);
     case GNUTLS_PRIVKEY_EXT:
@@ -875,6 +892,9 @@ gnutls_privkey_decrypt_data (gnutls_privkey_t key,
                                                    ciphertext, plaintext);
 #endif
     case GNUTLS_PRIVKEY_X509:
+      if (key->prepared)
+        return _gnutls_pk_prepared_decrypt (key->prepared, plaintext,
+                                            ciphertext);
       return _gnutls_pk_decrypt (key->pk_algorithm, plaintext, ciphertext,
                                  &key->key.x509->params);
 #ifdef ENABLE_PKCS11
@@ -51,6 +51,7 @@
 #include <gnutls_dtls.h>
 #include <gnutls_dh.h>
 #include <random.h>
+#include <gnutls_priority.h>
 
 struct tls_record_st {
   uint16_t header_size;
@@ -79,7 +80,13 @@ struct tls_record_st {
 void
 gnutls_record_disable_padding (gnutls_session_t session)
 {
-  session->internals.priorities.no_padding = 1;
+  if (_gnutls_priority_unshare (session) < 0)
+    {
+      gnutls_assert ();
+      return;
+    }
+
+  session->internals.priorities->no_padding = 1;
 }
 
 /**
@@ -787,7 +794,7 @@ int _gnutls_get_max_decrypted_data(gnutls_session_t session)
 int ret;
 
   if (gnutls_compression_get (session) != GNUTLS_COMP_NULL ||
-      session->internals.priorities.allow_large_records != 0)
+      session->internals.priorities->allow_large_records != 0)
     ret = MAX_RECORD_RECV_SIZE(session) + EXTRA_COMP_SIZE;
   else
     ret = MAX_RECORD_RECV_SIZE(session);
@@ -63,9 +63,11 @@ static int pack_anon_auth_info (gnutls_session_t session,
                                 gnutls_buffer_st * packed_session);
 
 static int unpack_security_parameters (gnutls_session_t session,
-                                       gnutls_buffer_st * packed_session);
+                                       gnutls_buffer_st * packed_session,
+                                       unsigned compact);
 static int pack_security_parameters (gnutls_session_t session,
-                                     gnutls_buffer_st * packed_session);
+                                     gnutls_buffer_st * packed_session,
+                                     unsigned compact);
 
 
 /* Since auth_info structures contain malloced data, this function
@@ -74,11 +76,14 @@ static int pack_security_parameters (gnutls_session_t session,
  *
  * packed_session will contain the session data.
  *
- * The data will be in a platform independent format.
+ * The data will be in a platform independent format. If compact
+ * is non-zero the security parameters and the extension headers
+ * use a shorter encoding, which omits the values that are replaced
+ * when resuming with a session ticket.
  */
-int
-_gnutls_session_pack (gnutls_session_t session,
-                      gnutls_datum_t * packed_session)
+static int
+session_pack (gnutls_session_t session,
+              gnutls_datum_t * packed_session, unsigned compact)
 {
   int ret;
   gnutls_buffer_st sb;
@@ -143,14 +148,14 @@ _gnutls_session_pack (gnutls_session_t session,
   /* Auth_info structures copied. Now copy security_parameters_st. 
    * packed_session must have allocated space for the security parameters.
    */
-  ret = pack_security_parameters (session, &sb);
+  ret = pack_security_parameters (session, &sb, compact);
   if (ret < 0)
     {
       gnutls_assert ();
       goto fail;
     }
 
-  ret = _gnutls_ext_pack (session, &sb);
+  ret = _gnutls_ext_pack (session, &sb, compact);
   if (ret < 0)
     {
       gnutls_assert ();
@@ -165,11 +170,27 @@ fail:
 }
 
 
-/* Load session data from a buffer.
+int
+_gnutls_session_pack (gnutls_session_t session,
+                      gnutls_datum_t * packed_session)
+{
+  return session_pack (session, packed_session, 0);
+}
+
+/* Packs the session in the compact format used in session tickets.
  */
 int
-_gnutls_session_unpack (gnutls_session_t session,
-                        const gnutls_datum_t * packed_session)
+_gnutls_session_pack_compact (gnutls_session_t session,
+                              gnutls_datum_t * packed_session)
+{
+  return session_pack (session, packed_session, 1);
+}
+
+/* Load session data from a buffer.
+ */
+static int
+session_unpack (gnutls_session_t session,
+                const gnutls_datum_t * packed_session, unsigned compact)
 {
   int ret;
   gnutls_buffer_st sb;
@@ -249,14 +270,14 @@ _gnutls_session_unpack (gnutls_session_t session,
   /* Auth_info structures copied. Now copy security_parameters_st. 
    * packed_session must have allocated space for the security parameters.
    */
-  ret = unpack_security_parameters (session, &sb);
+  ret = unpack_security_parameters (session, &sb, compact);
   if (ret < 0)
     {
       gnutls_assert ();
       goto error;
     }
 
-  ret = _gnutls_ext_unpack (session, &sb);
+  ret = _gnutls_ext_unpack (session, &sb, compact);
   if (ret < 0)
     {
       gnutls_assert ();
@@ -271,6 +292,20 @@ error:
   return ret;
 }
 
+int
+_gnutls_session_unpack (gnutls_session_t session,
+                        const gnutls_datum_t * packed_session)
+{
+  return session_unpack (session, packed_session, 0);
+}
+
+int
+_gnutls_session_unpack_compact (gnutls_session_t session,
+                                const gnutls_datum_t * packed_session)
+{
+  return session_unpack (session, packed_session, 1);
+}
+
 
 
 /* Format: 
@@ -294,6 +329,26 @@ error:
  *      4 bytes the size of first certificate
  *      x bytes the certificate
  *       and so on...
+ *        CHAIN REFERENCE
+ *      4 bytes the size of the chain digest (0 or 32)
+ *      x bytes the digest of the chain in the chain cache
+ *        VERIFICATION RESULT
+ *      4 bytes whether the chain was verified
+ *      4 bytes the verification status
+ *      4 bytes the verification flags
+ *      4 bytes whether an OCSP response was checked
+ *      8 bytes the trust list generation
+ *      8 bytes the start of the validity window
+ *      8 bytes the end of the validity window
+ *      4 bytes the length of the verified chain
+ *      4 bytes the size of its largest key
+ *      4 bytes whether it has an insecure key
+ *      4 bytes the size of its digest (0 or 32)
+ *      x bytes the digest of the verified chain
+ *
+ * When the credentials have a peer chain cache the certificate
+ * list is stored there and only its digest is packed. Data packed
+ * by earlier versions end after the certificate list.
  */
 static int
 pack_certificate_auth_info (gnutls_session_t session, gnutls_buffer_st * ps)
@@ -301,6 +356,9 @@ pack_certificate_auth_info (gnutls_session_t session, gnutls_buffer_st * ps)
   unsigned int i;
   int cur_size, ret;
   cert_auth_info_t info = _gnutls_get_auth_info (session);
+  gnutls_certificate_credentials_t cred;
+  uint8_t digest[CHAIN_DIGEST_SIZE];
+  unsigned int digest_set = 0;
   int size_offset;
 
   size_offset = ps->length;
@@ -321,11 +379,54 @@ pack_certificate_auth_info (gnutls_session_t session, gnutls_buffer_st * ps)
       BUFFER_APPEND_PFX4 (ps, info->rsa_export.exponent.data,
                          info->rsa_export.exponent.size);
 
-      BUFFER_APPEND_NUM (ps, info->ncerts);
+      cred = (gnutls_certificate_credentials_t)
+        _gnutls_get_cred (session, GNUTLS_CRD_CERTIFICATE, NULL);
 
-      for (i = 0; i < info->ncerts; i++)
-        BUFFER_APPEND_PFX4 (ps, info->raw_certificate_list[i].data,
-                           info->raw_certificate_list[i].size);
+      if (info->ncerts == 0 && info->chain_digest_set)
+        {
+          /* resumed and never restored */
+          memcpy (digest, info->chain_digest, CHAIN_DIGEST_SIZE);
+          digest_set = 1;
+        }
+      else if (info->ncerts > 0 && cred != NULL && cred->chain_cache != NULL)
+        {
+          ret = _gnutls_chain_cache_store (cred->chain_cache,
+                                           info->raw_certificate_list,
+                                           info->ncerts, digest);
+          if (ret < 0)
+            return gnutls_assert_val (ret);
+          digest_set = 1;
+        }
+
+      if (digest_set)
+        {
+          BUFFER_APPEND_NUM (ps, 0);
+        }
+      else
+        {
+          BUFFER_APPEND_NUM (ps, info->ncerts);
+
+          for (i = 0; i < info->ncerts; i++)
+            BUFFER_APPEND_PFX4 (ps, info->raw_certificate_list[i].data,
+                                info->raw_certificate_list[i].size);
+        }
+
+      BUFFER_APPEND_PFX4 (ps, digest, digest_set ? CHAIN_DIGEST_SIZE : 0);
+      BUFFER_APPEND_NUM (ps, info->verify.done);
+      BUFFER_APPEND_NUM (ps, info->verify.status);
+      BUFFER_APPEND_NUM (ps, info->verify.flags);
+      BUFFER_APPEND_NUM (ps, info->verify.ocsp_checked);
+      BUFFER_APPEND_NUM (ps, info->verify.tlist_generation >> 32);
+      BUFFER_APPEND_NUM (ps, info->verify.tlist_generation & 0xffffffff);
+      BUFFER_APPEND_NUM (ps, ((uint64_t) info->verify.not_before) >> 32);
+      BUFFER_APPEND_NUM (ps, ((uint64_t) info->verify.not_before) & 0xffffffff);
+      BUFFER_APPEND_NUM (ps, ((uint64_t) info->verify.not_after) >> 32);
+      BUFFER_APPEND_NUM (ps, ((uint64_t) info->verify.not_after) & 0xffffffff);
+      BUFFER_APPEND_NUM (ps, info->verify.ncerts);
+      BUFFER_APPEND_NUM (ps, info->verify.max_bits);
+      BUFFER_APPEND_NUM (ps, info->verify.weak);
+      BUFFER_APPEND_PFX4 (ps, info->verify.chain,
+                          info->verify.done ? CHAIN_DIGEST_SIZE : 0);
     }
 
   /* write the real size */
@@ -342,14 +443,18 @@ unpack_certificate_auth_info (gnutls_session_t session, gnutls_buffer_st * ps)
 {
   int ret;
   unsigned int i = 0, j = 0;
-  size_t pack_size;
+  size_t pack_size, start;
   cert_auth_info_t info = NULL;
+  gnutls_datum_t digest;
+  uint32_t gen_hi, gen_lo, time_hi, time_lo;
 
   BUFFER_POP_NUM (ps, pack_size);
 
   if (pack_size == 0)
     return 0;                   /* nothing to be done */
 
+  start = ps->length;
+
   /* client and server have the same auth_info here
    */
   ret =
@@ -373,6 +478,9 @@ unpack_certificate_auth_info (gnutls_session_t session, gnutls_buffer_st * ps)
   BUFFER_POP_DATUM (ps, &info->rsa_export.modulus);
   BUFFER_POP_DATUM (ps, &info->rsa_export.exponent);
 
+  _gnutls_free_peer_x509_crts (info);
+  memset (&info->verify, 0, sizeof (info->verify));
+  info->chain_digest_set = 0;
   BUFFER_POP_NUM (ps, info->ncerts);
 
   if (info->ncerts > 0)
@@ -392,6 +500,61 @@ unpack_certificate_auth_info (gnutls_session_t session, gnutls_buffer_st * ps)
       BUFFER_POP_DATUM (ps, &info->raw_certificate_list[i]);
     }
 
+  if (start - ps->length < pack_size)
+    {
+      ret = _gnutls_buffer_pop_datum_prefix (ps, &digest);
+      if (ret < 0)
+        {
+          gnutls_assert ();
+          goto error;
+        }
+
+      if (digest.size == CHAIN_DIGEST_SIZE && info->ncerts == 0)
+        {
+          memcpy (info->chain_digest, digest.data, CHAIN_DIGEST_SIZE);
+          info->chain_digest_set = 1;
+        }
+      else if (digest.size != 0)
+        {
+          gnutls_assert ();
+          ret = GNUTLS_E_PARSING_ERROR;
+          goto error;
+        }
+
+      BUFFER_POP_NUM (ps, info->verify.done);
+      BUFFER_POP_NUM (ps, info->verify.status);
+      BUFFER_POP_NUM (ps, info->verify.flags);
+      BUFFER_POP_NUM (ps, info->verify.ocsp_checked);
+      BUFFER_POP_NUM (ps, gen_hi);
+      BUFFER_POP_NUM (ps, gen_lo);
+      info->verify.tlist_generation = (((uint64_t) gen_hi) << 32) | gen_lo;
+      BUFFER_POP_NUM (ps, time_hi);
+      BUFFER_POP_NUM (ps, time_lo);
+      info->verify.not_before = (time_t) ((((uint64_t) time_hi) << 32) | time_lo);
+      BUFFER_POP_NUM (ps, time_hi);
+      BUFFER_POP_NUM (ps, time_lo);
+      info->verify.not_after = (time_t) ((((uint64_t) time_hi) << 32) | time_lo);
+      BUFFER_POP_NUM (ps, info->verify.ncerts);
+      BUFFER_POP_NUM (ps, info->verify.max_bits);
+      BUFFER_POP_NUM (ps, info->verify.weak);
+
+      ret = _gnutls_buffer_pop_datum_prefix (ps, &digest);
+      if (ret < 0)
+        {
+          gnutls_assert ();
+          goto error;
+        }
+
+      if (digest.size == CHAIN_DIGEST_SIZE)
+        memcpy (info->verify.chain, digest.data, CHAIN_DIGEST_SIZE);
+      else if (digest.size != 0 || info->verify.done != 0)
+        {
+          gnutls_assert ();
+          ret = GNUTLS_E_PARSING_ERROR;
+          goto error;
+        }
+    }
+
   return 0;
 
 error:
@@ -729,9 +892,26 @@ error:
  *            -------------------
  *                MAX: 169 bytes
  *
+ * Compact format:
+ *      1 byte the entity type (client/server)
+ *      1 byte the key exchange algorithm used
+ *      2 bytes the cipher suite
+ *      1 byte the compression method
+ *      1 byte the certificate type
+ *      1 byte the protocol version
+ *      48 bytes the master secret
+ *      4 bytes a timestamp
+ *      1 byte the ECC curve
+ *            -------------------
+ *                60 bytes
+ *
+ * The random values, the session ID and the record sizes are
+ * omitted in the compact format; a server resuming from a ticket
+ * sets them from the new handshake.
  */
 static int
-pack_security_parameters (gnutls_session_t session, gnutls_buffer_st * ps)
+pack_security_parameters (gnutls_session_t session, gnutls_buffer_st * ps,
+                          unsigned compact)
 {
 
   int ret;
@@ -753,6 +933,23 @@ pack_security_parameters (gnutls_session_t session, gnutls_buffer_st * ps)
       return ret;
     }
 
+  if (compact)
+    {
+      BUFFER_APPEND_NUM8 (ps, session->security_parameters.entity);
+      BUFFER_APPEND_NUM8 (ps, session->security_parameters.kx_algorithm);
+      BUFFER_APPEND (ps, session->security_parameters.cipher_suite, 2);
+      BUFFER_APPEND_NUM8 (ps,
+                          session->security_parameters.compression_method);
+      BUFFER_APPEND_NUM8 (ps, session->security_parameters.cert_type);
+      BUFFER_APPEND_NUM8 (ps, session->security_parameters.version);
+      BUFFER_APPEND (ps, session->security_parameters.master_secret,
+                     GNUTLS_MASTER_SIZE);
+      BUFFER_APPEND_NUM (ps, session->security_parameters.timestamp);
+      BUFFER_APPEND_NUM8 (ps, session->security_parameters.ecc_curve);
+
+      return 0;
+    }
+
   /* move after the auth info stuff.
    */
   size_offset = ps->length;
@@ -790,12 +987,47 @@ pack_security_parameters (gnutls_session_t session, gnutls_buffer_st * ps)
 }
 
 static int
-unpack_security_parameters (gnutls_session_t session, gnutls_buffer_st * ps)
+unpack_security_parameters (gnutls_session_t session, gnutls_buffer_st * ps,
+                            unsigned compact)
 {
   size_t pack_size;
   int ret;
   time_t timestamp = gnutls_time (0);
 
+  if (compact)
+    {
+      memset (&session->internals.resumed_security_parameters, 0,
+              sizeof (session->internals.resumed_security_parameters));
+
+      BUFFER_POP_NUM8 (ps,
+                       session->internals.resumed_security_parameters.entity);
+      BUFFER_POP_NUM8 (ps,
+                       session->internals.
+                       resumed_security_parameters.kx_algorithm);
+      BUFFER_POP (ps,
+                  session->internals.resumed_security_parameters.cipher_suite,
+                  2);
+      BUFFER_POP_NUM8 (ps,
+                       session->internals.
+                       resumed_security_parameters.compression_method);
+      BUFFER_POP_NUM8 (ps,
+                       session->internals.
+                       resumed_security_parameters.cert_type);
+      BUFFER_POP_NUM8 (ps,
+                       session->internals.resumed_security_parameters.version);
+      BUFFER_POP (ps,
+                  session->internals.resumed_security_parameters.master_secret,
+                  GNUTLS_MASTER_SIZE);
+      BUFFER_POP_NUM (ps,
+                      session->internals.
+                      resumed_security_parameters.timestamp);
+      BUFFER_POP_NUM8 (ps,
+                       session->internals.
+                       resumed_security_parameters.ecc_curve);
+
+      goto check_time;
+    }
+
   BUFFER_POP_NUM (ps, pack_size);
 
   if (pack_size == 0)
@@ -843,6 +1075,7 @@ unpack_security_parameters (gnutls_session_t session, gnutls_buffer_st * ps)
   BUFFER_POP_NUM (ps,
                   session->internals.resumed_security_parameters.ecc_curve);
 
+check_time:
   if (timestamp - session->internals.resumed_security_parameters.timestamp >
       session->internals.expire_time
       || session->internals.resumed_security_parameters.timestamp > timestamp)
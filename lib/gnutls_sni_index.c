@@ -0,0 +1,374 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * The GnuTLS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/* This file contains the index of the certificates of a server's
+ * credentials, used to select one for the requested server name. The
+ * names of the certificates are kept in a hash table, and each name
+ * records the first certificate (in the order they were added) of every
+ * certificate type and public key algorithm. A name starting with "*."
+ * is a wildcard for a single label.
+ */
+
+#include <gnutls_int.h>
+#include <gnutls_errors.h>
+#include <gnutls_str.h>
+#include <gnutls_sni_index.h>
+#include <c-ctype.h>
+#include <c-strcase.h>
+
+#define SNI_INITIAL_BUCKETS 16
+#define SNI_CERT_TYPES 2        /* X.509 and OpenPGP */
+#define SNI_PK_SLOTS (GNUTLS_PK_EC+1)
+
+typedef struct sni_name_st
+{
+  struct sni_name_st *next;
+  unsigned int hash;
+  /* index of the first certificate of each type and algorithm */
+  int first[SNI_CERT_TYPES][SNI_PK_SLOTS];
+  char *name;                   /* points after the structure */
+} sni_name_st;
+
+struct sni_index_st
+{
+  sni_name_st **buckets;
+  unsigned int nbuckets;
+  unsigned int nnames;
+
+  /* the first certificate of each type and algorithm, whatever its
+   * names */
+  int any[SNI_CERT_TYPES][SNI_PK_SLOTS];
+
+  /* set when a certificate could not be indexed; the index is then
+   * not used */
+  unsigned int broken:1;
+};
+
+#define VALID_SLOT(type, pk) ((type) >= 1 && (type) <= SNI_CERT_TYPES && \
+                              (pk) > 0 && (pk) < SNI_PK_SLOTS)
+
+static void
+slots_init (int slots[SNI_CERT_TYPES][SNI_PK_SLOTS])
+{
+  unsigned int i, j;
+
+  for (i = 0; i < SNI_CERT_TYPES; i++)
+    for (j = 0; j < SNI_PK_SLOTS; j++)
+      slots[i][j] = -1;
+}
+
+/* Returns the first certificate of the given type whose algorithm is
+ * one of the requested ones.
+ */
+static int
+slots_find (const int slots[SNI_CERT_TYPES][SNI_PK_SLOTS],
+            gnutls_certificate_type_t type,
+            const gnutls_pk_algorithm_t * pk_algos, size_t pk_algos_size)
+{
+  size_t j;
+  int idx = -1;
+
+  for (j = 0; j < pk_algos_size; j++)
+    {
+      if (!VALID_SLOT (type, pk_algos[j]))
+        continue;
+
+      if (slots[type - 1][pk_algos[j]] >= 0
+          && (idx < 0 || slots[type - 1][pk_algos[j]] < idx))
+        idx = slots[type - 1][pk_algos[j]];
+    }
+
+  return idx;
+}
+
+/* A case insensitive variant of hash_pjw_bare().
+ */
+unsigned int
+_gnutls_sni_name_hash (const char *name, size_t len)
+{
+  unsigned int h = 0;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    h = c_tolower (name[i]) + ((h << 9) | (h >> (sizeof (h) * 8 - 9)));
+
+  return h;
+}
+
+static sni_name_st *
+name_find (const sni_index_st * index, const char *name, unsigned int hash)
+{
+  sni_name_st *n;
+
+  for (n = index->buckets[hash % index->nbuckets]; n != NULL; n = n->next)
+    {
+      if (n->hash == hash && c_strcasecmp (n->name, name) == 0)
+        return n;
+    }
+
+  return NULL;
+}
+
+static int
+index_grow (sni_index_st * index)
+{
+  sni_name_st **buckets, *n, *next;
+  unsigned int nbuckets = index->nbuckets * 2, i;
+
+  buckets = gnutls_calloc (nbuckets, sizeof (sni_name_st *));
+  if (buckets == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  for (i = 0; i < index->nbuckets; i++)
+    {
+      for (n = index->buckets[i]; n != NULL; n = next)
+        {
+          next = n->next;
+          n->next = buckets[n->hash % nbuckets];
+          buckets[n->hash % nbuckets] = n;
+        }
+    }
+
+  gnutls_free (index->buckets);
+  index->buckets = buckets;
+  index->nbuckets = nbuckets;
+
+  return 0;
+}
+
+int
+_gnutls_sni_index_init (sni_index_st ** index)
+{
+  sni_index_st *idx;
+
+  idx = gnutls_calloc (1, sizeof (*idx));
+  if (idx == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  idx->buckets = gnutls_calloc (SNI_INITIAL_BUCKETS, sizeof (sni_name_st *));
+  if (idx->buckets == NULL)
+    {
+      gnutls_free (idx);
+      return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+    }
+  idx->nbuckets = SNI_INITIAL_BUCKETS;
+  slots_init (idx->any);
+
+  *index = idx;
+
+  return 0;
+}
+
+/* Removes all the certificates from the index.
+ */
+void
+_gnutls_sni_index_clear (sni_index_st * index)
+{
+  sni_name_st *n, *next;
+  unsigned int i;
+
+  if (index == NULL)
+    return;
+
+  for (i = 0; i < index->nbuckets; i++)
+    {
+      for (n = index->buckets[i]; n != NULL; n = next)
+        {
+          next = n->next;
+          gnutls_free (n);
+        }
+      index->buckets[i] = NULL;
+    }
+
+  index->nnames = 0;
+  index->broken = 0;
+  slots_init (index->any);
+}
+
+void
+_gnutls_sni_index_deinit (sni_index_st * index)
+{
+  if (index == NULL)
+    return;
+
+  _gnutls_sni_index_clear (index);
+  gnutls_free (index->buckets);
+  gnutls_free (index);
+}
+
+/* Adds the certificate at position @idx of the credentials. The
+ * certificates must be added in order.
+ */
+void
+_gnutls_sni_index_add (sni_index_st * index, unsigned idx,
+                       gnutls_str_array_t names,
+                       gnutls_certificate_type_t type,
+                       gnutls_pk_algorithm_t pk)
+{
+  gnutls_str_array_t p;
+  sni_name_st *n;
+  unsigned int hash;
+
+  if (index == NULL || index->broken)
+    return;
+
+  /* not expected; let the server scan the certificates instead */
+  if (!VALID_SLOT (type, pk))
+    goto fail;
+
+  if (index->any[type - 1][pk] < 0)
+    index->any[type - 1][pk] = idx;
+
+  for (p = names; p != NULL; p = p->next)
+    {
+      hash = _gnutls_sni_name_hash (p->str, p->len);
+
+      n = name_find (index, p->str, hash);
+      if (n == NULL)
+        {
+          if (index->nnames >= index->nbuckets && index_grow (index) < 0)
+            goto fail;
+
+          n = gnutls_malloc (sizeof (*n) + p->len + 1);
+          if (n == NULL)
+            {
+              gnutls_assert ();
+              goto fail;
+            }
+
+          n->hash = hash;
+          n->name = (char *) (n + 1);
+          memcpy (n->name, p->str, p->len + 1);
+          slots_init (n->first);
+
+          n->next = index->buckets[hash % index->nbuckets];
+          index->buckets[hash % index->nbuckets] = n;
+          index->nnames++;
+        }
+
+      if (n->first[type - 1][pk] < 0)
+        n->first[type - 1][pk] = idx;
+    }
+
+  return;
+
+fail:
+  _gnutls_debug_log ("Could not index the server certificates\n");
+  index->broken = 1;
+}
+
+int
+_gnutls_sni_index_usable (const sni_index_st * index)
+{
+  return (index != NULL && index->broken == 0);
+}
+
+/* Returns non-zero if one of @names is @name. Names are compared
+ * case insensitively, as in the index.
+ */
+int
+_gnutls_sni_names_match (gnutls_str_array_t names, const char *name)
+{
+  for (; names != NULL; names = names->next)
+    {
+      if (c_strcasecmp (names->str, name) == 0)
+        return 1;
+    }
+
+  return 0;
+}
+
+/* Writes in @wildcard the wildcard name that matches @name, and
+ * returns its length, or -1 if there is none. "*.example.com" matches
+ * "www.example.com" but neither "example.com" nor "a.www.example.com".
+ */
+int
+_gnutls_sni_wildcard (const char *name, char *wildcard, size_t wildcard_size)
+{
+  const char *domain;
+  size_t len;
+
+  domain = strchr (name, '.');
+  if (domain == NULL || strchr (domain + 1, '.') == NULL)
+    return -1;
+
+  len = strlen (domain);
+  if (len + 2 > wildcard_size)
+    return -1;
+
+  wildcard[0] = '*';
+  memcpy (&wildcard[1], domain, len + 1);       /* with the null terminator */
+
+  return len + 1;
+}
+
+/* Returns the index of the first certificate that has the given name,
+ * or else a wildcard name that matches it, or -1.
+ */
+int
+_gnutls_sni_index_find_name (const sni_index_st * index, const char *name,
+                             gnutls_certificate_type_t type,
+                             const gnutls_pk_algorithm_t * pk_algos,
+                             size_t pk_algos_size)
+{
+  const sni_name_st *n;
+  char wildcard[MAX_CN + 2];
+  size_t len = strlen (name);
+  int idx = -1, ret;
+
+  n = name_find (index, name, _gnutls_sni_name_hash (name, len));
+  if (n != NULL)
+    idx = slots_find (n->first, type, pk_algos, pk_algos_size);
+
+  if (idx >= 0)
+    return idx;
+
+  ret = _gnutls_sni_wildcard (name, wildcard, sizeof (wildcard));
+  if (ret < 0)
+    return -1;
+  len = ret;
+
+  n = name_find (index, wildcard, _gnutls_sni_name_hash (wildcard, len));
+  if (n != NULL)
+    idx = slots_find (n->first, type, pk_algos, pk_algos_size);
+
+  return idx;
+}
+
+/* Returns the index of the first certificate of an algorithm that is
+ * listed in @pk_algos, preferring the ones listed first, or -1.
+ */
+int
+_gnutls_sni_index_find_any (const sni_index_st * index,
+                            gnutls_certificate_type_t type,
+                            const gnutls_pk_algorithm_t * pk_algos,
+                            size_t pk_algos_size)
+{
+  size_t j;
+
+  for (j = 0; j < pk_algos_size; j++)
+    {
+      if (VALID_SLOT (type, pk_algos[j])
+          && index->any[type - 1][pk_algos[j]] >= 0)
+        return index->any[type - 1][pk_algos[j]];
+    }
+
+  return -1;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * The GnuTLS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+#ifndef GNUTLS_SNI_INDEX_H
+#define GNUTLS_SNI_INDEX_H
+
+#include <gnutls_str_array.h>
+
+typedef struct sni_index_st sni_index_st;
+
+unsigned int _gnutls_sni_name_hash (const char *name, size_t len);
+int _gnutls_sni_wildcard (const char *name, char *wildcard,
+                          size_t wildcard_size);
+int _gnutls_sni_names_match (gnutls_str_array_t names, const char *name);
+
+int _gnutls_sni_index_init (sni_index_st ** index);
+void _gnutls_sni_index_deinit (sni_index_st * index);
+void _gnutls_sni_index_clear (sni_index_st * index);
+
+void _gnutls_sni_index_add (sni_index_st * index, unsigned idx,
+                            gnutls_str_array_t names,
+                            gnutls_certificate_type_t type,
+                            gnutls_pk_algorithm_t pk);
+
+int _gnutls_sni_index_usable (const sni_index_st * index);
+int _gnutls_sni_index_find_name (const sni_index_st * index,
+                                 const char *name,
+                                 gnutls_certificate_type_t type,
+                                 const gnutls_pk_algorithm_t * pk_algos,
+                                 size_t pk_algos_size);
+int _gnutls_sni_index_find_any (const sni_index_st * index,
+                                gnutls_certificate_type_t type,
+                                const gnutls_pk_algorithm_t * pk_algos,
+                                size_t pk_algos_size);
+
+#endif
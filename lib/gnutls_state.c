@@ -47,6 +47,8 @@
 #include <system.h>
 #include <gnutls/dtls.h>
 #include <timespec.h>
+#include <gnutls_priority.h>
+#include <gnutls_cert_slot.h>
 
 /* These should really be static, but src/tests.c calls them.  Make
    them public functions?  */
@@ -207,13 +209,13 @@ _gnutls_session_cert_type_supported (gnutls_session_t session,
         }
     }
 
-  if (session->internals.priorities.cert_type.algorithms == 0
+  if (session->internals.priorities->cert_type.algorithms == 0
       && cert_type == DEFAULT_CERT_TYPE)
     return 0;
 
-  for (i = 0; i < session->internals.priorities.cert_type.algorithms; i++)
+  for (i = 0; i < session->internals.priorities->cert_type.algorithms; i++)
     {
-      if (session->internals.priorities.cert_type.priority[i] == cert_type)
+      if (session->internals.priorities->cert_type.priority[i] == cert_type)
         {
           return 0;             /* ok */
         }
@@ -369,7 +371,9 @@ gnutls_init (gnutls_session_t * session, unsigned int flags)
   /* emulate old gnutls behavior for old applications that do not use the priority_*
    * functions.
    */
-  (*session)->internals.priorities.sr = SR_PARTIAL;
+  (*session)->internals.priorities = &_gnutls_default_priority;
+
+  (*session)->internals.selected_cert_index = -1;
 
 #ifdef HAVE_WRITEV
   gnutls_transport_set_vec_push_function (*session, system_writev);
@@ -459,6 +463,9 @@ gnutls_deinit (gnutls_session_t session)
   gnutls_credentials_clear (session);
   _gnutls_selected_certs_deinit (session);
 
+  gnutls_free (session->internals.client_cache_server);
+  _gnutls_priority_unref (session->internals.priorities);
+
   gnutls_pk_params_release(&session->key.ecdh_params);
   _gnutls_mpi_release (&session->key.ecdh_x);
   _gnutls_mpi_release (&session->key.ecdh_y);
@@ -481,6 +488,9 @@ gnutls_deinit (gnutls_session_t session)
 
   _gnutls_mpi_release (&session->key.dh_secret);
 
+  /* last, as it may free the credentials */
+  _gnutls_cert_snapshot_release (session->internals.cert_snapshot);
+
   memset (session, 0, sizeof (struct gnutls_session_int));
   gnutls_free (session);
 }
@@ -786,24 +796,15 @@ gnutls_handshake_set_private_extensions (gnutls_session_t session, int allow)
   session->internals.enable_private = allow;
 }
 
-inline static int
-_gnutls_cal_PRF_A (gnutls_mac_algorithm_t algorithm,
-                   const void *secret, int secret_size,
-                   const void *seed, int seed_size, void *result)
-{
-  int ret;
-
-  ret = _gnutls_hmac_fast (algorithm, secret, secret_size, seed, seed_size, result);
-  if (ret < 0)
-    return gnutls_assert_val(ret);
-
-  return 0;
-}
-
 #define MAX_SEED_SIZE 200
 
 /* Produces "total_bytes" bytes using the hash algorithm specified.
  * (used in the PRF function)
+ *
+ * The HMAC is keyed once with the secret; after each output it is
+ * reset to the keyed state, i.e., the precomputed inner and outer
+ * hash states, instead of running the key schedule again for every
+ * A(i) and output block.
  */
 static int
 P_hash (gnutls_mac_algorithm_t algorithm,
@@ -839,30 +840,26 @@ P_hash (gnutls_mac_algorithm_t algorithm,
 
   times = output_bytes / blocksize;
 
-  for (i = 0; i < times; i++)
+  result = _gnutls_hmac_init (&td2, algorithm, secret, secret_size);
+  if (result < 0)
     {
-      result = _gnutls_hmac_init (&td2, algorithm, secret, secret_size);
-      if (result < 0)
-        {
-          gnutls_assert ();
-          return result;
-        }
+      gnutls_assert ();
+      return result;
+    }
 
+  for (i = 0; i < times; i++)
+    {
       /* here we calculate A(i+1) */
-      if ((result =
-           _gnutls_cal_PRF_A (algorithm, secret, secret_size, Atmp,
-                              A_size, Atmp)) < 0)
-        {
-          gnutls_assert ();
-          _gnutls_hmac_deinit (&td2, final);
-          return result;
-        }
+      _gnutls_hmac (&td2, Atmp, A_size);
+      _gnutls_hmac_output (&td2, Atmp);
+      _gnutls_hmac_reset (&td2);
 
       A_size = blocksize;
 
       _gnutls_hmac (&td2, Atmp, A_size);
       _gnutls_hmac (&td2, seed, seed_size);
-      _gnutls_hmac_deinit (&td2, final);
+      _gnutls_hmac_output (&td2, final);
+      _gnutls_hmac_reset (&td2);
 
       if ((1 + i) * blocksize < total_bytes)
         {
@@ -879,6 +876,8 @@ P_hash (gnutls_mac_algorithm_t algorithm,
         }
     }
 
+  _gnutls_hmac_deinit (&td2, NULL);
+
   return 0;
 }
 
@@ -1315,7 +1314,13 @@ gnutls_handshake_set_post_client_hello_function (gnutls_session_t session,
 void
 gnutls_session_enable_compatibility_mode (gnutls_session_t session)
 {
-  ENABLE_COMPAT(&session->internals.priorities);
+  if (_gnutls_priority_unshare (session) < 0)
+    {
+      gnutls_assert ();
+      return;
+    }
+
+  ENABLE_COMPAT(session->internals.priorities);
 }
 
 /**
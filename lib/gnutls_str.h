@@ -197,4 +197,33 @@ int _gnutls_hostname_compare (const char *certname, size_t certnamesize,
         o = s; \
     }
 
+/* append and pop numbers of fixed size (8 or 16 bits) */
+#define BUFFER_APPEND_NUM8(b, s) { \
+        ret = _gnutls_buffer_append_prefix(b, 8, s); \
+        if (ret < 0) { \
+            gnutls_assert(); \
+            return ret; \
+        } \
+    }
+
+#define BUFFER_APPEND_NUM16(b, s) { \
+        ret = _gnutls_buffer_append_prefix(b, 16, s); \
+        if (ret < 0) { \
+            gnutls_assert(); \
+            return ret; \
+        } \
+    }
+
+#define BUFFER_POP_NUM8(b, o) { \
+        uint8_t n8; \
+        BUFFER_POP(b, &n8, 1); \
+        o = n8; \
+    }
+
+#define BUFFER_POP_NUM16(b, o) { \
+        uint8_t n16[2]; \
+        BUFFER_POP(b, n16, 2); \
+        o = _gnutls_read_uint16(n16); \
+    }
+
 #endif
@@ -506,7 +506,7 @@ gnutls_certificate_get_ours (gnutls_session_t session)
 
   cred = (gnutls_certificate_credentials_t)
     _gnutls_get_cred (session, GNUTLS_CRD_CERTIFICATE, NULL);
-  if (cred == NULL || cred->certs == NULL)
+  if (cred == NULL || (cred->certs == NULL && cred->lazy_certs == NULL))
     {
       gnutls_assert ();
       return NULL;
@@ -548,6 +548,9 @@ gnutls_certificate_get_peers (gnutls_session_t
   if (info == NULL)
     return NULL;
 
+  if (_gnutls_peer_chain_restore (session, info) < 0)
+    return NULL;
+
   *list_size = info->ncerts;
   return info->raw_certificate_list;
 }
@@ -41,6 +41,7 @@
 #include <gnutls/ocsp.h>
 #include "x509/common.h"
 #include "x509/x509_int.h"
+#include "x509/verify-high.h"
 #include <gnutls_str_array.h>
 #include "read-file.h"
 #ifdef _WIN32
@@ -78,7 +79,7 @@ check_bits (gnutls_session_t session, gnutls_x509_crt_t crt, unsigned int max_bi
     {
       gnutls_assert();
       _gnutls_audit_log(session, "The security level of the certificate (%s: %u) is weak\n", gnutls_pk_get_name(pk), bits);
-      if (session->internals.priorities.allow_weak_keys == 0)
+      if (session->internals.priorities->allow_weak_keys == 0)
         return gnutls_assert_val(GNUTLS_E_CERTIFICATE_ERROR);
     }
 
@@ -199,11 +200,159 @@ cleanup:
 }
 
 
-#define CLEAR_CERTS for(x=0;x<peer_certificate_list_size;x++) { \
-	if (peer_certificate_list[x]) \
-		gnutls_x509_crt_deinit(peer_certificate_list[x]); \
-	} \
-	gnutls_free( peer_certificate_list)
+/* Returns non-zero if the verification result stored with the
+ * session, possibly by the handshake it was resumed from, still holds
+ * for the peer's current chain.
+ */
+static int
+verify_result_valid (cert_auth_info_t info,
+                     gnutls_certificate_credentials_t cred,
+                     unsigned int verify_flags)
+{
+  uint8_t digest[CHAIN_DIGEST_SIZE];
+  time_t now;
+
+  if (info->verify.done == 0 || info->verify.flags != verify_flags)
+    return 0;
+
+  if (_gnutls_peer_chain_digest (info, digest) < 0
+      || memcmp (digest, info->verify.chain, CHAIN_DIGEST_SIZE) != 0)
+    return 0;
+
+  /* CAs or CRLs were added since */
+  if (info->verify.tlist_generation !=
+      _gnutls_trustlist_generation (cred->tlist))
+    return 0;
+
+  if (verify_flags & GNUTLS_VERIFY_DISABLE_TIME_CHECKS)
+    return 1;
+
+  now = gnutls_time (0);
+  if (now < info->verify.not_before || now > info->verify.not_after)
+    return 0;
+
+  return 1;
+}
+
+/* Applies the current depth and key size limits to the chain
+ * of a stored verification result, as check_bits() does for a
+ * parsed chain.
+ */
+static int
+check_verify_limits (gnutls_session_t session, cert_auth_info_t info,
+                     gnutls_certificate_credentials_t cred)
+{
+  if (info->verify.ncerts > cred->verify_depth && cred->verify_depth > 0)
+    return gnutls_assert_val (GNUTLS_E_CONSTRAINT_ERROR);
+
+  if (info->verify.max_bits > cred->verify_bits && cred->verify_bits > 0)
+    return gnutls_assert_val (GNUTLS_E_CONSTRAINT_ERROR);
+
+  if (info->verify.weak && session->internals.priorities->allow_weak_keys == 0)
+    return gnutls_assert_val (GNUTLS_E_CERTIFICATE_ERROR);
+
+  return 0;
+}
+
+/* Reports the stored verification result. Only the end certificate
+ * is needed, for the hostname check.
+ */
+static int
+cached_verify_peers (gnutls_session_t session, cert_auth_info_t info,
+                     const char *hostname, unsigned int *status)
+{
+  gnutls_x509_crt_t *crts;
+  int ret;
+
+  if (hostname)
+    {
+      if (info->raw_certificate_list == NULL || info->ncerts == 0)
+        return GNUTLS_E_NO_CERTIFICATE_FOUND;
+
+      ret = _gnutls_get_peer_x509_crts (info, &crts);
+      if (ret < 0)
+        return gnutls_assert_val (ret);
+
+      *status = info->verify.status;
+      if (gnutls_x509_crt_check_hostname (crts[0], hostname) == 0)
+        *status |= GNUTLS_CERT_UNEXPECTED_OWNER;
+    }
+  else
+    *status = info->verify.status;
+
+  session->internals.ocsp_check_ok = info->verify.ocsp_checked;
+
+  return 0;
+}
+
+/* Stores the result of a verification of the peer's chain, and the
+ * time window in which it holds; the one in which all the certificates
+ * of the chain, and the trust anchor it leads to, are valid.
+ */
+static void
+save_verify_result (cert_auth_info_t info,
+                    gnutls_certificate_credentials_t cred,
+                    unsigned int verify_flags,
+                    gnutls_x509_crt_t * certs, int ncerts,
+                    unsigned int status, unsigned int ocsp_checked)
+{
+  gnutls_x509_crt_t issuer;
+  time_t not_before = 0, not_after = 0, t;
+  unsigned int bits, max_bits = 0, weak = 0;
+  uint8_t digest[CHAIN_DIGEST_SIZE];
+  int i, pk;
+
+  if (_gnutls_peer_chain_digest (info, digest) < 0)
+    return;
+
+  for (i = 0; i < ncerts; i++)
+    {
+      pk = gnutls_x509_crt_get_pk_algorithm (certs[i], &bits);
+      if (pk < 0)
+        return;
+
+      if (bits > max_bits)
+        max_bits = bits;
+      if (gnutls_pk_bits_to_sec_param (pk, bits) == GNUTLS_SEC_PARAM_INSECURE)
+        weak = 1;
+    }
+
+  for (i = 0; i <= ncerts; i++)
+    {
+      if (i == ncerts)
+        {
+          if (gnutls_x509_trust_list_get_issuer (cred->tlist, certs[i - 1],
+                                                 &issuer, 0) < 0)
+            break;
+        }
+      else
+        issuer = certs[i];
+
+      t = gnutls_x509_crt_get_activation_time (issuer);
+      if (t == (time_t) - 1)
+        return;
+      if (t > not_before)
+        not_before = t;
+
+      t = gnutls_x509_crt_get_expiration_time (issuer);
+      if (t == (time_t) - 1)
+        return;
+      if (i == 0 || t < not_after)
+        not_after = t;
+    }
+
+  info->verify.done = 1;
+  info->verify.status = status;
+  info->verify.flags = verify_flags;
+  info->verify.ocsp_checked = ocsp_checked;
+  info->verify.tlist_generation = _gnutls_trustlist_generation (cred->tlist);
+  info->verify.not_before = not_before;
+  info->verify.not_after = not_after;
+  info->verify.ncerts = ncerts;
+  info->verify.max_bits = max_bits;
+  info->verify.weak = weak;
+  memcpy (info->verify.chain, digest, CHAIN_DIGEST_SIZE);
+}
 
 /*-
  * _gnutls_x509_cert_verify_peers - return the peer's certificate status
@@ -223,7 +372,7 @@ _gnutls_x509_cert_verify_peers (gnutls_session_t session,
   gnutls_certificate_credentials_t cred;
   gnutls_x509_crt_t *peer_certificate_list;
   gnutls_datum_t resp;
-  int peer_certificate_list_size, i, x, ret;
+  int peer_certificate_list_size, i, ret;
   gnutls_x509_crt_t issuer;
   unsigned int ocsp_status = 0;
   unsigned int verify_flags;
@@ -248,6 +397,17 @@ _gnutls_x509_cert_verify_peers (gnutls_session_t session,
       return GNUTLS_E_INSUFFICIENT_CREDENTIALS;
     }
 
+  verify_flags = cred->verify_flags | session->internals.priorities->additional_verify_flags;
+
+  if (verify_result_valid (info, cred, verify_flags))
+    {
+      ret = check_verify_limits (session, info, cred);
+      if (ret < 0)
+        return gnutls_assert_val (ret);
+
+      return cached_verify_peers (session, info, hostname, status);
+    }
+
   if (info->raw_certificate_list == NULL || info->ncerts == 0)
     return GNUTLS_E_NO_CERTIFICATE_FOUND;
 
@@ -257,48 +417,18 @@ _gnutls_x509_cert_verify_peers (gnutls_session_t session,
       return GNUTLS_E_CONSTRAINT_ERROR;
     }
 
-  verify_flags = cred->verify_flags | session->internals.priorities.additional_verify_flags;
-  /* generate a list of gnutls_certs based on the auth info
-   * raw certs.
+  /* the certificates as parsed for the handshake
    */
+  ret = _gnutls_get_peer_x509_crts (info, &peer_certificate_list);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
   peer_certificate_list_size = info->ncerts;
-  peer_certificate_list =
-    gnutls_calloc (peer_certificate_list_size, sizeof (gnutls_x509_crt_t));
-  if (peer_certificate_list == NULL)
-    {
-      gnutls_assert ();
-      return GNUTLS_E_MEMORY_ERROR;
-    }
 
   for (i = 0; i < peer_certificate_list_size; i++)
     {
-      ret = gnutls_x509_crt_init (&peer_certificate_list[i]);
-      if (ret < 0)
-        {
-          gnutls_assert ();
-          CLEAR_CERTS;
-          return ret;
-        }
-
-      ret =
-        gnutls_x509_crt_import (peer_certificate_list[i],
-                                &info->raw_certificate_list[i],
-                                GNUTLS_X509_FMT_DER);
-      if (ret < 0)
-        {
-          gnutls_assert ();
-          CLEAR_CERTS;
-          return ret;
-        }
-
       ret = check_bits (session, peer_certificate_list[i], cred->verify_bits);
       if (ret < 0)
-        {
-          gnutls_assert ();
-          CLEAR_CERTS;
-          return ret;
-        }
-
+        return gnutls_assert_val (ret);
     }
 
   /* Use the OCSP extension if any */
@@ -323,10 +453,7 @@ _gnutls_x509_cert_verify_peers (gnutls_session_t session,
 
   ret = check_ocsp_response(session, peer_certificate_list[0], issuer, &resp, &ocsp_status);
   if (ret < 0)
-    {
-      CLEAR_CERTS;
-      return gnutls_assert_val(ret);
-    }
+    return gnutls_assert_val(ret);
 
 skip_ocsp:
   /* Verify certificate 
@@ -338,10 +465,15 @@ skip_ocsp:
   if (ret < 0)
     {
       gnutls_assert ();
-      CLEAR_CERTS;
       return ret;
     }
 
+  *status |= ocsp_status;
+
+  save_verify_result (info, cred, verify_flags, peer_certificate_list,
+                      peer_certificate_list_size, *status,
+                      session->internals.ocsp_check_ok);
+
   if (hostname)
     {
       ret = gnutls_x509_crt_check_hostname( peer_certificate_list[0], hostname);
@@ -349,10 +481,6 @@ skip_ocsp:
         *status |= GNUTLS_CERT_UNEXPECTED_OWNER;
     }
 
-  CLEAR_CERTS;
-
-  *status |= ocsp_status;
-
   return 0;
 }
 
@@ -977,6 +1105,7 @@ gnutls_certificate_set_x509_key_mem (gnutls_certificate_credentials_t res,
     return ret;
 
   res->ncerts++;
+  certificate_credentials_index_last (res);
 
   if (key && (ret = _gnutls_check_key_cert_match (res)) < 0)
     {
@@ -1053,28 +1182,54 @@ certificate_credential_append_crt_list (gnutls_certificate_credentials_t res,
                                         gnutls_str_array_t names, gnutls_pcert_st * crt, int nr)
 {
 int ret;
+gnutls_datum_t cert_msg = { NULL, 0 };
 
   ret = check_if_sorted(crt, nr);
   if (ret < 0)
     return gnutls_assert_val(ret);
 
+  /* the Certificate message is the same in every handshake that
+   * uses this chain, so encode it once */
+  if (nr > 0 && crt[0].type == GNUTLS_CRT_X509)
+    {
+      ret = _gnutls_encode_x509_crt_msg (crt, nr, &cert_msg);
+      if (ret < 0)
+        return gnutls_assert_val(ret);
+    }
+
   res->certs = gnutls_realloc_fast (res->certs,
                                         (1 + res->ncerts) *
                                         sizeof (certs_st));
   if (res->certs == NULL)
     {
       gnutls_assert ();
+      _gnutls_free_datum (&cert_msg);
       return GNUTLS_E_MEMORY_ERROR;
     }
 
   res->certs[res->ncerts].cert_list = crt;
   res->certs[res->ncerts].cert_list_length = nr;
   res->certs[res->ncerts].names = names;
+  res->certs[res->ncerts].cert_msg = cert_msg;
 
   return 0;
 
 }
 
+/* Adds the last certificate of the credentials to their index of
+ * names. Must be called after the certificate is counted in ncerts.
+ */
+void
+certificate_credentials_index_last (gnutls_certificate_credentials_t res)
+{
+  certs_st *c = &res->certs[res->ncerts - 1];
+
+  _gnutls_sni_index_add (res->sni_index, res->ncerts - 1, c->names,
+                         c->cert_list[0].type,
+                         gnutls_pubkey_get_pk_algorithm (c->cert_list[0].
+                                                         pubkey, NULL));
+}
+
 int
 certificate_credentials_append_pkey (gnutls_certificate_credentials_t res,
                                      gnutls_privkey_t pkey)
@@ -1179,6 +1334,7 @@ gnutls_certificate_set_x509_key (gnutls_certificate_credentials_t res,
     }
 
   res->ncerts++;
+  certificate_credentials_index_last (res);
 
   if ((ret = _gnutls_check_key_cert_match (res)) < 0)
     {
@@ -1260,6 +1416,7 @@ gnutls_certificate_set_key (gnutls_certificate_credentials_t res,
     }
 
   res->ncerts++;
+  certificate_credentials_index_last (res);
 
   if ((ret = _gnutls_check_key_cert_match (res)) < 0)
     {
@@ -1312,6 +1469,7 @@ gnutls_certificate_set_x509_key_file (gnutls_certificate_credentials_t res,
     return ret;
 
   res->ncerts++;
+  certificate_credentials_index_last (res);
 
   if ((ret = _gnutls_check_key_cert_match (res)) < 0)
     {
@@ -1439,6 +1597,14 @@ _gnutls_check_key_usage (const gnutls_pcert_st* cert, gnutls_kx_algorithm_t alg)
   return 0;
 }
 
+/* A trust list set with gnutls_certificate_set_trust_list() is owned
+ * by the application, and used by other credentials as well; the CAs
+ * and CRLs of the credentials cannot be added to it.
+ */
+#define CHECK_TLIST_NOT_SHARED(res) \
+  if ((res)->shared_tlist) \
+    return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST)
+
 static int
 parse_pem_ca_mem (gnutls_certificate_credentials_t res,
                   const uint8_t * input_cert, int input_cert_size)
@@ -1551,6 +1717,8 @@ gnutls_certificate_set_x509_trust_mem (gnutls_certificate_credentials_t res,
 {
   int ret;
 
+  CHECK_TLIST_NOT_SHARED (res);
+
   if (type == GNUTLS_X509_FMT_DER)
     ret = parse_der_ca_mem (res,
                             ca->data, ca->size);
@@ -1593,6 +1761,8 @@ gnutls_certificate_set_x509_trust (gnutls_certificate_credentials_t res,
   int ret, i, j;
   gnutls_x509_crt_t new_list[ca_list_size];
 
+  CHECK_TLIST_NOT_SHARED (res);
+
   for (i = 0; i < ca_list_size; i++)
     {
       ret = gnutls_x509_crt_init (&new_list[i]);
@@ -1665,6 +1835,8 @@ gnutls_certificate_set_x509_trust_file (gnutls_certificate_credentials_t cred,
   gnutls_datum_t cas;
   size_t size;
 
+  CHECK_TLIST_NOT_SHARED (cred);
+
 #ifdef ENABLE_PKCS11
   if (strncmp (cafile, "pkcs11:", 7) == 0)
     {
@@ -1712,9 +1884,56 @@ gnutls_certificate_set_x509_trust_file (gnutls_certificate_credentials_t cred,
 int
 gnutls_certificate_set_x509_system_trust (gnutls_certificate_credentials_t cred)
 {
+  CHECK_TLIST_NOT_SHARED (cred);
+
   return gnutls_x509_trust_list_add_system_trust(cred->tlist, 0, 0);
 }
 
+/**
+ * gnutls_certificate_set_trust_list:
+ * @res: is a #gnutls_certificate_credentials_t structure.
+ * @tlist: is a #gnutls_x509_trust_list_t structure
+ * @flags: must be zero
+ *
+ * This function replaces the trusted CAs and CRLs of the credentials
+ * with the given trust list, which is used for verifying the peer's
+ * certificate. The list is shared rather than copied, so the same
+ * list (e.g., one holding the system's CAs) can be set in many
+ * credentials and is parsed and kept in memory once.
+ *
+ * The list is owned by the application, which adds its CAs and CRLs
+ * with the gnutls_x509_trust_list_add_*() functions. Any such addition
+ * changes the trust of every credentials structure the list is set in.
+ * Adding CAs or CRLs through the credentials, e.g., with
+ * gnutls_certificate_set_x509_trust_file(), fails with
+ * %GNUTLS_E_INVALID_REQUEST once a list is set. The CAs of the list
+ * are not sent in the certificate request of a server.
+ *
+ * The application may call gnutls_x509_trust_list_deinit() on @tlist
+ * after this function; the list is then freed, as specified in that
+ * call, when the last credentials using it are freed. It must not be
+ * modified while it is used in a session.
+ *
+ * Returns: %GNUTLS_E_SUCCESS (0) on success, or a negative error code.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_certificate_set_trust_list (gnutls_certificate_credentials_t res,
+                                   gnutls_x509_trust_list_t tlist,
+                                   unsigned flags)
+{
+  if (tlist == NULL || flags != 0)
+    return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST);
+
+  _gnutls_trustlist_ref (tlist);
+  _gnutls_trustlist_unref (res->tlist);
+  res->tlist = tlist;
+  res->shared_tlist = 1;
+
+  return 0;
+}
+
 static int
 parse_pem_crl_mem (gnutls_x509_trust_list_t tlist, 
                    const char * input_crl, unsigned int input_crl_size)
@@ -1831,6 +2050,8 @@ gnutls_certificate_set_x509_crl_mem (gnutls_certificate_credentials_t res,
                                      const gnutls_datum_t * CRL,
                                      gnutls_x509_crt_fmt_t type)
 {
+  CHECK_TLIST_NOT_SHARED (res);
+
   return read_crl_mem (res, CRL->data, CRL->size, type);
 }
 
@@ -1858,6 +2079,8 @@ gnutls_certificate_set_x509_crl (gnutls_certificate_credentials_t res,
   int ret, i, j;
   gnutls_x509_crl_t new_crl[crl_list_size];
 
+  CHECK_TLIST_NOT_SHARED (res);
+
   for (i = 0; i < crl_list_size; i++)
     {
       ret = gnutls_x509_crl_init (&new_crl[i]);
@@ -1912,8 +2135,11 @@ gnutls_certificate_set_x509_crl_file (gnutls_certificate_credentials_t res,
 {
   int ret;
   size_t size;
-  char *data = (void*)read_binary_file (crlfile, &size);
+  char *data;
+
+  CHECK_TLIST_NOT_SHARED (res);
 
+  data = (void*)read_binary_file (crlfile, &size);
   if (data == NULL)
     {
       gnutls_assert ();
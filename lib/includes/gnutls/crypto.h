@@ -99,6 +99,10 @@ extern "C"
 
   int gnutls_rnd (gnutls_rnd_level_t level, void *data, size_t len);
 
+  void gnutls_ecc_pubkey_cache_get_stats (unsigned int *hits,
+                                          unsigned int *misses,
+                                          unsigned int *evictions);
+
 #ifdef __cplusplus
 }
 #endif
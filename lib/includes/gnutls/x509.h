@@ -1068,6 +1068,9 @@ extern "C"
     unsigned int *verify,
     gnutls_verify_output_function func);
 
+  int gnutls_x509_trust_list_set_verify_cache (gnutls_x509_trust_list_t list,
+                                               unsigned int max_entries);
+
   /* trust list convenience functions */
 int
 gnutls_x509_trust_list_add_trust_mem(gnutls_x509_trust_list_t list,
@@ -1088,6 +1091,10 @@ gnutls_x509_trust_list_add_trust_file(gnutls_x509_trust_list_t list,
 int
 gnutls_x509_trust_list_add_system_trust(gnutls_x509_trust_list_t list,
                                         unsigned int tl_flags, unsigned int tl_vflags);
+
+  int gnutls_certificate_set_trust_list (gnutls_certificate_credentials_t res,
+                                         gnutls_x509_trust_list_t tlist,
+                                         unsigned flags);
 #ifdef __cplusplus
 }
 #endif
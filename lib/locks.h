@@ -31,4 +31,13 @@ extern mutex_deinit_func gnutls_mutex_deinit;
 extern mutex_lock_func gnutls_mutex_lock;
 extern mutex_unlock_func gnutls_mutex_unlock;
 
+/* A full memory barrier. Data initialized on first use are published
+ * after it, so that they can be read without a lock; without it the
+ * readers take the lock.
+ */
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4)
+# define HAVE_MEMORY_BARRIER
+# define gnutls_memory_barrier() __sync_synchronize ()
+#endif
+
 #endif
@@ -368,6 +368,24 @@ wrap_nettle_cipher_close (void *h)
   gnutls_free (h);
 }
 
+static int
+wrap_nettle_cipher_copy (void **_dst, const void *_src)
+{
+  const struct nettle_cipher_ctx *src = _src;
+  struct nettle_cipher_ctx *dst;
+
+  dst = gnutls_malloc (sizeof (*dst));
+  if (dst == NULL)
+    return gnutls_assert_val(GNUTLS_E_MEMORY_ERROR);
+
+  memcpy (dst, src, sizeof (*dst));
+  /* ctx_ptr points within the structure */
+  dst->ctx_ptr = (uint8_t *) dst + ((uint8_t *) src->ctx_ptr - (uint8_t *) src);
+
+  *_dst = dst;
+  return 0;
+}
+
 gnutls_crypto_cipher_st _gnutls_cipher_ops = {
   .init = wrap_nettle_cipher_init,
   .exists = wrap_nettle_cipher_exists,
@@ -376,6 +394,7 @@ gnutls_crypto_cipher_st _gnutls_cipher_ops = {
   .encrypt = wrap_nettle_cipher_encrypt,
   .decrypt = wrap_nettle_cipher_decrypt,
   .deinit = wrap_nettle_cipher_close,
+  .copy = wrap_nettle_cipher_copy,
   .auth = wrap_nettle_cipher_auth,
   .tag = wrap_nettle_cipher_tag,
 };
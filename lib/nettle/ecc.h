@@ -153,6 +153,15 @@ int ecc_mulmod_cached (mpz_t k, gnutls_ecc_curve_t id, ecc_point * R, mpz_t a, m
 int ecc_mulmod_cached_timing (mpz_t k, gnutls_ecc_curve_t id, ecc_point * R, mpz_t a, mpz_t modulus, int map);
 int ecc_mulmod_cached_lookup (mpz_t k, ecc_point *G, ecc_point *R, mpz_t a, mpz_t modulus, int map);
 
+/* wMNAF tables of an arbitrary point */
+int ecc_wmnaf_precompute (ecc_point * G, ecc_point ** pos, ecc_point ** neg, mpz_t a, mpz_t modulus);
+int ecc_mulmod_wmnaf_table (mpz_t k, ecc_point ** pos, ecc_point ** neg, ecc_point * R, mpz_t a, mpz_t modulus, int map);
+
+/* LRU cache of wMNAF tables of public keys */
+int  ecc_pubkey_cache_init(void);
+void ecc_pubkey_cache_free(void);
+int ecc_mulmod_pubkey_cached (mpz_t k, ecc_point * Q, gnutls_ecc_curve_t id, ecc_point * R, mpz_t a, mpz_t modulus, int map);
+
 /* check if the given point is neutral point */
 int ecc_projective_isneutral(ecc_point *P, mpz_t modulus);
 
@@ -22,7 +22,9 @@
 
 /* needed for gnutls_* types */
 #include <gnutls_int.h>
+#include <gnutls_errors.h>
 #include <algorithms.h>
+#include <locks.h>
 
 #include "ecc.h"
 
@@ -40,8 +42,17 @@ typedef struct
   ecc_point *neg[WMNAF_PRECOMPUTED_LENGTH];
 } gnutls_ecc_curve_cache_entry_t;
 
-/* global cache */
-static gnutls_ecc_curve_cache_entry_t *ecc_wmnaf_cache = NULL;
+/* global cache, indexed by curve id - 1. An entry is
+ * built on the first multiplication on its curve, so that
+ * gnutls_global_init() does not pay for curves that are never used.
+ * The entries are only accessed with the lock held; it is cheap
+ * compared to the multiplication.
+ */
+static gnutls_ecc_curve_cache_entry_t ecc_wmnaf_cache[MAX_ALGOS];
+static void *ecc_wmnaf_cache_mutex = NULL;
+
+#define WMNAF_CACHE_LOCK if (gnutls_mutex_lock(&ecc_wmnaf_cache_mutex)!=0) abort()
+#define WMNAF_CACHE_UNLOCK if (gnutls_mutex_unlock(&ecc_wmnaf_cache_mutex)!=0) abort()
 
 /* free single cache entry */
 static void
@@ -53,24 +64,111 @@ _ecc_wmnaf_cache_entry_free (gnutls_ecc_curve_cache_entry_t * p)
     {
       ecc_del_point (p->pos[i]);
       ecc_del_point (p->neg[i]);
+      p->pos[i] = p->neg[i] = NULL;
     }
+  p->id = GNUTLS_ECC_CURVE_INVALID;
 }
 
 /* free curves caches */
 void
 ecc_wmnaf_cache_free (void)
 {
-  gnutls_ecc_curve_cache_entry_t *p = ecc_wmnaf_cache;
-  if (p)
+  int i;
+
+  if (ecc_wmnaf_cache_mutex == NULL)
+    return;
+
+  for (i = 0; i < MAX_ALGOS; ++i)
+    {
+      if (ecc_wmnaf_cache[i].id != GNUTLS_ECC_CURVE_INVALID)
+        _ecc_wmnaf_cache_entry_free (&ecc_wmnaf_cache[i]);
+    }
+
+  gnutls_mutex_deinit (&ecc_wmnaf_cache_mutex);
+  ecc_wmnaf_cache_mutex = NULL;
+}
+
+/* allocate and fill in the wMNAF tables of the given
+ * affine point G (z == 1).
+ *
+ * pos holds kG for k ==  1, 3, 5, ..., (2^w - 1)
+ * neg holds kG for k == -1,-3,-5, ...,-(2^w - 1)
+ *
+ * All the table points are mapped to affine, so that
+ * they can be used with ecc_projective_madd().
+ */
+int
+ecc_wmnaf_precompute (ecc_point * G, ecc_point ** pos, ecc_point ** neg,
+                      mpz_t a, mpz_t modulus)
+{
+  int i, j, err;
+
+  /* alloc ram for precomputed values */
+  for (i = 0; i < WMNAF_PRECOMPUTED_LENGTH; ++i)
     {
-      for (; p->id != GNUTLS_ECC_CURVE_INVALID; ++p)
+      pos[i] = ecc_new_point ();
+      neg[i] = ecc_new_point ();
+      if (pos[i] == NULL || neg[i] == NULL)
         {
-          _ecc_wmnaf_cache_entry_free (p);
+          ecc_del_point (pos[i]);
+          ecc_del_point (neg[i]);
+          for (j = 0; j < i; ++j)
+            {
+              ecc_del_point (pos[j]);
+              ecc_del_point (neg[j]);
+            }
+
+          return GNUTLS_E_MEMORY_ERROR;
         }
+    }
+
+  /* pos[0] == 2G for a while, later it will be set to the expected 1G */
+  if ((err = ecc_projective_dbl_point (G, pos[0], a, modulus)) != 0)
+    goto fail;
 
-      free (ecc_wmnaf_cache);
-      ecc_wmnaf_cache = NULL;
+  /* pos[1] == 3G */
+  if ((err =
+       ecc_projective_add_point (pos[0], G, pos[1], a, modulus)) != 0)
+    goto fail;
+
+  /* fill in kG for k = 5, 7, ..., (2^w - 1) */
+  for (j = 2; j < WMNAF_PRECOMPUTED_LENGTH; ++j)
+    {
+      if ((err =
+           ecc_projective_add_point (pos[j - 1], pos[0], pos[j],
+                                        a, modulus)) != 0)
+        goto fail;
     }
+
+  /* set pos[0] == 1G as expected
+   * after this step we don't need G at all */
+  mpz_set (pos[0]->x, G->x);
+  mpz_set (pos[0]->y, G->y);
+  mpz_set (pos[0]->z, G->z);
+
+  /* map to affine all elements in pos
+   * this will allow to use ecc_projective_madd later
+   * set neg[i] == -pos[i] */
+  for (j = 0; j < WMNAF_PRECOMPUTED_LENGTH; ++j)
+    {
+      if ((err = ecc_map (pos[j], modulus)) != 0)
+        goto fail;
+
+      if ((err =
+           ecc_projective_negate_point (pos[j], neg[j], modulus)) != 0)
+        goto fail;
+    }
+
+  return 0;
+
+fail:
+  for (j = 0; j < WMNAF_PRECOMPUTED_LENGTH; ++j)
+    {
+      ecc_del_point (pos[j]);
+      ecc_del_point (neg[j]);
+      pos[j] = neg[j] = NULL;
+    }
+  return err;
 }
 
 /* initialize single cache entry
@@ -79,7 +177,7 @@ static int
 _ecc_wmnaf_cache_entry_init (gnutls_ecc_curve_cache_entry_t * p,
                              gnutls_ecc_curve_t id)
 {
-  int i, j, err;
+  int err;
   ecc_point *G;
   mpz_t a, modulus;
 
@@ -97,15 +195,15 @@ _ecc_wmnaf_cache_entry_init (gnutls_ecc_curve_cache_entry_t * p,
   st = _gnutls_ecc_curve_get_params (id);
   if (st == NULL)
     {
-      err = GNUTLS_E_INTERNAL_ERROR;
-      goto done;
+      ecc_del_point (G);
+      return GNUTLS_E_INTERNAL_ERROR;
     }
 
-  if ((err = mp_init_multi (&a, &modulus, NULL) != 0))
-    return err;
-
-  /* set id */
-  p->id = id;
+  if ((err = mp_init_multi (&a, &modulus, NULL)) != 0)
+    {
+      ecc_del_point (G);
+      return err;
+    }
 
   /* set modulus */
   mpz_set_str (modulus, st->prime, 16);
@@ -118,125 +216,83 @@ _ecc_wmnaf_cache_entry_init (gnutls_ecc_curve_cache_entry_t * p,
   /* set A */
   mpz_set_str (a, st->A, 16);
 
-  /* alloc ram for precomputed values */
-  for (i = 0; i < WMNAF_PRECOMPUTED_LENGTH; ++i)
-    {
-      p->pos[i] = ecc_new_point ();
-      p->neg[i] = ecc_new_point ();
-      if (p->pos[i] == NULL || p->neg[i] == NULL)
-        {
-          for (j = 0; j < i; ++j)
-            {
-              ecc_del_point (p->pos[j]);
-              ecc_del_point (p->neg[j]);
-            }
-
-          err = GNUTLS_E_MEMORY_ERROR;
-          goto done;
-        }
-    }
-
-  /* fill in pos and neg arrays with precomputed values
-   * pos holds kG for k ==  1, 3, 5, ..., (2^w - 1)
-   * neg holds kG for k == -1,-3,-5, ...,-(2^w - 1)
-   */
-
-  /* pos[0] == 2G for a while, later it will be set to the expected 1G */
-  if ((err = ecc_projective_dbl_point (G, p->pos[0], a, modulus)) != 0)
-    goto done;
-
-  /* pos[1] == 3G */
-  if ((err =
-       ecc_projective_add_point (p->pos[0], G, p->pos[1], a,
-                                    modulus)) != 0)
-    goto done;
-
-  /* fill in kG for k = 5, 7, ..., (2^w - 1) */
-  for (j = 2; j < WMNAF_PRECOMPUTED_LENGTH; ++j)
-    {
-      if ((err =
-           ecc_projective_add_point (p->pos[j - 1], p->pos[0], p->pos[j],
-                                        a, modulus)) != 0)
-        goto done;
-    }
+  err = ecc_wmnaf_precompute (G, p->pos, p->neg, a, modulus);
 
-  /* set pos[0] == 1G as expected
-   * after this step we don't need G at all */
-  mpz_set (p->pos[0]->x, G->x);
-  mpz_set (p->pos[0]->y, G->y);
-  mpz_set (p->pos[0]->z, G->z);
+  ecc_del_point (G);
+  mp_clear_multi (&a, &modulus, NULL);
 
-  /* map to affine all elements in pos
-   * this will allow to use ecc_projective_madd later
-   * set neg[i] == -pos[i] */
-  for (j = 0; j < WMNAF_PRECOMPUTED_LENGTH; ++j)
+  if (err == 0)
     {
-      if ((err = ecc_map (p->pos[j], modulus)) != 0)
-        goto done;
-
-      if ((err =
-           ecc_projective_negate_point (p->pos[j], p->neg[j], modulus)) != 0)
-        goto done;
+      /* publish the tables; readers check the id without the lock */
+#ifdef HAVE_MEMORY_BARRIER
+      gnutls_memory_barrier ();
+#endif
+      *(gnutls_ecc_curve_t volatile *) &p->id = id;
     }
 
-  err = 0;
-done:
-  ecc_del_point (G);
-  mp_clear_multi (&a, &modulus, NULL);
-
   return err;
 }
 
-/* initialize curves caches */
+/* initialize curves caches; the tables themselves are
+ * computed on first use by _ecc_wmnaf_cache_get() */
 int
 ecc_wmnaf_cache_init (void)
 {
-  int j, err;
+  int ret;
 
-  gnutls_ecc_curve_cache_entry_t *ret;
+  memset (ecc_wmnaf_cache, 0, sizeof (ecc_wmnaf_cache));
 
-  const gnutls_ecc_curve_t *p;
+  ret = gnutls_mutex_init (&ecc_wmnaf_cache_mutex);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
 
-  ret = (gnutls_ecc_curve_cache_entry_t *)
-    malloc (MAX_ALGOS * sizeof (gnutls_ecc_curve_cache_entry_t));
-  if (ret == NULL)
-    return GNUTLS_E_MEMORY_ERROR;
+  return 0;
+}
+
+/* returns the cache entry of the given curve, computing
+ * its tables if this is the first use, or NULL on error */
+static gnutls_ecc_curve_cache_entry_t *
+_ecc_wmnaf_cache_get (gnutls_ecc_curve_t id)
+{
+  gnutls_ecc_curve_cache_entry_t *p;
+  int err;
+
+  if (id <= 0 || id > MAX_ALGOS || ecc_wmnaf_cache_mutex == NULL)
+    return NULL;
 
-  /* get supported curves' ids */
-  p = gnutls_ecc_curve_list ();
+  p = &ecc_wmnaf_cache[id - 1];
 
-  for (j = 0; *p; ++p, ++j)
+#ifdef HAVE_MEMORY_BARRIER
+  /* computed tables are not modified until the cache is deinitialized */
+  if (*(gnutls_ecc_curve_t volatile *) &p->id == id)
     {
-      if ((err = _ecc_wmnaf_cache_entry_init (ret + *p - 1, *p)) != 0)
-        goto done;
+      gnutls_memory_barrier ();
+      return p;
     }
+#endif
 
-  /* nullify last cache entry id */
-  ret[j].id = GNUTLS_ECC_CURVE_INVALID;
-
-  err = GNUTLS_E_SUCCESS;
-
-  ecc_wmnaf_cache = ret;
-done:
-  if (err)
+  WMNAF_CACHE_LOCK;
+  if (p->id != id)
     {
-      int i;
-      for (i = 0; i < j; ++i)
+      err = _ecc_wmnaf_cache_entry_init (p, id);
+      if (err < 0)
         {
-          _ecc_wmnaf_cache_entry_free (ret + i);
+          gnutls_assert ();
+          p = NULL;
         }
-
-      free (ret);
-      ecc_wmnaf_cache = NULL;
+      else
+        _gnutls_debug_log ("ECC: computed wMNAF tables for curve %d\n", id);
     }
-  return err;
-}
+  WMNAF_CACHE_UNLOCK;
 
+  return p;
+}
 
 /*
-   Perform a point wMNAF-multiplication utilizing cache
+   Perform a point wMNAF-multiplication utilizing precomputed tables
    @param k    The scalar to multiply by
-   @param id   The curve's id
+   @param pos  The precomputed positive multipliers of the base point (affine)
+   @param neg  The precomputed negative multipliers of the base point (affine)
    @param R    [out] Destination for kG
    @param a        The curve's A value
    @param modulus  The modulus of the field the ECC curve is in
@@ -244,17 +300,16 @@ done:
    @return     GNUTLS_E_SUCCESS on success
 */
 int
-ecc_mulmod_cached (mpz_t k, gnutls_ecc_curve_t id, ecc_point * R,
-                         mpz_t a, mpz_t modulus, int map)
+ecc_mulmod_wmnaf_table (mpz_t k, ecc_point ** pos, ecc_point ** neg,
+                        ecc_point * R, mpz_t a, mpz_t modulus, int map)
 {
   int j, err;
 
-  gnutls_ecc_curve_cache_entry_t *cache = NULL;
   signed char *wmnaf = NULL;
   size_t wmnaf_len;
   signed char digit;
 
-  if (k == NULL || R == NULL || modulus == NULL || id == 0)
+  if (k == NULL || R == NULL || modulus == NULL)
     return GNUTLS_E_RECEIVED_ILLEGAL_PARAMETER;
 
   /* calculate wMNAF */
@@ -270,9 +325,6 @@ ecc_mulmod_cached (mpz_t k, gnutls_ecc_curve_t id, ecc_point * R,
   mpz_set_ui (R->y, 1);
   mpz_set_ui (R->z, 0);
 
-  /* do cache lookup */
-  cache = ecc_wmnaf_cache + id - 1;
-
   /* perform ops */
   for (j = wmnaf_len - 1; j >= 0; --j)
     {
@@ -286,14 +338,14 @@ ecc_mulmod_cached (mpz_t k, gnutls_ecc_curve_t id, ecc_point * R,
           if (digit > 0)
             {
               if ((err =
-                   ecc_projective_madd (R, cache->pos[(digit / 2)], R, a,
+                   ecc_projective_madd (R, pos[(digit / 2)], R, a,
                                         modulus)) != 0)
                 goto done;
             }
           else
             {
               if ((err =
-                   ecc_projective_madd (R, cache->neg[(-digit / 2)], R, a,
+                   ecc_projective_madd (R, neg[(-digit / 2)], R, a,
                                         modulus)) != 0)
                 goto done;
             }
@@ -316,6 +368,34 @@ done:
   return err;
 }
 
+/*
+   Perform a point wMNAF-multiplication utilizing cache
+   @param k    The scalar to multiply by
+   @param id   The curve's id
+   @param R    [out] Destination for kG
+   @param a        The curve's A value
+   @param modulus  The modulus of the field the ECC curve is in
+   @param map      Boolean whether to map back to affine or not (1 == map, 0 == leave in projective)
+   @return     GNUTLS_E_SUCCESS on success
+*/
+int
+ecc_mulmod_cached (mpz_t k, gnutls_ecc_curve_t id, ecc_point * R,
+                         mpz_t a, mpz_t modulus, int map)
+{
+  gnutls_ecc_curve_cache_entry_t *cache = NULL;
+
+  if (k == NULL || R == NULL || modulus == NULL || id == 0)
+    return GNUTLS_E_RECEIVED_ILLEGAL_PARAMETER;
+
+  /* do cache lookup */
+  cache = _ecc_wmnaf_cache_get (id);
+  if (cache == NULL)
+    return GNUTLS_E_MEMORY_ERROR;
+
+  return ecc_mulmod_wmnaf_table (k, cache->pos, cache->neg, R, a, modulus,
+                                 map);
+}
+
 /*
    Perform a point wMNAF-multiplication utilizing cache
    This version tries to be timing resistant
@@ -367,7 +447,12 @@ ecc_mulmod_cached_timing (mpz_t k, gnutls_ecc_curve_t id, ecc_point * R,
   mpz_set_ui (T->z, 0);
 
   /* do cache lookup */
-  cache = ecc_wmnaf_cache + id - 1;
+  cache = _ecc_wmnaf_cache_get (id);
+  if (cache == NULL)
+    {
+      err = GNUTLS_E_MEMORY_ERROR;
+      goto done;
+    }
 
   /* perform ops */
   for (j = wmnaf_len - 1; j >= 0; --j)
@@ -440,19 +525,34 @@ int
 ecc_mulmod_cached_lookup (mpz_t k, ecc_point * G, ecc_point * R,
                                 mpz_t a, mpz_t modulus, int map)
 {
-  int i, id;
+  int id, err;
+  mpz_t gx, gy;
+  const gnutls_ecc_curve_entry_st *st;
 
   if (k == NULL || G == NULL || R == NULL || modulus == NULL)
     return GNUTLS_E_RECEIVED_ILLEGAL_PARAMETER;
 
-  for (i = 0; (id = ecc_wmnaf_cache[i].id); ++i)
+  /* compare against the curve parameters rather than the cached
+   * tables, which may not have been computed yet */
+  if ((err = mp_init_multi (&gx, &gy, NULL)) != 0)
+    return err;
+
+  for (id = 1; id <= MAX_ALGOS; ++id)
     {
-      if (!(mpz_cmp (G->x, ecc_wmnaf_cache[i].pos[0]->x)) &&
-          !(mpz_cmp (G->y, ecc_wmnaf_cache[i].pos[0]->y)))
-        {
-          break;
-        }
+      st = _gnutls_ecc_curve_get_params (id);
+      if (st == NULL)
+        continue;
+
+      if (mpz_set_str (gx, st->Gx, 16) == 0 &&
+          mpz_set_str (gy, st->Gy, 16) == 0 &&
+          !(mpz_cmp (G->x, gx)) && !(mpz_cmp (G->y, gy)))
+        break;
     }
 
+  mp_clear_multi (&gx, &gy, NULL);
+
+  if (id > MAX_ALGOS)
+    return ecc_mulmod (k, G, R, a, modulus, map);
+
   return ecc_mulmod_cached (k, id, R, a, modulus, map);
 }
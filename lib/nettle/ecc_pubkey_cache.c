@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GNUTLS.
+ *
+ * The GNUTLS library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/* This file contains a bounded LRU cache of wMNAF tables for
+ * public key points. Signature verification computes u2*Q for
+ * the signer's key Q, and in most deployments the same few (CA)
+ * keys verify the majority of signatures. Keeping the precomputed
+ * multiples of Q around avoids recomputing them on every verification.
+ */
+
+#include <gnutls_int.h>
+#include <gnutls_errors.h>
+#include <locks.h>
+#include <gnutls/crypto.h>
+
+#include "ecc.h"
+
+/* maximum number of public key tables kept */
+#define ECC_PUBKEY_CACHE_SIZE 32
+
+typedef struct
+{
+  /* curve's id; GNUTLS_ECC_CURVE_INVALID if the slot is empty */
+  gnutls_ecc_curve_t id;
+
+  /* affine coordinates of the public key */
+  mpz_t x;
+  mpz_t y;
+
+  ecc_point *pos[WMNAF_PRECOMPUTED_LENGTH];
+  ecc_point *neg[WMNAF_PRECOMPUTED_LENGTH];
+
+  /* number of threads currently using the tables */
+  unsigned int users;
+
+  /* LRU stamp */
+  unsigned long last_used;
+} ecc_pubkey_cache_entry_t;
+
+static ecc_pubkey_cache_entry_t ecc_pubkey_cache[ECC_PUBKEY_CACHE_SIZE];
+static unsigned long ecc_pubkey_cache_clock = 0;
+static void *ecc_pubkey_cache_mutex = NULL;
+
+static unsigned int ecc_pubkey_cache_hits = 0;
+static unsigned int ecc_pubkey_cache_misses = 0;
+static unsigned int ecc_pubkey_cache_evictions = 0;
+
+#define CACHE_LOCK if (gnutls_mutex_lock(&ecc_pubkey_cache_mutex)!=0) abort()
+#define CACHE_UNLOCK if (gnutls_mutex_unlock(&ecc_pubkey_cache_mutex)!=0) abort()
+
+static void
+_ecc_pubkey_tables_free (ecc_point ** pos, ecc_point ** neg)
+{
+  int i;
+
+  for (i = 0; i < WMNAF_PRECOMPUTED_LENGTH; ++i)
+    {
+      ecc_del_point (pos[i]);
+      ecc_del_point (neg[i]);
+      pos[i] = neg[i] = NULL;
+    }
+}
+
+static void
+_ecc_pubkey_cache_entry_clear (ecc_pubkey_cache_entry_t * e)
+{
+  if (e->id == GNUTLS_ECC_CURVE_INVALID)
+    return;
+
+  _ecc_pubkey_tables_free (e->pos, e->neg);
+  mp_clear_multi (&e->x, &e->y, NULL);
+  e->id = GNUTLS_ECC_CURVE_INVALID;
+  e->users = 0;
+  e->last_used = 0;
+}
+
+int
+ecc_pubkey_cache_init (void)
+{
+  int ret;
+
+  memset (ecc_pubkey_cache, 0, sizeof (ecc_pubkey_cache));
+  ecc_pubkey_cache_clock = 0;
+  ecc_pubkey_cache_hits = 0;
+  ecc_pubkey_cache_misses = 0;
+  ecc_pubkey_cache_evictions = 0;
+
+  ret = gnutls_mutex_init (&ecc_pubkey_cache_mutex);
+  if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  return 0;
+}
+
+void
+ecc_pubkey_cache_free (void)
+{
+  int i;
+
+  if (ecc_pubkey_cache_mutex == NULL)
+    return;
+
+  if (ecc_pubkey_cache_hits + ecc_pubkey_cache_misses > 0)
+    _gnutls_debug_log ("ECC public key cache: %u hits, %u misses, %u evictions\n",
+                       ecc_pubkey_cache_hits, ecc_pubkey_cache_misses,
+                       ecc_pubkey_cache_evictions);
+
+  for (i = 0; i < ECC_PUBKEY_CACHE_SIZE; i++)
+    _ecc_pubkey_cache_entry_clear (&ecc_pubkey_cache[i]);
+
+  gnutls_mutex_deinit (&ecc_pubkey_cache_mutex);
+  ecc_pubkey_cache_mutex = NULL;
+}
+
+/* Returns the entry holding the tables of Q, or NULL.
+ * Must be called with the cache lock held.
+ */
+static ecc_pubkey_cache_entry_t *
+_ecc_pubkey_cache_find (ecc_point * Q, gnutls_ecc_curve_t id)
+{
+  int i;
+
+  for (i = 0; i < ECC_PUBKEY_CACHE_SIZE; i++)
+    {
+      if (ecc_pubkey_cache[i].id == id &&
+          mpz_cmp (ecc_pubkey_cache[i].x, Q->x) == 0 &&
+          mpz_cmp (ecc_pubkey_cache[i].y, Q->y) == 0)
+        return &ecc_pubkey_cache[i];
+    }
+
+  return NULL;
+}
+
+/* Stores the given tables for Q, evicting the least recently
+ * used idle entry if needed. On success the tables are owned by
+ * the cache and the returned entry is marked as in use by the caller.
+ * Must be called with the cache lock held.
+ */
+static ecc_pubkey_cache_entry_t *
+_ecc_pubkey_cache_store (ecc_point * Q, gnutls_ecc_curve_t id,
+                         ecc_point ** pos, ecc_point ** neg)
+{
+  ecc_pubkey_cache_entry_t *e = NULL;
+  int i;
+
+  /* another thread may have inserted the same key meanwhile */
+  if (_ecc_pubkey_cache_find (Q, id) != NULL)
+    return NULL;
+
+  for (i = 0; i < ECC_PUBKEY_CACHE_SIZE; i++)
+    {
+      if (ecc_pubkey_cache[i].id == GNUTLS_ECC_CURVE_INVALID)
+        {
+          e = &ecc_pubkey_cache[i];
+          break;
+        }
+
+      if (ecc_pubkey_cache[i].users == 0 &&
+          (e == NULL || ecc_pubkey_cache[i].last_used < e->last_used))
+        e = &ecc_pubkey_cache[i];
+    }
+
+  /* every entry is in use */
+  if (e == NULL)
+    return NULL;
+
+  if (e->id != GNUTLS_ECC_CURVE_INVALID)
+    {
+      _ecc_pubkey_cache_entry_clear (e);
+      ecc_pubkey_cache_evictions++;
+    }
+
+  if (mp_init_multi (&e->x, &e->y, NULL) != 0)
+    return NULL;
+
+  mpz_set (e->x, Q->x);
+  mpz_set (e->y, Q->y);
+  memcpy (e->pos, pos, sizeof (e->pos));
+  memcpy (e->neg, neg, sizeof (e->neg));
+  e->users = 1;
+  e->last_used = ++ecc_pubkey_cache_clock;
+  e->id = id;
+
+  return e;
+}
+
+/*
+   Perform a point wMNAF-multiplication of a public key, utilizing
+   the public key cache.
+   @param k    The scalar to multiply by
+   @param Q    The public key point (affine, z == 1)
+   @param id   The curve's id
+   @param R    [out] Destination for kQ
+   @param a        The curve's A value
+   @param modulus  The modulus of the field the ECC curve is in
+   @param map      Boolean whether to map back to affine or not (1 == map, 0 == leave in projective)
+   @return     GNUTLS_E_SUCCESS on success
+*/
+int
+ecc_mulmod_pubkey_cached (mpz_t k, ecc_point * Q, gnutls_ecc_curve_t id,
+                          ecc_point * R, mpz_t a, mpz_t modulus, int map)
+{
+  ecc_pubkey_cache_entry_t *e;
+  ecc_point *pos[WMNAF_PRECOMPUTED_LENGTH], *neg[WMNAF_PRECOMPUTED_LENGTH];
+  int err;
+
+  if (k == NULL || Q == NULL || R == NULL || modulus == NULL || id == 0)
+    return GNUTLS_E_RECEIVED_ILLEGAL_PARAMETER;
+
+  if (ecc_pubkey_cache_mutex == NULL || mpz_cmp_ui (Q->z, 1) != 0)
+    return ecc_mulmod (k, Q, R, a, modulus, map);
+
+  CACHE_LOCK;
+  e = _ecc_pubkey_cache_find (Q, id);
+  if (e != NULL)
+    {
+      e->users++;
+      e->last_used = ++ecc_pubkey_cache_clock;
+      ecc_pubkey_cache_hits++;
+    }
+  else
+    ecc_pubkey_cache_misses++;
+  CACHE_UNLOCK;
+
+  if (e != NULL)
+    {
+      /* the tables are immutable while users > 0 */
+      err = ecc_mulmod_wmnaf_table (k, e->pos, e->neg, R, a, modulus, map);
+
+      CACHE_LOCK;
+      e->users--;
+      CACHE_UNLOCK;
+
+      return err;
+    }
+
+  /* miss; compute the tables outside the lock. They are stored
+   * before the multiplication because R may be the same point as Q. */
+  err = ecc_wmnaf_precompute (Q, pos, neg, a, modulus);
+  if (err != 0)
+    return err;
+
+  CACHE_LOCK;
+  e = _ecc_pubkey_cache_store (Q, id, pos, neg);
+  CACHE_UNLOCK;
+
+  err = ecc_mulmod_wmnaf_table (k, pos, neg, R, a, modulus, map);
+
+  if (e != NULL)
+    {
+      CACHE_LOCK;
+      e->users--;
+      CACHE_UNLOCK;
+    }
+  else
+    _ecc_pubkey_tables_free (pos, neg);
+
+  return err;
+}
+
+/**
+ * gnutls_ecc_pubkey_cache_get_stats:
+ * @hits: will hold the number of verifications that used a cached table
+ * @misses: will hold the number of verifications that computed a new table
+ * @evictions: will hold the number of tables dropped to make room
+ *
+ * This function reports the statistics of the internal cache
+ * of precomputed ECDSA public key tables. Any of the arguments
+ * may be %NULL. The counters are reset by gnutls_global_init().
+ *
+ * Since: 3.1.6
+ **/
+void
+gnutls_ecc_pubkey_cache_get_stats (unsigned int *hits, unsigned int *misses,
+                                   unsigned int *evictions)
+{
+  unsigned int h, m, e;
+
+  if (ecc_pubkey_cache_mutex == NULL)
+    h = m = e = 0;
+  else
+    {
+      CACHE_LOCK;
+      h = ecc_pubkey_cache_hits;
+      m = ecc_pubkey_cache_misses;
+      e = ecc_pubkey_cache_evictions;
+      CACHE_UNLOCK;
+    }
+
+  if (hits)
+    *hits = h;
+  if (misses)
+    *misses = m;
+  if (evictions)
+    *evictions = e;
+}
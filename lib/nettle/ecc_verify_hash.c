@@ -116,7 +116,7 @@ ecc_verify_hash (struct dsa_signature *signature,
     {
       goto error;
     }
-  if ((err = ecc_mulmod (u2, mQ, mQ, key->A, key->prime, 0)) != 0)
+  if ((err = ecc_mulmod_pubkey_cached (u2, mQ, curve_id, mQ, key->A, key->prime, 0)) != 0)
     {
       goto error;
     }
@@ -32,7 +32,20 @@
 int
 gnutls_crypto_init (void)
 {
-  return ecc_wmnaf_cache_init();
+  int ret;
+
+  ret = ecc_wmnaf_cache_init();
+  if (ret < 0)
+    return ret;
+
+  ret = ecc_pubkey_cache_init();
+  if (ret < 0)
+    {
+      ecc_wmnaf_cache_free();
+      return ret;
+    }
+
+  return 0;
 }
 
 /* Functions that refer to the deinitialization of the nettle library.
@@ -41,5 +54,6 @@ gnutls_crypto_init (void)
 void
 gnutls_crypto_deinit (void)
 {
+  ecc_pubkey_cache_free();
   ecc_wmnaf_cache_free();
 }
@@ -256,6 +256,24 @@ wrap_nettle_hmac_deinit (void *hd)
   gnutls_free (hd);
 }
 
+static int
+wrap_nettle_hmac_copy (void **_dst, const void *_src)
+{
+  const struct nettle_hmac_ctx *src = _src;
+  struct nettle_hmac_ctx *dst;
+
+  dst = gnutls_malloc (sizeof (*dst));
+  if (dst == NULL)
+    return gnutls_assert_val(GNUTLS_E_MEMORY_ERROR);
+
+  memcpy (dst, src, sizeof (*dst));
+  /* ctx_ptr points within the structure */
+  dst->ctx_ptr = (uint8_t *) dst + ((uint8_t *) src->ctx_ptr - (uint8_t *) src);
+
+  *_dst = dst;
+  return 0;
+}
+
 /* Hash functions 
  */
 static int
@@ -430,6 +448,7 @@ gnutls_crypto_mac_st _gnutls_mac_ops = {
   .reset = wrap_nettle_hmac_reset,
   .output = wrap_nettle_hmac_output,
   .deinit = wrap_nettle_hmac_deinit,
+  .copy = wrap_nettle_hmac_copy,
   .fast = wrap_nettle_hmac_fast,
   .exists = wrap_nettle_hmac_exists,
 };
@@ -244,6 +244,103 @@ cleanup:
   return ret;
 }
 
+/* The private key operations on the nettle structures; they are
+ * shared by the plain and the prepared keys.
+ */
+static int
+_rsa_decrypt_keys (const struct rsa_public_key *pub,
+                   const struct rsa_private_key *priv,
+                   gnutls_datum_t * plaintext,
+                   const gnutls_datum_t * ciphertext)
+{
+  unsigned length;
+  bigint_t c;
+  int ret;
+
+  plaintext->data = NULL;
+
+  if (_gnutls_mpi_scan_nz (&c, ciphertext->data, ciphertext->size) != 0)
+    return gnutls_assert_val (GNUTLS_E_MPI_SCAN_FAILED);
+
+  length = pub->size;
+  plaintext->data = gnutls_malloc (length);
+  if (plaintext->data == NULL)
+    {
+      _gnutls_mpi_release (&c);
+      return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+    }
+
+  /* the padding is checked by nettle, without branching on it */
+  ret = rsa_decrypt_tr (pub, priv, NULL, rnd_func, &length, plaintext->data,
+                        TOMPZ (c));
+  _gnutls_mpi_release (&c);
+
+  if (ret == 0)
+    {
+      gnutls_free (plaintext->data);
+      plaintext->data = NULL;
+      return gnutls_assert_val (GNUTLS_E_DECRYPTION_FAILED);
+    }
+
+  plaintext->size = length;
+  return 0;
+}
+
+static int
+_rsa_sign_keys (const struct rsa_public_key *pub,
+                const struct rsa_private_key *priv,
+                gnutls_datum_t * signature, const gnutls_datum_t * vdata)
+{
+  mpz_t s;
+  int ret;
+
+  mpz_init (s);
+
+  ret = rsa_pkcs1_sign_tr (pub, priv, NULL, rnd_func,
+                           vdata->size, vdata->data, s);
+  if (ret == 0)
+    {
+      gnutls_assert ();
+      ret = GNUTLS_E_PK_SIGN_FAILED;
+    }
+  else
+    ret = _gnutls_mpi_dprint (s, signature);
+
+  mpz_clear (s);
+  return ret;
+}
+
+static int
+_ecdsa_sign_key (ecc_key * priv, int curve_id, unsigned int hash,
+                 unsigned int hash_len, gnutls_datum_t * signature,
+                 const gnutls_datum_t * vdata)
+{
+  struct dsa_signature sig;
+  int ret;
+
+  if (hash_len > vdata->size)
+    {
+      gnutls_assert ();
+      _gnutls_debug_log("Security level of algorithm requires hash %s(%d) or better\n", gnutls_mac_get_name(hash), hash_len);
+      hash_len = vdata->size;
+    }
+
+  dsa_signature_init (&sig);
+
+  ret = ecc_sign_hash (vdata->data, hash_len,
+                       &sig, NULL, rnd_func, priv, curve_id);
+  if (ret != 0)
+    {
+      gnutls_assert ();
+      ret = GNUTLS_E_PK_SIGN_FAILED;
+    }
+  else
+    ret = _gnutls_encode_ber_rs (signature, &sig.r, &sig.s);
+
+  dsa_signature_clear (&sig);
+  return ret;
+}
+
 static int
 _wrap_nettle_pk_decrypt (gnutls_pk_algorithm_t algo,
                          gnutls_datum_t * plaintext,
@@ -261,34 +358,14 @@ _wrap_nettle_pk_decrypt (gnutls_pk_algorithm_t algo,
       {
         struct rsa_private_key priv;
         struct rsa_public_key pub;
-        unsigned length;
-        bigint_t c;
 
         _rsa_params_to_privkey (pk_params, &priv);
         _rsa_params_to_pubkey (pk_params, &pub);
 
-        if (_gnutls_mpi_scan_nz (&c, ciphertext->data, ciphertext->size) != 0)
-          {
-            ret = gnutls_assert_val(GNUTLS_E_MPI_SCAN_FAILED);
-            goto cleanup;
-          }
-
-        length = pub.size;
-        plaintext->data = gnutls_malloc(length);
-        if (plaintext->data == NULL)
-          {
-            ret = gnutls_assert_val(GNUTLS_E_MEMORY_ERROR);
-            goto cleanup;
-          }
-        
-        ret = rsa_decrypt_tr(&pub, &priv, NULL, rnd_func, &length, plaintext->data,
-                             TOMPZ(c));
-        _gnutls_mpi_release (&c);
-        plaintext->size = length;
-
-        if (ret == 0)
+        ret = _rsa_decrypt_keys (&pub, &priv, plaintext, ciphertext);
+        if (ret < 0)
           {
-            ret = gnutls_assert_val(GNUTLS_E_DECRYPTION_FAILED);
+            gnutls_assert ();
             goto cleanup;
           }
 
@@ -326,7 +403,6 @@ _wrap_nettle_pk_sign (gnutls_pk_algorithm_t algo,
     case GNUTLS_PK_EC: /* we do ECDSA */
       {
         ecc_key priv;
-        struct dsa_signature sig;
         int curve_id = pk_params->flags;
 
         if (is_supported_curve(curve_id) == 0)
@@ -334,29 +410,10 @@ _wrap_nettle_pk_sign (gnutls_pk_algorithm_t algo,
 
         _ecc_params_to_privkey(pk_params, &priv);
 
-        dsa_signature_init (&sig);
-
         hash = _gnutls_dsa_q_to_hash (algo, pk_params, &hash_len);
-        if (hash_len > vdata->size)
-          {
-            gnutls_assert ();
-            _gnutls_debug_log("Security level of algorithm requires hash %s(%d) or better\n", gnutls_mac_get_name(hash), hash_len);
-            hash_len = vdata->size;
-          }
 
-        ret = ecc_sign_hash(vdata->data, hash_len,
-                            &sig, NULL, rnd_func, &priv, curve_id);
-        if (ret != 0)
-          {
-            gnutls_assert ();
-            ret = GNUTLS_E_PK_SIGN_FAILED;
-            goto ecdsa_fail;
-          }
-
-        ret = _gnutls_encode_ber_rs (signature, &sig.r, &sig.s);
-
-      ecdsa_fail:
-        dsa_signature_clear (&sig);
+        ret = _ecdsa_sign_key (&priv, curve_id, hash, hash_len,
+                               signature, vdata);
         _ecc_params_clear( &priv);
 
         if (ret < 0)
@@ -413,27 +470,11 @@ _wrap_nettle_pk_sign (gnutls_pk_algorithm_t algo,
       {
         struct rsa_private_key priv;
         struct rsa_public_key pub;
-        mpz_t s;
 
         _rsa_params_to_privkey (pk_params, &priv);
         _rsa_params_to_pubkey (pk_params, &pub);
-        
-        mpz_init(s);
-
-        ret = rsa_pkcs1_sign_tr(&pub, &priv, NULL, rnd_func,
-                                vdata->size, vdata->data, s);
-        if (ret == 0)
-          {
-            gnutls_assert();
-            ret = GNUTLS_E_PK_SIGN_FAILED;
-            goto rsa_fail;
-          }
-
-        ret = _gnutls_mpi_dprint (s, signature);
-
-rsa_fail:
-        mpz_clear(s);
 
+        ret = _rsa_sign_keys (&pub, &priv, signature, vdata);
         if (ret < 0)
           {
             gnutls_assert ();
@@ -1131,6 +1172,133 @@ cleanup:
 }
 
 
+/* Prepared keys. The nettle structures of a private key are set up
+ * once, so that the private key operations do not repeat the
+ * conversion. The prepared key holds its own copy of the parameters,
+ * so it does not depend on the lifetime of the key it was prepared
+ * from. Nettle still computes the blinding factor and the modular
+ * exponentiation from scratch on every operation.
+ */
+
+struct nettle_prepared_st
+{
+  gnutls_pk_algorithm_t algo;
+  gnutls_pk_params_st params;
+
+  union
+  {
+    struct
+    {
+      struct rsa_public_key pub;
+      struct rsa_private_key priv;
+    } rsa;
+    struct
+    {
+      ecc_key key;
+      int curve;
+      unsigned int hash_len;
+      unsigned int hash;
+    } ecc;
+  } k;
+};
+
+static void
+_wrap_nettle_pk_prepared_deinit (void *_p)
+{
+  struct nettle_prepared_st *p = _p;
+
+  if (p->algo == GNUTLS_PK_EC)
+    _ecc_params_clear (&p->k.ecc.key);
+
+  gnutls_pk_params_release (&p->params);
+  gnutls_free (p);
+}
+
+static int
+_wrap_nettle_pk_prepare (gnutls_pk_algorithm_t algo,
+                         const gnutls_pk_params_st * pk_params,
+                         void **prepared)
+{
+  struct nettle_prepared_st *p;
+  int ret;
+
+  switch (algo)
+    {
+    case GNUTLS_PK_RSA:
+      if (pk_params->params_nr < RSA_PRIVATE_PARAMS)
+        return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST);
+      break;
+    case GNUTLS_PK_EC:
+      if (pk_params->params_nr < ECC_PRIVATE_PARAMS ||
+          is_supported_curve (pk_params->flags) == 0)
+        return gnutls_assert_val (GNUTLS_E_ECC_UNSUPPORTED_CURVE);
+      break;
+    default:
+      return GNUTLS_E_UNIMPLEMENTED_FEATURE;
+    }
+
+  p = gnutls_calloc (1, sizeof (*p));
+  if (p == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  p->algo = algo;
+
+  ret = _gnutls_pk_params_copy (&p->params, pk_params);
+  if (ret < 0)
+    {
+      gnutls_free (p);
+      return gnutls_assert_val (ret);
+    }
+  p->params.flags = pk_params->flags;
+
+  if (algo == GNUTLS_PK_RSA)
+    {
+      _rsa_params_to_privkey (&p->params, &p->k.rsa.priv);
+      _rsa_params_to_pubkey (&p->params, &p->k.rsa.pub);
+    }
+  else
+    {
+      _ecc_params_to_privkey (&p->params, &p->k.ecc.key);
+      p->k.ecc.curve = p->params.flags;
+      p->k.ecc.hash = _gnutls_dsa_q_to_hash (algo, &p->params,
+                                             &p->k.ecc.hash_len);
+    }
+
+  *prepared = p;
+  return 0;
+}
+
+static int
+_wrap_nettle_pk_prepared_sign (void *_p, gnutls_datum_t * signature,
+                               const gnutls_datum_t * vdata)
+{
+  struct nettle_prepared_st *p = _p;
+
+  switch (p->algo)
+    {
+    case GNUTLS_PK_EC:
+      return _ecdsa_sign_key (&p->k.ecc.key, p->k.ecc.curve, p->k.ecc.hash,
+                              p->k.ecc.hash_len, signature, vdata);
+    case GNUTLS_PK_RSA:
+      return _rsa_sign_keys (&p->k.rsa.pub, &p->k.rsa.priv, signature, vdata);
+    default:
+      return gnutls_assert_val (GNUTLS_E_INTERNAL_ERROR);
+    }
+}
+
+static int
+_wrap_nettle_pk_prepared_decrypt (void *_p, gnutls_datum_t * plaintext,
+                                  const gnutls_datum_t * ciphertext)
+{
+  struct nettle_prepared_st *p = _p;
+
+  if (p->algo != GNUTLS_PK_RSA)
+    return gnutls_assert_val (GNUTLS_E_INTERNAL_ERROR);
+
+  return _rsa_decrypt_keys (&p->k.rsa.pub, &p->k.rsa.priv, plaintext,
+                            ciphertext);
+}
+
 int crypto_pk_prio = INT_MAX;
 
 gnutls_crypto_pk_st _gnutls_pk_ops = {
@@ -1143,4 +1311,8 @@ gnutls_crypto_pk_st _gnutls_pk_ops = {
   .generate = wrap_nettle_pk_generate_params,
   .pk_fixup_private_params = wrap_nettle_pk_fixup,
   .derive = _wrap_nettle_pk_derive,
+  .prepare = _wrap_nettle_pk_prepare,
+  .prepared_deinit = _wrap_nettle_pk_prepared_deinit,
+  .prepared_sign = _wrap_nettle_pk_prepared_sign,
+  .prepared_decrypt = _wrap_nettle_pk_prepared_decrypt,
 };
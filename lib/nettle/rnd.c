@@ -35,6 +35,14 @@
 
 #define SOURCES 2
 
+/* Per-thread generators need thread-local storage and
+ * pthread_atfork() for the fork detection. */
+#if !defined(_WIN32) && defined(HAVE___THREAD) && defined(HAVE_LIBPTHREAD)
+# define THREAD_RND
+# include <pthread.h>
+static void _rnd_thread_free_current (void);
+#endif
+
 #define RND_LOCK if (gnutls_mutex_lock(&rnd_mutex)!=0) abort()
 #define RND_UNLOCK if (gnutls_mutex_unlock(&rnd_mutex)!=0) abort()
 
@@ -159,6 +167,9 @@ wrap_nettle_rnd_deinit (void *ctx)
 #ifdef HAVE_GETRUSAGE
 #include <sys/resource.h>
 #endif
+#ifdef HAVE_GETRANDOM
+#include <sys/random.h>
+#endif
 #include "egd.h"
 
 #define DEVICE_READ_SIZE 16
@@ -288,6 +299,42 @@ do_device_source_urandom (int init)
   return 0;
 }
 
+#ifdef HAVE_GETRANDOM
+static int
+do_device_source_getrandom (int init)
+{
+  time_t now = gnutls_time (NULL);
+  unsigned int read_size = DEVICE_READ_SIZE;
+
+  if (init)
+    read_size = DEVICE_READ_SIZE_MAX; /* initially read more data */
+
+  if (init || ((now - device_last_read) > DEVICE_READ_INTERVAL))
+    {
+      /* More than 20 minutes since we last read the device */
+      uint8_t buf[DEVICE_READ_SIZE_MAX];
+      int res;
+
+      do
+        res = getrandom (buf, read_size, 0);
+      while (res < 0 && errno == EINTR);
+
+      if (res != (int) read_size)
+        {
+          if (res < 0)
+            _gnutls_debug_log ("getrandom failed: %s\n", strerror (errno));
+          return gnutls_assert_val (GNUTLS_E_INTERNAL_ERROR);
+        }
+
+      device_last_read = now;
+      return yarrow256_update (&yctx, RANDOM_SOURCE_DEVICE,
+                               read_size * 8 / 2 /* we trust the RNG */ ,
+                               read_size, buf);
+    }
+  return 0;
+}
+#endif
+
 static int
 do_device_source_egd (int init)
 {
@@ -356,10 +403,18 @@ do_device_source (int init)
   if (init == 1)
     {
       pid = getpid();
+      device_fd = -1;
 
-      do_source = do_device_source_urandom;
+#ifdef HAVE_GETRANDOM
+      do_source = do_device_source_getrandom;
       ret = do_source (init);
       if (ret < 0)
+#endif
+        {
+          do_source = do_device_source_urandom;
+          ret = do_source (init);
+        }
+      if (ret < 0)
         {
           do_source = do_device_source_egd;
           ret = do_source (init);
@@ -396,9 +451,15 @@ static void
 wrap_nettle_rnd_deinit (void *ctx)
 {
   RND_LOCK;
-  close (device_fd);
+  if (device_fd >= 0)
+    close (device_fd);
+  device_fd = -1;
   RND_UNLOCK;
 
+#ifdef THREAD_RND
+  _rnd_thread_free_current ();
+#endif
+
   gnutls_mutex_deinit (&rnd_mutex);
   rnd_mutex = NULL;
 }
@@ -406,68 +467,259 @@ wrap_nettle_rnd_deinit (void *ctx)
 #endif
 
 
+/* Reads from the master generator. Each call stirs the trivia
+ * and device sources, under the global lock.
+ */
 static int
-wrap_nettle_rnd_init (void **ctx)
+_rnd_master (void *data, size_t datasize)
 {
   int ret;
 
-  ret = gnutls_mutex_init (&rnd_mutex);
+  RND_LOCK;
+
+  ret = do_trivia_source (0);
   if (ret < 0)
     {
+      RND_UNLOCK;
       gnutls_assert ();
       return ret;
     }
 
-  yarrow256_init (&yctx, SOURCES, ysources);
-
-  ret = do_device_source (1);
+  ret = do_device_source (0);
   if (ret < 0)
     {
+      RND_UNLOCK;
       gnutls_assert ();
       return ret;
     }
 
-  ret = do_trivia_source (1);
+  yarrow256_random (&yctx, datasize, data);
+  RND_UNLOCK;
+  return 0;
+}
+
+#ifdef THREAD_RND
+
+/* Per-thread generators. Each thread keeps its own yarrow generator,
+ * seeded from the master one. It is re-seeded after THREAD_RESEED_BYTES
+ * of output, and whenever the global generation changes. The generation
+ * is increased on initialization and, through pthread_atfork(), in the
+ * child after a fork, so detecting a fork costs no system call.
+ *
+ * The state is allocated on the first use in a thread, and registered
+ * with a pthread key whose destructor wipes and frees it when the
+ * thread exits. The __thread pointer avoids pthread_getspecific() on
+ * every request.
+ */
+
+/* reseed a thread's generator after that much output */
+#define THREAD_RESEED_BYTES (1 << 20)
+
+/* size of the buffer used for GNUTLS_RND_NONCE requests */
+#define NONCE_BUFFER_SIZE 512
+
+struct thread_rnd_st
+{
+  struct yarrow256_ctx ctx;
+  unsigned int generation;      /* 0 if never seeded */
+  size_t output;
+
+  uint8_t nonce[NONCE_BUFFER_SIZE];
+  unsigned int nonce_left;
+};
+
+static __thread struct thread_rnd_st *thread_rnd;
+static volatile unsigned int rnd_generation = 1;
+
+static pthread_key_t thread_rnd_key;
+static pthread_once_t thread_rnd_key_once = PTHREAD_ONCE_INIT;
+static int thread_rnd_key_ret;
+
+/* runs in the exiting thread */
+static void
+thread_rnd_free (void *p)
+{
+  memset (p, 0, sizeof (struct thread_rnd_st));
+  gnutls_free (p);
+  thread_rnd = NULL;
+}
+
+static void
+thread_rnd_key_init (void)
+{
+  thread_rnd_key_ret = pthread_key_create (&thread_rnd_key, thread_rnd_free);
+}
+
+/* Wipes the state of the calling thread, which may be the main one
+ * whose key destructor never runs. */
+static void
+_rnd_thread_free_current (void)
+{
+  struct thread_rnd_st *t = thread_rnd;
+
+  if (t == NULL)
+    return;
+
+  pthread_setspecific (thread_rnd_key, NULL);
+  thread_rnd_free (t);
+}
+
+static struct thread_rnd_st *
+thread_rnd_get (void)
+{
+  struct thread_rnd_st *t = thread_rnd;
+
+  if (t != NULL)
+    return t;
+
+  t = gnutls_calloc (1, sizeof (*t));
+  if (t == NULL)
+    return NULL;
+
+  if (pthread_setspecific (thread_rnd_key, t) != 0)
+    {
+      gnutls_free (t);
+      return NULL;
+    }
+
+  thread_rnd = t;
+  return t;
+}
+
+static void
+rnd_atfork_child (void)
+{
+  rnd_generation++;
+}
+
+static int
+_rnd_thread_reseed (struct thread_rnd_st *t)
+{
+  uint8_t seed[YARROW256_SEED_FILE_SIZE];
+  int ret;
+
+  ret = _rnd_master (seed, sizeof (seed));
   if (ret < 0)
+    return gnutls_assert_val (ret);
+
+  if (t->generation == 0)
+    yarrow256_init (&t->ctx, 0, NULL);
+
+  yarrow256_seed (&t->ctx, sizeof (seed), seed);
+  memset (seed, 0, sizeof (seed));
+
+  /* buffered nonces may be shared with the parent process */
+  memset (t->nonce, 0, sizeof (t->nonce));
+  t->nonce_left = 0;
+
+  t->output = 0;
+  t->generation = rnd_generation;
+
+  return 0;
+}
+
+static int
+wrap_nettle_rnd (void *_ctx, int level, void *data, size_t datasize)
+{
+  struct thread_rnd_st *t = thread_rnd_get ();
+  int ret;
+
+  if (t == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  if (t->generation != rnd_generation || t->output >= THREAD_RESEED_BYTES)
     {
-      gnutls_assert ();
-      return ret;
+      ret = _rnd_thread_reseed (t);
+      if (ret < 0)
+        return gnutls_assert_val (ret);
     }
 
-  yarrow256_slow_reseed (&yctx);
+  if (level == GNUTLS_RND_NONCE && datasize <= NONCE_BUFFER_SIZE / 4)
+    {
+      if (t->nonce_left < datasize)
+        {
+          yarrow256_random (&t->ctx, sizeof (t->nonce), t->nonce);
+          t->output += sizeof (t->nonce);
+          t->nonce_left = sizeof (t->nonce);
+        }
+
+      /* consume from the end, and wipe what was handed out */
+      t->nonce_left -= datasize;
+      memcpy (data, &t->nonce[t->nonce_left], datasize);
+      memset (&t->nonce[t->nonce_left], 0, datasize);
+      return 0;
+    }
+
+  yarrow256_random (&t->ctx, datasize, data);
+  t->output += datasize;
 
   return 0;
 }
 
+#else
 
 static int
 wrap_nettle_rnd (void *_ctx, int level, void *data, size_t datasize)
+{
+  return _rnd_master (data, datasize);
+}
+
+#endif
+
+static int
+wrap_nettle_rnd_init (void **ctx)
 {
   int ret;
 
-  RND_LOCK;
+  ret = gnutls_mutex_init (&rnd_mutex);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      return ret;
+    }
 
-  ret = do_trivia_source (0);
+  yarrow256_init (&yctx, SOURCES, ysources);
+
+  ret = do_device_source (1);
   if (ret < 0)
     {
-      RND_UNLOCK;
       gnutls_assert ();
       return ret;
     }
 
-  ret = do_device_source (0);
+  ret = do_trivia_source (1);
   if (ret < 0)
     {
-      RND_UNLOCK;
       gnutls_assert ();
       return ret;
     }
 
-  yarrow256_random (&yctx, datasize, data);
-  RND_UNLOCK;
+  yarrow256_slow_reseed (&yctx);
+
+#ifdef THREAD_RND
+  {
+    static int atfork_registered = 0;
+
+    /* force all threads to re-seed from the new master */
+    rnd_generation++;
+
+    pthread_once (&thread_rnd_key_once, thread_rnd_key_init);
+    if (thread_rnd_key_ret != 0)
+      return gnutls_assert_val (GNUTLS_E_INTERNAL_ERROR);
+
+    if (atfork_registered == 0)
+      {
+        if (pthread_atfork (NULL, NULL, rnd_atfork_child) != 0)
+          return gnutls_assert_val (GNUTLS_E_INTERNAL_ERROR);
+        atfork_registered = 1;
+      }
+  }
+#endif
+
   return 0;
 }
 
+
 int crypto_rnd_prio = INT_MAX;
 
 gnutls_crypto_rnd_st _gnutls_rnd_ops = {
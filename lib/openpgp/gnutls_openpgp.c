@@ -156,6 +156,7 @@ gnutls_certificate_set_openpgp_key (gnutls_certificate_credentials_t res,
     }
 
   res->ncerts++;
+  certificate_credentials_index_last (res);
 
   ret = _gnutls_check_key_cert_match (res);
   if (ret < 0)
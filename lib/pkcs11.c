@@ -32,6 +32,7 @@
 
 #include <pin.h>
 #include <pkcs11_int.h>
+#include <locks.h>
 #include <p11-kit/p11-kit.h>
 #include <p11-kit/pin.h>
 
@@ -74,6 +75,12 @@ static struct gnutls_pkcs11_provider_s providers[MAX_PROVIDERS];
 static unsigned int active_providers = 0;
 static unsigned int initialized_registered = 0;
 
+/* gnutls_global_init() only schedules the automatic initialization;
+ * the modules are loaded on the first operation that needs them. */
+static unsigned int auto_init_pending = 0;
+static unsigned int auto_init_done = 0;
+static void *auto_init_mutex = NULL;
+
 gnutls_pkcs11_token_callback_t _gnutls_token_func;
 void *_gnutls_token_data;
 
@@ -522,6 +529,80 @@ initialize_automatic_p11_kit (void)
   return 0;
 }
 
+/* Called by gnutls_global_init() in place of
+ * gnutls_pkcs11_init (GNUTLS_PKCS11_FLAG_AUTO, NULL).
+ */
+void
+_gnutls_pkcs11_auto_init_schedule (void)
+{
+  if (gnutls_mutex_init (&auto_init_mutex) < 0)
+    {
+      /* cannot defer safely; initialize now */
+      gnutls_assert ();
+      if (init == 0 && gnutls_pkcs11_init (GNUTLS_PKCS11_FLAG_AUTO, NULL) >= 0)
+        auto_init_done = 1;
+      return;
+    }
+
+  /* the application may have initialized PKCS #11 itself */
+  if (init == 0)
+    auto_init_pending = 1;
+}
+
+/* Performs the automatic initialization scheduled by
+ * gnutls_global_init(), if it has not been done yet. As with the
+ * former eager initialization, a failure is not fatal; operations
+ * will simply find no tokens.
+ */
+void
+_gnutls_pkcs11_check_init (void)
+{
+  int ret;
+
+  /* the flag is only read with the lock held, so that the modules
+   * loaded by another thread are seen initialized */
+  if (auto_init_mutex == NULL)
+    return;
+
+  if (gnutls_mutex_lock (&auto_init_mutex) != 0)
+    abort ();
+
+  if (auto_init_pending != 0)
+    {
+      auto_init_pending = 0;
+      if (init == 0)
+        {
+          ret = gnutls_pkcs11_init (GNUTLS_PKCS11_FLAG_AUTO, NULL);
+          auto_init_done = 1;
+          if (ret < 0)
+            _gnutls_debug_log ("Cannot initialize PKCS #11 modules: %s\n",
+                               gnutls_strerror (ret));
+        }
+    }
+
+  if (gnutls_mutex_unlock (&auto_init_mutex) != 0)
+    abort ();
+}
+
+/* Undoes _gnutls_pkcs11_auto_init_schedule() on gnutls_global_deinit().
+ */
+void
+_gnutls_pkcs11_auto_deinit (void)
+{
+  auto_init_pending = 0;
+  if (auto_init_done != 0)
+    {
+      auto_init_done = 0;
+      gnutls_pkcs11_deinit ();
+    }
+
+  if (auto_init_mutex != NULL)
+    {
+      gnutls_mutex_deinit (&auto_init_mutex);
+      auto_init_mutex = NULL;
+    }
+}
+
 /**
  * gnutls_pkcs11_init:
  * @flags: %GNUTLS_PKCS11_FLAG_MANUAL or %GNUTLS_PKCS11_FLAG_AUTO
@@ -534,8 +615,9 @@ initialize_automatic_p11_kit (void)
  * if %GNUTLS_PKCS11_FLAG_MANUAL is specified.
  *
  * Normally you don't need to call this function since it is being called
- * by gnutls_global_init() using the %GNUTLS_PKCS11_FLAG_AUTO. If other option
- * is required then it must be called before it.
+ * using the %GNUTLS_PKCS11_FLAG_AUTO on the first PKCS 11 operation
+ * after gnutls_global_init(). If other option is required then it must
+ * be called before any such operation.
  *
  * Returns: On success, %GNUTLS_E_SUCCESS (0) is returned, otherwise a
  *   negative error value.
@@ -547,6 +629,9 @@ gnutls_pkcs11_init (unsigned int flags, const char *deprecated_config_file)
 {
   int ret = 0;
 
+  /* an explicit initialization replaces the automatic one */
+  auto_init_pending = 0;
+
   if (init != 0)
     {
       init++;
@@ -588,6 +673,10 @@ int gnutls_pkcs11_reinit (void)
 {
   int rv;
 
+  /* nothing loaded yet; the child will initialize on first use */
+  if (auto_init_pending != 0)
+    return 0;
+
   rv = p11_kit_initialize_registered ();
   if (rv != CKR_OK)
     {
@@ -870,6 +959,8 @@ pkcs11_find_slot (struct ck_function_list ** module, ck_slot_id_t * slot,
 {
   unsigned int x, z;
 
+  _gnutls_pkcs11_check_init ();
+
   for (x = 0; x < active_providers; x++)
     {
       for (z = 0; z < providers[x].nslots; z++)
@@ -977,6 +1068,8 @@ _pkcs11_traverse_tokens (find_func_t find_func, void *input,
   struct pkcs11_session_info sinfo;
   struct ck_function_list *module = NULL;
 
+  _gnutls_pkcs11_check_init ();
+
   for (x = 0; x < active_providers; x++)
     {
       module = providers[x].module;
@@ -94,6 +94,9 @@ extern gnutls_pkcs11_token_callback_t _gnutls_token_func;
 extern void *_gnutls_token_data;
 
 void pkcs11_rescan_slots (void);
+void _gnutls_pkcs11_auto_init_schedule (void);
+void _gnutls_pkcs11_auto_deinit (void);
+void _gnutls_pkcs11_check_init (void);
 int pkcs11_info_to_url (struct p11_kit_uri *info,
                         gnutls_pkcs11_url_type_t detailed, char **url);
 
@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * The GnuTLS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+
+/* This file contains the cache of verification results of a trust
+ * list. An entry maps the digest of a certificate chain and the
+ * verification flags to the verification status, and is only used
+ * within the validity period of the chain and its trust anchor, and
+ * while the trust list is unchanged.
+ */
+
+#include <gnutls_int.h>
+#include <gnutls_errors.h>
+#include <gnutls_datum.h>
+#include <gnutls_chain_cache.h>
+#include <common.h>
+#include "x509_int.h"
+#include "verify-cache.h"
+#include <locks.h>
+
+#define VERIFY_CACHE_BUCKETS 256
+
+typedef struct verify_cache_entry_st
+{
+  struct verify_cache_entry_st *next;   /* in the hash bucket */
+  struct verify_cache_entry_st *lru_prev;       /* towards the most recent */
+  struct verify_cache_entry_st *lru_next;       /* towards the least recent */
+
+  uint8_t digest[CHAIN_DIGEST_SIZE];
+  unsigned int flags;
+
+  unsigned int status;
+  time_t not_before;
+  time_t not_after;
+} verify_cache_entry_st;
+
+struct verify_cache_st
+{
+  void *mutex;
+
+  verify_cache_entry_st *buckets[VERIFY_CACHE_BUCKETS];
+  verify_cache_entry_st *lru_head;
+  verify_cache_entry_st *lru_tail;
+
+  /* the generation of the trust list the entries were verified
+   * against */
+  uint64_t generation;
+
+  unsigned int nentries;
+  unsigned int max_entries;
+};
+
+#define CACHE_LOCK(c) if (gnutls_mutex_lock(&(c)->mutex)!=0) abort()
+#define CACHE_UNLOCK(c) if (gnutls_mutex_unlock(&(c)->mutex)!=0) abort()
+
+/* the digest is uniformly distributed */
+#define DIGEST_TO_BUCKET(d) ((d)[0] % VERIFY_CACHE_BUCKETS)
+
+static void
+lru_unlink (verify_cache_st * c, verify_cache_entry_st * e)
+{
+  if (e->lru_prev)
+    e->lru_prev->lru_next = e->lru_next;
+  else
+    c->lru_head = e->lru_next;
+
+  if (e->lru_next)
+    e->lru_next->lru_prev = e->lru_prev;
+  else
+    c->lru_tail = e->lru_prev;
+
+  e->lru_prev = e->lru_next = NULL;
+}
+
+static void
+lru_push_front (verify_cache_st * c, verify_cache_entry_st * e)
+{
+  e->lru_prev = NULL;
+  e->lru_next = c->lru_head;
+  if (c->lru_head)
+    c->lru_head->lru_prev = e;
+  c->lru_head = e;
+  if (c->lru_tail == NULL)
+    c->lru_tail = e;
+}
+
+/* Must be called with the cache lock held.
+ */
+static verify_cache_entry_st *
+cache_find (verify_cache_st * c, const uint8_t * digest, unsigned int flags)
+{
+  verify_cache_entry_st *e;
+
+  for (e = c->buckets[DIGEST_TO_BUCKET (digest)]; e != NULL; e = e->next)
+    {
+      if (e->flags == flags
+          && memcmp (e->digest, digest, CHAIN_DIGEST_SIZE) == 0)
+        return e;
+    }
+
+  return NULL;
+}
+
+/* Unlinks and frees the entry. Must be called with the cache lock held.
+ */
+static void
+cache_remove_entry (verify_cache_st * c, verify_cache_entry_st * e)
+{
+  verify_cache_entry_st **p;
+
+  for (p = &c->buckets[DIGEST_TO_BUCKET (e->digest)]; *p != NULL;
+       p = &(*p)->next)
+    {
+      if (*p == e)
+        {
+          *p = e->next;
+          break;
+        }
+    }
+
+  lru_unlink (c, e);
+  c->nentries--;
+  gnutls_free (e);
+}
+
+/* Drops the entries if the trust list changed since they were stored.
+ * Must be called with the cache lock held.
+ */
+static void
+cache_check_generation (verify_cache_st * c, uint64_t generation)
+{
+  if (c->generation == generation)
+    return;
+
+  while (c->lru_head != NULL)
+    cache_remove_entry (c, c->lru_head);
+  c->generation = generation;
+}
+
+int
+_gnutls_verify_cache_init (verify_cache_st ** cache, unsigned int max_entries)
+{
+  verify_cache_st *c;
+  int ret;
+
+  c = gnutls_calloc (1, sizeof (*c));
+  if (c == NULL)
+    return gnutls_assert_val (GNUTLS_E_MEMORY_ERROR);
+
+  ret = gnutls_mutex_init (&c->mutex);
+  if (ret < 0)
+    {
+      gnutls_assert ();
+      gnutls_free (c);
+      return ret;
+    }
+
+  c->max_entries = max_entries;
+  *cache = c;
+
+  return 0;
+}
+
+void
+_gnutls_verify_cache_deinit (verify_cache_st * cache)
+{
+  if (cache == NULL)
+    return;
+
+  while (cache->lru_head != NULL)
+    cache_remove_entry (cache, cache->lru_head);
+
+  gnutls_mutex_deinit (&cache->mutex);
+  gnutls_free (cache);
+}
+
+/* Computes the digest identifying the chain in the cache.
+ */
+int
+_gnutls_verify_cache_digest (const gnutls_x509_crt_t * certs,
+                             unsigned int ncerts,
+                             uint8_t digest[CHAIN_DIGEST_SIZE])
+{
+  gnutls_datum_t der[DEFAULT_MAX_VERIFY_DEPTH];
+  unsigned int i, n;
+  int ret;
+
+  if (ncerts == 0 || ncerts > DEFAULT_MAX_VERIFY_DEPTH)
+    return gnutls_assert_val (GNUTLS_E_INVALID_REQUEST);
+
+  for (n = 0; n < ncerts; n++)
+    {
+      ret = _gnutls_x509_der_encode (certs[n]->cert, "", &der[n], 0);
+      if (ret < 0)
+        {
+          gnutls_assert ();
+          goto cleanup;
+        }
+    }
+
+  ret = _gnutls_chain_digest (der, ncerts, digest);
+  if (ret < 0)
+    gnutls_assert ();
+
+cleanup:
+  for (i = 0; i < n; i++)
+    _gnutls_free_datum (&der[i]);
+
+  return ret;
+}
+
+/* Returns zero and the cached status if the chain was verified with
+ * the same flags, and @now is within its validity period.
+ */
+int
+_gnutls_verify_cache_get (verify_cache_st * cache,
+                          const uint8_t digest[CHAIN_DIGEST_SIZE],
+                          unsigned int flags, uint64_t generation,
+                          time_t now, unsigned int *status)
+{
+  verify_cache_entry_st *e;
+
+  CACHE_LOCK (cache);
+  cache_check_generation (cache, generation);
+
+  e = cache_find (cache, digest, flags);
+  if (e == NULL)
+    {
+      CACHE_UNLOCK (cache);
+      return GNUTLS_E_REQUESTED_DATA_NOT_AVAILABLE;
+    }
+
+  if (now < e->not_before || now > e->not_after)
+    {
+      cache_remove_entry (cache, e);
+      CACHE_UNLOCK (cache);
+      return GNUTLS_E_REQUESTED_DATA_NOT_AVAILABLE;
+    }
+
+  lru_unlink (cache, e);
+  lru_push_front (cache, e);
+  *status = e->status;
+  CACHE_UNLOCK (cache);
+
+  return 0;
+}
+
+void
+_gnutls_verify_cache_put (verify_cache_st * cache,
+                          const uint8_t digest[CHAIN_DIGEST_SIZE],
+                          unsigned int flags, uint64_t generation,
+                          unsigned int status, time_t not_before,
+                          time_t not_after)
+{
+  verify_cache_entry_st *e;
+
+  CACHE_LOCK (cache);
+  cache_check_generation (cache, generation);
+
+  e = cache_find (cache, digest, flags);
+  if (e == NULL)
+    {
+      e = gnutls_calloc (1, sizeof (*e));
+      if (e == NULL)
+        {
+          CACHE_UNLOCK (cache);
+          gnutls_assert ();
+          return;
+        }
+
+      memcpy (e->digest, digest, CHAIN_DIGEST_SIZE);
+      e->flags = flags;
+      e->next = cache->buckets[DIGEST_TO_BUCKET (digest)];
+      cache->buckets[DIGEST_TO_BUCKET (digest)] = e;
+      cache->nentries++;
+    }
+  else
+    lru_unlink (cache, e);
+
+  e->status = status;
+  e->not_before = not_before;
+  e->not_after = not_after;
+  lru_push_front (cache, e);
+
+  while (cache->nentries > cache->max_entries && cache->lru_tail != e)
+    cache_remove_entry (cache, cache->lru_tail);
+  CACHE_UNLOCK (cache);
+}
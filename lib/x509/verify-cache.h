@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * The GnuTLS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+
+#ifndef GNUTLS_VERIFY_CACHE_H
+#define GNUTLS_VERIFY_CACHE_H
+
+#include <gnutls_chain_cache.h>
+
+typedef struct verify_cache_st verify_cache_st;
+
+int _gnutls_verify_cache_init (verify_cache_st ** cache,
+                               unsigned int max_entries);
+void _gnutls_verify_cache_deinit (verify_cache_st * cache);
+
+int _gnutls_verify_cache_digest (const gnutls_x509_crt_t * certs,
+                                 unsigned int ncerts,
+                                 uint8_t digest[CHAIN_DIGEST_SIZE]);
+
+int _gnutls_verify_cache_get (verify_cache_st * cache,
+                              const uint8_t digest[CHAIN_DIGEST_SIZE],
+                              unsigned int flags, uint64_t generation,
+                              time_t now, unsigned int *status);
+void _gnutls_verify_cache_put (verify_cache_st * cache,
+                               const uint8_t digest[CHAIN_DIGEST_SIZE],
+                               unsigned int flags, uint64_t generation,
+                               unsigned int status, time_t not_before,
+                               time_t not_after);
+
+#endif
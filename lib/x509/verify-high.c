@@ -28,20 +28,27 @@
 #include <gnutls_sig.h>
 #include <gnutls_str.h>
 #include <gnutls_datum.h>
-#include <hash-pjw-bare.h>
 #include "x509_int.h"
 #include <common.h>
+#include <random.h>
+#include <locks.h>
 #include "verify-high.h"
+#include "verify-cache.h"
 
 struct named_cert_st {
   gnutls_x509_crt_t cert;
   uint8_t name[MAX_SERVER_NAME_SIZE];
   unsigned int name_size;
+  uint32_t hash;                /* of the issuer's DN */
 };
 
+/* The elements of a node share the hash of their DN modulo the size of
+ * the table; the full hashes are kept to move them when it grows.
+ */
 struct node_st {
   /* The trusted certificates */
   gnutls_x509_crt_t *trusted_cas;
+  uint32_t *trusted_ca_hashes;
   unsigned int trusted_ca_size;
 
   struct named_cert_st *named_certs;
@@ -49,22 +56,276 @@ struct node_st {
 
   /* The trusted CRLs */
   gnutls_x509_crl_t *crls;
+  uint32_t *crl_hashes;
   unsigned int crl_size;
 };
 
+/* An entry of the index of the trusted certificates by their subject
+ * key identifier.
+ */
+struct ski_entry_st {
+  struct ski_entry_st *next;
+  uint32_t hash;
+  gnutls_x509_crt_t ca;
+  unsigned int id_size;
+  uint8_t *id;                  /* points after the structure */
+};
+
 struct gnutls_x509_trust_list_st {
   unsigned int size;
   struct node_st *node;
+  unsigned int nentries;        /* CAs, named certificates and CRLs */
+  uint32_t seed;                /* of the hash function */
+
+  struct ski_entry_st **ski;
+  unsigned int ski_size;
+  unsigned int nski;
+
+  /* changes whenever a CA, a named certificate or a CRL is added.
+   * The upper half is random so that values from different lists
+   * (or processes) do not match. */
+  uint64_t generation;
+
+  /* the list is shared by the certificate credentials it is set in;
+   * it is freed when the last reference is dropped */
+  void *mutex;
+  unsigned int refcount;
+  unsigned int deinit_all;      /* free the certificates and CRLs */
+
+  /* verification results, if enabled */
+  verify_cache_st *vcache;
 };
 
+#define TLIST_LOCK(l) if (gnutls_mutex_lock(&(l)->mutex)!=0) abort()
+#define TLIST_UNLOCK(l) if (gnutls_mutex_unlock(&(l)->mutex)!=0) abort()
+
 #define DEFAULT_SIZE 503
+#define SKI_INITIAL_SIZE 64
+#define MAX_KEY_ID_SIZE 64
+
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+/* MurmurHash3 (x86, 32-bit) of the data; faster than hash_pjw_bare()
+ * on DNs, and seeded per list.
+ */
+static uint32_t
+murmur3_32(uint32_t seed, const uint8_t * data, size_t size)
+{
+    uint32_t h = seed, k;
+    size_t i;
+
+    for (i = 0; i + 4 <= size; i += 4) {
+        k = data[i] | (data[i + 1] << 8) | (data[i + 2] << 16) |
+            ((uint32_t) data[i + 3] << 24);
+        k *= 0xcc9e2d51;
+        k = ROTL32(k, 15);
+        k *= 0x1b873593;
+
+        h ^= k;
+        h = ROTL32(h, 13);
+        h = h * 5 + 0xe6546b64;
+    }
+
+    k = 0;
+    switch (size & 3) {
+    case 3:
+        k ^= data[i + 2] << 16;
+    case 2:
+        k ^= data[i + 1] << 8;
+    case 1:
+        k ^= data[i];
+        k *= 0xcc9e2d51;
+        k = ROTL32(k, 15);
+        k *= 0x1b873593;
+        h ^= k;
+    }
+
+    h ^= size;
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+
+    return h;
+}
+
+static uint32_t
+dn_hash(gnutls_x509_trust_list_t list, const gnutls_datum_t * dn)
+{
+    return murmur3_32(list->seed, dn->data, dn->size);
+}
+
+/* Doubles the size of the table once it holds as many elements as it
+ * has nodes. Failing to grow it is not an error.
+ */
+static void trust_list_grow(gnutls_x509_trust_list_t list)
+{
+    struct node_st *node, *src, *dst;
+    unsigned int size, i, j, h;
+    int failed = 0;
+
+    if (list->nentries < list->size || list->size >= UINT_MAX / 4)
+        return;
+
+    size = list->size * 2 + 1;
+    node = gnutls_calloc(size, sizeof(node[0]));
+    if (node == NULL)
+        return;
+
+    /* count the elements of each node, and allocate them */
+    for (i = 0; i < list->size; i++) {
+        src = &list->node[i];
+        for (j = 0; j < src->trusted_ca_size; j++)
+            node[src->trusted_ca_hashes[j] % size].trusted_ca_size++;
+        for (j = 0; j < src->named_cert_size; j++)
+            node[src->named_certs[j].hash % size].named_cert_size++;
+        for (j = 0; j < src->crl_size; j++)
+            node[src->crl_hashes[j] % size].crl_size++;
+    }
+
+    for (i = 0; i < size && failed == 0; i++) {
+        dst = &node[i];
+        if (dst->trusted_ca_size > 0) {
+            dst->trusted_cas =
+                gnutls_malloc(dst->trusted_ca_size *
+                              sizeof(dst->trusted_cas[0]));
+            dst->trusted_ca_hashes =
+                gnutls_malloc(dst->trusted_ca_size *
+                              sizeof(dst->trusted_ca_hashes[0]));
+            if (dst->trusted_cas == NULL
+                || dst->trusted_ca_hashes == NULL)
+                failed = 1;
+        }
+        if (dst->named_cert_size > 0) {
+            dst->named_certs =
+                gnutls_malloc(dst->named_cert_size *
+                              sizeof(dst->named_certs[0]));
+            if (dst->named_certs == NULL)
+                failed = 1;
+        }
+        if (dst->crl_size > 0) {
+            dst->crls =
+                gnutls_malloc(dst->crl_size * sizeof(dst->crls[0]));
+            dst->crl_hashes =
+                gnutls_malloc(dst->crl_size * sizeof(dst->crl_hashes[0]));
+            if (dst->crls == NULL || dst->crl_hashes == NULL)
+                failed = 1;
+        }
+        dst->trusted_ca_size = dst->named_cert_size = dst->crl_size = 0;
+    }
+
+    if (failed) {
+        gnutls_assert();
+        goto cleanup;
+    }
+
+    /* move them, keeping their order */
+    for (i = 0; i < list->size; i++) {
+        src = &list->node[i];
+        for (j = 0; j < src->trusted_ca_size; j++) {
+            dst = &node[src->trusted_ca_hashes[j] % size];
+            dst->trusted_cas[dst->trusted_ca_size] = src->trusted_cas[j];
+            dst->trusted_ca_hashes[dst->trusted_ca_size] =
+                src->trusted_ca_hashes[j];
+            dst->trusted_ca_size++;
+        }
+        for (j = 0; j < src->named_cert_size; j++) {
+            dst = &node[src->named_certs[j].hash % size];
+            dst->named_certs[dst->named_cert_size++] = src->named_certs[j];
+        }
+        for (j = 0; j < src->crl_size; j++) {
+            h = src->crl_hashes[j];
+            dst = &node[h % size];
+            dst->crls[dst->crl_size] = src->crls[j];
+            dst->crl_hashes[dst->crl_size] = h;
+            dst->crl_size++;
+        }
+    }
+
+    /* free the old table, and swap it with the new one */
+    for (i = 0; i < list->size; i++) {
+        src = &list->node[i];
+        gnutls_free(src->trusted_cas);
+        gnutls_free(src->trusted_ca_hashes);
+        gnutls_free(src->named_certs);
+        gnutls_free(src->crls);
+        gnutls_free(src->crl_hashes);
+    }
+    gnutls_free(list->node);
+    list->node = node;
+    list->size = size;
+    return;
+
+  cleanup:
+    for (i = 0; i < size; i++) {
+        gnutls_free(node[i].trusted_cas);
+        gnutls_free(node[i].trusted_ca_hashes);
+        gnutls_free(node[i].named_certs);
+        gnutls_free(node[i].crls);
+        gnutls_free(node[i].crl_hashes);
+    }
+    gnutls_free(node);
+}
+
+/* Adds the CA to the index by subject key identifier, if it has one.
+ * Failing to do so is not an error, as the issuers are also looked up
+ * by DN.
+ */
+static void ski_add(gnutls_x509_trust_list_t list, gnutls_x509_crt_t ca)
+{
+    uint8_t id[MAX_KEY_ID_SIZE];
+    size_t id_size = sizeof(id);
+    unsigned int critical, size, i;
+    struct ski_entry_st *e, *next, **ski;
+    uint32_t hash;
+
+    if (gnutls_x509_crt_get_subject_key_id(ca, id, &id_size, &critical) <
+        0 || id_size == 0)
+        return;
+
+    if (list->nski >= list->ski_size && list->ski_size < UINT_MAX / 4) {
+        size = list->ski_size * 2;
+        ski = gnutls_calloc(size, sizeof(ski[0]));
+        if (ski != NULL) {
+            for (i = 0; i < list->ski_size; i++) {
+                for (e = list->ski[i]; e != NULL; e = next) {
+                    next = e->next;
+                    e->next = ski[e->hash % size];
+                    ski[e->hash % size] = e;
+                }
+            }
+            gnutls_free(list->ski);
+            list->ski = ski;
+            list->ski_size = size;
+        }
+    }
+
+    e = gnutls_malloc(sizeof(*e) + id_size);
+    if (e == NULL) {
+        gnutls_assert();
+        return;
+    }
+
+    hash = murmur3_32(list->seed, id, id_size);
+    e->hash = hash;
+    e->ca = ca;
+    e->id_size = id_size;
+    e->id = (uint8_t *) (e + 1);
+    memcpy(e->id, id, id_size);
+
+    e->next = list->ski[hash % list->ski_size];
+    list->ski[hash % list->ski_size] = e;
+    list->nski++;
+}
 
 /**
  * gnutls_x509_trust_list_init:
  * @list: The structure to be initialized
- * @size: The size of the internal hash table. Use (0) for default size.
+ * @size: The initial size of the internal hash table. Use (0) for default size.
  *
- * This function will initialize an X.509 trust list structure.
+ * This function will initialize an X.509 trust list structure. The
+ * hash table grows as certificates and CRLs are added to the list.
  *
  * Returns: On success, %GNUTLS_E_SUCCESS (0) is returned, otherwise a
  *   negative error value.
@@ -77,6 +338,8 @@ gnutls_x509_trust_list_init(gnutls_x509_trust_list_t * list,
 {
     gnutls_x509_trust_list_t tmp =
         gnutls_calloc(1, sizeof(struct gnutls_x509_trust_list_st));
+    uint32_t id[2];
+    int ret;
 
     if (!tmp)
         return GNUTLS_E_MEMORY_ERROR;
@@ -92,28 +355,47 @@ gnutls_x509_trust_list_init(gnutls_x509_trust_list_t * list,
         return GNUTLS_E_MEMORY_ERROR;
     }
 
+    tmp->ski_size = SKI_INITIAL_SIZE;
+    tmp->ski = gnutls_calloc(tmp->ski_size, sizeof(tmp->ski[0]));
+    if (tmp->ski == NULL) {
+        gnutls_assert();
+        gnutls_free(tmp->node);
+        gnutls_free(tmp);
+        return GNUTLS_E_MEMORY_ERROR;
+    }
+
+    ret = _gnutls_rnd(GNUTLS_RND_NONCE, id, sizeof(id));
+    if (ret < 0) {
+        gnutls_assert();
+        goto fail;
+    }
+    tmp->generation = ((uint64_t) id[0]) << 32;
+    tmp->seed = id[1];
+
+    ret = gnutls_mutex_init(&tmp->mutex);
+    if (ret < 0) {
+        gnutls_assert();
+        goto fail;
+    }
+    tmp->refcount = 1;
+    tmp->deinit_all = 1;
+
     *list = tmp;
 
     return 0;                   /* success */
+
+  fail:
+    gnutls_free(tmp->ski);
+    gnutls_free(tmp->node);
+    gnutls_free(tmp);
+    return ret;
 }
 
-/**
- * gnutls_x509_trust_list_deinit:
- * @list: The structure to be deinitialized
- * @all: if non-(0) it will deinitialize all the certificates and CRLs contained in the structure.
- *
- * This function will deinitialize a trust list.
- *
- * Since: 3.0
- **/
-void
-gnutls_x509_trust_list_deinit(gnutls_x509_trust_list_t list,
-                              unsigned int all)
+static void
+trust_list_free(gnutls_x509_trust_list_t list)
 {
-    unsigned int i, j;
-
-    if (!list)
-        return;
+    unsigned int i, j, all = list->deinit_all;
+    struct ski_entry_st *e, *next;
 
     for (i = 0; i < list->size; i++) {
         if (all)
@@ -121,12 +403,14 @@ gnutls_x509_trust_list_deinit(gnutls_x509_trust_list_t list,
                 gnutls_x509_crt_deinit(list->node[i].trusted_cas[j]);
             }
         gnutls_free(list->node[i].trusted_cas);
+        gnutls_free(list->node[i].trusted_ca_hashes);
 
         if (all)
             for (j = 0; j < list->node[i].crl_size; j++) {
                 gnutls_x509_crl_deinit(list->node[i].crls[j]);
             }
         gnutls_free(list->node[i].crls);
+        gnutls_free(list->node[i].crl_hashes);
 
         if (all)
             for (j = 0; j < list->node[i].named_cert_size; j++) {
@@ -135,10 +419,72 @@ gnutls_x509_trust_list_deinit(gnutls_x509_trust_list_t list,
         gnutls_free(list->node[i].named_certs);
     }
 
+    for (i = 0; i < list->ski_size; i++) {
+        for (e = list->ski[i]; e != NULL; e = next) {
+            next = e->next;
+            gnutls_free(e);
+        }
+    }
+    gnutls_free(list->ski);
+
+    _gnutls_verify_cache_deinit(list->vcache);
+    gnutls_mutex_deinit(&list->mutex);
     gnutls_free(list->node);
     gnutls_free(list);
 }
 
+/**
+ * gnutls_x509_trust_list_deinit:
+ * @list: The structure to be deinitialized
+ * @all: if non-(0) it will deinitialize all the certificates and CRLs contained in the structure.
+ *
+ * This function will deinitialize a trust list. If the list is set
+ * in certificate credentials with gnutls_certificate_set_trust_list(),
+ * it is freed, as @all specifies, once these credentials are freed.
+ *
+ * Since: 3.0
+ **/
+void
+gnutls_x509_trust_list_deinit(gnutls_x509_trust_list_t list,
+                              unsigned int all)
+{
+    if (!list)
+        return;
+
+    TLIST_LOCK(list);
+    list->deinit_all = all;
+    TLIST_UNLOCK(list);
+
+    _gnutls_trustlist_unref(list);
+}
+
+void
+_gnutls_trustlist_ref(gnutls_x509_trust_list_t list)
+{
+    TLIST_LOCK(list);
+    list->refcount++;
+    TLIST_UNLOCK(list);
+}
+
+/* Drops a reference to the list, without changing whether its
+ * certificates and CRLs are freed with it.
+ */
+void
+_gnutls_trustlist_unref(gnutls_x509_trust_list_t list)
+{
+    unsigned int refcount;
+
+    if (!list)
+        return;
+
+    TLIST_LOCK(list);
+    refcount = --list->refcount;
+    TLIST_UNLOCK(list);
+
+    if (refcount == 0)
+        trust_list_free(list);
+}
+
 /**
  * gnutls_x509_trust_list_add_cas:
  * @list: The structure of the list
@@ -161,7 +507,7 @@ gnutls_x509_trust_list_add_cas(gnutls_x509_trust_list_t list,
 {
     gnutls_datum_t dn;
     int ret, i;
-    uint32_t hash;
+    uint32_t hash, full_hash;
 
     for (i = 0; i < clist_size; i++) {
         ret = gnutls_x509_crt_get_raw_dn(clist[i], &dn);
@@ -170,8 +516,10 @@ gnutls_x509_trust_list_add_cas(gnutls_x509_trust_list_t list,
             return i;
         }
 
-        hash = hash_pjw_bare(dn.data, dn.size);
-        hash %= list->size;
+        trust_list_grow(list);
+
+        full_hash = dn_hash(list, &dn);
+        hash = full_hash % list->size;
 
         _gnutls_free_datum(&dn);
         list->node[hash].trusted_cas =
@@ -184,9 +532,26 @@ gnutls_x509_trust_list_add_cas(gnutls_x509_trust_list_t list,
             return i;
         }
 
+        list->node[hash].trusted_ca_hashes =
+            gnutls_realloc_fast(list->node[hash].trusted_ca_hashes,
+                                (list->node[hash].trusted_ca_size +
+                                 1) *
+                                sizeof(list->node[hash].
+                                       trusted_ca_hashes[0]));
+        if (list->node[hash].trusted_ca_hashes == NULL) {
+            gnutls_assert();
+            return i;
+        }
+
         list->node[hash].trusted_cas[list->node[hash].trusted_ca_size] =
             clist[i];
+        list->node[hash].trusted_ca_hashes[list->node[hash].
+                                           trusted_ca_size] = full_hash;
         list->node[hash].trusted_ca_size++;
+        list->nentries++;
+        list->generation++;
+
+        ski_add(list, clist[i]);
     }
 
     return i;
@@ -225,7 +590,7 @@ gnutls_x509_trust_list_add_named_crt(gnutls_x509_trust_list_t list,
 {
     gnutls_datum_t dn;
     int ret;
-    uint32_t hash;
+    uint32_t hash, full_hash;
 
     if (name_size >= MAX_SERVER_NAME_SIZE)
         return gnutls_assert_val(GNUTLS_E_INVALID_REQUEST);
@@ -236,8 +601,10 @@ gnutls_x509_trust_list_add_named_crt(gnutls_x509_trust_list_t list,
         return ret;
     }
 
-    hash = hash_pjw_bare(dn.data, dn.size);
-    hash %= list->size;
+    trust_list_grow(list);
+
+    full_hash = dn_hash(list, &dn);
+    hash = full_hash % list->size;
 
     _gnutls_free_datum(&dn);
 
@@ -254,8 +621,12 @@ gnutls_x509_trust_list_add_named_crt(gnutls_x509_trust_list_t list,
            name, name, name_size);
     list->node[hash].named_certs[list->node[hash].named_cert_size].
         name_size = name_size;
+    list->node[hash].named_certs[list->node[hash].named_cert_size].hash =
+        full_hash;
 
     list->node[hash].named_cert_size++;
+    list->nentries++;
+    list->generation++;
 
     return 0;
 }
@@ -288,7 +659,7 @@ gnutls_x509_trust_list_add_crls(gnutls_x509_trust_list_t list,
     int ret, i, j = 0;
     gnutls_datum_t dn;
     unsigned int vret = 0;
-    uint32_t hash;
+    uint32_t hash, full_hash;
 
     /* Probably we can optimize things such as removing duplicates
      * etc.
@@ -304,8 +675,10 @@ gnutls_x509_trust_list_add_crls(gnutls_x509_trust_list_t list,
             return i;
         }
 
-        hash = hash_pjw_bare(dn.data, dn.size);
-        hash %= list->size;
+        trust_list_grow(list);
+
+        full_hash = dn_hash(list, &dn);
+        hash = full_hash % list->size;
 
         _gnutls_free_datum(&dn);
 
@@ -330,8 +703,20 @@ gnutls_x509_trust_list_add_crls(gnutls_x509_trust_list_t list,
             return i;
         }
 
+        list->node[hash].crl_hashes =
+            gnutls_realloc_fast(list->node[hash].crl_hashes,
+                                (list->node[hash].crl_size +
+                                 1) * sizeof(list->node[hash].crl_hashes[0]));
+        if (list->node[hash].crl_hashes == NULL) {
+            gnutls_assert();
+            return i;
+        }
+
         list->node[hash].crls[list->node[hash].crl_size] = crl_list[i];
+        list->node[hash].crl_hashes[list->node[hash].crl_size] = full_hash;
         list->node[hash].crl_size++;
+        list->nentries++;
+        list->generation++;
         j++;
     }
 
@@ -383,8 +768,7 @@ static int shorten_clist(gnutls_x509_trust_list_t list,
             return ret;
         }
 
-        hash = hash_pjw_bare(dn.data, dn.size);
-        hash %= list->size;
+        hash = dn_hash(list, &dn) % list->size;
 
         _gnutls_free_datum(&dn);
 
@@ -489,8 +873,27 @@ int gnutls_x509_trust_list_get_issuer(gnutls_x509_trust_list_t list,
 {
     gnutls_datum_t dn;
     int ret;
-    unsigned int i;
+    unsigned int i, critical;
     uint32_t hash;
+    uint8_t id[MAX_KEY_ID_SIZE];
+    size_t id_size = sizeof(id);
+    struct ski_entry_st *e;
+
+    /* try the CAs whose key identifier matches first */
+    ret = gnutls_x509_crt_get_authority_key_id(cert, id, &id_size,
+                                               &critical);
+    if (ret >= 0 && id_size > 0) {
+        hash = murmur3_32(list->seed, id, id_size);
+
+        for (e = list->ski[hash % list->ski_size]; e != NULL; e = e->next) {
+            if (e->hash == hash && e->id_size == id_size
+                && memcmp(e->id, id, id_size) == 0
+                && gnutls_x509_crt_check_issuer(cert, e->ca) > 0) {
+                *issuer = e->ca;
+                return 0;
+            }
+        }
+    }
 
     ret = gnutls_x509_crt_get_raw_issuer_dn(cert, &dn);
     if (ret < 0) {
@@ -498,8 +901,7 @@ int gnutls_x509_trust_list_get_issuer(gnutls_x509_trust_list_t list,
         return ret;
     }
 
-    hash = hash_pjw_bare(dn.data, dn.size);
-    hash %= list->size;
+    hash = dn_hash(list, &dn) % list->size;
 
     _gnutls_free_datum(&dn);
 
@@ -516,33 +918,13 @@ int gnutls_x509_trust_list_get_issuer(gnutls_x509_trust_list_t list,
     return GNUTLS_E_REQUESTED_DATA_NOT_AVAILABLE;
 }
 
-/**
- * gnutls_x509_trust_list_verify_crt:
- * @list: The structure of the list
- * @cert_list: is the certificate list to be verified
- * @cert_list_size: is the certificate list size
- * @flags: Flags that may be used to change the verification algorithm. Use OR of the gnutls_certificate_verify_flags enumerations.
- * @verify: will hold the certificate verification output.
- * @func: If non-null will be called on each chain element verification with the output.
- *
- * This function will try to verify the given certificate and return
- * its status. The @verify parameter will hold an OR'ed sequence of
- * %gnutls_certificate_status_t flags.
- *
- * Limitation: Pathlen constraints or key usage flags are not consulted.
- *
- * Returns: On success, %GNUTLS_E_SUCCESS (0) is returned, otherwise a
- *   negative error value.
- *
- * Since: 3.0
- **/
-int
-gnutls_x509_trust_list_verify_crt(gnutls_x509_trust_list_t list,
-                                  gnutls_x509_crt_t * cert_list,
-                                  unsigned int cert_list_size,
-                                  unsigned int flags,
-                                  unsigned int *verify,
-                                  gnutls_verify_output_function func)
+static int
+trust_list_verify_crt(gnutls_x509_trust_list_t list,
+                      gnutls_x509_crt_t * cert_list,
+                      unsigned int cert_list_size,
+                      unsigned int flags,
+                      unsigned int *verify,
+                      gnutls_verify_output_function func)
 {
     gnutls_datum_t dn;
     int ret;
@@ -568,8 +950,7 @@ gnutls_x509_trust_list_verify_crt(gnutls_x509_trust_list_t list,
         return ret;
     }
 
-    hash = hash_pjw_bare(dn.data, dn.size);
-    hash %= list->size;
+    hash = dn_hash(list, &dn) % list->size;
 
     _gnutls_free_datum(&dn);
 
@@ -602,8 +983,7 @@ gnutls_x509_trust_list_verify_crt(gnutls_x509_trust_list_t list,
             return ret;
         }
 
-        hash = hash_pjw_bare(dn.data, dn.size);
-        hash %= list->size;
+        hash = dn_hash(list, &dn) % list->size;
 
         _gnutls_free_datum(&dn);
 
@@ -621,6 +1001,152 @@ gnutls_x509_trust_list_verify_crt(gnutls_x509_trust_list_t list,
     return 0;
 }
 
+/**
+ * gnutls_x509_trust_list_verify_crt:
+ * @list: The structure of the list
+ * @cert_list: is the certificate list to be verified
+ * @cert_list_size: is the certificate list size
+ * @flags: Flags that may be used to change the verification algorithm. Use OR of the gnutls_certificate_verify_flags enumerations.
+ * @verify: will hold the certificate verification output.
+ * @func: If non-null will be called on each chain element verification with the output.
+ *
+ * This function will try to verify the given certificate and return
+ * its status. The @verify parameter will hold an OR'ed sequence of
+ * %gnutls_certificate_status_t flags.
+ *
+ * Limitation: Pathlen constraints or key usage flags are not consulted.
+ *
+ * If enabled with gnutls_x509_trust_list_set_verify_cache(), the
+ * status of a chain verified earlier is taken from the cache.
+ *
+ * Returns: On success, %GNUTLS_E_SUCCESS (0) is returned, otherwise a
+ *   negative error value.
+ *
+ * Since: 3.0
+ **/
+int
+gnutls_x509_trust_list_verify_crt(gnutls_x509_trust_list_t list,
+                                  gnutls_x509_crt_t * cert_list,
+                                  unsigned int cert_list_size,
+                                  unsigned int flags,
+                                  unsigned int *verify,
+                                  gnutls_verify_output_function func)
+{
+    uint8_t digest[CHAIN_DIGEST_SIZE];
+    time_t now, not_before, not_after, t;
+    gnutls_x509_crt_t issuer, crt;
+    unsigned int i;
+    int ret;
+
+    /* the output function expects the chain to be verified */
+    if (list->vcache == NULL || func != NULL || cert_list == NULL
+        || _gnutls_verify_cache_digest(cert_list, cert_list_size,
+                                       digest) < 0)
+        return trust_list_verify_crt(list, cert_list, cert_list_size,
+                                     flags, verify, func);
+
+    now = gnutls_time(0);
+    if (_gnutls_verify_cache_get(list->vcache, digest, flags,
+                                 list->generation, now, verify) == 0)
+        return 0;
+
+    ret = trust_list_verify_crt(list, cert_list, cert_list_size,
+                                flags, verify, func);
+    if (ret < 0)
+        return gnutls_assert_val(ret);
+
+    if (*verify & (GNUTLS_CERT_EXPIRED | GNUTLS_CERT_NOT_ACTIVATED))
+        return 0;
+
+    /* the result holds while the chain and the trust anchors that
+     * issued it are within their validity period */
+    not_before = gnutls_x509_crt_get_activation_time(cert_list[0]);
+    not_after = gnutls_x509_crt_get_expiration_time(cert_list[0]);
+
+    for (i = 0; i < cert_list_size * 2; i++) {
+        if (i & 1) {
+            if (gnutls_x509_trust_list_get_issuer(list, cert_list[i / 2],
+                                                  &issuer, 0) < 0)
+                continue;
+            crt = issuer;
+        } else
+            crt = cert_list[i / 2];
+
+        t = gnutls_x509_crt_get_activation_time(crt);
+        if (t == (time_t) - 1)
+            return 0;
+        if (t > not_before)
+            not_before = t;
+
+        t = gnutls_x509_crt_get_expiration_time(crt);
+        if (t == (time_t) - 1)
+            return 0;
+        if (t < not_after)
+            not_after = t;
+    }
+
+    _gnutls_verify_cache_put(list->vcache, digest, flags,
+                             list->generation, *verify, not_before,
+                             not_after);
+
+    return 0;
+}
+
+/**
+ * gnutls_x509_trust_list_set_verify_cache:
+ * @list: The structure of the list
+ * @max_entries: the maximum number of results to keep, or zero to disable
+ *
+ * This function enables a cache of the results of
+ * gnutls_x509_trust_list_verify_crt() in the trust list, which avoids
+ * verifying again a chain that was verified with the same flags,
+ * e.g., the certificates of returning clients. A result is used while
+ * the certificates of the chain and the trust anchors that issued them
+ * are within their validity period, and the cache is emptied when
+ * certificate authorities or CRLs are added to the list.
+ *
+ * Verifications with an output function are not cached.
+ *
+ * The cache is replaced without synchronization with the
+ * verifications that use it, so this function must be called before
+ * the list is used by several threads, and before it is set in
+ * certificate credentials with gnutls_certificate_set_trust_list().
+ *
+ * Returns: On success, %GNUTLS_E_SUCCESS (0) is returned, otherwise a
+ *   negative error value. %GNUTLS_E_INVALID_REQUEST is returned if
+ *   the list is already shared by certificate credentials.
+ *
+ * Since: 3.1.6
+ **/
+int
+gnutls_x509_trust_list_set_verify_cache(gnutls_x509_trust_list_t list,
+                                        unsigned int max_entries)
+{
+    verify_cache_st *vcache = NULL, *old;
+    int ret;
+
+    if (max_entries > 0) {
+        ret = _gnutls_verify_cache_init(&vcache, max_entries);
+        if (ret < 0)
+            return gnutls_assert_val(ret);
+    }
+
+    TLIST_LOCK(list);
+    if (list->refcount > 1) {
+        TLIST_UNLOCK(list);
+        _gnutls_verify_cache_deinit(vcache);
+        return gnutls_assert_val(GNUTLS_E_INVALID_REQUEST);
+    }
+
+    old = list->vcache;
+    list->vcache = vcache;
+    TLIST_UNLOCK(list);
+
+    _gnutls_verify_cache_deinit(old);
+
+    return 0;
+}
+
 /**
  * gnutls_x509_trust_list_verify_named_crt:
  * @list: The structure of the list
@@ -661,8 +1187,7 @@ gnutls_x509_trust_list_verify_named_crt(gnutls_x509_trust_list_t list,
         return ret;
     }
 
-    hash = hash_pjw_bare(dn.data, dn.size);
-    hash %= list->size;
+    hash = dn_hash(list, &dn) % list->size;
 
     _gnutls_free_datum(&dn);
 
@@ -715,8 +1240,7 @@ _gnutls_trustlist_inlist (gnutls_x509_trust_list_t list,
       return ret;
     }
 
-  hash = hash_pjw_bare(dn.data, dn.size);
-  hash %= list->size;
+  hash = dn_hash(list, &dn) % list->size;
 
   _gnutls_free_datum (&dn);
 
@@ -735,3 +1259,12 @@ _gnutls_trustlist_inlist (gnutls_x509_trust_list_t list,
 
   return 1;
 }
+
+/* Returns a value that changes whenever the contents of @list
+ * change; used to tell whether an earlier verification still holds.
+ */
+uint64_t
+_gnutls_trustlist_generation (gnutls_x509_trust_list_t list)
+{
+  return list->generation;
+}
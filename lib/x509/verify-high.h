@@ -22,3 +22,6 @@
 
 int _gnutls_trustlist_inlist (gnutls_x509_trust_list_t list,
 			      gnutls_x509_crt_t cert);
+uint64_t _gnutls_trustlist_generation (gnutls_x509_trust_list_t list);
+void _gnutls_trustlist_ref (gnutls_x509_trust_list_t list);
+void _gnutls_trustlist_unref (gnutls_x509_trust_list_t list);
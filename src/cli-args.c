@@ -67,7 +67,7 @@ extern FILE * option_usage_fp;
 /*
  *  gnutls-cli option static const strings
  */
-static char const gnutls_cli_opt_strs[3786] =
+static char const gnutls_cli_opt_strs[3850] =
 /*     0 */ "gnutls-cli @VERSION@\n"
             "Copyright (C) 2000-2012 Free Software Foundation, all rights reserved.\n"
             "This is free software. It is licensed for use, modification and\n"
@@ -109,125 +109,128 @@ static char const gnutls_cli_opt_strs[3786] =
 /*  1263 */ "Establish a session and resume\0"
 /*  1294 */ "RESUME\0"
 /*  1301 */ "resume\0"
-/*  1308 */ "Activate heartbeat support\0"
-/*  1335 */ "HEARTBEAT\0"
-/*  1345 */ "heartbeat\0"
-/*  1355 */ "Establish a session and rehandshake\0"
-/*  1391 */ "REHANDSHAKE\0"
-/*  1403 */ "rehandshake\0"
-/*  1415 */ "Don't accept session tickets\0"
-/*  1444 */ "NOTICKET\0"
-/*  1453 */ "noticket\0"
-/*  1462 */ "Connect, establish a plain session and start TLS.\0"
-/*  1512 */ "STARTTLS\0"
-/*  1521 */ "starttls\0"
-/*  1530 */ "Use DTLS (datagram TLS) over UDP\0"
-/*  1563 */ "UDP\0"
-/*  1567 */ "udp\0"
-/*  1571 */ "Set MTU for datagram TLS\0"
-/*  1596 */ "MTU\0"
-/*  1600 */ "mtu\0"
-/*  1604 */ "Offer SRTP profiles\0"
-/*  1624 */ "SRTP_PROFILES\0"
-/*  1638 */ "srtp-profiles\0"
-/*  1652 */ "Send CR LF instead of LF\0"
-/*  1677 */ "CRLF\0"
-/*  1682 */ "crlf\0"
-/*  1687 */ "Use DER format for certificates to read from\0"
-/*  1732 */ "X509FMTDER\0"
-/*  1743 */ "x509fmtder\0"
-/*  1754 */ "Send the openpgp fingerprint, instead of the key\0"
-/*  1803 */ "FINGERPRINT\0"
-/*  1815 */ "fingerprint\0"
-/*  1827 */ "Disable all the TLS extensions\0"
-/*  1858 */ "DISABLE_EXTENSIONS\0"
-/*  1877 */ "disable-extensions\0"
-/*  1896 */ "Print peer's certificate in PEM format\0"
-/*  1935 */ "PRINT_CERT\0"
-/*  1946 */ "print-cert\0"
-/*  1957 */ "The maximum record size to advertize\0"
-/*  1994 */ "RECORDSIZE\0"
-/*  2005 */ "recordsize\0"
-/*  2016 */ "The minimum number of bits allowed for DH\0"
-/*  2058 */ "DH_BITS\0"
-/*  2066 */ "dh-bits\0"
-/*  2074 */ "Priorities string\0"
-/*  2092 */ "PRIORITY\0"
-/*  2101 */ "priority\0"
-/*  2110 */ "Certificate file or PKCS #11 URL to use\0"
-/*  2150 */ "X509CAFILE\0"
-/*  2161 */ "x509cafile\0"
-/*  2172 */ "CRL file to use\0"
-/*  2188 */ "X509CRLFILE\0"
-/*  2200 */ "x509crlfile\0"
-/*  2212 */ "PGP Key file to use\0"
-/*  2232 */ "PGPKEYFILE\0"
-/*  2243 */ "pgpkeyfile\0"
-/*  2254 */ "PGP Key ring file to use\0"
-/*  2279 */ "PGPKEYRING\0"
-/*  2290 */ "pgpkeyring\0"
-/*  2301 */ "PGP Public Key (certificate) file to use\0"
-/*  2342 */ "PGPCERTFILE\0"
-/*  2354 */ "pgpcertfile\0"
-/*  2366 */ "X.509 key file or PKCS #11 URL to use\0"
-/*  2404 */ "X509KEYFILE\0"
-/*  2416 */ "x509keyfile\0"
-/*  2428 */ "X.509 Certificate file or PKCS #11 URL to use\0"
-/*  2474 */ "X509CERTFILE\0"
-/*  2487 */ "x509certfile\0"
-/*  2500 */ "PGP subkey to use (hex or auto)\0"
-/*  2532 */ "PGPSUBKEY\0"
-/*  2542 */ "pgpsubkey\0"
-/*  2552 */ "SRP username to use\0"
-/*  2572 */ "SRPUSERNAME\0"
-/*  2584 */ "srpusername\0"
-/*  2596 */ "SRP password to use\0"
-/*  2616 */ "SRPPASSWD\0"
-/*  2626 */ "srppasswd\0"
-/*  2636 */ "PSK username to use\0"
-/*  2656 */ "PSKUSERNAME\0"
-/*  2668 */ "pskusername\0"
-/*  2680 */ "PSK key (in hex) to use\0"
-/*  2704 */ "PSKKEY\0"
-/*  2711 */ "pskkey\0"
-/*  2718 */ "The port or service to connect to\0"
-/*  2752 */ "PORT\0"
-/*  2757 */ "port\0"
-/*  2762 */ "Don't abort program if server certificate can't be validated\0"
-/*  2823 */ "INSECURE\0"
-/*  2832 */ "insecure\0"
-/*  2841 */ "Benchmark individual ciphers\0"
-/*  2870 */ "BENCHMARK_CIPHERS\0"
-/*  2888 */ "benchmark-ciphers\0"
-/*  2906 */ "Benchmark individual software ciphers (no hw acceleration)\0"
-/*  2965 */ "BENCHMARK_SOFT_CIPHERS\0"
-/*  2988 */ "benchmark-soft-ciphers\0"
-/*  3011 */ "Benchmark TLS key exchange methods\0"
-/*  3046 */ "BENCHMARK_TLS_KX\0"
-/*  3063 */ "benchmark-tls-kx\0"
-/*  3080 */ "Benchmark TLS ciphers\0"
-/*  3102 */ "BENCHMARK_TLS_CIPHERS\0"
-/*  3124 */ "benchmark-tls-ciphers\0"
-/*  3146 */ "Print a list of the supported algorithms and modes\0"
-/*  3197 */ "LIST\0"
-/*  3202 */ "list\0"
-/*  3207 */ "Display extended usage information and exit\0"
-/*  3251 */ "help\0"
-/*  3256 */ "Extended usage information passed thru pager\0"
-/*  3301 */ "more-help\0"
-/*  3311 */ "Output version information and exit\0"
-/*  3347 */ "version\0"
-/*  3355 */ "GNUTLS_CLI\0"
-/*  3366 */ "gnutls-cli - GnuTLS client - Ver. @VERSION@\n"
+/*  1308 */ "Resume using the client session cache\0"
+/*  1346 */ "RESUME_CACHE\0"
+/*  1359 */ "resume-cache\0"
+/*  1372 */ "Activate heartbeat support\0"
+/*  1399 */ "HEARTBEAT\0"
+/*  1409 */ "heartbeat\0"
+/*  1419 */ "Establish a session and rehandshake\0"
+/*  1455 */ "REHANDSHAKE\0"
+/*  1467 */ "rehandshake\0"
+/*  1479 */ "Don't accept session tickets\0"
+/*  1508 */ "NOTICKET\0"
+/*  1517 */ "noticket\0"
+/*  1526 */ "Connect, establish a plain session and start TLS.\0"
+/*  1576 */ "STARTTLS\0"
+/*  1585 */ "starttls\0"
+/*  1594 */ "Use DTLS (datagram TLS) over UDP\0"
+/*  1627 */ "UDP\0"
+/*  1631 */ "udp\0"
+/*  1635 */ "Set MTU for datagram TLS\0"
+/*  1660 */ "MTU\0"
+/*  1664 */ "mtu\0"
+/*  1668 */ "Offer SRTP profiles\0"
+/*  1688 */ "SRTP_PROFILES\0"
+/*  1702 */ "srtp-profiles\0"
+/*  1716 */ "Send CR LF instead of LF\0"
+/*  1741 */ "CRLF\0"
+/*  1746 */ "crlf\0"
+/*  1751 */ "Use DER format for certificates to read from\0"
+/*  1796 */ "X509FMTDER\0"
+/*  1807 */ "x509fmtder\0"
+/*  1818 */ "Send the openpgp fingerprint, instead of the key\0"
+/*  1867 */ "FINGERPRINT\0"
+/*  1879 */ "fingerprint\0"
+/*  1891 */ "Disable all the TLS extensions\0"
+/*  1922 */ "DISABLE_EXTENSIONS\0"
+/*  1941 */ "disable-extensions\0"
+/*  1960 */ "Print peer's certificate in PEM format\0"
+/*  1999 */ "PRINT_CERT\0"
+/*  2010 */ "print-cert\0"
+/*  2021 */ "The maximum record size to advertize\0"
+/*  2058 */ "RECORDSIZE\0"
+/*  2069 */ "recordsize\0"
+/*  2080 */ "The minimum number of bits allowed for DH\0"
+/*  2122 */ "DH_BITS\0"
+/*  2130 */ "dh-bits\0"
+/*  2138 */ "Priorities string\0"
+/*  2156 */ "PRIORITY\0"
+/*  2165 */ "priority\0"
+/*  2174 */ "Certificate file or PKCS #11 URL to use\0"
+/*  2214 */ "X509CAFILE\0"
+/*  2225 */ "x509cafile\0"
+/*  2236 */ "CRL file to use\0"
+/*  2252 */ "X509CRLFILE\0"
+/*  2264 */ "x509crlfile\0"
+/*  2276 */ "PGP Key file to use\0"
+/*  2296 */ "PGPKEYFILE\0"
+/*  2307 */ "pgpkeyfile\0"
+/*  2318 */ "PGP Key ring file to use\0"
+/*  2343 */ "PGPKEYRING\0"
+/*  2354 */ "pgpkeyring\0"
+/*  2365 */ "PGP Public Key (certificate) file to use\0"
+/*  2406 */ "PGPCERTFILE\0"
+/*  2418 */ "pgpcertfile\0"
+/*  2430 */ "X.509 key file or PKCS #11 URL to use\0"
+/*  2468 */ "X509KEYFILE\0"
+/*  2480 */ "x509keyfile\0"
+/*  2492 */ "X.509 Certificate file or PKCS #11 URL to use\0"
+/*  2538 */ "X509CERTFILE\0"
+/*  2551 */ "x509certfile\0"
+/*  2564 */ "PGP subkey to use (hex or auto)\0"
+/*  2596 */ "PGPSUBKEY\0"
+/*  2606 */ "pgpsubkey\0"
+/*  2616 */ "SRP username to use\0"
+/*  2636 */ "SRPUSERNAME\0"
+/*  2648 */ "srpusername\0"
+/*  2660 */ "SRP password to use\0"
+/*  2680 */ "SRPPASSWD\0"
+/*  2690 */ "srppasswd\0"
+/*  2700 */ "PSK username to use\0"
+/*  2720 */ "PSKUSERNAME\0"
+/*  2732 */ "pskusername\0"
+/*  2744 */ "PSK key (in hex) to use\0"
+/*  2768 */ "PSKKEY\0"
+/*  2775 */ "pskkey\0"
+/*  2782 */ "The port or service to connect to\0"
+/*  2816 */ "PORT\0"
+/*  2821 */ "port\0"
+/*  2826 */ "Don't abort program if server certificate can't be validated\0"
+/*  2887 */ "INSECURE\0"
+/*  2896 */ "insecure\0"
+/*  2905 */ "Benchmark individual ciphers\0"
+/*  2934 */ "BENCHMARK_CIPHERS\0"
+/*  2952 */ "benchmark-ciphers\0"
+/*  2970 */ "Benchmark individual software ciphers (no hw acceleration)\0"
+/*  3029 */ "BENCHMARK_SOFT_CIPHERS\0"
+/*  3052 */ "benchmark-soft-ciphers\0"
+/*  3075 */ "Benchmark TLS key exchange methods\0"
+/*  3110 */ "BENCHMARK_TLS_KX\0"
+/*  3127 */ "benchmark-tls-kx\0"
+/*  3144 */ "Benchmark TLS ciphers\0"
+/*  3166 */ "BENCHMARK_TLS_CIPHERS\0"
+/*  3188 */ "benchmark-tls-ciphers\0"
+/*  3210 */ "Print a list of the supported algorithms and modes\0"
+/*  3261 */ "LIST\0"
+/*  3266 */ "list\0"
+/*  3271 */ "Display extended usage information and exit\0"
+/*  3315 */ "help\0"
+/*  3320 */ "Extended usage information passed thru pager\0"
+/*  3365 */ "more-help\0"
+/*  3375 */ "Output version information and exit\0"
+/*  3411 */ "version\0"
+/*  3419 */ "GNUTLS_CLI\0"
+/*  3430 */ "gnutls-cli - GnuTLS client - Ver. @VERSION@\n"
             "USAGE:  %s [ -<flag> [<val>] | --<name>[{=| }<val>] ]... [hostname]\n\0"
-/*  3479 */ "bug-gnutls@gnu.org\0"
-/*  3498 */ "\n\n\0"
-/*  3501 */ "\n"
+/*  3543 */ "bug-gnutls@gnu.org\0"
+/*  3562 */ "\n\n\0"
+/*  3565 */ "\n"
             "Simple client program to set up a TLS connection to some other computer.  It\n"
             "sets up a TLS connection and forwards data from the standard input to the\n"
             "secured socket and vice versa.\n\0"
-/*  3685 */ "gnutls-cli @VERSION@\0"
-/*  3706 */ "Usage: gnutls-cli [options] hostname\n"
+/*  3749 */ "gnutls-cli @VERSION@\0"
+/*  3770 */ "Usage: gnutls-cli [options] hostname\n"
             "gnutls-cli --help for usage instructions.\n";
 
 /*
@@ -305,304 +308,315 @@ static char const gnutls_cli_opt_strs[3786] =
 #define RESUME_name      (gnutls_cli_opt_strs+1301)
 #define RESUME_FLAGS     (OPTST_DISABLED)
 
+/*
+ *  resume-cache option description with
+ *  "Must also have options" and "Incompatible options":
+ */
+#define RESUME_CACHE_DESC      (gnutls_cli_opt_strs+1308)
+#define RESUME_CACHE_NAME      (gnutls_cli_opt_strs+1346)
+#define RESUME_CACHE_name      (gnutls_cli_opt_strs+1359)
+static int const aResume_CacheMustList[] = {
+    INDEX_OPT_RESUME, NO_EQUIVALENT };
+#define RESUME_CACHE_FLAGS     (OPTST_DISABLED)
+
 /*
  *  heartbeat option description:
  */
-#define HEARTBEAT_DESC      (gnutls_cli_opt_strs+1308)
-#define HEARTBEAT_NAME      (gnutls_cli_opt_strs+1335)
-#define HEARTBEAT_name      (gnutls_cli_opt_strs+1345)
+#define HEARTBEAT_DESC      (gnutls_cli_opt_strs+1372)
+#define HEARTBEAT_NAME      (gnutls_cli_opt_strs+1399)
+#define HEARTBEAT_name      (gnutls_cli_opt_strs+1409)
 #define HEARTBEAT_FLAGS     (OPTST_DISABLED)
 
 /*
  *  rehandshake option description:
  */
-#define REHANDSHAKE_DESC      (gnutls_cli_opt_strs+1355)
-#define REHANDSHAKE_NAME      (gnutls_cli_opt_strs+1391)
-#define REHANDSHAKE_name      (gnutls_cli_opt_strs+1403)
+#define REHANDSHAKE_DESC      (gnutls_cli_opt_strs+1419)
+#define REHANDSHAKE_NAME      (gnutls_cli_opt_strs+1455)
+#define REHANDSHAKE_name      (gnutls_cli_opt_strs+1467)
 #define REHANDSHAKE_FLAGS     (OPTST_DISABLED)
 
 /*
  *  noticket option description:
  */
-#define NOTICKET_DESC      (gnutls_cli_opt_strs+1415)
-#define NOTICKET_NAME      (gnutls_cli_opt_strs+1444)
-#define NOTICKET_name      (gnutls_cli_opt_strs+1453)
+#define NOTICKET_DESC      (gnutls_cli_opt_strs+1479)
+#define NOTICKET_NAME      (gnutls_cli_opt_strs+1508)
+#define NOTICKET_name      (gnutls_cli_opt_strs+1517)
 #define NOTICKET_FLAGS     (OPTST_DISABLED)
 
 /*
  *  starttls option description:
  */
-#define STARTTLS_DESC      (gnutls_cli_opt_strs+1462)
-#define STARTTLS_NAME      (gnutls_cli_opt_strs+1512)
-#define STARTTLS_name      (gnutls_cli_opt_strs+1521)
+#define STARTTLS_DESC      (gnutls_cli_opt_strs+1526)
+#define STARTTLS_NAME      (gnutls_cli_opt_strs+1576)
+#define STARTTLS_name      (gnutls_cli_opt_strs+1585)
 #define STARTTLS_FLAGS     (OPTST_DISABLED)
 
 /*
  *  udp option description:
  */
-#define UDP_DESC      (gnutls_cli_opt_strs+1530)
-#define UDP_NAME      (gnutls_cli_opt_strs+1563)
-#define UDP_name      (gnutls_cli_opt_strs+1567)
+#define UDP_DESC      (gnutls_cli_opt_strs+1594)
+#define UDP_NAME      (gnutls_cli_opt_strs+1627)
+#define UDP_name      (gnutls_cli_opt_strs+1631)
 #define UDP_FLAGS     (OPTST_DISABLED)
 
 /*
  *  mtu option description:
  */
-#define MTU_DESC      (gnutls_cli_opt_strs+1571)
-#define MTU_NAME      (gnutls_cli_opt_strs+1596)
-#define MTU_name      (gnutls_cli_opt_strs+1600)
+#define MTU_DESC      (gnutls_cli_opt_strs+1635)
+#define MTU_NAME      (gnutls_cli_opt_strs+1660)
+#define MTU_name      (gnutls_cli_opt_strs+1664)
 #define MTU_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_NUMERIC))
 
 /*
  *  srtp_profiles option description:
  */
-#define SRTP_PROFILES_DESC      (gnutls_cli_opt_strs+1604)
-#define SRTP_PROFILES_NAME      (gnutls_cli_opt_strs+1624)
-#define SRTP_PROFILES_name      (gnutls_cli_opt_strs+1638)
+#define SRTP_PROFILES_DESC      (gnutls_cli_opt_strs+1668)
+#define SRTP_PROFILES_NAME      (gnutls_cli_opt_strs+1688)
+#define SRTP_PROFILES_name      (gnutls_cli_opt_strs+1702)
 #define SRTP_PROFILES_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_STRING))
 
 /*
  *  crlf option description:
  */
-#define CRLF_DESC      (gnutls_cli_opt_strs+1652)
-#define CRLF_NAME      (gnutls_cli_opt_strs+1677)
-#define CRLF_name      (gnutls_cli_opt_strs+1682)
+#define CRLF_DESC      (gnutls_cli_opt_strs+1716)
+#define CRLF_NAME      (gnutls_cli_opt_strs+1741)
+#define CRLF_name      (gnutls_cli_opt_strs+1746)
 #define CRLF_FLAGS     (OPTST_DISABLED)
 
 /*
  *  x509fmtder option description:
  */
-#define X509FMTDER_DESC      (gnutls_cli_opt_strs+1687)
-#define X509FMTDER_NAME      (gnutls_cli_opt_strs+1732)
-#define X509FMTDER_name      (gnutls_cli_opt_strs+1743)
+#define X509FMTDER_DESC      (gnutls_cli_opt_strs+1751)
+#define X509FMTDER_NAME      (gnutls_cli_opt_strs+1796)
+#define X509FMTDER_name      (gnutls_cli_opt_strs+1807)
 #define X509FMTDER_FLAGS     (OPTST_DISABLED)
 
 /*
  *  fingerprint option description:
  */
-#define FINGERPRINT_DESC      (gnutls_cli_opt_strs+1754)
-#define FINGERPRINT_NAME      (gnutls_cli_opt_strs+1803)
-#define FINGERPRINT_name      (gnutls_cli_opt_strs+1815)
+#define FINGERPRINT_DESC      (gnutls_cli_opt_strs+1818)
+#define FINGERPRINT_NAME      (gnutls_cli_opt_strs+1867)
+#define FINGERPRINT_name      (gnutls_cli_opt_strs+1879)
 #define FINGERPRINT_FLAGS     (OPTST_DISABLED)
 
 /*
  *  disable-extensions option description:
  */
-#define DISABLE_EXTENSIONS_DESC      (gnutls_cli_opt_strs+1827)
-#define DISABLE_EXTENSIONS_NAME      (gnutls_cli_opt_strs+1858)
-#define DISABLE_EXTENSIONS_name      (gnutls_cli_opt_strs+1877)
+#define DISABLE_EXTENSIONS_DESC      (gnutls_cli_opt_strs+1891)
+#define DISABLE_EXTENSIONS_NAME      (gnutls_cli_opt_strs+1922)
+#define DISABLE_EXTENSIONS_name      (gnutls_cli_opt_strs+1941)
 #define DISABLE_EXTENSIONS_FLAGS     (OPTST_DISABLED)
 
 /*
  *  print-cert option description:
  */
-#define PRINT_CERT_DESC      (gnutls_cli_opt_strs+1896)
-#define PRINT_CERT_NAME      (gnutls_cli_opt_strs+1935)
-#define PRINT_CERT_name      (gnutls_cli_opt_strs+1946)
+#define PRINT_CERT_DESC      (gnutls_cli_opt_strs+1960)
+#define PRINT_CERT_NAME      (gnutls_cli_opt_strs+1999)
+#define PRINT_CERT_name      (gnutls_cli_opt_strs+2010)
 #define PRINT_CERT_FLAGS     (OPTST_DISABLED)
 
 /*
  *  recordsize option description:
  */
-#define RECORDSIZE_DESC      (gnutls_cli_opt_strs+1957)
-#define RECORDSIZE_NAME      (gnutls_cli_opt_strs+1994)
-#define RECORDSIZE_name      (gnutls_cli_opt_strs+2005)
+#define RECORDSIZE_DESC      (gnutls_cli_opt_strs+2021)
+#define RECORDSIZE_NAME      (gnutls_cli_opt_strs+2058)
+#define RECORDSIZE_name      (gnutls_cli_opt_strs+2069)
 #define RECORDSIZE_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_NUMERIC))
 
 /*
  *  dh-bits option description:
  */
-#define DH_BITS_DESC      (gnutls_cli_opt_strs+2016)
-#define DH_BITS_NAME      (gnutls_cli_opt_strs+2058)
-#define DH_BITS_name      (gnutls_cli_opt_strs+2066)
+#define DH_BITS_DESC      (gnutls_cli_opt_strs+2080)
+#define DH_BITS_NAME      (gnutls_cli_opt_strs+2122)
+#define DH_BITS_name      (gnutls_cli_opt_strs+2130)
 #define DH_BITS_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_NUMERIC))
 
 /*
  *  priority option description:
  */
-#define PRIORITY_DESC      (gnutls_cli_opt_strs+2074)
-#define PRIORITY_NAME      (gnutls_cli_opt_strs+2092)
-#define PRIORITY_name      (gnutls_cli_opt_strs+2101)
+#define PRIORITY_DESC      (gnutls_cli_opt_strs+2138)
+#define PRIORITY_NAME      (gnutls_cli_opt_strs+2156)
+#define PRIORITY_name      (gnutls_cli_opt_strs+2165)
 #define PRIORITY_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_STRING))
 
 /*
  *  x509cafile option description:
  */
-#define X509CAFILE_DESC      (gnutls_cli_opt_strs+2110)
-#define X509CAFILE_NAME      (gnutls_cli_opt_strs+2150)
-#define X509CAFILE_name      (gnutls_cli_opt_strs+2161)
+#define X509CAFILE_DESC      (gnutls_cli_opt_strs+2174)
+#define X509CAFILE_NAME      (gnutls_cli_opt_strs+2214)
+#define X509CAFILE_name      (gnutls_cli_opt_strs+2225)
 #define X509CAFILE_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_STRING))
 
 /*
  *  x509crlfile option description:
  */
-#define X509CRLFILE_DESC      (gnutls_cli_opt_strs+2172)
-#define X509CRLFILE_NAME      (gnutls_cli_opt_strs+2188)
-#define X509CRLFILE_name      (gnutls_cli_opt_strs+2200)
+#define X509CRLFILE_DESC      (gnutls_cli_opt_strs+2236)
+#define X509CRLFILE_NAME      (gnutls_cli_opt_strs+2252)
+#define X509CRLFILE_name      (gnutls_cli_opt_strs+2264)
 #define X509CRLFILE_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_FILE))
 
 /*
  *  pgpkeyfile option description:
  */
-#define PGPKEYFILE_DESC      (gnutls_cli_opt_strs+2212)
-#define PGPKEYFILE_NAME      (gnutls_cli_opt_strs+2232)
-#define PGPKEYFILE_name      (gnutls_cli_opt_strs+2243)
+#define PGPKEYFILE_DESC      (gnutls_cli_opt_strs+2276)
+#define PGPKEYFILE_NAME      (gnutls_cli_opt_strs+2296)
+#define PGPKEYFILE_name      (gnutls_cli_opt_strs+2307)
 #define PGPKEYFILE_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_FILE))
 
 /*
  *  pgpkeyring option description:
  */
-#define PGPKEYRING_DESC      (gnutls_cli_opt_strs+2254)
-#define PGPKEYRING_NAME      (gnutls_cli_opt_strs+2279)
-#define PGPKEYRING_name      (gnutls_cli_opt_strs+2290)
+#define PGPKEYRING_DESC      (gnutls_cli_opt_strs+2318)
+#define PGPKEYRING_NAME      (gnutls_cli_opt_strs+2343)
+#define PGPKEYRING_name      (gnutls_cli_opt_strs+2354)
 #define PGPKEYRING_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_FILE))
 
 /*
  *  pgpcertfile option description:
  */
-#define PGPCERTFILE_DESC      (gnutls_cli_opt_strs+2301)
-#define PGPCERTFILE_NAME      (gnutls_cli_opt_strs+2342)
-#define PGPCERTFILE_name      (gnutls_cli_opt_strs+2354)
+#define PGPCERTFILE_DESC      (gnutls_cli_opt_strs+2365)
+#define PGPCERTFILE_NAME      (gnutls_cli_opt_strs+2406)
+#define PGPCERTFILE_name      (gnutls_cli_opt_strs+2418)
 #define PGPCERTFILE_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_FILE))
 
 /*
  *  x509keyfile option description:
  */
-#define X509KEYFILE_DESC      (gnutls_cli_opt_strs+2366)
-#define X509KEYFILE_NAME      (gnutls_cli_opt_strs+2404)
-#define X509KEYFILE_name      (gnutls_cli_opt_strs+2416)
+#define X509KEYFILE_DESC      (gnutls_cli_opt_strs+2430)
+#define X509KEYFILE_NAME      (gnutls_cli_opt_strs+2468)
+#define X509KEYFILE_name      (gnutls_cli_opt_strs+2480)
 #define X509KEYFILE_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_STRING))
 
 /*
  *  x509certfile option description:
  */
-#define X509CERTFILE_DESC      (gnutls_cli_opt_strs+2428)
-#define X509CERTFILE_NAME      (gnutls_cli_opt_strs+2474)
-#define X509CERTFILE_name      (gnutls_cli_opt_strs+2487)
+#define X509CERTFILE_DESC      (gnutls_cli_opt_strs+2492)
+#define X509CERTFILE_NAME      (gnutls_cli_opt_strs+2538)
+#define X509CERTFILE_name      (gnutls_cli_opt_strs+2551)
 #define X509CERTFILE_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_STRING))
 
 /*
  *  pgpsubkey option description:
  */
-#define PGPSUBKEY_DESC      (gnutls_cli_opt_strs+2500)
-#define PGPSUBKEY_NAME      (gnutls_cli_opt_strs+2532)
-#define PGPSUBKEY_name      (gnutls_cli_opt_strs+2542)
+#define PGPSUBKEY_DESC      (gnutls_cli_opt_strs+2564)
+#define PGPSUBKEY_NAME      (gnutls_cli_opt_strs+2596)
+#define PGPSUBKEY_name      (gnutls_cli_opt_strs+2606)
 #define PGPSUBKEY_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_STRING))
 
 /*
  *  srpusername option description:
  */
-#define SRPUSERNAME_DESC      (gnutls_cli_opt_strs+2552)
-#define SRPUSERNAME_NAME      (gnutls_cli_opt_strs+2572)
-#define SRPUSERNAME_name      (gnutls_cli_opt_strs+2584)
+#define SRPUSERNAME_DESC      (gnutls_cli_opt_strs+2616)
+#define SRPUSERNAME_NAME      (gnutls_cli_opt_strs+2636)
+#define SRPUSERNAME_name      (gnutls_cli_opt_strs+2648)
 #define SRPUSERNAME_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_STRING))
 
 /*
  *  srppasswd option description:
  */
-#define SRPPASSWD_DESC      (gnutls_cli_opt_strs+2596)
-#define SRPPASSWD_NAME      (gnutls_cli_opt_strs+2616)
-#define SRPPASSWD_name      (gnutls_cli_opt_strs+2626)
+#define SRPPASSWD_DESC      (gnutls_cli_opt_strs+2660)
+#define SRPPASSWD_NAME      (gnutls_cli_opt_strs+2680)
+#define SRPPASSWD_name      (gnutls_cli_opt_strs+2690)
 #define SRPPASSWD_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_STRING))
 
 /*
  *  pskusername option description:
  */
-#define PSKUSERNAME_DESC      (gnutls_cli_opt_strs+2636)
-#define PSKUSERNAME_NAME      (gnutls_cli_opt_strs+2656)
-#define PSKUSERNAME_name      (gnutls_cli_opt_strs+2668)
+#define PSKUSERNAME_DESC      (gnutls_cli_opt_strs+2700)
+#define PSKUSERNAME_NAME      (gnutls_cli_opt_strs+2720)
+#define PSKUSERNAME_name      (gnutls_cli_opt_strs+2732)
 #define PSKUSERNAME_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_STRING))
 
 /*
  *  pskkey option description:
  */
-#define PSKKEY_DESC      (gnutls_cli_opt_strs+2680)
-#define PSKKEY_NAME      (gnutls_cli_opt_strs+2704)
-#define PSKKEY_name      (gnutls_cli_opt_strs+2711)
+#define PSKKEY_DESC      (gnutls_cli_opt_strs+2744)
+#define PSKKEY_NAME      (gnutls_cli_opt_strs+2768)
+#define PSKKEY_name      (gnutls_cli_opt_strs+2775)
 #define PSKKEY_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_STRING))
 
 /*
  *  port option description:
  */
-#define PORT_DESC      (gnutls_cli_opt_strs+2718)
-#define PORT_NAME      (gnutls_cli_opt_strs+2752)
-#define PORT_name      (gnutls_cli_opt_strs+2757)
+#define PORT_DESC      (gnutls_cli_opt_strs+2782)
+#define PORT_NAME      (gnutls_cli_opt_strs+2816)
+#define PORT_name      (gnutls_cli_opt_strs+2821)
 #define PORT_FLAGS     (OPTST_DISABLED \
         | OPTST_SET_ARGTYPE(OPARG_TYPE_STRING))
 
 /*
  *  insecure option description:
  */
-#define INSECURE_DESC      (gnutls_cli_opt_strs+2762)
-#define INSECURE_NAME      (gnutls_cli_opt_strs+2823)
-#define INSECURE_name      (gnutls_cli_opt_strs+2832)
+#define INSECURE_DESC      (gnutls_cli_opt_strs+2826)
+#define INSECURE_NAME      (gnutls_cli_opt_strs+2887)
+#define INSECURE_name      (gnutls_cli_opt_strs+2896)
 #define INSECURE_FLAGS     (OPTST_DISABLED)
 
 /*
  *  benchmark-ciphers option description:
  */
-#define BENCHMARK_CIPHERS_DESC      (gnutls_cli_opt_strs+2841)
-#define BENCHMARK_CIPHERS_NAME      (gnutls_cli_opt_strs+2870)
-#define BENCHMARK_CIPHERS_name      (gnutls_cli_opt_strs+2888)
+#define BENCHMARK_CIPHERS_DESC      (gnutls_cli_opt_strs+2905)
+#define BENCHMARK_CIPHERS_NAME      (gnutls_cli_opt_strs+2934)
+#define BENCHMARK_CIPHERS_name      (gnutls_cli_opt_strs+2952)
 #define BENCHMARK_CIPHERS_FLAGS     (OPTST_DISABLED)
 
 /*
  *  benchmark-soft-ciphers option description:
  */
-#define BENCHMARK_SOFT_CIPHERS_DESC      (gnutls_cli_opt_strs+2906)
-#define BENCHMARK_SOFT_CIPHERS_NAME      (gnutls_cli_opt_strs+2965)
-#define BENCHMARK_SOFT_CIPHERS_name      (gnutls_cli_opt_strs+2988)
+#define BENCHMARK_SOFT_CIPHERS_DESC      (gnutls_cli_opt_strs+2970)
+#define BENCHMARK_SOFT_CIPHERS_NAME      (gnutls_cli_opt_strs+3029)
+#define BENCHMARK_SOFT_CIPHERS_name      (gnutls_cli_opt_strs+3052)
 #define BENCHMARK_SOFT_CIPHERS_FLAGS     (OPTST_DISABLED)
 
 /*
  *  benchmark-tls-kx option description:
  */
-#define BENCHMARK_TLS_KX_DESC      (gnutls_cli_opt_strs+3011)
-#define BENCHMARK_TLS_KX_NAME      (gnutls_cli_opt_strs+3046)
-#define BENCHMARK_TLS_KX_name      (gnutls_cli_opt_strs+3063)
+#define BENCHMARK_TLS_KX_DESC      (gnutls_cli_opt_strs+3075)
+#define BENCHMARK_TLS_KX_NAME      (gnutls_cli_opt_strs+3110)
+#define BENCHMARK_TLS_KX_name      (gnutls_cli_opt_strs+3127)
 #define BENCHMARK_TLS_KX_FLAGS     (OPTST_DISABLED)
 
 /*
  *  benchmark-tls-ciphers option description:
  */
-#define BENCHMARK_TLS_CIPHERS_DESC      (gnutls_cli_opt_strs+3080)
-#define BENCHMARK_TLS_CIPHERS_NAME      (gnutls_cli_opt_strs+3102)
-#define BENCHMARK_TLS_CIPHERS_name      (gnutls_cli_opt_strs+3124)
+#define BENCHMARK_TLS_CIPHERS_DESC      (gnutls_cli_opt_strs+3144)
+#define BENCHMARK_TLS_CIPHERS_NAME      (gnutls_cli_opt_strs+3166)
+#define BENCHMARK_TLS_CIPHERS_name      (gnutls_cli_opt_strs+3188)
 #define BENCHMARK_TLS_CIPHERS_FLAGS     (OPTST_DISABLED)
 
 /*
  *  list option description:
  */
-#define LIST_DESC      (gnutls_cli_opt_strs+3146)
-#define LIST_NAME      (gnutls_cli_opt_strs+3197)
-#define LIST_name      (gnutls_cli_opt_strs+3202)
+#define LIST_DESC      (gnutls_cli_opt_strs+3210)
+#define LIST_NAME      (gnutls_cli_opt_strs+3261)
+#define LIST_name      (gnutls_cli_opt_strs+3266)
 #define LIST_FLAGS     (OPTST_DISABLED)
 
 /*
  *  Help/More_Help/Version option descriptions:
  */
-#define HELP_DESC       (gnutls_cli_opt_strs+3207)
-#define HELP_name       (gnutls_cli_opt_strs+3251)
+#define HELP_DESC       (gnutls_cli_opt_strs+3271)
+#define HELP_name       (gnutls_cli_opt_strs+3315)
 #ifdef HAVE_WORKING_FORK
-#define MORE_HELP_DESC  (gnutls_cli_opt_strs+3256)
-#define MORE_HELP_name  (gnutls_cli_opt_strs+3301)
+#define MORE_HELP_DESC  (gnutls_cli_opt_strs+3320)
+#define MORE_HELP_name  (gnutls_cli_opt_strs+3365)
 #define MORE_HELP_FLAGS (OPTST_IMM | OPTST_NO_INIT)
 #else
 #define MORE_HELP_DESC  NULL
@@ -615,8 +629,8 @@ static char const gnutls_cli_opt_strs[3786] =
 #  define VER_FLAGS     (OPTST_SET_ARGTYPE(OPARG_TYPE_STRING) | \
                          OPTST_ARG_OPTIONAL | OPTST_IMM | OPTST_NO_INIT)
 #endif
-#define VER_DESC        (gnutls_cli_opt_strs+3311)
-#define VER_name        (gnutls_cli_opt_strs+3347)
+#define VER_DESC        (gnutls_cli_opt_strs+3375)
+#define VER_name        (gnutls_cli_opt_strs+3411)
 /*
  *  Declare option callback procedures
  */
@@ -733,8 +747,20 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ RESUME_DESC, RESUME_NAME, RESUME_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 8, VALUE_OPT_HEARTBEAT,
-     /* equiv idx, value */ 8, VALUE_OPT_HEARTBEAT,
+  {  /* entry idx, value */ 8, VALUE_OPT_RESUME_CACHE,
+     /* equiv idx, value */ 8, VALUE_OPT_RESUME_CACHE,
+     /* equivalenced to  */ NO_EQUIVALENT,
+     /* min, max, act ct */ 0, 1, 0,
+     /* opt state flags  */ RESUME_CACHE_FLAGS, 0,
+     /* last opt argumnt */ { NULL }, /* --resume-cache */
+     /* arg list/cookie  */ NULL,
+     /* must/cannot opts */ aResume_CacheMustList, NULL,
+     /* option proc      */ NULL,
+     /* desc, NAME, name */ RESUME_CACHE_DESC, RESUME_CACHE_NAME, RESUME_CACHE_name,
+     /* disablement strs */ NULL, NULL },
+
+  {  /* entry idx, value */ 9, VALUE_OPT_HEARTBEAT,
+     /* equiv idx, value */ 9, VALUE_OPT_HEARTBEAT,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ HEARTBEAT_FLAGS, 0,
@@ -745,8 +771,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ HEARTBEAT_DESC, HEARTBEAT_NAME, HEARTBEAT_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 9, VALUE_OPT_REHANDSHAKE,
-     /* equiv idx, value */ 9, VALUE_OPT_REHANDSHAKE,
+  {  /* entry idx, value */ 10, VALUE_OPT_REHANDSHAKE,
+     /* equiv idx, value */ 10, VALUE_OPT_REHANDSHAKE,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ REHANDSHAKE_FLAGS, 0,
@@ -757,8 +783,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ REHANDSHAKE_DESC, REHANDSHAKE_NAME, REHANDSHAKE_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 10, VALUE_OPT_NOTICKET,
-     /* equiv idx, value */ 10, VALUE_OPT_NOTICKET,
+  {  /* entry idx, value */ 11, VALUE_OPT_NOTICKET,
+     /* equiv idx, value */ 11, VALUE_OPT_NOTICKET,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ NOTICKET_FLAGS, 0,
@@ -769,8 +795,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ NOTICKET_DESC, NOTICKET_NAME, NOTICKET_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 11, VALUE_OPT_STARTTLS,
-     /* equiv idx, value */ 11, VALUE_OPT_STARTTLS,
+  {  /* entry idx, value */ 12, VALUE_OPT_STARTTLS,
+     /* equiv idx, value */ 12, VALUE_OPT_STARTTLS,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ STARTTLS_FLAGS, 0,
@@ -781,8 +807,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ STARTTLS_DESC, STARTTLS_NAME, STARTTLS_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 12, VALUE_OPT_UDP,
-     /* equiv idx, value */ 12, VALUE_OPT_UDP,
+  {  /* entry idx, value */ 13, VALUE_OPT_UDP,
+     /* equiv idx, value */ 13, VALUE_OPT_UDP,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ UDP_FLAGS, 0,
@@ -793,8 +819,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ UDP_DESC, UDP_NAME, UDP_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 13, VALUE_OPT_MTU,
-     /* equiv idx, value */ 13, VALUE_OPT_MTU,
+  {  /* entry idx, value */ 14, VALUE_OPT_MTU,
+     /* equiv idx, value */ 14, VALUE_OPT_MTU,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ MTU_FLAGS, 0,
@@ -805,8 +831,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ MTU_DESC, MTU_NAME, MTU_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 14, VALUE_OPT_SRTP_PROFILES,
-     /* equiv idx, value */ 14, VALUE_OPT_SRTP_PROFILES,
+  {  /* entry idx, value */ 15, VALUE_OPT_SRTP_PROFILES,
+     /* equiv idx, value */ 15, VALUE_OPT_SRTP_PROFILES,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ SRTP_PROFILES_FLAGS, 0,
@@ -817,8 +843,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ SRTP_PROFILES_DESC, SRTP_PROFILES_NAME, SRTP_PROFILES_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 15, VALUE_OPT_CRLF,
-     /* equiv idx, value */ 15, VALUE_OPT_CRLF,
+  {  /* entry idx, value */ 16, VALUE_OPT_CRLF,
+     /* equiv idx, value */ 16, VALUE_OPT_CRLF,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ CRLF_FLAGS, 0,
@@ -829,8 +855,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ CRLF_DESC, CRLF_NAME, CRLF_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 16, VALUE_OPT_X509FMTDER,
-     /* equiv idx, value */ 16, VALUE_OPT_X509FMTDER,
+  {  /* entry idx, value */ 17, VALUE_OPT_X509FMTDER,
+     /* equiv idx, value */ 17, VALUE_OPT_X509FMTDER,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ X509FMTDER_FLAGS, 0,
@@ -841,8 +867,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ X509FMTDER_DESC, X509FMTDER_NAME, X509FMTDER_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 17, VALUE_OPT_FINGERPRINT,
-     /* equiv idx, value */ 17, VALUE_OPT_FINGERPRINT,
+  {  /* entry idx, value */ 18, VALUE_OPT_FINGERPRINT,
+     /* equiv idx, value */ 18, VALUE_OPT_FINGERPRINT,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ FINGERPRINT_FLAGS, 0,
@@ -853,8 +879,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ FINGERPRINT_DESC, FINGERPRINT_NAME, FINGERPRINT_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 18, VALUE_OPT_DISABLE_EXTENSIONS,
-     /* equiv idx, value */ 18, VALUE_OPT_DISABLE_EXTENSIONS,
+  {  /* entry idx, value */ 19, VALUE_OPT_DISABLE_EXTENSIONS,
+     /* equiv idx, value */ 19, VALUE_OPT_DISABLE_EXTENSIONS,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ DISABLE_EXTENSIONS_FLAGS, 0,
@@ -865,8 +891,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ DISABLE_EXTENSIONS_DESC, DISABLE_EXTENSIONS_NAME, DISABLE_EXTENSIONS_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 19, VALUE_OPT_PRINT_CERT,
-     /* equiv idx, value */ 19, VALUE_OPT_PRINT_CERT,
+  {  /* entry idx, value */ 20, VALUE_OPT_PRINT_CERT,
+     /* equiv idx, value */ 20, VALUE_OPT_PRINT_CERT,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ PRINT_CERT_FLAGS, 0,
@@ -877,8 +903,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ PRINT_CERT_DESC, PRINT_CERT_NAME, PRINT_CERT_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 20, VALUE_OPT_RECORDSIZE,
-     /* equiv idx, value */ 20, VALUE_OPT_RECORDSIZE,
+  {  /* entry idx, value */ 21, VALUE_OPT_RECORDSIZE,
+     /* equiv idx, value */ 21, VALUE_OPT_RECORDSIZE,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ RECORDSIZE_FLAGS, 0,
@@ -889,8 +915,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ RECORDSIZE_DESC, RECORDSIZE_NAME, RECORDSIZE_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 21, VALUE_OPT_DH_BITS,
-     /* equiv idx, value */ 21, VALUE_OPT_DH_BITS,
+  {  /* entry idx, value */ 22, VALUE_OPT_DH_BITS,
+     /* equiv idx, value */ 22, VALUE_OPT_DH_BITS,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ DH_BITS_FLAGS, 0,
@@ -901,8 +927,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ DH_BITS_DESC, DH_BITS_NAME, DH_BITS_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 22, VALUE_OPT_PRIORITY,
-     /* equiv idx, value */ 22, VALUE_OPT_PRIORITY,
+  {  /* entry idx, value */ 23, VALUE_OPT_PRIORITY,
+     /* equiv idx, value */ 23, VALUE_OPT_PRIORITY,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ PRIORITY_FLAGS, 0,
@@ -913,8 +939,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ PRIORITY_DESC, PRIORITY_NAME, PRIORITY_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 23, VALUE_OPT_X509CAFILE,
-     /* equiv idx, value */ 23, VALUE_OPT_X509CAFILE,
+  {  /* entry idx, value */ 24, VALUE_OPT_X509CAFILE,
+     /* equiv idx, value */ 24, VALUE_OPT_X509CAFILE,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ X509CAFILE_FLAGS, 0,
@@ -925,8 +951,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ X509CAFILE_DESC, X509CAFILE_NAME, X509CAFILE_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 24, VALUE_OPT_X509CRLFILE,
-     /* equiv idx, value */ 24, VALUE_OPT_X509CRLFILE,
+  {  /* entry idx, value */ 25, VALUE_OPT_X509CRLFILE,
+     /* equiv idx, value */ 25, VALUE_OPT_X509CRLFILE,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ X509CRLFILE_FLAGS, 0,
@@ -937,8 +963,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ X509CRLFILE_DESC, X509CRLFILE_NAME, X509CRLFILE_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 25, VALUE_OPT_PGPKEYFILE,
-     /* equiv idx, value */ 25, VALUE_OPT_PGPKEYFILE,
+  {  /* entry idx, value */ 26, VALUE_OPT_PGPKEYFILE,
+     /* equiv idx, value */ 26, VALUE_OPT_PGPKEYFILE,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ PGPKEYFILE_FLAGS, 0,
@@ -949,8 +975,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ PGPKEYFILE_DESC, PGPKEYFILE_NAME, PGPKEYFILE_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 26, VALUE_OPT_PGPKEYRING,
-     /* equiv idx, value */ 26, VALUE_OPT_PGPKEYRING,
+  {  /* entry idx, value */ 27, VALUE_OPT_PGPKEYRING,
+     /* equiv idx, value */ 27, VALUE_OPT_PGPKEYRING,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ PGPKEYRING_FLAGS, 0,
@@ -961,8 +987,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ PGPKEYRING_DESC, PGPKEYRING_NAME, PGPKEYRING_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 27, VALUE_OPT_PGPCERTFILE,
-     /* equiv idx, value */ 27, VALUE_OPT_PGPCERTFILE,
+  {  /* entry idx, value */ 28, VALUE_OPT_PGPCERTFILE,
+     /* equiv idx, value */ 28, VALUE_OPT_PGPCERTFILE,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ PGPCERTFILE_FLAGS, 0,
@@ -973,8 +999,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ PGPCERTFILE_DESC, PGPCERTFILE_NAME, PGPCERTFILE_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 28, VALUE_OPT_X509KEYFILE,
-     /* equiv idx, value */ 28, VALUE_OPT_X509KEYFILE,
+  {  /* entry idx, value */ 29, VALUE_OPT_X509KEYFILE,
+     /* equiv idx, value */ 29, VALUE_OPT_X509KEYFILE,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ X509KEYFILE_FLAGS, 0,
@@ -985,8 +1011,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ X509KEYFILE_DESC, X509KEYFILE_NAME, X509KEYFILE_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 29, VALUE_OPT_X509CERTFILE,
-     /* equiv idx, value */ 29, VALUE_OPT_X509CERTFILE,
+  {  /* entry idx, value */ 30, VALUE_OPT_X509CERTFILE,
+     /* equiv idx, value */ 30, VALUE_OPT_X509CERTFILE,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ X509CERTFILE_FLAGS, 0,
@@ -997,8 +1023,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ X509CERTFILE_DESC, X509CERTFILE_NAME, X509CERTFILE_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 30, VALUE_OPT_PGPSUBKEY,
-     /* equiv idx, value */ 30, VALUE_OPT_PGPSUBKEY,
+  {  /* entry idx, value */ 31, VALUE_OPT_PGPSUBKEY,
+     /* equiv idx, value */ 31, VALUE_OPT_PGPSUBKEY,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ PGPSUBKEY_FLAGS, 0,
@@ -1009,8 +1035,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ PGPSUBKEY_DESC, PGPSUBKEY_NAME, PGPSUBKEY_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 31, VALUE_OPT_SRPUSERNAME,
-     /* equiv idx, value */ 31, VALUE_OPT_SRPUSERNAME,
+  {  /* entry idx, value */ 32, VALUE_OPT_SRPUSERNAME,
+     /* equiv idx, value */ 32, VALUE_OPT_SRPUSERNAME,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ SRPUSERNAME_FLAGS, 0,
@@ -1021,8 +1047,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ SRPUSERNAME_DESC, SRPUSERNAME_NAME, SRPUSERNAME_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 32, VALUE_OPT_SRPPASSWD,
-     /* equiv idx, value */ 32, VALUE_OPT_SRPPASSWD,
+  {  /* entry idx, value */ 33, VALUE_OPT_SRPPASSWD,
+     /* equiv idx, value */ 33, VALUE_OPT_SRPPASSWD,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ SRPPASSWD_FLAGS, 0,
@@ -1033,8 +1059,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ SRPPASSWD_DESC, SRPPASSWD_NAME, SRPPASSWD_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 33, VALUE_OPT_PSKUSERNAME,
-     /* equiv idx, value */ 33, VALUE_OPT_PSKUSERNAME,
+  {  /* entry idx, value */ 34, VALUE_OPT_PSKUSERNAME,
+     /* equiv idx, value */ 34, VALUE_OPT_PSKUSERNAME,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ PSKUSERNAME_FLAGS, 0,
@@ -1045,8 +1071,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ PSKUSERNAME_DESC, PSKUSERNAME_NAME, PSKUSERNAME_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 34, VALUE_OPT_PSKKEY,
-     /* equiv idx, value */ 34, VALUE_OPT_PSKKEY,
+  {  /* entry idx, value */ 35, VALUE_OPT_PSKKEY,
+     /* equiv idx, value */ 35, VALUE_OPT_PSKKEY,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ PSKKEY_FLAGS, 0,
@@ -1057,8 +1083,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ PSKKEY_DESC, PSKKEY_NAME, PSKKEY_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 35, VALUE_OPT_PORT,
-     /* equiv idx, value */ 35, VALUE_OPT_PORT,
+  {  /* entry idx, value */ 36, VALUE_OPT_PORT,
+     /* equiv idx, value */ 36, VALUE_OPT_PORT,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ PORT_FLAGS, 0,
@@ -1069,8 +1095,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ PORT_DESC, PORT_NAME, PORT_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 36, VALUE_OPT_INSECURE,
-     /* equiv idx, value */ 36, VALUE_OPT_INSECURE,
+  {  /* entry idx, value */ 37, VALUE_OPT_INSECURE,
+     /* equiv idx, value */ 37, VALUE_OPT_INSECURE,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ INSECURE_FLAGS, 0,
@@ -1081,8 +1107,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ INSECURE_DESC, INSECURE_NAME, INSECURE_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 37, VALUE_OPT_BENCHMARK_CIPHERS,
-     /* equiv idx, value */ 37, VALUE_OPT_BENCHMARK_CIPHERS,
+  {  /* entry idx, value */ 38, VALUE_OPT_BENCHMARK_CIPHERS,
+     /* equiv idx, value */ 38, VALUE_OPT_BENCHMARK_CIPHERS,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ BENCHMARK_CIPHERS_FLAGS, 0,
@@ -1093,8 +1119,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ BENCHMARK_CIPHERS_DESC, BENCHMARK_CIPHERS_NAME, BENCHMARK_CIPHERS_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 38, VALUE_OPT_BENCHMARK_SOFT_CIPHERS,
-     /* equiv idx, value */ 38, VALUE_OPT_BENCHMARK_SOFT_CIPHERS,
+  {  /* entry idx, value */ 39, VALUE_OPT_BENCHMARK_SOFT_CIPHERS,
+     /* equiv idx, value */ 39, VALUE_OPT_BENCHMARK_SOFT_CIPHERS,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ BENCHMARK_SOFT_CIPHERS_FLAGS, 0,
@@ -1105,8 +1131,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ BENCHMARK_SOFT_CIPHERS_DESC, BENCHMARK_SOFT_CIPHERS_NAME, BENCHMARK_SOFT_CIPHERS_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 39, VALUE_OPT_BENCHMARK_TLS_KX,
-     /* equiv idx, value */ 39, VALUE_OPT_BENCHMARK_TLS_KX,
+  {  /* entry idx, value */ 40, VALUE_OPT_BENCHMARK_TLS_KX,
+     /* equiv idx, value */ 40, VALUE_OPT_BENCHMARK_TLS_KX,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ BENCHMARK_TLS_KX_FLAGS, 0,
@@ -1117,8 +1143,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ BENCHMARK_TLS_KX_DESC, BENCHMARK_TLS_KX_NAME, BENCHMARK_TLS_KX_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 40, VALUE_OPT_BENCHMARK_TLS_CIPHERS,
-     /* equiv idx, value */ 40, VALUE_OPT_BENCHMARK_TLS_CIPHERS,
+  {  /* entry idx, value */ 41, VALUE_OPT_BENCHMARK_TLS_CIPHERS,
+     /* equiv idx, value */ 41, VALUE_OPT_BENCHMARK_TLS_CIPHERS,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ BENCHMARK_TLS_CIPHERS_FLAGS, 0,
@@ -1129,8 +1155,8 @@ static tOptDesc optDesc[OPTION_CT] = {
      /* desc, NAME, name */ BENCHMARK_TLS_CIPHERS_DESC, BENCHMARK_TLS_CIPHERS_NAME, BENCHMARK_TLS_CIPHERS_name,
      /* disablement strs */ NULL, NULL },
 
-  {  /* entry idx, value */ 41, VALUE_OPT_LIST,
-     /* equiv idx, value */ 41, VALUE_OPT_LIST,
+  {  /* entry idx, value */ 42, VALUE_OPT_LIST,
+     /* equiv idx, value */ 42, VALUE_OPT_LIST,
      /* equivalenced to  */ NO_EQUIVALENT,
      /* min, max, act ct */ 0, 1, 0,
      /* opt state flags  */ LIST_FLAGS, 0,
@@ -1185,14 +1211,14 @@ static tOptDesc optDesc[OPTION_CT] = {
  *
  *  Define the gnutls-cli Option Environment
  */
-#define zPROGNAME       (gnutls_cli_opt_strs+3355)
-#define zUsageTitle     (gnutls_cli_opt_strs+3366)
+#define zPROGNAME       (gnutls_cli_opt_strs+3419)
+#define zUsageTitle     (gnutls_cli_opt_strs+3430)
 #define zRcName         NULL
 #define apzHomeList     NULL
-#define zBugsAddr       (gnutls_cli_opt_strs+3479)
-#define zExplain        (gnutls_cli_opt_strs+3498)
-#define zDetail         (gnutls_cli_opt_strs+3501)
-#define zFullVersion    (gnutls_cli_opt_strs+3685)
+#define zBugsAddr       (gnutls_cli_opt_strs+3543)
+#define zExplain        (gnutls_cli_opt_strs+3562)
+#define zDetail         (gnutls_cli_opt_strs+3565)
+#define zFullVersion    (gnutls_cli_opt_strs+3749)
 /* extracted from optcode.tlib near line 350 */
 
 #if defined(ENABLE_NLS)
@@ -1206,7 +1232,7 @@ static tOptDesc optDesc[OPTION_CT] = {
 
 #define gnutls_cli_full_usage (NULL)
 
-#define gnutls_cli_short_usage (gnutls_cli_opt_strs+3706)
+#define gnutls_cli_short_usage (gnutls_cli_opt_strs+3770)
 
 #endif /* not defined __doxygen__ */
 
@@ -1484,7 +1510,7 @@ tOptions gnutls_cliOptions = {
       NO_EQUIVALENT, /* '-#' option index */
       NO_EQUIVALENT /* index of default opt */
     },
-    45 /* full option count */, 42 /* user option count */,
+    46 /* full option count */, 43 /* user option count */,
     gnutls_cli_full_usage, gnutls_cli_short_usage,
     NULL, NULL,
     PKGDATADIR, gnutls_cli_packager_info
@@ -75,46 +75,47 @@ typedef enum {
     INDEX_OPT_CA_VERIFICATION         =  5,
     INDEX_OPT_OCSP                    =  6,
     INDEX_OPT_RESUME                  =  7,
-    INDEX_OPT_HEARTBEAT               =  8,
-    INDEX_OPT_REHANDSHAKE             =  9,
-    INDEX_OPT_NOTICKET                = 10,
-    INDEX_OPT_STARTTLS                = 11,
-    INDEX_OPT_UDP                     = 12,
-    INDEX_OPT_MTU                     = 13,
-    INDEX_OPT_SRTP_PROFILES           = 14,
-    INDEX_OPT_CRLF                    = 15,
-    INDEX_OPT_X509FMTDER              = 16,
-    INDEX_OPT_FINGERPRINT             = 17,
-    INDEX_OPT_DISABLE_EXTENSIONS      = 18,
-    INDEX_OPT_PRINT_CERT              = 19,
-    INDEX_OPT_RECORDSIZE              = 20,
-    INDEX_OPT_DH_BITS                 = 21,
-    INDEX_OPT_PRIORITY                = 22,
-    INDEX_OPT_X509CAFILE              = 23,
-    INDEX_OPT_X509CRLFILE             = 24,
-    INDEX_OPT_PGPKEYFILE              = 25,
-    INDEX_OPT_PGPKEYRING              = 26,
-    INDEX_OPT_PGPCERTFILE             = 27,
-    INDEX_OPT_X509KEYFILE             = 28,
-    INDEX_OPT_X509CERTFILE            = 29,
-    INDEX_OPT_PGPSUBKEY               = 30,
-    INDEX_OPT_SRPUSERNAME             = 31,
-    INDEX_OPT_SRPPASSWD               = 32,
-    INDEX_OPT_PSKUSERNAME             = 33,
-    INDEX_OPT_PSKKEY                  = 34,
-    INDEX_OPT_PORT                    = 35,
-    INDEX_OPT_INSECURE                = 36,
-    INDEX_OPT_BENCHMARK_CIPHERS       = 37,
-    INDEX_OPT_BENCHMARK_SOFT_CIPHERS  = 38,
-    INDEX_OPT_BENCHMARK_TLS_KX        = 39,
-    INDEX_OPT_BENCHMARK_TLS_CIPHERS   = 40,
-    INDEX_OPT_LIST                    = 41,
-    INDEX_OPT_VERSION                 = 42,
-    INDEX_OPT_HELP                    = 43,
-    INDEX_OPT_MORE_HELP               = 44
+    INDEX_OPT_RESUME_CACHE            =  8,
+    INDEX_OPT_HEARTBEAT               =  9,
+    INDEX_OPT_REHANDSHAKE             = 10,
+    INDEX_OPT_NOTICKET                = 11,
+    INDEX_OPT_STARTTLS                = 12,
+    INDEX_OPT_UDP                     = 13,
+    INDEX_OPT_MTU                     = 14,
+    INDEX_OPT_SRTP_PROFILES           = 15,
+    INDEX_OPT_CRLF                    = 16,
+    INDEX_OPT_X509FMTDER              = 17,
+    INDEX_OPT_FINGERPRINT             = 18,
+    INDEX_OPT_DISABLE_EXTENSIONS      = 19,
+    INDEX_OPT_PRINT_CERT              = 20,
+    INDEX_OPT_RECORDSIZE              = 21,
+    INDEX_OPT_DH_BITS                 = 22,
+    INDEX_OPT_PRIORITY                = 23,
+    INDEX_OPT_X509CAFILE              = 24,
+    INDEX_OPT_X509CRLFILE             = 25,
+    INDEX_OPT_PGPKEYFILE              = 26,
+    INDEX_OPT_PGPKEYRING              = 27,
+    INDEX_OPT_PGPCERTFILE             = 28,
+    INDEX_OPT_X509KEYFILE             = 29,
+    INDEX_OPT_X509CERTFILE            = 30,
+    INDEX_OPT_PGPSUBKEY               = 31,
+    INDEX_OPT_SRPUSERNAME             = 32,
+    INDEX_OPT_SRPPASSWD               = 33,
+    INDEX_OPT_PSKUSERNAME             = 34,
+    INDEX_OPT_PSKKEY                  = 35,
+    INDEX_OPT_PORT                    = 36,
+    INDEX_OPT_INSECURE                = 37,
+    INDEX_OPT_BENCHMARK_CIPHERS       = 38,
+    INDEX_OPT_BENCHMARK_SOFT_CIPHERS  = 39,
+    INDEX_OPT_BENCHMARK_TLS_KX        = 40,
+    INDEX_OPT_BENCHMARK_TLS_CIPHERS   = 41,
+    INDEX_OPT_LIST                    = 42,
+    INDEX_OPT_VERSION                 = 43,
+    INDEX_OPT_HELP                    = 44,
+    INDEX_OPT_MORE_HELP               = 45
 } teOptIndex;
 
-#define OPTION_CT    45
+#define OPTION_CT    46
 #define GNUTLS_CLI_VERSION       "@VERSION@"
 #define GNUTLS_CLI_FULL_VERSION  "gnutls-cli @VERSION@"
 
@@ -162,45 +163,46 @@ typedef enum {
 #define VALUE_OPT_CA_VERIFICATION 5
 #define VALUE_OPT_OCSP           6
 #define VALUE_OPT_RESUME         'r'
+#define VALUE_OPT_RESUME_CACHE   8
 #define VALUE_OPT_HEARTBEAT      'b'
 #define VALUE_OPT_REHANDSHAKE    'e'
-#define VALUE_OPT_NOTICKET       10
+#define VALUE_OPT_NOTICKET       11
 #define VALUE_OPT_STARTTLS       's'
 #define VALUE_OPT_UDP            'u'
-#define VALUE_OPT_MTU            13
+#define VALUE_OPT_MTU            14
 
 #define OPT_VALUE_MTU            (DESC(MTU).optArg.argInt)
-#define VALUE_OPT_SRTP_PROFILES  14
-#define VALUE_OPT_CRLF           15
-#define VALUE_OPT_X509FMTDER     16
+#define VALUE_OPT_SRTP_PROFILES  15
+#define VALUE_OPT_CRLF           16
+#define VALUE_OPT_X509FMTDER     17
 #define VALUE_OPT_FINGERPRINT    'f'
-#define VALUE_OPT_DISABLE_EXTENSIONS 18
-#define VALUE_OPT_PRINT_CERT     19
-#define VALUE_OPT_RECORDSIZE     20
+#define VALUE_OPT_DISABLE_EXTENSIONS 19
+#define VALUE_OPT_PRINT_CERT     20
+#define VALUE_OPT_RECORDSIZE     21
 
 #define OPT_VALUE_RECORDSIZE     (DESC(RECORDSIZE).optArg.argInt)
-#define VALUE_OPT_DH_BITS        21
+#define VALUE_OPT_DH_BITS        22
 
 #define OPT_VALUE_DH_BITS        (DESC(DH_BITS).optArg.argInt)
-#define VALUE_OPT_PRIORITY       22
-#define VALUE_OPT_X509CAFILE     23
-#define VALUE_OPT_X509CRLFILE    24
-#define VALUE_OPT_PGPKEYFILE     25
-#define VALUE_OPT_PGPKEYRING     26
-#define VALUE_OPT_PGPCERTFILE    27
-#define VALUE_OPT_X509KEYFILE    28
-#define VALUE_OPT_X509CERTFILE   29
-#define VALUE_OPT_PGPSUBKEY      30
-#define VALUE_OPT_SRPUSERNAME    31
-#define VALUE_OPT_SRPPASSWD      32
-#define VALUE_OPT_PSKUSERNAME    129
-#define VALUE_OPT_PSKKEY         130
+#define VALUE_OPT_PRIORITY       23
+#define VALUE_OPT_X509CAFILE     24
+#define VALUE_OPT_X509CRLFILE    25
+#define VALUE_OPT_PGPKEYFILE     26
+#define VALUE_OPT_PGPKEYRING     27
+#define VALUE_OPT_PGPCERTFILE    28
+#define VALUE_OPT_X509KEYFILE    29
+#define VALUE_OPT_X509CERTFILE   30
+#define VALUE_OPT_PGPSUBKEY      31
+#define VALUE_OPT_SRPUSERNAME    32
+#define VALUE_OPT_SRPPASSWD      129
+#define VALUE_OPT_PSKUSERNAME    130
+#define VALUE_OPT_PSKKEY         131
 #define VALUE_OPT_PORT           'p'
-#define VALUE_OPT_INSECURE       132
-#define VALUE_OPT_BENCHMARK_CIPHERS 133
-#define VALUE_OPT_BENCHMARK_SOFT_CIPHERS 134
-#define VALUE_OPT_BENCHMARK_TLS_KX 135
-#define VALUE_OPT_BENCHMARK_TLS_CIPHERS 136
+#define VALUE_OPT_INSECURE       133
+#define VALUE_OPT_BENCHMARK_CIPHERS 134
+#define VALUE_OPT_BENCHMARK_SOFT_CIPHERS 135
+#define VALUE_OPT_BENCHMARK_TLS_KX 136
+#define VALUE_OPT_BENCHMARK_TLS_CIPHERS 137
 #define VALUE_OPT_LIST           'l'
 #define VALUE_OPT_HELP          'h'
 #define VALUE_OPT_MORE_HELP     '!'
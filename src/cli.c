@@ -98,6 +98,7 @@ static gnutls_srp_client_credentials_t srp_cred;
 static gnutls_psk_client_credentials_t psk_cred;
 static gnutls_anon_client_credentials_t anon_cred;
 static gnutls_certificate_credentials_t xcred;
+static gnutls_client_cache_t client_cache = NULL;
 
 /* end of global stuff */
 
@@ -672,6 +673,18 @@ init_tls_session (const char *hostname)
   if (HAVE_OPT(HEARTBEAT))
     gnutls_heartbeat_enable (session, GNUTLS_HB_PEER_ALLOWED_TO_SEND);
 
+  if (client_cache != NULL)
+    {
+      ret = gnutls_session_set_client_cache (session, client_cache, hostname,
+                                             atoi (service));
+      if (ret < 0)
+        {
+          fprintf (stderr, "Error setting the session cache: %s\n",
+                   gnutls_strerror (ret));
+          exit (1);
+        }
+    }
+
 #ifdef ENABLE_DTLS_SRTP
   if (HAVE_OPT(SRTP_PROFILES))
     {
@@ -854,10 +867,14 @@ main (int argc, char **argv)
 
       if (i == 1)
         {
+          /* with the cache the session data are set by the library */
           hd.session = init_tls_session (hostname);
-          gnutls_session_set_data (hd.session, session_data,
-                                   session_data_size);
-          free (session_data);
+          if (client_cache == NULL)
+            {
+              gnutls_session_set_data (hd.session, session_data,
+                                       session_data_size);
+              free (session_data);
+            }
         }
 
       ret = do_handshake (&hd);
@@ -879,11 +896,14 @@ main (int argc, char **argv)
       if (resume != 0 && i == 0)
         {
 
-          gnutls_session_get_data (hd.session, NULL, &session_data_size);
-          session_data = malloc (session_data_size);
+          if (client_cache == NULL)
+            {
+              gnutls_session_get_data (hd.session, NULL, &session_data_size);
+              session_data = malloc (session_data_size);
 
-          gnutls_session_get_data (hd.session, session_data,
-                                   &session_data_size);
+              gnutls_session_get_data (hd.session, session_data,
+                                       &session_data_size);
+            }
 
           gnutls_session_get_id (hd.session, NULL, &session_id_size);
 
@@ -1058,6 +1078,7 @@ after_handshake:
     gnutls_psk_free_client_credentials (psk_cred);
 #endif
 
+  gnutls_client_cache_deinit (client_cache);
   gnutls_certificate_free_credentials (xcred);
 
 #ifdef ENABLE_ANON
@@ -1374,6 +1395,15 @@ init_global_tls_stuff (void)
     }
   gnutls_certificate_set_pin_function(xcred, pin_callback, NULL);
 
+  if (HAVE_OPT(RESUME_CACHE))
+    {
+      if (gnutls_client_cache_init (&client_cache, 0) < 0)
+        {
+          fprintf (stderr, "Session cache allocation memory error\n");
+          exit (1);
+        }
+    }
+
   if (x509_cafile != NULL)
     {
       ret = gnutls_certificate_set_x509_trust_file (xcred,
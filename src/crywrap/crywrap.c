@@ -125,6 +125,8 @@ static const char *pidfile = _CRYWRAP_PIDFILE; /**< File to log our PID
  */
 static gnutls_certificate_server_credentials cred;
 static gnutls_dh_params dh_params; /**< GNUTLS DH parameters. */
+static gnutls_db_shm_cache_t session_cache = NULL; /**< Session cache
+						       shared by the children. */
 static gnutls_datum dh_file = { (void*)_crywrap_prime_dh_1024, sizeof(_crywrap_prime_dh_1024) }; /**< Diffie Hellman parameters */
 
 /** Bugreport address.
@@ -549,6 +551,14 @@ _crywrap_tls_session_create (const crywrap_config_t *config)
   else if (config->verify==2)
     gnutls_certificate_server_set_request (session, GNUTLS_CERT_REQUIRE);
 
+  if (session_cache != NULL)
+    {
+      gnutls_db_set_retrieve_function (session, gnutls_db_shm_cache_retrieve);
+      gnutls_db_set_remove_function (session, gnutls_db_shm_cache_remove);
+      gnutls_db_set_store_function (session, gnutls_db_shm_cache_store);
+      gnutls_db_set_ptr (session, session_cache);
+    }
+
   return session;
 }
 
@@ -1029,6 +1039,14 @@ main (int argc, char **argv, char **envp)
 
   cry_log ("%s", "Crywrap starting...");
 
+  /* Each connection is handled in a forked child; share the
+     resumable sessions among them. */
+  if (gnutls_db_shm_cache_init (&session_cache, NULL, 0, 0, 0) < 0)
+    {
+      cry_log ("%s", "Session cache unavailable; resumption disabled.");
+      session_cache = NULL;
+    }
+
   server_socket = _crywrap_listen (config);
   if (server_socket < 0)
     exit (1);
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * GnuTLS is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GnuTLS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GnuTLS; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Checks that sessions stored in the shared memory cache by a
+ * child process can be retrieved by the parent, and that a named
+ * cache file left incomplete by a dead process is initialized again.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+
+int
+main ()
+{
+  exit (77);
+}
+
+#else
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <gnutls/gnutls.h>
+
+#include "utils.h"
+
+#define SESSIONS 64
+#define SLOTS 32
+
+static void
+make_entry (unsigned int i, unsigned char *key, unsigned char *data,
+            gnutls_datum_t * k, gnutls_datum_t * d)
+{
+  memset (key, 0, 32);
+  key[0] = i;
+  key[31] = i * 7;
+  memset (data, i, 256);
+
+  k->data = key;
+  k->size = 32;
+  d->data = data;
+  d->size = 100 + i;
+}
+
+static void
+check_file (void)
+{
+  gnutls_db_shm_cache_t cache, cache2;
+  unsigned char key[32], data[256];
+  gnutls_datum_t k, d, r;
+  char file[64];
+  FILE *fp;
+  int ret;
+
+  snprintf (file, sizeof (file), "db-shm-cache.%d.tmp", (int) getpid ());
+
+  /* a creator that died before initializing the header */
+  fp = fopen (file, "w");
+  if (fp == NULL)
+    fail ("could not create %s\n", file);
+  memset (data, 0, sizeof (data));
+  fwrite (data, 1, 100, fp);
+  fclose (fp);
+
+  ret = gnutls_db_shm_cache_init (&cache, file, SLOTS, 256, 0);
+  if (ret == GNUTLS_E_UNIMPLEMENTED_FEATURE)
+    {
+      unlink (file);
+      return;
+    }
+  if (ret < 0)
+    fail ("gnutls_db_shm_cache_init: incomplete file: %s\n",
+          gnutls_strerror (ret));
+
+  make_entry (1, key, data, &k, &d);
+  if (gnutls_db_shm_cache_store (cache, k, d) != 0)
+    fail ("could not store in the named cache\n");
+
+  /* attaches to the initialized file */
+  ret = gnutls_db_shm_cache_init (&cache2, file, SLOTS, 256, 0);
+  if (ret < 0)
+    fail ("gnutls_db_shm_cache_init: attach: %s\n", gnutls_strerror (ret));
+
+  r = gnutls_db_shm_cache_retrieve (cache2, k);
+  if (r.data == NULL || r.size != d.size
+      || memcmp (r.data, d.data, d.size) != 0)
+    fail ("the session was not found through the second mapping\n");
+  gnutls_free (r.data);
+  gnutls_db_shm_cache_deinit (cache2);
+
+  /* an initialized file is not reset for other parameters */
+  ret = gnutls_db_shm_cache_init (&cache2, file, SLOTS, 512, 0);
+  if (ret != GNUTLS_E_FILE_ERROR)
+    fail ("attached with another slot size: %d\n", ret);
+
+  r = gnutls_db_shm_cache_retrieve (cache, k);
+  if (r.data == NULL)
+    fail ("the session was lost\n");
+  gnutls_free (r.data);
+
+  gnutls_db_shm_cache_deinit (cache);
+  unlink (file);
+}
+
+void
+doit (void)
+{
+  gnutls_db_shm_cache_t cache;
+  unsigned char key[32], data[256];
+  gnutls_datum_t k, d, r;
+  unsigned int i, found = 0;
+  pid_t child;
+  int ret, status;
+
+  gnutls_global_init ();
+
+  ret = gnutls_db_shm_cache_init (&cache, NULL, SLOTS, 256, 0);
+  if (ret == GNUTLS_E_UNIMPLEMENTED_FEATURE)
+    exit (77);
+  if (ret < 0)
+    fail ("gnutls_db_shm_cache_init: %s\n", gnutls_strerror (ret));
+
+  child = fork ();
+  if (child < 0)
+    fail ("fork\n");
+
+  if (child == 0)
+    {
+      for (i = 0; i < SESSIONS; i++)
+        {
+          make_entry (i, key, data, &k, &d);
+          if (gnutls_db_shm_cache_store (cache, k, d) != 0)
+            _exit (1);
+        }
+      _exit (0);
+    }
+
+  waitpid (child, &status, 0);
+  if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    fail ("child failed to store the sessions\n");
+
+  for (i = 0; i < SESSIONS; i++)
+    {
+      make_entry (i, key, data, &k, &d);
+      r = gnutls_db_shm_cache_retrieve (cache, k);
+      if (r.data == NULL)
+        continue;
+
+      if (r.size != d.size || memcmp (r.data, d.data, d.size) != 0)
+        fail ("session %u was corrupted\n", i);
+      gnutls_free (r.data);
+      found++;
+    }
+
+  if (found == 0 || found > SLOTS)
+    fail ("found %u sessions, expected 1 to %u\n", found, SLOTS);
+
+  /* the last stored session is never evicted */
+  make_entry (SESSIONS - 1, key, data, &k, &d);
+  if (gnutls_db_shm_cache_remove (cache, k) != 0)
+    fail ("could not remove the last session\n");
+
+  r = gnutls_db_shm_cache_retrieve (cache, k);
+  if (r.data != NULL)
+    fail ("removed session was retrieved\n");
+
+  /* too large for a slot */
+  d.size = 257;
+  if (gnutls_db_shm_cache_store (cache, k, d) == 0)
+    fail ("oversized session was stored\n");
+
+  gnutls_db_shm_cache_deinit (cache);
+
+  check_file ();
+
+  gnutls_global_deinit ();
+
+  if (debug)
+    success ("found %u of %u sessions\n", found, SESSIONS);
+}
+
+#endif /* _WIN32 */
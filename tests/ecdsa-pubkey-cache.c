@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * GnuTLS is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GnuTLS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GnuTLS; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Checks that repeated ECDSA verifications with the same key
+ * use the cached public key tables and still give correct results.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gnutls/gnutls.h>
+#include <gnutls/x509.h>
+#include <gnutls/abstract.h>
+#include <gnutls/crypto.h>
+
+#include "utils.h"
+
+static void
+tls_log_func (int level, const char *str)
+{
+  fprintf (stderr, "<%d> %s", level, str);
+}
+
+/* sha1 hash of "hello" string */
+static const gnutls_datum_t hash_data = {
+  (void *)
+    "\xaa\xf4\xc6\x1d\xdc\xc5\xe8\xa2\xda\xbe"
+    "\xde\x0f\x3b\x48\x2c\xd9\xae\xa9\x43\x4d",
+  20
+};
+
+static const gnutls_datum_t invalid_hash_data = {
+  (void *)
+    "\xaa\xf4\xc6\x1d\xdc\xca\xe8\xa2\xda\xbe"
+    "\xde\x0f\x3b\x48\x2c\xb9\xae\xa9\x43\x4d",
+  20
+};
+
+#define VERIFICATIONS 8
+
+void
+doit (void)
+{
+  gnutls_x509_privkey_t key;
+  gnutls_privkey_t privkey;
+  gnutls_pubkey_t pubkey;
+  gnutls_datum_t signature;
+  unsigned int hits, misses, evictions;
+  int ret, i;
+
+  gnutls_global_init ();
+
+  gnutls_global_set_log_function (tls_log_func);
+  if (debug)
+    gnutls_global_set_log_level (6);
+
+  ret = gnutls_x509_privkey_init (&key);
+  if (ret < 0)
+    fail ("gnutls_x509_privkey_init\n");
+
+  ret = gnutls_x509_privkey_generate (key, GNUTLS_PK_EC, 256, 0);
+  if (ret < 0)
+    fail ("gnutls_x509_privkey_generate: %s\n", gnutls_strerror (ret));
+
+  ret = gnutls_privkey_init (&privkey);
+  if (ret < 0)
+    fail ("gnutls_privkey_init\n");
+
+  ret = gnutls_privkey_import_x509 (privkey, key, 0);
+  if (ret < 0)
+    fail ("gnutls_privkey_import_x509\n");
+
+  ret = gnutls_pubkey_init (&pubkey);
+  if (ret < 0)
+    fail ("gnutls_pubkey_init\n");
+
+  ret = gnutls_pubkey_import_privkey (pubkey, privkey, 0, 0);
+  if (ret < 0)
+    fail ("gnutls_pubkey_import_privkey\n");
+
+  ret = gnutls_privkey_sign_hash (privkey, GNUTLS_DIG_SHA1, 0,
+                                  &hash_data, &signature);
+  if (ret < 0)
+    fail ("gnutls_privkey_sign_hash\n");
+
+  gnutls_ecc_pubkey_cache_get_stats (&hits, &misses, &evictions);
+  if (hits != 0 || misses != 0 || evictions != 0)
+    fail ("cache is not empty: %u/%u/%u\n", hits, misses, evictions);
+
+  for (i = 0; i < VERIFICATIONS; i++)
+    {
+      ret = gnutls_pubkey_verify_hash (pubkey, 0, &hash_data, &signature);
+      if (ret < 0)
+        fail ("gnutls_pubkey_verify_hash (%d)\n", i);
+
+      /* should fail */
+      ret = gnutls_pubkey_verify_hash (pubkey, 0, &invalid_hash_data,
+                                       &signature);
+      if (ret != GNUTLS_E_PK_SIG_VERIFY_FAILED)
+        fail ("gnutls_pubkey_verify_hash-2 (%d)\n", i);
+    }
+
+  gnutls_ecc_pubkey_cache_get_stats (&hits, &misses, &evictions);
+  if (debug)
+    success ("hits: %u, misses: %u, evictions: %u\n", hits, misses,
+             evictions);
+
+  if (misses != 1 || hits != 2 * VERIFICATIONS - 1)
+    fail ("unexpected cache statistics: %u hits, %u misses\n", hits, misses);
+
+  gnutls_free (signature.data);
+  gnutls_pubkey_deinit (pubkey);
+  gnutls_privkey_deinit (privkey);
+  gnutls_x509_privkey_deinit (key);
+
+  gnutls_global_deinit ();
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2012 Free Software Foundation, Inc.
+ *
+ * This file is part of GnuTLS.
+ *
+ * GnuTLS is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GnuTLS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GnuTLS; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Checks that the priority strings are parsed once into a global
+ * cache, and that the priorities shared by sessions, either through
+ * gnutls_priority_set() or the cache of gnutls_priority_set_direct(),
+ * are not affected by changes made to a single session. Also checks
+ * that the least recently used strings are evicted once the cache is
+ * full.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gnutls/gnutls.h>
+
+#include "utils.h"
+
+static void
+tls_log_func (int level, const char *str)
+{
+  fprintf (stderr, "<%d> %s", level, str);
+}
+
+#define TLS1_1_ONLY "NORMAL:-VERS-TLS-ALL:+VERS-TLS1.1"
+#define TLS1_2_ONLY "NORMAL:-VERS-TLS-ALL:+VERS-TLS1.2"
+#define SSL3_ONLY "NORMAL:-VERS-TLS-ALL:+VERS-SSL3.0"
+
+#define SESSIONS 4
+
+/* more than the entries of the cache */
+#define FILL_STRINGS 300
+
+/* A distinct valid string for each i < 512.
+ */
+static void
+make_string (char *str, unsigned i)
+{
+  unsigned j;
+
+  strcpy (str, "NORMAL");
+  for (j = 0; j < 9; j++)
+    strcat (str, (i & (1 << j)) ? ":+COMP-NULL" : ":-COMP-NULL");
+}
+
+static void
+check_eviction (void)
+{
+  gnutls_priority_t used, unused, prio;
+  char used_str[128], unused_str[128], str[128];
+  int ret;
+  unsigned i;
+
+  make_string (used_str, 0);
+  make_string (unused_str, 1);
+
+  ret = gnutls_priority_init (&used, used_str, NULL);
+  if (ret < 0)
+    fail ("gnutls_priority_init: %s\n", gnutls_strerror (ret));
+
+  ret = gnutls_priority_init (&unused, unused_str, NULL);
+  if (ret < 0)
+    fail ("gnutls_priority_init: %s\n", gnutls_strerror (ret));
+
+  for (i = 2; i < FILL_STRINGS; i++)
+    {
+      make_string (str, i);
+      ret = gnutls_priority_init (&prio, str, NULL);
+      if (ret < 0)
+        fail ("gnutls_priority_init: %s\n", gnutls_strerror (ret));
+      gnutls_priority_deinit (prio);
+
+      /* keeps it the most recently used */
+      ret = gnutls_priority_init (&prio, used_str, NULL);
+      if (ret < 0)
+        fail ("gnutls_priority_init: %s\n", gnutls_strerror (ret));
+      if (prio != used)
+        fail ("a recently used string was evicted\n");
+      gnutls_priority_deinit (prio);
+    }
+
+  /* we hold a reference, so a new parse cannot reuse its address */
+  ret = gnutls_priority_init (&prio, unused_str, NULL);
+  if (ret < 0)
+    fail ("gnutls_priority_init: %s\n", gnutls_strerror (ret));
+  if (prio == unused)
+    fail ("the least recently used string was not evicted\n");
+  gnutls_priority_deinit (prio);
+
+  gnutls_priority_deinit (unused);
+  gnutls_priority_deinit (used);
+}
+
+void
+doit (void)
+{
+  gnutls_session_t sessions[SESSIONS];
+  gnutls_priority_t prio, prio2;
+  const char *err_pos;
+  int ret, i;
+
+  gnutls_global_init ();
+
+  gnutls_global_set_log_function (tls_log_func);
+  if (debug)
+    gnutls_global_set_log_level (4711);
+
+  for (i = 0; i < SESSIONS; i++)
+    {
+      gnutls_init (&sessions[i], GNUTLS_CLIENT);
+
+      ret = gnutls_priority_set_direct (sessions[i], TLS1_1_ONLY, NULL);
+      if (ret < 0)
+        fail ("gnutls_priority_set_direct (%d): %s\n", i,
+              gnutls_strerror (ret));
+
+      if (gnutls_protocol_get_version (sessions[i]) != GNUTLS_TLS1_1)
+        fail ("session %d: unexpected version\n", i);
+
+      /* modifies the first session only */
+      if (i == 0)
+        {
+          ret = gnutls_priority_set_direct (sessions[i], SSL3_ONLY, NULL);
+          if (ret < 0)
+            fail ("gnutls_priority_set_direct (%d): %s\n", i,
+                  gnutls_strerror (ret));
+          if (gnutls_protocol_get_version (sessions[i]) != GNUTLS_SSL3)
+            fail ("session %d: the version was not set\n", i);
+        }
+    }
+
+  ret = gnutls_priority_set_direct (sessions[1], "NORMAL:+UNKNOWN",
+                                    &err_pos);
+  if (ret != GNUTLS_E_INVALID_REQUEST || strcmp (err_pos, "+UNKNOWN") != 0)
+    fail ("the invalid string was accepted\n");
+
+  /* the same string is parsed once */
+  ret = gnutls_priority_init (&prio, TLS1_2_ONLY, NULL);
+  if (ret < 0)
+    fail ("gnutls_priority_init: %s\n", gnutls_strerror (ret));
+
+  ret = gnutls_priority_init (&prio2, TLS1_2_ONLY, NULL);
+  if (ret < 0)
+    fail ("gnutls_priority_init: %s\n", gnutls_strerror (ret));
+
+  if (prio2 != prio)
+    fail ("the priorities were not found in the cache\n");
+  gnutls_priority_deinit (prio2);
+
+  ret = gnutls_priority_init (&prio2, TLS1_1_ONLY, NULL);
+  if (ret < 0)
+    fail ("gnutls_priority_init: %s\n", gnutls_strerror (ret));
+
+  if (prio2 == prio)
+    fail ("different strings share their priorities\n");
+  gnutls_priority_deinit (prio2);
+
+  /* the same with a priority structure, which is released before
+   * the sessions that use it */
+  gnutls_priority_set (sessions[2], prio);
+  ret = gnutls_priority_set_direct (sessions[2], SSL3_ONLY, NULL);
+  if (ret < 0)
+    fail ("gnutls_priority_set_direct: %s\n", gnutls_strerror (ret));
+  if (gnutls_protocol_get_version (sessions[2]) != GNUTLS_SSL3)
+    fail ("session 2: the version was not set\n");
+
+  gnutls_priority_set (sessions[3], prio);
+  if (gnutls_protocol_get_version (sessions[3]) != GNUTLS_TLS1_2)
+    fail ("session 3: unexpected version\n");
+
+  gnutls_priority_deinit (prio);
+
+  for (i = 0; i < SESSIONS; i++)
+    gnutls_deinit (sessions[i]);
+
+  check_eviction ();
+
+  gnutls_global_deinit ();
+}
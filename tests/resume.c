@@ -58,13 +58,45 @@ struct params_res
   int enable_session_ticket_server;
   int enable_session_ticket_client;
   int expect_resume;
+  int enable_builtin_db;
+  int rotate_ticket_key;
+  int use_client_cache;
 };
 
 pid_t child;
 
+/* The sessions of the client cache expire after CLIENT_CACHE_EXPIRATION
+ * seconds of the client's clock, which advances by CLIENT_CACHE_STEP
+ * per connection. The third connection is past the expiration of the
+ * first session, which resuming it must not have extended.
+ */
+#define CLIENT_CACHE_EXPIRATION 100
+#define CLIENT_CACHE_STEP 60
+
+static time_t client_now;
+
+static time_t
+client_time (time_t * t)
+{
+  if (t)
+    *t = client_now;
+
+  return client_now;
+}
+
+static int
+connections (struct params_res *params)
+{
+  return params->use_client_cache ? 3 : 2;
+}
+
 struct params_res resume_tests[] = {
   {"try to resume from db", 50, 0, 0, 1},
+  {"try to resume from the built-in cache", 0, 0, 0, 1, 1},
   {"try to resume from session ticket", 0, 1, 1, 1},
+  {"try to resume from session ticket after key rotation", 0, 1, 1, 1, 0, 1},
+  {"try to resume from db with the client cache", 50, 0, 0, 1, 0, 0, 1},
+  {"try to resume from session ticket with the client cache", 0, 1, 1, 1, 0, 0, 1},
   {"try to resume from session ticket (server only)", 0, 1, 0, 0},
   {"try to resume from session ticket (client only)", 0, 0, 1, 0},
   {NULL, -1}
@@ -93,8 +125,9 @@ client (struct params_res *params)
 
   /* variables used in session resuming
    */
-  int t;
+  int t, expect_resume;
   gnutls_datum_t session_data;
+  gnutls_client_cache_t client_cache = NULL;
 
   if (debug)
     {
@@ -105,8 +138,18 @@ client (struct params_res *params)
 
   gnutls_anon_allocate_client_credentials (&anoncred);
 
-  for (t = 0; t < 2; t++)
-    {                           /* connect 2 times to the server */
+  if (params->use_client_cache)
+    {
+      ret = gnutls_client_cache_init (&client_cache, 0);
+      if (ret < 0)
+        fail ("client: cache init failed: %s\n", gnutls_strerror (ret));
+
+      client_now = time (0);
+      gnutls_global_set_time_function (client_time);
+    }
+
+  for (t = 0; t < connections (params); t++)
+    {                           /* connect 2 or 3 times to the server */
       /* connect to the peer
        */
       sd = tcp_connect ();
@@ -125,7 +168,19 @@ client (struct params_res *params)
       if (params->enable_session_ticket_client)
         gnutls_session_ticket_enable_client (session);
 
-      if (t > 0)
+      if (client_cache != NULL)
+        {
+          if (t > 0)
+            client_now += CLIENT_CACHE_STEP;
+          gnutls_db_set_cache_expiration (session, CLIENT_CACHE_EXPIRATION);
+
+          ret = gnutls_session_set_client_cache (session, client_cache,
+                                                 "localhost", 5556);
+          if (ret < 0)
+            fail ("client: setting the cache failed: %s\n",
+                  gnutls_strerror (ret));
+        }
+      else if (t > 0)
         {
           /* if this is not the first time we connect */
           gnutls_session_set_data (session, session_data.data,
@@ -154,17 +209,21 @@ client (struct params_res *params)
       if (t == 0)
         {                       /* the first time we connect */
           /* get the session data size */
-          ret = gnutls_session_get_data2 (session, &session_data);
-          if (ret < 0)
-            fail ("Getting resume data failed\n");
+          if (client_cache == NULL)
+            {
+              ret = gnutls_session_get_data2 (session, &session_data);
+              if (ret < 0)
+                fail ("Getting resume data failed\n");
+            }
         }
       else
         {                       /* the second time we connect */
+          expect_resume = params->expect_resume && t < 2;
 
           /* check if we actually resumed the previous session */
           if (gnutls_session_is_resumed (session) != 0)
             {
-              if (params->expect_resume)
+              if (expect_resume)
                 {
                   if (debug)
                     success ("- Previous session was resumed\n");
@@ -174,7 +233,7 @@ client (struct params_res *params)
             }
           else
             {
-              if (params->expect_resume)
+              if (expect_resume)
                 {
                   fail ("*** Previous session was NOT resumed\n");
                 }
@@ -221,6 +280,7 @@ client (struct params_res *params)
     }
 
 end:
+  gnutls_client_cache_deinit (client_cache);
   gnutls_anon_free_client_credentials (anoncred);
 }
 
@@ -234,6 +294,8 @@ end:
 /* These are global */
 gnutls_anon_server_credentials_t anoncred;
 static gnutls_datum_t session_ticket_key = { NULL, 0 };
+static gnutls_db_cache_t builtin_cache = NULL;
+static gnutls_session_ticket_keys_t session_ticket_keys = NULL;
 
 static gnutls_session_t
 initialize_tls_session (struct params_res *params)
@@ -259,8 +321,17 @@ initialize_tls_session (struct params_res *params)
       gnutls_db_set_ptr (session, NULL);
     }
 
+  if (params->enable_builtin_db)
+    gnutls_db_set_cache (session, builtin_cache);
+
   if (params->enable_session_ticket_server)
-    gnutls_session_ticket_enable_server (session, &session_ticket_key);
+    {
+      if (session_ticket_keys)
+        gnutls_session_ticket_enable_server_keys (session,
+                                                  session_ticket_keys);
+      else
+        gnutls_session_ticket_enable_server (session, &session_ticket_key);
+    }
 
   return session;
 }
@@ -374,10 +445,31 @@ server (struct params_res *params)
       wrap_db_init ();
     }
 
+  if (params->enable_builtin_db)
+    {
+      ret = gnutls_db_cache_init (&builtin_cache, 0);
+      if (ret < 0)
+        fail ("server: gnutls_db_cache_init: %s\n", gnutls_strerror (ret));
+    }
+
   if (params->enable_session_ticket_server)
     gnutls_session_ticket_key_generate (&session_ticket_key);
 
-  for (t = 0; t < 2; t++)
+  if (params->rotate_ticket_key)
+    {
+      ret = gnutls_session_ticket_keys_init (&session_ticket_keys, 2);
+      if (ret < 0)
+        fail ("server: gnutls_session_ticket_keys_init: %s\n",
+              gnutls_strerror (ret));
+
+      ret = gnutls_session_ticket_keys_add (session_ticket_keys,
+                                            &session_ticket_key);
+      if (ret < 0)
+        fail ("server: gnutls_session_ticket_keys_add: %s\n",
+              gnutls_strerror (ret));
+    }
+
+  for (t = 0; t < connections (params); t++)
     {
       client_len = sizeof (sa_cli);
 
@@ -437,6 +529,19 @@ server (struct params_res *params)
       close (sd);
 
       gnutls_deinit (session);
+
+      /* the ticket issued above must remain valid after a rotation */
+      if (params->rotate_ticket_key)
+        {
+          gnutls_datum_t new_key;
+
+          gnutls_session_ticket_key_generate (&new_key);
+          ret = gnutls_session_ticket_keys_add (session_ticket_keys, &new_key);
+          gnutls_free (new_key.data);
+          if (ret < 0)
+            fail ("server: gnutls_session_ticket_keys_add: %s\n",
+                  gnutls_strerror (ret));
+        }
     }
 
   close (listen_sd);
@@ -446,6 +551,25 @@ server (struct params_res *params)
       wrap_db_deinit ();
     }
 
+  if (params->enable_builtin_db)
+    {
+      unsigned int hits, misses;
+
+      gnutls_db_cache_get_stats (builtin_cache, &hits, &misses, NULL);
+      if (hits != 1)
+        fail ("server: expected 1 cache hit, got %u (%u misses)\n",
+              hits, misses);
+
+      gnutls_db_cache_deinit (builtin_cache);
+      builtin_cache = NULL;
+    }
+
+  if (params->rotate_ticket_key)
+    {
+      gnutls_session_ticket_keys_deinit (session_ticket_keys);
+      session_ticket_keys = NULL;
+    }
+
   gnutls_free (session_ticket_key.data);
   session_ticket_key.data = NULL;
 
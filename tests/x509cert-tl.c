@@ -192,9 +192,12 @@ doit (void)
 {
   int ret;
   gnutls_datum_t data;
-  gnutls_x509_crt_t server_crt, ca_crt;
+  gnutls_x509_crt_t server_crt, ca_crt, issuer;
+  gnutls_x509_privkey_t pkey;
+  gnutls_x509_crl_t crl;
   gnutls_x509_trust_list_t tl;
   unsigned int status;
+  int i;
 
   /* this must be called once in the program
    */
@@ -230,6 +233,18 @@ doit (void)
   if (ret < 0 || status != 0)
     fail("gnutls_x509_trust_list_verify_crt\n");
 
+  /* the same result is returned from the verification cache */
+  ret = gnutls_x509_trust_list_set_verify_cache(tl, 16);
+  if (ret < 0)
+    fail("gnutls_x509_trust_list_set_verify_cache");
+
+  for (i = 0; i < 2; i++)
+    {
+      ret = gnutls_x509_trust_list_verify_crt(tl, &server_crt, 1, 0, &status, NULL);
+      if (ret < 0 || status != 0)
+        fail("gnutls_x509_trust_list_verify_crt: %d\n", __LINE__);
+    }
+
   ret = gnutls_x509_trust_list_verify_named_crt(tl, server_crt, NAME, NAME_SIZE, 0, &status, NULL);
   if (ret < 0 || status != 0)
     fail("gnutls_x509_trust_list_verify_named_crt: %d\n", __LINE__);
@@ -255,6 +270,86 @@ doit (void)
   if (ret < 1)
     fail("gnutls_x509_trust_list_add_trust_mem: %d (%s)\n", __LINE__, gnutls_strerror(ret));
 
+  /* verified again after the list changed */
+  ret = gnutls_x509_trust_list_verify_crt(tl, &server_crt, 1, 0, &status, NULL);
+  if (ret < 0 || status != 0)
+    fail("gnutls_x509_trust_list_verify_crt: %d\n", __LINE__);
+
+  /* a CRL revoking the cached certificate; its signature is not
+   * checked when added without GNUTLS_TL_VERIFY_CRL */
+  gnutls_x509_privkey_init(&pkey);
+  data.data = server_key_pem;
+  data.size = strlen((char*)server_key_pem);
+  ret = gnutls_x509_privkey_import(pkey, &data, GNUTLS_X509_FMT_PEM);
+  if (ret < 0)
+    fail("gnutls_x509_privkey_import");
+
+  gnutls_x509_crl_init(&crl);
+  gnutls_x509_crl_set_version(crl, 2);
+  gnutls_x509_crl_set_this_update(crl, mytime(0));
+  gnutls_x509_crl_set_next_update(crl, mytime(0) + 3600);
+  ret = gnutls_x509_crl_set_crt(crl, server_crt, mytime(0));
+  if (ret < 0)
+    fail("gnutls_x509_crl_set_crt");
+
+  ret = gnutls_x509_crl_sign2(crl, ca_crt, pkey, GNUTLS_DIG_SHA1, 0);
+  if (ret < 0)
+    fail("gnutls_x509_crl_sign2: %s\n", gnutls_strerror(ret));
+  gnutls_x509_privkey_deinit(pkey);
+
+  ret = gnutls_x509_trust_list_add_crls(tl, &crl, 1, 0, 0);
+  if (ret != 1)
+    fail("gnutls_x509_trust_list_add_crls: %d\n", __LINE__);
+
+  /* the stored result of the previous call is not reused */
+  ret = gnutls_x509_trust_list_verify_crt(tl, &server_crt, 1, 0, &status, NULL);
+  if (ret < 0 || !(status & GNUTLS_CERT_REVOKED))
+    fail("gnutls_x509_trust_list_verify_crt: %d\n", __LINE__);
+
+  gnutls_x509_trust_list_deinit(tl, 1);
+
+  /* a list that starts small, and grows as elements are added */
+  gnutls_x509_trust_list_init(&tl, 1);
+  gnutls_x509_crt_init(&server_crt);
+  gnutls_x509_crt_init(&ca_crt);
+
+  ret = gnutls_x509_crt_import(server_crt, &cert, GNUTLS_X509_FMT_PEM);
+  if (ret < 0)
+    fail("gnutls_x509_crt_import");
+
+  ret = gnutls_x509_crt_import(ca_crt, &ca, GNUTLS_X509_FMT_PEM);
+  if (ret < 0)
+    fail("gnutls_x509_crt_import");
+
+  for (i = 0; i < 8; i++)
+    {
+      data.data = cert_der;
+      data.size = sizeof(cert_der);
+      ret = gnutls_x509_trust_list_add_trust_mem(tl, &data, NULL, GNUTLS_X509_FMT_DER, 0, 0);
+      if (ret < 1)
+        fail("gnutls_x509_trust_list_add_trust_mem: %d (%s)\n", __LINE__, gnutls_strerror(ret));
+    }
+
+  ret = gnutls_x509_trust_list_add_cas(tl, &ca_crt, 1, 0);
+  if (ret < 0)
+    fail("gnutls_x509_trust_list_add_cas");
+
+  ret = gnutls_x509_trust_list_add_named_crt(tl, server_crt, NAME, NAME_SIZE, 0);
+  if (ret < 0)
+    fail("gnutls_x509_trust_list_add_named_crt");
+
+  ret = gnutls_x509_trust_list_get_issuer(tl, server_crt, &issuer, 0);
+  if (ret < 0 || issuer != ca_crt)
+    fail("gnutls_x509_trust_list_get_issuer: %d\n", __LINE__);
+
+  ret = gnutls_x509_trust_list_verify_crt(tl, &server_crt, 1, 0, &status, NULL);
+  if (ret < 0 || status != 0)
+    fail("gnutls_x509_trust_list_verify_crt: %d\n", __LINE__);
+
+  ret = gnutls_x509_trust_list_verify_named_crt(tl, server_crt, NAME, NAME_SIZE, 0, &status, NULL);
+  if (ret < 0 || status != 0)
+    fail("gnutls_x509_trust_list_verify_named_crt: %d\n", __LINE__);
+
   gnutls_x509_trust_list_deinit(tl, 1);
   
   gnutls_global_deinit();